@@ -0,0 +1,300 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audio_spectrum.h"
+
+// esp-dsp picks its fastest FFT for the target (the PIE SIMD one on the
+// ESP32-S3); the scalar FFT below is for host builds or when overridden
+#ifndef AUDIO_SPECTRUM_USE_ESP_DSP
+#ifdef ESP_PLATFORM
+#define AUDIO_SPECTRUM_USE_ESP_DSP 1
+#else
+#define AUDIO_SPECTRUM_USE_ESP_DSP 0
+#endif
+#endif
+
+#if AUDIO_SPECTRUM_USE_ESP_DSP
+#include "esp_heap_caps.h"
+#include "dsps_fft2r.h"
+#endif
+
+// Band powers are compared as log2 in Q4, about 0.19 dB per step
+#define LOG2_Q4_PER_DB(db)  ((int32_t)(db) * 85 / 16)   // 16 / (10 * log10(2)) = 5.3 steps per dB
+
+// A full-scale sine ends up at |X| = 8192 in its bin: the Hann window halves
+// it and the FFT scales by 1/N, so its band power is about 2^26
+#define FULL_SCALE_LOG2_Q4  (26 << 4)
+
+// Bands at or below this stay dark: the reference peak never falls so low
+// that its range would reach under it and amplify the noise floor
+#define GATE_LOG2_Q4        (FULL_SCALE_LOG2_Q4 - LOG2_Q4_PER_DB(60))
+
+// Reference peak fall per frame after a loud passage (about 12 dB/s at 60 frames/s)
+#define PEAK_RELEASE_LOG2_Q4 (1)
+
+struct audio_spectrum_s {
+    audio_spectrum_config_t config;
+    int16_t *fft;                                   // Interleaved re/im work buffer, 16-byte aligned for SIMD loads
+    uint16_t band_start[AUDIO_SPECTRUM_MAX_BANDS + 1]; // First bin of each band; the last entry ends the top band
+    int32_t peak;                                   // Loudest band power, released slowly (log2 Q4)
+    uint8_t levels[AUDIO_SPECTRUM_MAX_BANDS];
+    int16_t tables[];                               // Hann window (Q15), then scalar twiddles (cos, -sin Q15 pairs)
+};
+
+#if AUDIO_SPECTRUM_USE_ESP_DSP
+
+static int16_t *fft_buffer_alloc(size_t bytes)
+{
+    return heap_caps_aligned_calloc(16, 1, bytes, MALLOC_CAP_DEFAULT);
+}
+
+static void fft_buffer_free(int16_t *buffer)
+{
+    heap_caps_free(buffer);
+}
+
+static esp_err_t fft_init(void)
+{
+    // The coefficient table is shared by every size up to the one it is built for
+    static bool initialized = false;
+    if (!initialized) {
+        esp_err_t ret = dsps_fft2r_init_sc16(NULL, AUDIO_SPECTRUM_MAX_FFT_SIZE);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        initialized = true;
+    }
+    return ESP_OK;
+}
+
+static void fft_run(audio_spectrum_t *spectrum)
+{
+    // Scales by 1/2 per stage like the scalar version; the bins come out in bit-reversed order
+    dsps_fft2r_sc16(spectrum->fft, spectrum->config.fft_size);
+    dsps_bit_rev_sc16_ansi(spectrum->fft, spectrum->config.fft_size);
+}
+
+const char *audio_spectrum_backend(void)
+{
+    return "esp-dsp";
+}
+
+#else
+
+static int16_t *fft_buffer_alloc(size_t bytes)
+{
+    int16_t *buffer = aligned_alloc(16, (bytes + 15) & ~(size_t)15);
+    if (buffer) {
+        memset(buffer, 0, bytes);
+    }
+    return buffer;
+}
+
+static void fft_buffer_free(int16_t *buffer)
+{
+    free(buffer);
+}
+
+static esp_err_t fft_init(void)
+{
+    return ESP_OK;
+}
+
+// Radix-2 decimation in time on Q15 complex pairs. Each stage halves its
+// outputs so nothing overflows; the result is the DFT divided by N.
+static void fft_run(audio_spectrum_t *spectrum)
+{
+    int16_t *data = spectrum->fft;
+    const int n = spectrum->config.fft_size;
+    const int16_t *twiddle = spectrum->tables + n;
+    
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+        if (i < j) {
+            int16_t re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+    
+    for (int len = 2; len <= n; len <<= 1) {
+        const int half = len >> 1;
+        const int step = n / len;
+        for (int start = 0; start < n; start += len) {
+            for (int k = 0; k < half; k++) {
+                int16_t *a = &data[2 * (start + k)];
+                int16_t *b = &data[2 * (start + k + half)];
+                int32_t wr = twiddle[2 * k * step], wi = twiddle[2 * k * step + 1];
+                int32_t tr = (b[0] * wr - b[1] * wi) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr) >> 15;
+                int32_t ar = a[0], ai = a[1];
+                a[0] = (int16_t)((ar + tr) >> 1);
+                a[1] = (int16_t)((ai + ti) >> 1);
+                b[0] = (int16_t)((ar - tr) >> 1);
+                b[1] = (int16_t)((ai - ti) >> 1);
+            }
+        }
+    }
+}
+
+const char *audio_spectrum_backend(void)
+{
+    return "scalar";
+}
+
+#endif // AUDIO_SPECTRUM_USE_ESP_DSP
+
+// log2 with a linear mantissa, Q4
+static int32_t log2_q4(uint64_t x)
+{
+    if (x == 0) {
+        return 0;
+    }
+    int msb = 63 - __builtin_clzll(x);
+    uint32_t frac = msb >= 4 ? (uint32_t)(x >> (msb - 4)) : (uint32_t)(x << (4 - msb));
+    return (msb << 4) | (frac & 0xF);
+}
+
+esp_err_t audio_spectrum_new(const audio_spectrum_config_t *config, audio_spectrum_t **ret_spectrum)
+{
+    if (!config || !ret_spectrum) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const int n = config->fft_size;
+    if (n < 64 || n > AUDIO_SPECTRUM_MAX_FFT_SIZE || (n & (n - 1)) ||
+        config->band_count == 0 || config->band_count > AUDIO_SPECTRUM_MAX_BANDS ||
+        config->min_freq_hz == 0 || config->min_freq_hz >= config->max_freq_hz ||
+        config->max_freq_hz > config->sample_rate_hz / 2 || config->range_db == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = fft_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    size_t table_len = AUDIO_SPECTRUM_USE_ESP_DSP ? n : 2 * n;
+    audio_spectrum_t *spectrum = calloc(1, sizeof(audio_spectrum_t) + table_len * sizeof(int16_t));
+    if (!spectrum) {
+        return ESP_ERR_NO_MEM;
+    }
+    spectrum->fft = fft_buffer_alloc(2 * n * sizeof(int16_t));
+    if (!spectrum->fft) {
+        free(spectrum);
+        return ESP_ERR_NO_MEM;
+    }
+    spectrum->config = *config;
+    spectrum->peak = GATE_LOG2_Q4 + LOG2_Q4_PER_DB(config->range_db);
+    
+    const float pi = 3.14159265f;
+    int16_t *window = spectrum->tables;
+    for (int i = 0; i < n; i++) {
+        window[i] = (int16_t)lrintf(32767.0f * 0.5f * (1.0f - cosf(2.0f * pi * i / n)));
+    }
+    if (!AUDIO_SPECTRUM_USE_ESP_DSP) {
+        int16_t *twiddle = spectrum->tables + n;
+        for (int k = 0; k < n / 2; k++) {
+            twiddle[2 * k] = (int16_t)lrintf(32767.0f * cosf(2.0f * pi * k / n));
+            twiddle[2 * k + 1] = (int16_t)lrintf(-32767.0f * sinf(2.0f * pi * k / n));
+        }
+    }
+    
+    // Log-spaced edges rounded to bins; bin 0 (DC) is never used
+    const float ratio = (float)config->max_freq_hz / config->min_freq_hz;
+    for (int b = 0; b <= config->band_count; b++) {
+        float freq = config->min_freq_hz * powf(ratio, (float)b / config->band_count);
+        int bin = (int)lrintf(freq * n / config->sample_rate_hz);
+        int min_bin = b ? spectrum->band_start[b - 1] + 1 : 1;
+        spectrum->band_start[b] = (uint16_t)(bin < min_bin ? min_bin : bin);
+    }
+    if (spectrum->band_start[config->band_count] > n / 2) {
+        audio_spectrum_del(spectrum); // More bands than bins
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *ret_spectrum = spectrum;
+    return ESP_OK;
+}
+
+void audio_spectrum_del(audio_spectrum_t *spectrum)
+{
+    if (spectrum) {
+        fft_buffer_free(spectrum->fft);
+        free(spectrum);
+    }
+}
+
+esp_err_t audio_spectrum_process(audio_spectrum_t *spectrum, const int16_t *samples, uint8_t *levels)
+{
+    if (!spectrum || !samples || !levels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const audio_spectrum_config_t *config = &spectrum->config;
+    const int n = config->fft_size;
+    const int16_t *window = spectrum->tables;
+    int16_t *fft = spectrum->fft;
+    
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    const int32_t dc = sum / n;
+    for (int i = 0; i < n; i++) {
+        int32_t x = samples[i] - dc;
+        x = x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x);
+        fft[2 * i] = (int16_t)((x * window[i]) >> 15);
+        fft[2 * i + 1] = 0;
+    }
+    
+    fft_run(spectrum);
+    
+    int32_t band_log[AUDIO_SPECTRUM_MAX_BANDS];
+    int32_t loudest = 0;
+    for (int b = 0; b < config->band_count; b++) {
+        uint64_t power = 0;
+        for (int k = spectrum->band_start[b]; k < spectrum->band_start[b + 1]; k++) {
+            int32_t re = fft[2 * k], im = fft[2 * k + 1];
+            power += (uint32_t)(re * re) + (uint32_t)(im * im);
+        }
+        band_log[b] = log2_q4(power);
+        if (band_log[b] > loudest) {
+            loudest = band_log[b];
+        }
+    }
+    
+    // Levels are relative to a peak that jumps up and falls back slowly
+    const int32_t range = LOG2_Q4_PER_DB(config->range_db);
+    if (loudest > spectrum->peak) {
+        spectrum->peak = loudest;
+    } else if (spectrum->peak - PEAK_RELEASE_LOG2_Q4 >= GATE_LOG2_Q4 + range) {
+        spectrum->peak -= PEAK_RELEASE_LOG2_Q4;
+    }
+    const int32_t floor = spectrum->peak - range;
+    
+    for (int b = 0; b < config->band_count; b++) {
+        int32_t level = band_log[b] <= floor ? 0 : (band_log[b] - floor) * 255 / range;
+        if (level > 255) {
+            level = 255;
+        }
+        int32_t fallen = spectrum->levels[b] - config->decay;
+        if (level < fallen) {
+            level = fallen;
+        }
+        spectrum->levels[b] = (uint8_t)level;
+        levels[b] = (uint8_t)level;
+    }
+    return ESP_OK;
+}
+
+void audio_spectrum_run_fft(audio_spectrum_t *spectrum)
+{
+    fft_run(spectrum);
+}
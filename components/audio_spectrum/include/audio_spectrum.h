@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Largest supported FFT size (points)
+ */
+#define AUDIO_SPECTRUM_MAX_FFT_SIZE (1024)
+
+/**
+ * @brief Largest supported number of bands
+ */
+#define AUDIO_SPECTRUM_MAX_BANDS (16)
+
+/**
+ * @brief Analyzer configuration
+ *
+ * Bands are spaced logarithmically between min_freq_hz and max_freq_hz, so
+ * each one covers the same number of octaves. Every band gets at least one
+ * FFT bin, which makes the lowest bands wider than that at small FFT sizes.
+ */
+typedef struct {
+    uint32_t sample_rate_hz;    /*!< Rate of the samples passed to audio_spectrum_process */
+    uint16_t fft_size;          /*!< Samples per frame, a power of two from 64 to AUDIO_SPECTRUM_MAX_FFT_SIZE */
+    uint8_t band_count;         /*!< Bands reported, 1 to AUDIO_SPECTRUM_MAX_BANDS */
+    uint16_t min_freq_hz;       /*!< Lower edge of the first band */
+    uint16_t max_freq_hz;       /*!< Upper edge of the last band, at most sample_rate_hz / 2 */
+    uint8_t range_db;           /*!< Dynamic range below the loudest band that maps onto levels 1-255 */
+    uint8_t decay;              /*!< Level fall per frame; rises are immediate */
+} audio_spectrum_config_t;
+
+/**
+ * @brief Default configuration: 256-point frames, 8 bands from 60 Hz to half the sample rate
+ */
+#define AUDIO_SPECTRUM_DEFAULT_CONFIG(rate)    \
+    {                                           \
+        .sample_rate_hz = rate,                 \
+        .fft_size = 256,                        \
+        .band_count = 8,                        \
+        .min_freq_hz = 60,                      \
+        .max_freq_hz = (rate) / 2,              \
+        .range_db = 36,                         \
+        .decay = 12,                            \
+    }
+
+/**
+ * @brief Spectrum analyzer
+ */
+typedef struct audio_spectrum_s audio_spectrum_t;
+
+/**
+ * @brief Create an analyzer
+ *
+ * Window, twiddle and band tables are built here; processing a frame only
+ * uses integer arithmetic.
+ *
+ * @param config: Analyzer configuration
+ * @param ret_spectrum: Receives the analyzer
+ * @return
+ *      - ESP_OK: Analyzer created
+ *      - ESP_ERR_INVALID_ARG: Invalid configuration
+ *      - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t audio_spectrum_new(const audio_spectrum_config_t *config, audio_spectrum_t **ret_spectrum);
+
+/**
+ * @brief Delete an analyzer
+ *
+ * @param spectrum: Analyzer
+ */
+void audio_spectrum_del(audio_spectrum_t *spectrum);
+
+/**
+ * @brief Analyze one frame of samples
+ *
+ * The frame's DC offset is removed and a Hann window applied before the
+ * FFT. Band powers are compared in the log domain against a slowly falling
+ * peak, so the levels follow the music rather than the input gain. Input
+ * quieter than about -60 dBFS leaves every band at 0.
+ *
+ * @param spectrum: Analyzer
+ * @param samples: fft_size signed 16-bit samples
+ * @param levels: Receives band_count levels, 0-255, lowest band first
+ * @return
+ *      - ESP_OK: Levels updated
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ */
+esp_err_t audio_spectrum_process(audio_spectrum_t *spectrum, const int16_t *samples, uint8_t *levels);
+
+/**
+ * @brief Run the FFT alone on the analyzer's work buffer
+ *
+ * For benchmarks: this is the part the SIMD backend accelerates. The
+ * result is discarded; the next audio_spectrum_process refills the buffer.
+ *
+ * @param spectrum: Analyzer
+ */
+void audio_spectrum_run_fft(audio_spectrum_t *spectrum);
+
+/**
+ * @brief Name of the FFT implementation compiled in
+ *
+ * @return "esp-dsp" (PIE SIMD on ESP32-S3) or "scalar"
+ */
+const char *audio_spectrum_backend(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,333 @@
+// Run the audio spectrum analyzer over a WAV file on the host.
+//
+// Builds the component with its portable scalar FFT, so the band levels can
+// be checked without a board, and times the FFT for comparison with the
+// device's "audio bench" console command.
+//
+//     cc -O2 -I../../../tools/host -I../include -o spectrum_wav spectrum_wav.c ../audio_spectrum.c -lm
+//     ./spectrum_wav --check                   synthesized tones, see below
+//     ./spectrum_wav music.wav                 one bar graph line per frame
+//     ./spectrum_wav music.wav --csv           band levels as CSV
+//     ./spectrum_wav tone.wav --expect-band 3  exit 1 unless band 3 is the loudest on average
+//     ./spectrum_wav music.wav --bench 20000   FFT and analysis frames per second
+//
+// --check needs no recordings: for several rates, FFT sizes and band counts
+// it synthesizes a -6 dBFS sine in the middle of each band, on the band
+// edges the header documents, and the band must be the loudest on average.
+// Silence must leave every band at 0. Exits 1 if a tone lands in another
+// band or silence lights one up.
+//
+// Input must be 16-bit PCM; stereo is mixed down to mono.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "audio_spectrum.h"
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+#define CHECK_FRAMES    16      // Frames of each synthesized signal
+
+static int failures = 0;
+
+typedef struct {
+    uint32_t sample_rate;
+    size_t count;
+    int16_t *samples;
+} wav_t;
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static int wav_load(const char *path, wav_t *wav)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *file = malloc(size);
+    if (!file || fread(file, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(file);
+        return -1;
+    }
+    fclose(f);
+    
+    if (size < 12 || memcmp(file, "RIFF", 4) || memcmp(file + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        free(file);
+        return -1;
+    }
+    
+    uint16_t format = 0, channels = 0, bits = 0;
+    const uint8_t *data = NULL;
+    uint32_t data_len = 0;
+    for (long pos = 12; pos + 8 <= size;) {
+        uint32_t len = le32(file + pos + 4);
+        const uint8_t *body = file + pos + 8;
+        if (len > size - pos - 8) {
+            len = size - pos - 8; // Truncated recording: use what is there
+        }
+        if (!memcmp(file + pos, "fmt ", 4) && len >= 16) {
+            format = le16(body);
+            channels = le16(body + 2);
+            wav->sample_rate = le32(body + 4);
+            bits = le16(body + 14);
+        } else if (!memcmp(file + pos, "data", 4)) {
+            data = body;
+            data_len = len;
+        }
+        pos += 8 + len + (len & 1);
+    }
+    if (format != 1 || bits != 16 || channels == 0 || !data) {
+        fprintf(stderr, "%s: need 16-bit PCM (format %u, %u bits)\n", path, format, bits);
+        free(file);
+        return -1;
+    }
+    
+    wav->count = data_len / (2 * channels);
+    wav->samples = malloc(wav->count * sizeof(int16_t));
+    for (size_t i = 0; i < wav->count; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += (int16_t)le16(data + 2 * (i * channels + c));
+        }
+        wav->samples[i] = (int16_t)(sum / channels);
+    }
+    free(file);
+    return 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Sum the levels of every frame of samples; returns the loudest band
+static int analyze(audio_spectrum_t *spectrum, const int16_t *samples, int fft_size, int bands, size_t frames,
+                   uint64_t *totals)
+{
+    memset(totals, 0, bands * sizeof(totals[0]));
+    for (size_t frame = 0; frame < frames; frame++) {
+        uint8_t levels[AUDIO_SPECTRUM_MAX_BANDS];
+        audio_spectrum_process(spectrum, samples + frame * fft_size, levels);
+        for (int b = 0; b < bands; b++) {
+            totals[b] += levels[b];
+        }
+    }
+    int loudest = 0;
+    for (int b = 1; b < bands; b++) {
+        if (totals[b] > totals[loudest]) {
+            loudest = b;
+        }
+    }
+    return loudest;
+}
+
+// One synthesized signal through a fresh analyzer, so no level or peak
+// carries over from the previous one; returns the loudest band, -1 on error
+static int analyze_signal(const audio_spectrum_config_t *config, const int16_t *samples, uint64_t *totals)
+{
+    audio_spectrum_t *spectrum;
+    if (audio_spectrum_new(config, &spectrum) != ESP_OK) {
+        return -1;
+    }
+    int loudest = analyze(spectrum, samples, config->fft_size, config->band_count, CHECK_FRAMES, totals);
+    audio_spectrum_del(spectrum);
+    return loudest;
+}
+
+// Tones in the middle of every band, on the edges audio_spectrum.h
+// describes: log-spaced, rounded to bins, at least one bin per band
+static void check_tones(uint32_t rate, int fft_size, int bands)
+{
+    audio_spectrum_config_t config = AUDIO_SPECTRUM_DEFAULT_CONFIG(rate);
+    config.fft_size = fft_size;
+    config.band_count = bands;
+    
+    int edges[AUDIO_SPECTRUM_MAX_BANDS + 1];
+    const float ratio = (float)config.max_freq_hz / config.min_freq_hz;
+    for (int b = 0; b <= bands; b++) {
+        int bin = (int)lrintf(config.min_freq_hz * powf(ratio, (float)b / bands) * fft_size / rate);
+        int min_bin = b ? edges[b - 1] + 1 : 1;
+        edges[b] = bin < min_bin ? min_bin : bin;
+    }
+    
+    size_t count = (size_t)fft_size * CHECK_FRAMES;
+    int16_t *samples = calloc(count, sizeof(int16_t));
+    uint64_t totals[AUDIO_SPECTRUM_MAX_BANDS];
+    printf("  %5u Hz %4d-point %2d bands:", rate, fft_size, bands);
+    for (int b = 0; b < bands; b++) {
+        double freq = (edges[b] + edges[b + 1] - 1) / 2.0 * rate / fft_size;
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = (int16_t)lrint(16384.0 * sin(2.0 * M_PI * freq * i / rate));
+        }
+        int loudest = analyze_signal(&config, samples, totals);
+        printf(" %.0f", freq);
+        CHECK(loudest == b, "%u Hz, %d-point, %d bands: %.0f Hz tone loudest in band %d, expected %d", rate, fft_size, bands,
+              freq, loudest, b);
+    }
+    printf(" Hz\n");
+    
+    memset(samples, 0, count * sizeof(int16_t));
+    uint64_t sum = 0;
+    if (analyze_signal(&config, samples, totals) >= 0) {
+        for (int b = 0; b < bands; b++) {
+            sum += totals[b];
+        }
+    }
+    CHECK(sum == 0, "%u Hz, %d-point: silence gave levels (sum %llu)", rate, fft_size, (unsigned long long)sum);
+    free(samples);
+}
+
+static int run_checks(void)
+{
+    static const struct {
+        uint32_t rate;
+        int fft_size;
+        int bands;
+    } configs[] = {
+        { 16000, 256, 8 },      // The application's microphone setup
+        { 16000, 64, 4 },
+        { 16000, 512, 16 },
+        { 44100, 1024, 16 },
+        { 48000, 256, 8 },
+    };
+    printf("tones\n");
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        check_tones(configs[c].rate, configs[c].fft_size, configs[c].bands);
+    }
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s --check\n"
+            "       %s file.wav [--fft N] [--bands N] [--csv] [--expect-band B] [--bench FRAMES]\n", prog, prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--check")) {
+        return run_checks();
+    }
+    if (argc < 2) {
+        usage(argv[0]);
+    }
+    int fft_size = 256, bands = 8, expect_band = -1, bench = 0;
+    int csv = 0;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--csv")) {
+            csv = 1;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--fft")) {
+            fft_size = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--bands")) {
+            bands = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--expect-band")) {
+            expect_band = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--bench")) {
+            bench = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    
+    wav_t wav = { 0 };
+    if (wav_load(argv[1], &wav) != 0) {
+        return 2;
+    }
+    
+    audio_spectrum_config_t config = AUDIO_SPECTRUM_DEFAULT_CONFIG(wav.sample_rate);
+    config.fft_size = fft_size;
+    config.band_count = bands;
+    audio_spectrum_t *spectrum;
+    if (audio_spectrum_new(&config, &spectrum) != ESP_OK) {
+        fprintf(stderr, "invalid analyzer configuration for %u Hz\n", wav.sample_rate);
+        return 2;
+    }
+    
+    size_t frames = wav.count / fft_size;
+    if (frames == 0) {
+        fprintf(stderr, "%s: shorter than one %d-sample frame\n", argv[1], fft_size);
+        return 2;
+    }
+    
+    if (bench > 0) {
+        uint8_t levels[AUDIO_SPECTRUM_MAX_BANDS];
+        audio_spectrum_process(spectrum, wav.samples, levels);
+        double start = now_s();
+        for (int i = 0; i < bench; i++) {
+            audio_spectrum_run_fft(spectrum);
+        }
+        double fft_s = now_s() - start;
+        start = now_s();
+        for (int i = 0; i < bench; i++) {
+            audio_spectrum_process(spectrum, wav.samples + (i % frames) * fft_size, levels);
+        }
+        double process_s = now_s() - start;
+        printf("%s FFT %d: %.0f frames/s (%.2f us), full analysis %.0f frames/s (%.2f us)\n",
+               audio_spectrum_backend(), fft_size, bench / fft_s, fft_s * 1e6 / bench,
+               bench / process_s, process_s * 1e6 / bench);
+        return 0;
+    }
+    
+    uint64_t totals[AUDIO_SPECTRUM_MAX_BANDS] = { 0 };
+    for (size_t frame = 0; frame < frames; frame++) {
+        uint8_t levels[AUDIO_SPECTRUM_MAX_BANDS];
+        audio_spectrum_process(spectrum, wav.samples + frame * fft_size, levels);
+        double t = (double)frame * fft_size / wav.sample_rate;
+        if (csv) {
+            printf("%.3f", t);
+        } else {
+            printf("%7.3f ", t);
+        }
+        for (int b = 0; b < bands; b++) {
+            totals[b] += levels[b];
+            if (csv) {
+                printf(",%u", levels[b]);
+            } else {
+                static const char bars[] = " .:-=+*#%@";
+                putchar(bars[levels[b] * 9 / 255]);
+            }
+        }
+        putchar('\n');
+    }
+    
+    if (expect_band >= 0) {
+        int loudest = 0;
+        for (int b = 1; b < bands; b++) {
+            if (totals[b] > totals[loudest]) {
+                loudest = b;
+            }
+        }
+        fprintf(stderr, "loudest band %d, expected %d\n", loudest, expect_band);
+        return loudest == expect_band ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include <string.h>
+#include "dmx_net.h"
+
+// E1.31 data packet layout (ANSI E1.31-2018, table 4-1); big endian
+#define E131_PREAMBLE_SIZE          0x0010
+#define E131_ROOT_VECTOR_DATA       0x00000004
+#define E131_ROOT_VECTOR_EXTENDED   0x00000008
+#define E131_FRAMING_VECTOR_DATA    0x00000002
+#define E131_EXTENDED_VECTOR_SYNC   0x00000001
+#define E131_DMP_VECTOR_SET         0x02
+#define E131_DMP_ADDRESS_DATA_TYPE  0xA1
+#define E131_ROOT_HEADER_LEN        38
+#define E131_DATA_HEADER_LEN        126     // Up to and including the start code
+#define E131_SYNC_PACKET_LEN        49
+#define E131_OPTION_PREVIEW         0x80    // Visualizer data, not for output
+#define E131_OPTION_TERMINATED      0x40    // Source is stopping this universe
+
+// Art-Net: "Art-Net\0", opcode (little endian), protocol version (big endian)
+#define ARTNET_OP_DMX               0x5000
+#define ARTNET_OP_SYNC              0x5200
+#define ARTNET_HEADER_LEN           12
+#define ARTNET_DMX_HEADER_LEN       18
+
+// Packets this far behind the last sequence number are late; anything
+// further back is a restarted source (E1.31 6.7.2, also used for Art-Net)
+#define SEQUENCE_WINDOW             20
+
+#define DMX_CHANNELS                512
+
+static uint16_t be16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static int find_universe(const dmx_net_t *net, uint16_t universe)
+{
+    for (int i = 0; i < net->universe_count; i++) {
+        if (net->universes[i].universe == universe) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool dmx_net_init(dmx_net_t *net, const dmx_net_config_t *config, const dmx_net_mapping_t *mappings, size_t count,
+                  const dmx_net_callbacks_t *callbacks)
+{
+    memset(net, 0, sizeof(*net));
+    net->config = *config;
+    if (callbacks) {
+        net->callbacks = *callbacks;
+    }
+    if (count > DMX_NET_MAX_MAPPINGS) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        const dmx_net_mapping_t *mapping = &mappings[i];
+        if (mapping->channel < 1 || mapping->channel > DMX_CHANNELS || mapping->strip >= DMX_NET_MAX_STRIPS) {
+            return false;
+        }
+        int u = find_universe(net, mapping->universe);
+        if (u < 0) {
+            if (net->universe_count == DMX_NET_MAX_UNIVERSES) {
+                return false;
+            }
+            u = net->universe_count++;
+            net->universes[u].universe = mapping->universe;
+            net->all_universes |= 1u << u;
+        }
+        net->mappings[i] = *mapping;
+        net->mapping_universe[i] = (uint8_t)u;
+    }
+    net->mapping_count = (uint8_t)count;
+    return true;
+}
+
+// Show whatever has been written since the last frame
+static uint32_t end_frame(dmx_net_t *net)
+{
+    if (net->pending == 0) {
+        return 0;
+    }
+    bool complete = net->pending == net->all_universes;
+    uint32_t strips = net->pending_strips;
+    net->pending = 0;
+    net->pending_strips = 0;
+    net->stats.frames++;
+    if (!complete) {
+        net->stats.partial_frames++;
+    }
+    if (net->callbacks.frame_end) {
+        net->callbacks.frame_end(net->callbacks.ctx, strips, complete);
+    }
+    return 1;
+}
+
+static bool sequence_ok(dmx_net_universe_t *universe, dmx_net_protocol_t protocol, uint8_t sequence)
+{
+    uint8_t bit = 1 << protocol;
+    if (universe->sequence_valid & bit) {
+        int8_t diff = (int8_t)(sequence - universe->sequence[protocol]);
+        if (diff <= 0 && diff > -SEQUENCE_WINDOW) {
+            return false;
+        }
+    }
+    universe->sequence[protocol] = sequence;
+    universe->sequence_valid |= bit;
+    return true;
+}
+
+static bool is_synced(dmx_net_t *net, dmx_net_protocol_t protocol, uint32_t now_ms)
+{
+    uint8_t bit = 1 << protocol;
+    if ((net->synced & bit) && now_ms - net->last_sync_ms[protocol] > net->config.sync_timeout_ms) {
+        net->synced &= ~bit;
+    }
+    return net->synced & bit;
+}
+
+static void on_sync(dmx_net_t *net, dmx_net_protocol_t protocol, uint32_t now_ms)
+{
+    net->stats.sync_packets++;
+    net->synced |= 1 << protocol;
+    net->last_sync_ms[protocol] = now_ms;
+}
+
+// Universe data: copy each mapped pixel run straight into its strip buffer
+static uint32_t on_data(dmx_net_t *net, dmx_net_protocol_t protocol, uint16_t universe, bool check_sequence,
+                        uint8_t sequence, bool synced, const uint8_t *data, uint32_t channels, uint32_t now_ms)
+{
+    int u = find_universe(net, universe);
+    if (u < 0) {
+        net->stats.ignored_packets++;
+        return 0;
+    }
+    if (check_sequence && !sequence_ok(&net->universes[u], protocol, sequence)) {
+        net->stats.sequence_drops++;
+        return 0;
+    }
+    
+    uint32_t ended = 0;
+    uint32_t bit = 1u << u;
+    if (!synced && (net->pending & bit)) {
+        // Back round to this universe before the others arrived: show what there is
+        ended += end_frame(net);
+    }
+    if (net->pending == 0) {
+        net->frame_start_ms = now_ms;
+        if (net->callbacks.frame_begin) {
+            net->callbacks.frame_begin(net->callbacks.ctx);
+        }
+    }
+    
+    for (int i = 0; i < net->mapping_count; i++) {
+        if (net->mapping_universe[i] != u) {
+            continue;
+        }
+        const dmx_net_mapping_t *mapping = &net->mappings[i];
+        uint32_t first = mapping->channel - 1;
+        if (first >= channels) {
+            continue;
+        }
+        uint32_t count = (channels - first) / 3;
+        if (count > mapping->pixel_count) {
+            count = mapping->pixel_count;
+        }
+        const uint8_t *src = data + first;
+        uint8_t *dst = mapping->buffer;
+        const uint8_t r = mapping->offset[0], g = mapping->offset[1], b = mapping->offset[2];
+        for (uint32_t p = 0; p < count; p++) {
+            dst[r] = src[0];
+            dst[g] = src[1];
+            dst[b] = src[2];
+            src += 3;
+            dst += mapping->bytes_per_pixel;
+        }
+        net->pending_strips |= 1u << mapping->strip;
+    }
+    net->pending |= bit;
+    
+    // Synchronized data waits for the sync packet even when complete
+    if (!synced && net->pending == net->all_universes) {
+        ended += end_frame(net);
+    }
+    return ended;
+}
+
+static uint32_t feed_e131(dmx_net_t *net, const uint8_t *p, size_t len, uint32_t now_ms)
+{
+    uint32_t root_vector = be32(p + 18);
+    
+    if (root_vector == E131_ROOT_VECTOR_EXTENDED) {
+        if (len < E131_SYNC_PACKET_LEN || be32(p + 40) != E131_EXTENDED_VECTOR_SYNC) {
+            net->stats.ignored_packets++; // Universe discovery
+            return 0;
+        }
+        uint16_t sync_address = be16(p + 45);
+        if (sync_address == 0 || sync_address != net->e131_sync_address) {
+            net->stats.ignored_packets++;
+            return 0;
+        }
+        on_sync(net, DMX_NET_E131, now_ms);
+        return end_frame(net);
+    }
+    
+    if (root_vector != E131_ROOT_VECTOR_DATA || len < E131_DATA_HEADER_LEN ||
+        be32(p + 40) != E131_FRAMING_VECTOR_DATA || p[117] != E131_DMP_VECTOR_SET ||
+        p[118] != E131_DMP_ADDRESS_DATA_TYPE || be16(p + 119) != 0 || be16(p + 121) != 1) {
+        net->stats.bad_packets++;
+        return 0;
+    }
+    uint32_t count = be16(p + 123); // Start code plus channels
+    if (count < 1 || 125 + count > len) {
+        net->stats.bad_packets++;
+        return 0;
+    }
+    
+    uint16_t sync_address = be16(p + 109);
+    uint8_t sequence = p[111];
+    uint8_t options = p[112];
+    uint16_t universe = be16(p + 113);
+    
+    if (options & E131_OPTION_TERMINATED) {
+        // A restarted source may begin at any sequence number
+        int u = find_universe(net, universe);
+        if (u >= 0) {
+            net->universes[u].sequence_valid &= ~(1 << DMX_NET_E131);
+        }
+        net->stats.ignored_packets++;
+        return 0;
+    }
+    if ((options & E131_OPTION_PREVIEW) || p[125] != 0) {
+        net->stats.ignored_packets++; // Preview data, or an alternate start code such as per-channel priority
+        return 0;
+    }
+    
+    // Data names its sync universe; it waits for sync once that has been seen
+    bool synced = false;
+    if (sync_address != 0) {
+        if (sync_address != net->e131_sync_address) {
+            net->e131_sync_address = sync_address;
+            net->synced &= ~(1 << DMX_NET_E131);
+        }
+        synced = is_synced(net, DMX_NET_E131, now_ms);
+    }
+    
+    uint32_t channels = count - 1;
+    if (channels > DMX_CHANNELS) {
+        channels = DMX_CHANNELS;
+    }
+    return on_data(net, DMX_NET_E131, universe, true, sequence, synced, p + E131_DATA_HEADER_LEN, channels, now_ms);
+}
+
+static uint32_t feed_artnet(dmx_net_t *net, const uint8_t *p, size_t len, uint32_t now_ms)
+{
+    uint16_t opcode = p[8] | p[9] << 8;
+    
+    if (opcode == ARTNET_OP_SYNC) {
+        on_sync(net, DMX_NET_ARTNET, now_ms);
+        return end_frame(net);
+    }
+    if (opcode != ARTNET_OP_DMX) {
+        net->stats.ignored_packets++; // ArtPoll and the rest
+        return 0;
+    }
+    
+    uint32_t channels = len >= ARTNET_DMX_HEADER_LEN ? be16(p + 16) : 0;
+    if (channels < 2 || channels > DMX_CHANNELS || ARTNET_DMX_HEADER_LEN + channels > len) {
+        net->stats.bad_packets++;
+        return 0;
+    }
+    
+    uint8_t sequence = p[12];
+    uint16_t port_address = (uint16_t)((p[15] & 0x7F) << 8 | p[14]);
+    uint16_t universe = port_address + net->config.artnet_universe_offset;
+    bool synced = is_synced(net, DMX_NET_ARTNET, now_ms);
+    
+    // Sequence 0 means the sender does not number its packets
+    return on_data(net, DMX_NET_ARTNET, universe, sequence != 0, sequence, synced,
+                   p + ARTNET_DMX_HEADER_LEN, channels, now_ms);
+}
+
+uint32_t dmx_net_feed(dmx_net_t *net, const uint8_t *packet, size_t len, uint32_t now_ms)
+{
+    static const uint8_t acn_id[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    static const uint8_t artnet_id[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+    
+    net->stats.packets++;
+    if (len >= E131_ROOT_HEADER_LEN && be16(packet) == E131_PREAMBLE_SIZE && be16(packet + 2) == 0 &&
+        memcmp(packet + 4, acn_id, sizeof(acn_id)) == 0) {
+        return feed_e131(net, packet, len, now_ms);
+    }
+    if (len >= ARTNET_HEADER_LEN && memcmp(packet, artnet_id, sizeof(artnet_id)) == 0) {
+        return feed_artnet(net, packet, len, now_ms);
+    }
+    net->stats.bad_packets++;
+    return 0;
+}
+
+bool dmx_net_tick(dmx_net_t *net, uint32_t now_ms)
+{
+    // Re-evaluated so a lost sync stream falls back to the frame timeout
+    bool synced = is_synced(net, DMX_NET_E131, now_ms) | is_synced(net, DMX_NET_ARTNET, now_ms);
+    uint32_t timeout_ms = synced ? net->config.sync_timeout_ms : net->config.frame_timeout_ms;
+    
+    if (net->pending && now_ms - net->frame_start_ms > timeout_ms) {
+        return end_frame(net) > 0;
+    }
+    return false;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DMX_NET_E131_PORT       (5568)  /*!< UDP port of E1.31 (sACN) */
+#define DMX_NET_ARTNET_PORT     (6454)  /*!< UDP port of Art-Net */
+#define DMX_NET_PACKET_MAX      (638)   /*!< Largest packet either protocol sends (E1.31 with 512 channels) */
+#define DMX_NET_MAX_MAPPINGS    (16)    /*!< Strip regions per receiver */
+#define DMX_NET_MAX_UNIVERSES   (16)    /*!< Distinct universes per receiver */
+#define DMX_NET_MAX_STRIPS      (32)    /*!< Strip indices reported in a frame mask */
+
+/**
+ * @brief DMX-over-IP protocols understood by the parser
+ *
+ * E1.31 (sACN): ANSI E1.31-2018 data and universe synchronization packets.
+ * Art-Net:      ArtDmx and ArtSync; other opcodes are ignored.
+ */
+typedef enum {
+    DMX_NET_E131,
+    DMX_NET_ARTNET,
+} dmx_net_protocol_t;
+
+/**
+ * @brief Channels of one universe mapped onto a run of strip pixels
+ *
+ * Pixel i takes channels channel + 3i to channel + 3i + 2 as red, green and
+ * blue, and is written straight into the strip buffer in wire order.
+ */
+typedef struct {
+    uint16_t universe;          /*!< E1.31 universe; Art-Net port-address plus dmx_net_config_t::artnet_universe_offset */
+    uint16_t channel;           /*!< DMX channel (1-512) of the first pixel's red */
+    uint8_t *buffer;            /*!< First pixel in the strip buffer (see led_strip_t::get_buffer) */
+    uint16_t pixel_count;       /*!< Pixels; those past channel 512 are never written */
+    uint8_t bytes_per_pixel;    /*!< Stride between pixels */
+    uint8_t offset[3];          /*!< Byte offset of red, green and blue within a pixel */
+    uint8_t strip;              /*!< Strip index reported to frame_end, below DMX_NET_MAX_STRIPS */
+} dmx_net_mapping_t;
+
+/**
+ * @brief Receiver configuration
+ */
+typedef struct {
+    uint16_t artnet_universe_offset;    /*!< Added to Art-Net port-addresses; 1 makes port-address 0 universe 1 */
+    uint32_t frame_timeout_ms;          /*!< Unsynchronized: show a frame missing universes after this long */
+    uint32_t sync_timeout_ms;           /*!< Sync packets missing this long: fall back to unsynchronized frames */
+} dmx_net_config_t;
+
+/**
+ * @brief Default configuration
+ *
+ * The sync timeout follows E1.31's 2.5 s; Art-Net specifies 4 s, but a
+ * console that stops syncing has usually stopped sending altogether.
+ */
+#define DMX_NET_DEFAULT_CONFIG()            \
+    {                                       \
+        .artnet_universe_offset = 1,        \
+        .frame_timeout_ms = 40,             \
+        .sync_timeout_ms = 2500,            \
+    }
+
+/**
+ * @brief Frame callbacks, called from dmx_net_feed and dmx_net_tick
+ */
+typedef struct {
+    void (*frame_begin)(void *ctx);     /*!< A new frame is about to be written; earlier refreshes must be done with the buffers */
+    void (*frame_end)(void *ctx, uint32_t strips, bool complete); /*!< Frame ready; strips has a bit per strip written, complete is false when universes are missing */
+    void *ctx;
+} dmx_net_callbacks_t;
+
+/**
+ * @brief Receiver counters
+ */
+typedef struct {
+    uint32_t packets;           /*!< Datagrams fed */
+    uint32_t frames;            /*!< Frames ended */
+    uint32_t partial_frames;    /*!< Frames shown with universes missing, after a timeout or a universe repeating */
+    uint32_t sync_packets;      /*!< E1.31 sync and ArtSync packets */
+    uint32_t sequence_drops;    /*!< Data packets older than the last one of their universe */
+    uint32_t bad_packets;       /*!< Malformed or unsupported packets */
+    uint32_t ignored_packets;   /*!< Unmapped universes, preview data, other opcodes and start codes */
+} dmx_net_stats_t;
+
+/**
+ * @brief Per-universe receive state
+ */
+typedef struct {
+    uint16_t universe;
+    uint8_t sequence[2];        /*!< Last sequence number per protocol */
+    uint8_t sequence_valid;     /*!< Bit per protocol with a sequence number seen */
+} dmx_net_universe_t;
+
+/**
+ * @brief Receiver state (treat as opaque; public so it can be statically allocated)
+ */
+typedef struct {
+    dmx_net_config_t config;
+    dmx_net_callbacks_t callbacks;
+    dmx_net_stats_t stats;
+    dmx_net_mapping_t mappings[DMX_NET_MAX_MAPPINGS];
+    uint8_t mapping_universe[DMX_NET_MAX_MAPPINGS];     /*!< Index into universes */
+    uint8_t mapping_count;
+    dmx_net_universe_t universes[DMX_NET_MAX_UNIVERSES];
+    uint8_t universe_count;
+    uint32_t all_universes;     /*!< Bit per universe index */
+    uint32_t pending;           /*!< Universes written since the last frame ended */
+    uint32_t pending_strips;    /*!< Strips written since the last frame ended */
+    uint32_t frame_start_ms;    /*!< When the open frame got its first data */
+    uint32_t last_sync_ms[2];   /*!< Last sync packet per protocol */
+    uint8_t synced;             /*!< Bit per protocol that has seen a sync packet within the timeout */
+    uint16_t e131_sync_address; /*!< Synchronization universe of the last synced E1.31 data */
+} dmx_net_t;
+
+/**
+ * @brief Initialize a receiver
+ *
+ * @param net: Receiver state
+ * @param config: Receiver configuration
+ * @param mappings: Strip regions; copied
+ * @param count: Number of mappings
+ * @param callbacks: Frame callbacks (members may be NULL)
+ *
+ * @return
+ *      false if there are more mappings or universes than the limits allow
+ */
+bool dmx_net_init(dmx_net_t *net, const dmx_net_config_t *config, const dmx_net_mapping_t *mappings, size_t count,
+                  const dmx_net_callbacks_t *callbacks);
+
+/**
+ * @brief Handle one received datagram
+ *
+ * Either protocol is detected from the packet itself, so one receiver can
+ * serve both ports. Universe data is written directly into the mapped strip
+ * buffers. Without synchronization a frame ends once every mapped universe
+ * has arrived, or when a universe arrives twice; with it, frames end on the
+ * sync packet, so several universes and strips change together.
+ *
+ * Has no platform dependencies, so it can be driven from lwIP, a host
+ * socket or a test buffer alike.
+ *
+ * @param net: Receiver state
+ * @param packet: UDP payload
+ * @param len: Payload length
+ * @param now_ms: Millisecond clock, for the sync and frame timeouts
+ *
+ * @return
+ *      Number of frames ended
+ */
+uint32_t dmx_net_feed(dmx_net_t *net, const uint8_t *packet, size_t len, uint32_t now_ms);
+
+/**
+ * @brief End a frame stuck waiting for missing universes or a lost sync packet
+ *
+ * Call periodically, e.g. when the socket wait times out.
+ *
+ * @param net: Receiver state
+ * @param now_ms: Millisecond clock
+ *
+ * @return
+ *      true if a frame was ended
+ */
+bool dmx_net_tick(dmx_net_t *net, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+// Receive E1.31 and Art-Net on the host with the dmx_net parser.
+//
+// Listens on both protocol ports, maps consecutive universes onto one pixel
+// buffer the way the device lays out its strips, and reports each frame and
+// its latency: from the first packet of the frame, and from the packet that
+// completed it, to the frame being ready for output. Pairs with
+// dmx_net_send.py over loopback to exercise sequencing, sync and partial
+// frames without a board.
+//
+//     cc -O2 -I../include -o dmx_net_recv dmx_net_recv.c ../dmx_net.c
+//     ./dmx_net_recv --pixels 340 --frames 400 &
+//     ./dmx_net_send.py 127.0.0.1 --universes 2 --pixels 340 --frames 400 --sync
+//
+// Options: --universe U (first universe, default 1), --pixels N (default 170),
+// --frames N (exit after N frames, default run forever), --multicast (join
+// the E1.31 groups of the mapped universes), --quiet (summary only).
+// Exits 1 if no frame arrived.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "dmx_net.h"
+
+#define PIXELS_PER_UNIVERSE     170
+#define BYTES_PER_PIXEL         3
+#define MAX_PIXELS              (PIXELS_PER_UNIVERSE * DMX_NET_MAX_MAPPINGS)
+
+typedef struct {
+    uint8_t pixels[MAX_PIXELS * BYTES_PER_PIXEL];
+    int pixel_count;
+    int quiet;
+    uint64_t first_packet_us;   // Received the frame's first packet
+    uint64_t last_packet_us;    // Received the packet being fed
+    uint64_t first_sum_us, last_sum_us;
+    uint64_t first_max_us, last_max_us;
+    uint32_t frames;
+} receiver_t;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void frame_begin(void *ctx)
+{
+    receiver_t *rx = ctx;
+    rx->first_packet_us = rx->last_packet_us;
+}
+
+static void frame_end(void *ctx, uint32_t strips, bool complete)
+{
+    receiver_t *rx = ctx;
+    (void)strips; // Everything is mapped onto one buffer
+    uint64_t now = now_us();
+    uint64_t from_first = now - rx->first_packet_us;
+    uint64_t from_last = now - rx->last_packet_us;
+    rx->frames++;
+    rx->first_sum_us += from_first;
+    rx->last_sum_us += from_last;
+    if (from_first > rx->first_max_us) {
+        rx->first_max_us = from_first;
+    }
+    if (from_last > rx->last_max_us) {
+        rx->last_max_us = from_last;
+    }
+    if (!rx->quiet) {
+        const uint8_t *last = &rx->pixels[(rx->pixel_count - 1) * BYTES_PER_PIXEL];
+        printf("frame %u%s: first %02x%02x%02x last %02x%02x%02x, latency %llu us (%llu us from last packet)\n",
+               rx->frames, complete ? "" : " (partial)", rx->pixels[0], rx->pixels[1], rx->pixels[2],
+               last[0], last[1], last[2], (unsigned long long)from_first, (unsigned long long)from_last);
+    }
+}
+
+static int open_socket(uint16_t port, uint16_t first_universe, int universes, int multicast)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return -1;
+    }
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+    for (int u = 0; multicast && u < universes; u++) {
+        uint16_t universe = first_universe + u;
+        struct ip_mreq mreq = {
+            .imr_multiaddr.s_addr = htonl(0xEFFF0000 | universe), // 239.255.hi.lo
+            .imr_interface.s_addr = htonl(INADDR_ANY),
+        };
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            perror("IP_ADD_MEMBERSHIP");
+        }
+    }
+    return sock;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--universe U] [--pixels N] [--frames N] [--multicast] [--quiet]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static receiver_t rx;
+    int first_universe = 1, frames = 0, multicast = 0;
+    rx.pixel_count = PIXELS_PER_UNIVERSE;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--multicast")) {
+            multicast = 1;
+        } else if (!strcmp(argv[i], "--quiet")) {
+            rx.quiet = 1;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--universe")) {
+            first_universe = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--pixels")) {
+            rx.pixel_count = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--frames")) {
+            frames = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (rx.pixel_count < 1 || rx.pixel_count > MAX_PIXELS || first_universe < 1) {
+        usage(argv[0]);
+    }
+    
+    // One mapping per universe, 170 pixels each, consecutive in the buffer
+    dmx_net_mapping_t mappings[DMX_NET_MAX_MAPPINGS];
+    int count = 0;
+    for (int p = 0; p < rx.pixel_count; p += PIXELS_PER_UNIVERSE, count++) {
+        int n = rx.pixel_count - p < PIXELS_PER_UNIVERSE ? rx.pixel_count - p : PIXELS_PER_UNIVERSE;
+        mappings[count] = (dmx_net_mapping_t){
+            .universe = first_universe + count,
+            .channel = 1,
+            .buffer = &rx.pixels[p * BYTES_PER_PIXEL],
+            .pixel_count = n,
+            .bytes_per_pixel = BYTES_PER_PIXEL,
+            .offset = { 0, 1, 2 },
+            .strip = 0,
+        };
+    }
+    
+    dmx_net_t net;
+    dmx_net_config_t config = DMX_NET_DEFAULT_CONFIG();
+    dmx_net_callbacks_t callbacks = {
+        .frame_begin = frame_begin,
+        .frame_end = frame_end,
+        .ctx = &rx,
+    };
+    if (!dmx_net_init(&net, &config, mappings, count, &callbacks)) {
+        fprintf(stderr, "invalid mapping\n");
+        return 2;
+    }
+    
+    struct pollfd fds[2] = {
+        { .fd = open_socket(DMX_NET_E131_PORT, first_universe, count, multicast), .events = POLLIN },
+        { .fd = open_socket(DMX_NET_ARTNET_PORT, first_universe, 0, 0), .events = POLLIN },
+    };
+    if (fds[0].fd < 0 || fds[1].fd < 0) {
+        return 2;
+    }
+    fprintf(stderr, "listening on ports %d and %d for universes %d-%d\n", DMX_NET_E131_PORT, DMX_NET_ARTNET_PORT,
+            first_universe, first_universe + count - 1);
+    
+    uint8_t packet[DMX_NET_PACKET_MAX];
+    uint64_t idle_ms = 0;
+    while (!frames || rx.frames < (uint32_t)frames) {
+        int ready = poll(fds, 2, 10);
+        uint32_t now_ms = (uint32_t)(now_us() / 1000);
+        if (ready <= 0) {
+            dmx_net_tick(&net, now_ms);
+            // Stop a bounded run once the sender has gone quiet
+            if (frames && rx.frames && (idle_ms += 10) > 2000) {
+                break;
+            }
+            continue;
+        }
+        idle_ms = 0;
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].revents & POLLIN) {
+                ssize_t len = recv(fds[i].fd, packet, sizeof(packet), 0);
+                if (len > 0) {
+                    rx.last_packet_us = now_us();
+                    dmx_net_feed(&net, packet, len, now_ms);
+                }
+            }
+        }
+    }
+    
+    const dmx_net_stats_t *s = &net.stats;
+    printf("%u packets, %u frames (%u partial), %u sync, %u out of sequence, %u bad, %u ignored\n",
+           s->packets, s->frames, s->partial_frames, s->sync_packets, s->sequence_drops, s->bad_packets,
+           s->ignored_packets);
+    if (rx.frames) {
+        printf("latency from first packet: avg %llu us, max %llu us; from last packet: avg %llu us, max %llu us\n",
+               (unsigned long long)(rx.first_sum_us / rx.frames), (unsigned long long)rx.first_max_us,
+               (unsigned long long)(rx.last_sum_us / rx.frames), (unsigned long long)rx.last_max_us);
+    }
+    return rx.frames ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Send E1.31 (sACN) or Art-Net universes of pixel data over UDP.
+
+Generates a test pattern across one or more universes at a fixed frame rate,
+optionally followed by a sync packet per frame, in the packet formats that
+dmx_net.c parses. Without a host, E1.31 goes to each universe's multicast
+group and Art-Net is broadcast; pass 127.0.0.1 to drive dmx_net_recv on the
+same machine. Stale packets and missing universes can be injected to check
+that the receiver drops out-of-order data and still shows partial frames.
+
+    dmx_net_send.py 192.168.1.50 --universes 2 --pixels 170 --fps 40
+    dmx_net_send.py --protocol artnet --sync --color ff8000
+    dmx_net_send.py 127.0.0.1 --frames 400 --stale 10 --drop 25
+"""
+
+import argparse
+import colorsys
+import socket
+import struct
+import sys
+import time
+import uuid
+
+E131_PORT = 5568
+ARTNET_PORT = 6454
+PIXELS_PER_UNIVERSE = 170  # 510 of 512 channels
+
+
+def flags_length(length):
+    return struct.pack(">H", 0x7000 | length)
+
+
+def e131_root(vector, cid, body_len):
+    preamble = struct.pack(">HH", 0x0010, 0) + b"ASC-E1.17\0\0\0"
+    return preamble + flags_length(22 + body_len) + struct.pack(">I", vector) + cid
+
+
+def e131_data(cid, universe, sequence, data, sync_universe=0, name=b"dmx_net_send"):
+    dmp = struct.pack(">BBHHH", 0x02, 0xA1, 0, 1, len(data) + 1) + b"\0" + data
+    dmp = flags_length(2 + len(dmp)) + dmp
+    framing = (
+        struct.pack(">I", 0x00000002)
+        + name.ljust(64, b"\0")[:64]
+        + struct.pack(">BHBBH", 100, sync_universe, sequence, 0, universe)
+        + dmp
+    )
+    framing = flags_length(2 + len(framing)) + framing
+    return e131_root(0x00000004, cid, len(framing)) + framing
+
+
+def e131_sync(cid, sync_universe, sequence):
+    framing = struct.pack(">IBHH", 0x00000001, sequence, sync_universe, 0)
+    framing = flags_length(2 + len(framing)) + framing
+    return e131_root(0x00000008, cid, len(framing)) + framing
+
+
+def artnet_dmx(port_address, sequence, data):
+    if len(data) & 1:
+        data += b"\0"  # ArtDmx lengths are even
+    return (
+        b"Art-Net\0"
+        + struct.pack("<H", 0x5000)
+        + struct.pack(">HBBBBH", 14, sequence, 0, port_address & 0xFF, (port_address >> 8) & 0x7F, len(data))
+        + data
+    )
+
+
+def artnet_sync():
+    return b"Art-Net\0" + struct.pack("<H", 0x5200) + struct.pack(">HBB", 14, 0, 0)
+
+
+def rainbow(leds, frame, fps):
+    pixels = []
+    for i in range(leds):
+        hue = (frame / (fps * 5.0) + i / float(leds)) % 1.0
+        r, g, b = colorsys.hsv_to_rgb(hue, 1.0, 1.0)
+        pixels.append((int(r * 255), int(g * 255), int(b * 255)))
+    return pixels
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", nargs="?", help="receiver address (default: multicast for E1.31, broadcast for Art-Net)")
+    parser.add_argument("--protocol", choices=("e131", "artnet"), default="e131")
+    parser.add_argument("--port", type=int, help="UDP port (default 5568 or 6454)")
+    parser.add_argument("--universe", type=int, default=1, help="first universe (default 1; Art-Net port-address is one less)")
+    parser.add_argument("--universes", type=int, default=1, help="consecutive universes (default 1)")
+    parser.add_argument("--pixels", type=int, default=170, help="pixels in total (default 170)")
+    parser.add_argument("--fps", type=float, default=40.0, help="frame rate (default 40, 0 = as fast as possible)")
+    parser.add_argument("--frames", type=int, default=0, help="stop after this many frames (default: run forever)")
+    parser.add_argument("--sync", action="store_true", help="send a sync packet after each frame")
+    parser.add_argument("--sync-universe", type=int, default=7962, help="E1.31 synchronization universe (default 7962)")
+    parser.add_argument("--color", help="send a solid RRGGBB color instead of a rainbow")
+    parser.add_argument("--stale", type=int, default=0, help="every Nth frame, resend an old packet out of sequence")
+    parser.add_argument("--drop", type=int, default=0, help="every Nth frame, leave out the last universe")
+    args = parser.parse_args()
+
+    e131 = args.protocol == "e131"
+    port = args.port or (E131_PORT if e131 else ARTNET_PORT)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 4)
+
+    def address(universe):
+        if args.host:
+            return (args.host, port)
+        if e131:
+            return ("239.255.%d.%d" % (universe >> 8, universe & 0xFF), port)
+        return ("255.255.255.255", port)
+
+    solid = None
+    if args.color:
+        value = int(args.color.lstrip("#"), 16)
+        solid = [((value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF)] * args.pixels
+
+    cid = uuid.uuid4().bytes
+    sync_universe = args.sync_universe if (e131 and args.sync) else 0
+    sequence = [1] * args.universes
+    sync_sequence = 0
+    last_packet = None
+    period = 1.0 / args.fps if args.fps > 0 else 0.0
+    next_time = time.monotonic()
+    sent = stale = dropped = 0
+    try:
+        while not args.frames or sent < args.frames:
+            pixels = solid or rainbow(args.pixels, sent, args.fps or 60.0)
+            universes = args.universes
+            if args.drop > 0 and (sent + 1) % args.drop == 0 and universes > 1:
+                universes -= 1
+                dropped += 1
+            for u in range(universes):
+                chunk = pixels[u * PIXELS_PER_UNIVERSE:(u + 1) * PIXELS_PER_UNIVERSE]
+                data = b"".join(bytes(p) for p in chunk)
+                universe = args.universe + u
+                if e131:
+                    packet = e131_data(cid, universe, sequence[u], data, sync_universe)
+                else:
+                    packet = artnet_dmx(universe - 1, sequence[u], data)
+                sequence[u] = sequence[u] % 255 + 1  # Art-Net reserves 0 for "unsequenced"
+                sock.sendto(packet, address(universe))
+                if u == 0:
+                    if args.stale > 0 and (sent + 1) % args.stale == 0 and last_packet:
+                        sock.sendto(last_packet, address(universe))
+                        stale += 1
+                    last_packet = packet
+            if args.sync:
+                if e131:
+                    sock.sendto(e131_sync(cid, sync_universe, sync_sequence), address(sync_universe))
+                    sync_sequence = (sync_sequence + 1) & 0xFF
+                else:
+                    sock.sendto(artnet_sync(), address(args.universe))
+            sent += 1
+            if period:
+                next_time += period
+                time.sleep(max(0.0, next_time - time.monotonic()))
+    except KeyboardInterrupt:
+        pass
+    print("sent %d frames (%d stale packets, %d with a universe missing)" % (sent, stale, dropped), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
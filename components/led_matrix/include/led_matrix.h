@@ -0,0 +1,174 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip.h"
+#include "ssd1306_fonts.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How the strip runs through the panel
+ */
+typedef enum {
+    LED_MATRIX_WIRING_PROGRESSIVE,  /*!< Every row (or column) starts at the same side */
+    LED_MATRIX_WIRING_SERPENTINE,   /*!< Zig-zag: every other row (or column) runs backwards */
+    LED_MATRIX_WIRING_CUSTOM,       /*!< Index table supplied in led_matrix_config_t::custom_map */
+} led_matrix_wiring_t;
+
+/**
+ * @brief Clockwise rotation from the panel to the canvas
+ */
+typedef enum {
+    LED_MATRIX_ROTATE_0,
+    LED_MATRIX_ROTATE_90,
+    LED_MATRIX_ROTATE_180,
+    LED_MATRIX_ROTATE_270,
+} led_matrix_rotation_t;
+
+/**
+ * @brief Matrix configuration
+ *
+ * The panel is described as wired: panel_width x panel_height pixels with
+ * the first LED at the top-left. Rotation and flips say how the canvas the
+ * application draws on sits on that panel.
+ */
+typedef struct {
+    uint16_t panel_width;           /*!< LEDs per panel row */
+    uint16_t panel_height;          /*!< Panel rows */
+    led_matrix_wiring_t wiring;     /*!< Strip path through the panel */
+    bool column_major;              /*!< Strip runs down columns instead of along rows */
+    led_matrix_rotation_t rotation; /*!< Canvas rotation on the panel */
+    bool flip_x;                    /*!< Mirror the panel horizontally (first LED top-right) */
+    bool flip_y;                    /*!< Mirror the panel vertically (first LED bottom-left) */
+    const uint16_t *custom_map;     /*!< CUSTOM wiring: strip index per panel pixel, row-major, panel_width * panel_height entries */
+} led_matrix_config_t;
+
+/**
+ * @brief Default configuration: serpentine rows, first LED top-left
+ */
+#define LED_MATRIX_DEFAULT_CONFIG(width, height)       \
+    {                                                   \
+        .panel_width = width,                           \
+        .panel_height = height,                         \
+        .wiring = LED_MATRIX_WIRING_SERPENTINE,         \
+        .column_major = false,                          \
+        .rotation = LED_MATRIX_ROTATE_0,                \
+        .flip_x = false,                                \
+        .flip_y = false,                                \
+        .custom_map = NULL,                             \
+    }
+
+/**
+ * @brief Canvas over an LED strip
+ */
+typedef struct led_matrix_s led_matrix_t;
+
+/**
+ * @brief Create a canvas over a strip
+ *
+ * The (x, y) to buffer offset table is built here once; drawing never
+ * computes the wiring again. Drawing writes the strip's pixel buffer
+ * directly (see led_strip_t::get_buffer), announcing the pixels it reaches
+ * with led_strip_t::mark_dirty; call led_matrix_refresh to send it, not the
+ * strip's own refresh, so the canvas knows the announcement ended.
+ *
+ * @param strip: LED strip with at least panel_width * panel_height pixels
+ * @param config: Panel description
+ * @param ret_matrix: Receives the canvas
+ *
+ * @return
+ *      - ESP_OK: Canvas created
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ *      - ESP_ERR_INVALID_SIZE: The panel (or a custom map entry) does not fit the strip
+ *      - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t led_matrix_create(led_strip_t *strip, const led_matrix_config_t *config, led_matrix_t **ret_matrix);
+
+/**
+ * @brief Free a canvas (the strip is left alone)
+ */
+void led_matrix_delete(led_matrix_t *matrix);
+
+/**
+ * @brief Canvas width after rotation
+ */
+uint16_t led_matrix_width(const led_matrix_t *matrix);
+
+/**
+ * @brief Canvas height after rotation
+ */
+uint16_t led_matrix_height(const led_matrix_t *matrix);
+
+/**
+ * @brief Set one pixel; coordinates outside the canvas are ignored
+ */
+void led_matrix_set_pixel(led_matrix_t *matrix, int x, int y, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Fill the whole canvas
+ */
+void led_matrix_fill(led_matrix_t *matrix, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Fill a rectangle, clipped to the canvas
+ */
+void led_matrix_fill_rect(led_matrix_t *matrix, int x, int y, int width, int height, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Copy an RGB image onto the canvas, clipped
+ *
+ * @param matrix: Canvas
+ * @param x: Left edge on the canvas (may be negative)
+ * @param y: Top edge on the canvas (may be negative)
+ * @param rgb: Image, 3 bytes per pixel in R, G, B order, row-major
+ * @param width: Image width
+ * @param height: Image height
+ */
+void led_matrix_blit(led_matrix_t *matrix, int x, int y, const uint8_t *rgb, int width, int height);
+
+/**
+ * @brief Shift the canvas contents
+ *
+ * Pixels moved off the canvas are lost; uncovered pixels are set to the
+ * fill color.
+ *
+ * @param matrix: Canvas
+ * @param dx: Pixels to the right (negative: left)
+ * @param dy: Pixels down (negative: up)
+ */
+void led_matrix_scroll(led_matrix_t *matrix, int dx, int dy, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Draw text with an SSD1306 font table
+ *
+ * Set glyph bits are drawn in the color; clear bits leave the canvas as is,
+ * so text can be drawn over a background and scrolled by moving x.
+ *
+ * @param matrix: Canvas
+ * @param x: Left edge of the first glyph (may be negative)
+ * @param y: Top edge of the glyphs (may be negative)
+ * @param text: NUL-terminated string
+ * @param font: Font, e.g. &ssd1306_font_6x8
+ *
+ * @return X position after the last glyph
+ */
+int led_matrix_draw_text(led_matrix_t *matrix, int x, int y, const char *text, const ssd1306_font_t *font,
+                         uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Send the canvas to the LEDs
+ *
+ * @param matrix: Canvas
+ * @param timeout_ms: Timeout for the strip refresh
+ *
+ * @return Result of the strip refresh
+ */
+esp_err_t led_matrix_refresh(led_matrix_t *matrix, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,291 @@
+#include <stdlib.h>
+#include <string.h>
+#include "led_matrix.h"
+
+struct led_matrix_s {
+    led_strip_t *strip;
+    uint8_t *buffer;            // Strip pixel buffer, wire order
+    uint8_t bpp;                // Bytes per pixel
+    uint8_t red, green, blue;   // Channel offsets within a pixel
+    uint16_t width, height;     // Canvas size after rotation
+    uint32_t span_lo, span_hi;  // Buffer bytes the canvas covers
+    uint32_t dirty_lo, dirty_hi; // Buffer bytes announced to the strip with mark_dirty since the last refresh
+    uint16_t offset[];          // Buffer byte offset of each canvas pixel, row-major
+};
+
+// Canvas pixel to panel pixel: rotation first, then the panel flips
+static void canvas_to_panel(const led_matrix_config_t *config, int x, int y, int *px, int *py)
+{
+    int pw = config->panel_width, ph = config->panel_height;
+    
+    switch (config->rotation) {
+    case LED_MATRIX_ROTATE_90:
+        *px = pw - 1 - y;
+        *py = x;
+        break;
+    case LED_MATRIX_ROTATE_180:
+        *px = pw - 1 - x;
+        *py = ph - 1 - y;
+        break;
+    case LED_MATRIX_ROTATE_270:
+        *px = y;
+        *py = ph - 1 - x;
+        break;
+    default:
+        *px = x;
+        *py = y;
+        break;
+    }
+    if (config->flip_x) {
+        *px = pw - 1 - *px;
+    }
+    if (config->flip_y) {
+        *py = ph - 1 - *py;
+    }
+}
+
+// Panel pixel to strip index according to the wiring
+static uint32_t panel_to_index(const led_matrix_config_t *config, int px, int py)
+{
+    int pw = config->panel_width, ph = config->panel_height;
+    
+    if (config->wiring == LED_MATRIX_WIRING_CUSTOM) {
+        return config->custom_map[py * pw + px];
+    }
+    
+    // Lines are rows, or columns for column-major panels
+    int line = config->column_major ? px : py;
+    int pos = config->column_major ? py : px;
+    int line_len = config->column_major ? ph : pw;
+    if (config->wiring == LED_MATRIX_WIRING_SERPENTINE && (line & 1)) {
+        pos = line_len - 1 - pos;
+    }
+    return (uint32_t)line * line_len + pos;
+}
+
+esp_err_t led_matrix_create(led_strip_t *strip, const led_matrix_config_t *config, led_matrix_t **ret_matrix)
+{
+    if (!strip || !config || !ret_matrix || config->panel_width == 0 || config->panel_height == 0 ||
+        (config->wiring == LED_MATRIX_WIRING_CUSTOM && !config->custom_map)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint8_t *buffer;
+    led_strip_layout_t layout;
+    esp_err_t ret = strip->get_buffer(strip, &buffer, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint32_t pixels = (uint32_t)config->panel_width * config->panel_height;
+    if (pixels > layout.pixel_count || layout.pixel_count * layout.bytes_per_pixel > UINT16_MAX + 1) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    led_matrix_t *matrix = calloc(1, sizeof(led_matrix_t) + pixels * sizeof(uint16_t));
+    if (!matrix) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    matrix->strip = strip;
+    matrix->buffer = buffer;
+    matrix->bpp = layout.bytes_per_pixel;
+    matrix->red = layout.red_offset;
+    matrix->green = layout.green_offset;
+    matrix->blue = layout.blue_offset;
+    bool swap = config->rotation == LED_MATRIX_ROTATE_90 || config->rotation == LED_MATRIX_ROTATE_270;
+    matrix->width = swap ? config->panel_height : config->panel_width;
+    matrix->height = swap ? config->panel_width : config->panel_height;
+    
+    matrix->span_lo = UINT32_MAX;
+    for (int y = 0; y < matrix->height; y++) {
+        for (int x = 0; x < matrix->width; x++) {
+            int px, py;
+            canvas_to_panel(config, x, y, &px, &py);
+            uint32_t index = panel_to_index(config, px, py);
+            if (index >= layout.pixel_count) {
+                free(matrix);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            uint32_t offset = index * layout.bytes_per_pixel;
+            matrix->offset[y * matrix->width + x] = offset;
+            if (offset < matrix->span_lo) {
+                matrix->span_lo = offset;
+            }
+            if (offset + layout.bytes_per_pixel > matrix->span_hi) {
+                matrix->span_hi = offset + layout.bytes_per_pixel;
+            }
+        }
+    }
+    
+    *ret_matrix = matrix;
+    return ESP_OK;
+}
+
+void led_matrix_delete(led_matrix_t *matrix)
+{
+    free(matrix);
+}
+
+uint16_t led_matrix_width(const led_matrix_t *matrix)
+{
+    return matrix->width;
+}
+
+uint16_t led_matrix_height(const led_matrix_t *matrix)
+{
+    return matrix->height;
+}
+
+// Announce buffer bytes [lo, hi) to the strip before writing them. The
+// strip keeps one range per frame, so ours grows the same way.
+static void mark_dirty(led_matrix_t *matrix, uint32_t lo, uint32_t hi)
+{
+    matrix->strip->mark_dirty(matrix->strip, lo / matrix->bpp, (hi - lo) / matrix->bpp);
+    if (matrix->dirty_hi == matrix->dirty_lo) {
+        matrix->dirty_lo = lo;
+        matrix->dirty_hi = hi;
+        return;
+    }
+    if (lo < matrix->dirty_lo) {
+        matrix->dirty_lo = lo;
+    }
+    if (hi > matrix->dirty_hi) {
+        matrix->dirty_hi = hi;
+    }
+}
+
+static inline void put_pixel(led_matrix_t *matrix, int x, int y, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t offset = matrix->offset[y * matrix->width + x];
+    if (offset < matrix->dirty_lo || offset >= matrix->dirty_hi) {
+        mark_dirty(matrix, offset, offset + matrix->bpp);
+    }
+    uint8_t *p = matrix->buffer + offset;
+    p[matrix->red] = red;
+    p[matrix->green] = green;
+    p[matrix->blue] = blue;
+}
+
+// Clip a span [*start, *start + *len) to [0, limit); false if nothing is left
+static bool clip(int *start, int *len, int limit, int *skip)
+{
+    *skip = 0;
+    if (*start < 0) {
+        *skip = -*start;
+        *len += *start;
+        *start = 0;
+    }
+    if (*start + *len > limit) {
+        *len = limit - *start;
+    }
+    return *len > 0;
+}
+
+void led_matrix_set_pixel(led_matrix_t *matrix, int x, int y, uint8_t red, uint8_t green, uint8_t blue)
+{
+    if (x < 0 || y < 0 || x >= matrix->width || y >= matrix->height) {
+        return;
+    }
+    put_pixel(matrix, x, y, red, green, blue);
+}
+
+void led_matrix_fill(led_matrix_t *matrix, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t pixels = (uint32_t)matrix->width * matrix->height;
+    mark_dirty(matrix, matrix->span_lo, matrix->span_hi);
+    for (uint32_t i = 0; i < pixels; i++) {
+        uint8_t *p = matrix->buffer + matrix->offset[i];
+        p[matrix->red] = red;
+        p[matrix->green] = green;
+        p[matrix->blue] = blue;
+    }
+}
+
+void led_matrix_fill_rect(led_matrix_t *matrix, int x, int y, int width, int height, uint8_t red, uint8_t green, uint8_t blue)
+{
+    int skip_x, skip_y;
+    if (!clip(&x, &width, matrix->width, &skip_x) || !clip(&y, &height, matrix->height, &skip_y)) {
+        return;
+    }
+    for (int row = y; row < y + height; row++) {
+        for (int col = x; col < x + width; col++) {
+            put_pixel(matrix, col, row, red, green, blue);
+        }
+    }
+}
+
+void led_matrix_blit(led_matrix_t *matrix, int x, int y, const uint8_t *rgb, int width, int height)
+{
+    int stride = width * 3;
+    int skip_x, skip_y;
+    if (!clip(&x, &width, matrix->width, &skip_x) || !clip(&y, &height, matrix->height, &skip_y)) {
+        return;
+    }
+    for (int row = 0; row < height; row++) {
+        const uint8_t *src = rgb + (row + skip_y) * stride + skip_x * 3;
+        for (int col = 0; col < width; col++, src += 3) {
+            put_pixel(matrix, x + col, y + row, src[0], src[1], src[2]);
+        }
+    }
+}
+
+void led_matrix_scroll(led_matrix_t *matrix, int dx, int dy, uint8_t red, uint8_t green, uint8_t blue)
+{
+    int w = matrix->width, h = matrix->height;
+    mark_dirty(matrix, matrix->span_lo, matrix->span_hi);
+    
+    // Walk against the scroll direction so every source is read before it is overwritten
+    int y0 = dy > 0 ? h - 1 : 0, y_step = dy > 0 ? -1 : 1;
+    int x0 = dx > 0 ? w - 1 : 0, x_step = dx > 0 ? -1 : 1;
+    for (int i = 0, y = y0; i < h; i++, y += y_step) {
+        int sy = y - dy;
+        for (int j = 0, x = x0; j < w; j++, x += x_step) {
+            int sx = x - dx;
+            if (sx < 0 || sy < 0 || sx >= w || sy >= h) {
+                put_pixel(matrix, x, y, red, green, blue);
+            } else {
+                memcpy(matrix->buffer + matrix->offset[y * w + x],
+                       matrix->buffer + matrix->offset[sy * w + sx], matrix->bpp);
+            }
+        }
+    }
+}
+
+int led_matrix_draw_text(led_matrix_t *matrix, int x, int y, const char *text, const ssd1306_font_t *font,
+                         uint8_t red, uint8_t green, uint8_t blue)
+{
+    for (; *text; text++, x += font->width) {
+        if (x >= matrix->width) {
+            continue; // Keep counting the width for the return value
+        }
+        if (x + font->width <= 0) {
+            continue;
+        }
+        
+        // Glyphs are page-major columns with the LSB at the top (SSD1306 layout)
+        const uint8_t *glyph = ssd1306_font_glyph(font, (uint8_t)*text);
+        for (int row = 0; row < font->height; row++) {
+            int cy = y + row;
+            if (cy < 0 || cy >= matrix->height) {
+                continue;
+            }
+            const uint8_t *page = glyph + (row / 8) * font->width;
+            uint8_t bit = 1 << (row % 8);
+            for (int col = 0; col < font->width; col++) {
+                int cx = x + col;
+                if ((page[col] & bit) && cx >= 0 && cx < matrix->width) {
+                    put_pixel(matrix, cx, cy, red, green, blue);
+                }
+            }
+        }
+    }
+    return x;
+}
+
+esp_err_t led_matrix_refresh(led_matrix_t *matrix, uint32_t timeout_ms)
+{
+    // The refresh commits what was announced; the next frame starts a new range
+    matrix->dirty_lo = 0;
+    matrix->dirty_hi = 0;
+    return matrix->strip->refresh(matrix->strip, timeout_ms);
+}
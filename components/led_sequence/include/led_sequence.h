@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compact recorded pixel sequences
+ *
+ * A sequence is a header followed by frame records, all little endian:
+ *
+ *     header     led_sequence_header_t (40 bytes)
+ *     frame      delay_ms (16 bit), size (16 bit), then size bytes of ops
+ *
+ * delay_ms is the time from the previous frame (or the start) to this one.
+ * The ops of a frame cover its pixels in order, RGB per pixel:
+ *
+ *     0x00-0x3F  skip n+1 pixels, unchanged from the previous frame
+ *     0x40-0x7F  (n & 0x3F)+1 literal pixels follow
+ *     0x80-0xFF  fill (n & 0x7F)+1 pixels with the one pixel that follows
+ *
+ * The first frame never skips, so playback can start or loop there. Pixels
+ * past the last op keep their previous value. A partition image holds
+ * sequences back to back, each starting on a LED_SEQUENCE_ALIGN boundary so
+ * one can be erased and written without touching the others; erased flash
+ * (no magic) ends the image.
+ */
+#define LED_SEQUENCE_MAGIC          "LSEQ"
+#define LED_SEQUENCE_VERSION        (1)
+#define LED_SEQUENCE_ALIGN          (4096)      /*!< Flash sector */
+#define LED_SEQUENCE_NAME_LEN       (16)        /*!< Including the terminating NUL */
+#define LED_SEQUENCE_MAX_PIXELS     (4096)      /*!< Keeps a frame's ops below 64 KiB */
+#define LED_SEQUENCE_FRAME_HEADER   (4)         /*!< delay_ms and size */
+
+#define LED_SEQUENCE_OP_SKIP        (0x00)
+#define LED_SEQUENCE_OP_LITERAL     (0x40)
+#define LED_SEQUENCE_OP_FILL        (0x80)
+#define LED_SEQUENCE_SKIP_MAX       (64)
+#define LED_SEQUENCE_LITERAL_MAX    (64)
+#define LED_SEQUENCE_FILL_MAX       (128)
+
+#define LED_SEQUENCE_FLAG_LOOP      (1 << 0)    /*!< Loop by default when played */
+
+/**
+ * @brief Sequence header, stored as is (little endian)
+ */
+typedef struct {
+    char magic[4];              /*!< LED_SEQUENCE_MAGIC */
+    uint8_t version;            /*!< LED_SEQUENCE_VERSION */
+    uint8_t flags;              /*!< LED_SEQUENCE_FLAG_* */
+    uint16_t pixel_count;       /*!< Pixels per frame */
+    uint32_t frame_count;
+    uint32_t data_size;         /*!< Bytes of frame records after the header */
+    uint32_t duration_ms;       /*!< Last frame's time plus how long it is held */
+    uint16_t frame_rate_hz;     /*!< Playback tick: frames due are shown at this rate */
+    uint16_t reserved;
+    char name[LED_SEQUENCE_NAME_LEN];
+} led_sequence_header_t;
+
+/**
+ * @brief Pixel buffer frames are decoded into
+ *
+ * Usually the LED strip's own buffer (see led_strip_t::get_buffer), so
+ * frames go from flash to the buffer in wire order without a copy.
+ */
+typedef struct {
+    uint8_t *buffer;            /*!< Pixel buffer */
+    uint32_t pixel_count;       /*!< Pixels in the buffer; further sequence pixels are dropped */
+    uint8_t bytes_per_pixel;    /*!< Stride between pixels */
+    uint8_t offset[3];          /*!< Byte offset of red, green and blue within a pixel */
+} led_sequence_target_t;
+
+/**
+ * @brief Playback position in a sequence
+ */
+typedef struct {
+    const led_sequence_header_t *header;
+    const uint8_t *data;        /*!< First frame record */
+    const uint8_t *next;        /*!< Next frame record */
+    uint32_t frame;             /*!< Index of the next frame */
+    uint32_t time_ms;           /*!< Time of the next frame */
+} led_sequence_t;
+
+/**
+ * @brief Result of decoding a frame
+ */
+typedef enum {
+    LED_SEQUENCE_FRAME,         /*!< A frame was decoded */
+    LED_SEQUENCE_END,           /*!< No frames left */
+    LED_SEQUENCE_CORRUPT,       /*!< A record runs past the data or has too many pixels */
+} led_sequence_result_t;
+
+/**
+ * @brief Check a header and start at the first frame
+ *
+ * @param seq: Playback position
+ * @param data: Sequence, e.g. in a memory-mapped partition; read in place
+ * @param size: Bytes available at data
+ *
+ * @return
+ *      - true: Valid sequence
+ *      - false: No magic, unknown version, or the sequence does not fit in size
+ */
+bool led_sequence_open(led_sequence_t *seq, const void *data, size_t size);
+
+/**
+ * @brief Go back to the first frame
+ */
+void led_sequence_rewind(led_sequence_t *seq);
+
+/**
+ * @brief Time of the next frame, or UINT32_MAX at the end
+ */
+uint32_t led_sequence_next_time(const led_sequence_t *seq);
+
+/**
+ * @brief Decode the next frame into a pixel buffer
+ *
+ * Frames are deltas, so they must be decoded in order into the same
+ * buffer, even those that are never shown.
+ *
+ * @param seq: Playback position
+ * @param target: Buffer holding the previous frame
+ *
+ * @return
+ *      Decode result
+ */
+led_sequence_result_t led_sequence_decode(led_sequence_t *seq, const led_sequence_target_t *target);
+
+/**
+ * @brief Find the sequences in a partition image
+ *
+ * @param image: Start of the image, e.g. the memory-mapped partition
+ * @param size: Image size
+ * @param headers: Receives a pointer to each sequence's header
+ * @param max: Entries in headers
+ *
+ * @return
+ *      Number of sequences found
+ */
+int led_sequence_list(const void *image, size_t size, const led_sequence_header_t **headers, int max);
+
+/**
+ * @brief Bytes a sequence takes in a partition image, rounded up to LED_SEQUENCE_ALIGN
+ */
+size_t led_sequence_image_size(const led_sequence_header_t *header);
+
+/**
+ * @brief Encoder state (treat as opaque)
+ */
+typedef struct {
+    uint8_t *out;               /*!< Header, then frame records */
+    size_t capacity;
+    size_t size;                /*!< Bytes used, including the header */
+    uint8_t *previous;          /*!< Last frame, RGB */
+    uint16_t pixel_count;
+    uint32_t frame_count;
+    uint32_t time_ms;           /*!< Time of the last frame */
+} led_sequence_encoder_t;
+
+/**
+ * @brief Start encoding a sequence
+ *
+ * @param enc: Encoder state
+ * @param pixel_count: Pixels per frame, at most LED_SEQUENCE_MAX_PIXELS
+ * @param previous: pixel_count * 3 bytes to keep the last frame in
+ * @param out: Output buffer; the header is written to its start by led_sequence_encoder_finish
+ * @param capacity: Size of out
+ *
+ * @return
+ *      - true: Ready
+ *      - false: Invalid pixel count, or out cannot even hold the header
+ */
+bool led_sequence_encoder_init(led_sequence_encoder_t *enc, uint16_t pixel_count, uint8_t *previous, uint8_t *out,
+                               size_t capacity);
+
+/**
+ * @brief Append a frame
+ *
+ * Only pixels that differ from the previous frame are stored. Delays over
+ * 65535 ms are split with empty frames.
+ *
+ * @param enc: Encoder state
+ * @param rgb: Frame, pixel_count RGB pixels
+ * @param delay_ms: Time since the previous frame (ignored for the first)
+ *
+ * @return
+ *      - true: Frame appended
+ *      - false: Out of space; the sequence so far is kept
+ */
+bool led_sequence_encode_frame(led_sequence_encoder_t *enc, const uint8_t *rgb, uint32_t delay_ms);
+
+/**
+ * @brief Write the header in front of the frames
+ *
+ * @param enc: Encoder state
+ * @param name: Sequence name, truncated to LED_SEQUENCE_NAME_LEN - 1
+ * @param frame_rate_hz: Playback tick rate
+ * @param hold_ms: How long the last frame is shown before the sequence ends or loops
+ * @param flags: LED_SEQUENCE_FLAG_*
+ *
+ * @return
+ *      Size of the sequence at out
+ */
+size_t led_sequence_encoder_finish(led_sequence_encoder_t *enc, const char *name, uint16_t frame_rate_hz,
+                                   uint32_t hold_ms, uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
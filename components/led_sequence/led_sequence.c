@@ -0,0 +1,256 @@
+#include <string.h>
+#include "led_sequence.h"
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put_u16(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+bool led_sequence_open(led_sequence_t *seq, const void *data, size_t size)
+{
+    const led_sequence_header_t *header = data;
+    if (size < sizeof(*header) || memcmp(header->magic, LED_SEQUENCE_MAGIC, 4) != 0 ||
+        header->version != LED_SEQUENCE_VERSION || header->pixel_count == 0 ||
+        header->pixel_count > LED_SEQUENCE_MAX_PIXELS || header->frame_rate_hz == 0 ||
+        header->data_size > size - sizeof(*header)) {
+        return false;
+    }
+    seq->header = header;
+    seq->data = (const uint8_t *)data + sizeof(*header);
+    led_sequence_rewind(seq);
+    return true;
+}
+
+void led_sequence_rewind(led_sequence_t *seq)
+{
+    seq->next = seq->data;
+    seq->frame = 0;
+    seq->time_ms = seq->header->data_size >= LED_SEQUENCE_FRAME_HEADER ? get_u16(seq->data) : 0;
+}
+
+uint32_t led_sequence_next_time(const led_sequence_t *seq)
+{
+    return seq->frame < seq->header->frame_count ? seq->time_ms : UINT32_MAX;
+}
+
+// Copy n pixels to the target from src, stepping src by stride (0 repeats one pixel)
+static void write_pixels(const led_sequence_target_t *target, uint32_t first, uint32_t n, const uint8_t *src,
+                         uint32_t stride)
+{
+    if (first >= target->pixel_count) {
+        return;
+    }
+    if (n > target->pixel_count - first) {
+        n = target->pixel_count - first;
+    }
+    const uint32_t step = target->bytes_per_pixel;
+    const uint8_t r = target->offset[0], g = target->offset[1], b = target->offset[2];
+    uint8_t *dst = target->buffer + first * step;
+    for (uint32_t i = 0; i < n; i++) {
+        dst[r] = src[0];
+        dst[g] = src[1];
+        dst[b] = src[2];
+        dst += step;
+        src += stride;
+    }
+}
+
+led_sequence_result_t led_sequence_decode(led_sequence_t *seq, const led_sequence_target_t *target)
+{
+    const led_sequence_header_t *header = seq->header;
+    if (seq->frame >= header->frame_count) {
+        return LED_SEQUENCE_END;
+    }
+    const uint8_t *end = seq->data + header->data_size;
+    if (end - seq->next < LED_SEQUENCE_FRAME_HEADER) {
+        return LED_SEQUENCE_CORRUPT;
+    }
+    const uint8_t *op = seq->next + LED_SEQUENCE_FRAME_HEADER;
+    const uint8_t *ops_end = op + get_u16(seq->next + 2);
+    if (ops_end > end) {
+        return LED_SEQUENCE_CORRUPT;
+    }
+    
+    uint32_t pixel = 0;
+    while (op < ops_end) {
+        uint8_t code = *op++;
+        uint32_t n;
+        if (code < LED_SEQUENCE_OP_LITERAL) {
+            n = code + 1;
+        } else if (code < LED_SEQUENCE_OP_FILL) {
+            n = (code & 0x3F) + 1;
+            if ((uint32_t)(ops_end - op) < 3 * n || pixel + n > header->pixel_count) {
+                return LED_SEQUENCE_CORRUPT;
+            }
+            write_pixels(target, pixel, n, op, 3);
+            op += 3 * n;
+        } else {
+            n = (code & 0x7F) + 1;
+            if (ops_end - op < 3 || pixel + n > header->pixel_count) {
+                return LED_SEQUENCE_CORRUPT;
+            }
+            write_pixels(target, pixel, n, op, 0);
+            op += 3;
+        }
+        pixel += n;
+    }
+    if (pixel > header->pixel_count) {
+        return LED_SEQUENCE_CORRUPT;
+    }
+    
+    seq->next = ops_end;
+    seq->frame++;
+    if (seq->frame < header->frame_count && end - ops_end >= LED_SEQUENCE_FRAME_HEADER) {
+        seq->time_ms += get_u16(ops_end);
+    }
+    return LED_SEQUENCE_FRAME;
+}
+
+size_t led_sequence_image_size(const led_sequence_header_t *header)
+{
+    size_t size = sizeof(*header) + header->data_size;
+    return (size + LED_SEQUENCE_ALIGN - 1) / LED_SEQUENCE_ALIGN * LED_SEQUENCE_ALIGN;
+}
+
+int led_sequence_list(const void *image, size_t size, const led_sequence_header_t **headers, int max)
+{
+    int count = 0;
+    size_t offset = 0;
+    while (count < max && offset < size) {
+        led_sequence_t seq;
+        if (!led_sequence_open(&seq, (const uint8_t *)image + offset, size - offset)) {
+            break;
+        }
+        headers[count++] = seq.header;
+        offset += led_sequence_image_size(seq.header);
+    }
+    return count;
+}
+
+bool led_sequence_encoder_init(led_sequence_encoder_t *enc, uint16_t pixel_count, uint8_t *previous, uint8_t *out,
+                               size_t capacity)
+{
+    if (pixel_count == 0 || pixel_count > LED_SEQUENCE_MAX_PIXELS || capacity < sizeof(led_sequence_header_t)) {
+        return false;
+    }
+    memset(enc, 0, sizeof(*enc));
+    enc->out = out;
+    enc->capacity = capacity;
+    enc->size = sizeof(led_sequence_header_t);
+    enc->previous = previous;
+    enc->pixel_count = pixel_count;
+    return true;
+}
+
+static bool same_pixel(const uint8_t *a, const uint8_t *b)
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// Pixels from first on with the same color as first, up to max
+static uint32_t run_length(const uint8_t *rgb, uint32_t first, uint32_t count, uint32_t max)
+{
+    uint32_t n = 1;
+    while (first + n < count && n < max && same_pixel(&rgb[first * 3], &rgb[(first + n) * 3])) {
+        n++;
+    }
+    return n;
+}
+
+static bool put_frame(led_sequence_encoder_t *enc, const uint8_t *rgb, uint32_t delay_ms)
+{
+    if (enc->capacity - enc->size < LED_SEQUENCE_FRAME_HEADER) {
+        return false;
+    }
+    uint8_t *record = enc->out + enc->size;
+    uint8_t *op = record + LED_SEQUENCE_FRAME_HEADER;
+    const uint8_t *end = enc->out + enc->capacity;
+    uint8_t *last_change = op;      // Trailing skips are implied, so they are dropped
+    const bool delta = enc->frame_count > 0;
+    const uint32_t count = enc->pixel_count;
+    
+    for (uint32_t i = 0; i < count;) {
+        uint32_t n = 1;
+        if (delta && same_pixel(&rgb[i * 3], &enc->previous[i * 3])) {
+            while (i + n < count && n < LED_SEQUENCE_SKIP_MAX &&
+                   same_pixel(&rgb[(i + n) * 3], &enc->previous[(i + n) * 3])) {
+                n++;
+            }
+            if (end - op < 1) {
+                return false;
+            }
+            *op++ = LED_SEQUENCE_OP_SKIP | (n - 1);
+        } else if ((n = run_length(rgb, i, count, LED_SEQUENCE_FILL_MAX)) >= 2) {
+            if (end - op < 4) {
+                return false;
+            }
+            *op++ = LED_SEQUENCE_OP_FILL | (n - 1);
+            memcpy(op, &rgb[i * 3], 3);
+            op += 3;
+            last_change = op;
+        } else {
+            // Literals up to an unchanged pixel or a run worth a fill
+            while (i + n < count && n < LED_SEQUENCE_LITERAL_MAX &&
+                   !(delta && same_pixel(&rgb[(i + n) * 3], &enc->previous[(i + n) * 3])) &&
+                   run_length(rgb, i + n, count, 3) < 3) {
+                n++;
+            }
+            if ((size_t)(end - op) < 1 + 3 * n) {
+                return false;
+            }
+            *op++ = LED_SEQUENCE_OP_LITERAL | (n - 1);
+            memcpy(op, &rgb[i * 3], 3 * n);
+            op += 3 * n;
+            last_change = op;
+        }
+        i += n;
+    }
+    
+    put_u16(record, delay_ms);
+    put_u16(record + 2, (uint32_t)(last_change - record - LED_SEQUENCE_FRAME_HEADER));
+    enc->size = last_change - enc->out;
+    if (rgb != enc->previous) {
+        memcpy(enc->previous, rgb, count * 3);
+    }
+    enc->frame_count++;
+    enc->time_ms += delay_ms;
+    return true;
+}
+
+bool led_sequence_encode_frame(led_sequence_encoder_t *enc, const uint8_t *rgb, uint32_t delay_ms)
+{
+    if (enc->frame_count == 0) {
+        delay_ms = 0;
+    }
+    while (delay_ms > UINT16_MAX) {
+        if (!put_frame(enc, enc->previous, UINT16_MAX)) {
+            return false;
+        }
+        delay_ms -= UINT16_MAX;
+    }
+    return put_frame(enc, rgb, delay_ms);
+}
+
+size_t led_sequence_encoder_finish(led_sequence_encoder_t *enc, const char *name, uint16_t frame_rate_hz,
+                                   uint32_t hold_ms, uint8_t flags)
+{
+    led_sequence_header_t header = {
+        .version = LED_SEQUENCE_VERSION,
+        .flags = flags,
+        .pixel_count = enc->pixel_count,
+        .frame_count = enc->frame_count,
+        .data_size = (uint32_t)(enc->size - sizeof(header)),
+        .duration_ms = enc->time_ms + hold_ms,
+        .frame_rate_hz = frame_rate_hz,
+    };
+    memcpy(header.magic, LED_SEQUENCE_MAGIC, sizeof(header.magic));
+    strncpy(header.name, name ? name : "", sizeof(header.name) - 1);
+    memcpy(enc->out, &header, sizeof(header));
+    return enc->size;
+}
@@ -0,0 +1,164 @@
+// Benchmark and check the LED sequence decoder on the host.
+//
+// Encodes each synthetic pattern (seq_gen.h), decodes it back into a GRB
+// strip buffer as the player does, and checks every frame against the
+// source. Reports the compressed size and the decode time per frame and
+// per pixel, then feeds corrupted copies to the decoder, which must reject
+// or survive them without writing outside the buffer.
+//
+//     cc -O2 -I../include -o seq_bench seq_bench.c ../led_sequence.c -lm
+//     ./seq_bench                       144 LEDs, 3000 frames per pattern
+//     ./seq_bench --leds 1024 --frames 500
+//
+// Exits 1 if a decoded frame differs from its source or a corrupted
+// sequence writes out of bounds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "led_sequence.h"
+#include "seq_gen.h"
+
+#define FPS         50
+#define GUARD       64      // Bytes checked on either side of the strip buffer
+#define FUZZ_ROUNDS 2000
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// GRB like a WS2812B strip, with guard bytes around it
+static uint8_t *strip_buffer(int leds, led_sequence_target_t *target)
+{
+    uint8_t *mem = malloc(leds * 3 + 2 * GUARD);
+    memset(mem, 0xA5, leds * 3 + 2 * GUARD);
+    *target = (led_sequence_target_t){
+        .buffer = mem + GUARD,
+        .pixel_count = leds,
+        .bytes_per_pixel = 3,
+        .offset = { 1, 0, 2 },
+    };
+    return mem;
+}
+
+static bool guards_intact(const uint8_t *mem, int leds)
+{
+    for (int i = 0; i < GUARD; i++) {
+        if (mem[i] != 0xA5 || mem[GUARD + leds * 3 + i] != 0xA5) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int leds = 144;
+    uint32_t frames = 3000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "--leds")) {
+            leds = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--frames")) {
+            frames = (uint32_t)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--leds N] [--frames N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (leds < 1 || leds > LED_SEQUENCE_MAX_PIXELS || frames < 1) {
+        fprintf(stderr, "--leds 1-%d, --frames at least 1\n", LED_SEQUENCE_MAX_PIXELS);
+        return 2;
+    }
+    
+    size_t raw = (size_t)frames * leds * 3;
+    size_t capacity = raw + frames * (LED_SEQUENCE_FRAME_HEADER + leds / 8 + 8) + sizeof(led_sequence_header_t);
+    uint8_t *source = malloc(raw);
+    uint8_t *encoded = malloc(capacity);
+    uint8_t *previous = malloc(leds * 3);
+    led_sequence_target_t target;
+    uint8_t *mem = strip_buffer(leds, &target);
+    int failures = 0;
+    srand(1);
+    
+    printf("%d LEDs, %u frames at %d Hz\n", leds, frames, FPS);
+    printf("%-8s %12s %8s %14s %12s\n", "pattern", "bytes/frame", "of raw", "decode/frame", "per pixel");
+    for (size_t p = 0; p < SEQ_GEN_PATTERNS; p++) {
+        const char *pattern = seq_gen_patterns[p];
+        led_sequence_encoder_t enc;
+        led_sequence_encoder_init(&enc, (uint16_t)leds, previous, encoded, capacity);
+        for (uint32_t n = 0; n < frames; n++) {
+            seq_gen_frame(pattern, n, leds, FPS, &source[(size_t)n * leds * 3]);
+            led_sequence_encode_frame(&enc, &source[(size_t)n * leds * 3], 1000 / FPS);
+        }
+        size_t size = led_sequence_encoder_finish(&enc, pattern, FPS, 1000 / FPS, LED_SEQUENCE_FLAG_LOOP);
+        
+        // Every frame must come back exactly, in the strip's channel order
+        led_sequence_t seq;
+        led_sequence_open(&seq, encoded, size);
+        for (uint32_t n = 0; n < frames; n++) {
+            if (led_sequence_decode(&seq, &target) != LED_SEQUENCE_FRAME) {
+                printf("%s: frame %u did not decode\n", pattern, n);
+                failures++;
+                break;
+            }
+            const uint8_t *src = &source[(size_t)n * leds * 3];
+            for (int i = 0; i < leds; i++) {
+                const uint8_t *px = &target.buffer[i * 3];
+                if (px[1] != src[i * 3] || px[0] != src[i * 3 + 1] || px[2] != src[i * 3 + 2]) {
+                    printf("%s: frame %u pixel %d differs\n", pattern, n, i);
+                    failures++;
+                    n = frames;
+                    break;
+                }
+            }
+        }
+        if (led_sequence_decode(&seq, &target) != LED_SEQUENCE_END) {
+            printf("%s: no end after %u frames\n", pattern, frames);
+            failures++;
+        }
+        
+        // Decode time, looping the sequence as the player does
+        uint32_t decoded = 0;
+        uint64_t start = now_ns(), elapsed;
+        do {
+            led_sequence_rewind(&seq);
+            while (led_sequence_decode(&seq, &target) == LED_SEQUENCE_FRAME) {
+                decoded++;
+            }
+            elapsed = now_ns() - start;
+        } while (elapsed < 200000000);
+        double ns = (double)elapsed / decoded;
+        printf("%-8s %12.1f %7.1f%% %11.0f ns %9.2f ns\n", pattern, (double)enc.size / frames,
+               100.0 * size / raw, ns, ns / leds);
+        
+        // Corrupted copies: any result is fine, writing outside the strip is not
+        uint8_t *copy = malloc(size);
+        for (int round = 0; round < FUZZ_ROUNDS; round++) {
+            memcpy(copy, encoded, size);
+            for (int k = 0; k < 4; k++) {
+                size_t at = sizeof(led_sequence_header_t) + rand() % (size - sizeof(led_sequence_header_t));
+                copy[at] = (uint8_t)rand();
+            }
+            if (!led_sequence_open(&seq, copy, size)) {
+                continue;
+            }
+            while (led_sequence_decode(&seq, &target) == LED_SEQUENCE_FRAME) {
+            }
+        }
+        free(copy);
+        if (!guards_intact(mem, leds)) {
+            printf("%s: corrupted sequence wrote outside the strip buffer\n", pattern);
+            failures++;
+        }
+    }
+    
+    free(source);
+    free(encoded);
+    free(previous);
+    free(mem);
+    return failures ? 1 : 0;
+}
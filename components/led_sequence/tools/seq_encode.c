@@ -0,0 +1,269 @@
+// Encode LED sequences into an image for the "sequences" flash partition.
+//
+// Frames come from a recorded session as CSV, from raw RGB frames, or from
+// a built-in pattern. Each run adds one sequence to the image; the device
+// lists and plays them with the "seq" console command. Flash the image with
+//     parttool.py write_partition --partition-name sequences --input sequences.bin
+//
+//     cc -O2 -I../include -o seq_encode seq_encode.c ../led_sequence.c -lm
+//     ./seq_encode --gen rainbow --leds 60 --seconds 10 --name rainbow -o sequences.bin
+//     ./seq_encode --csv session.csv --leds 60 --name session --append -o sequences.bin
+//     ./seq_encode --raw clip.rgb --leds 60 --fps 30 --name clip --loop --append -o sequences.bin
+//     ./seq_encode --list sequences.bin
+//
+// CSV lines are "time_ms,r,g,b" (the whole strip one color, as the picker
+// shows it) or "time_ms,r,g,b,r,g,b,..." for each pixel; times are from the
+// start and lines starting with # are skipped. Raw input is leds * 3 bytes
+// of RGB per frame at --fps; patterns are breathe, chase, sparkle, rainbow.
+//
+// Options: --fps N (playback tick, and frame rate of raw input and patterns,
+// default 50), --hold MS (time the last frame is shown, default one tick),
+// --loop (loop by default), --size N (partition size, default 0x70000 as in
+// partitions.csv). Exits 1 if the image would not fit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "led_sequence.h"
+#include "seq_gen.h"
+
+#define MAX_SEQUENCES 64
+
+typedef struct {
+    int leds;
+    int fps;
+    double seconds;
+    uint32_t hold_ms;
+    uint8_t flags;
+    size_t partition_size;
+    const char *name;
+    const char *output;
+    bool append;
+} options_t;
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(len > 0 ? len : 1);
+    *size = len > 0 ? fread(data, 1, len, f) : 0;
+    fclose(f);
+    return data;
+}
+
+// Bytes used by the sequences already in an image
+static size_t image_used(const uint8_t *image, size_t size, int *count)
+{
+    const led_sequence_header_t *headers[MAX_SEQUENCES];
+    *count = led_sequence_list(image, size, headers, MAX_SEQUENCES);
+    size_t used = 0;
+    for (int i = 0; i < *count; i++) {
+        used += led_sequence_image_size(headers[i]);
+    }
+    return used;
+}
+
+static int list(const char *path)
+{
+    size_t size;
+    uint8_t *image = read_file(path, &size);
+    if (!image) {
+        perror(path);
+        return 1;
+    }
+    const led_sequence_header_t *headers[MAX_SEQUENCES];
+    int count = led_sequence_list(image, size, headers, MAX_SEQUENCES);
+    for (int i = 0; i < count; i++) {
+        const led_sequence_header_t *h = headers[i];
+        printf("%2d %-16s %5u frames %4u px %7.1f s %3u Hz %7u bytes (%.1f%% of raw)%s\n", i, h->name,
+               h->frame_count, h->pixel_count, h->duration_ms / 1000.0, h->frame_rate_hz, h->data_size,
+               100.0 * h->data_size / ((double)h->frame_count * h->pixel_count * 3),
+               h->flags & LED_SEQUENCE_FLAG_LOOP ? " loop" : "");
+    }
+    printf("%d sequences, %zu of %zu bytes\n", count, image_used(image, size, &count), size);
+    free(image);
+    return 0;
+}
+
+static bool encode_csv(led_sequence_encoder_t *enc, const options_t *opt, FILE *in, uint8_t *frame)
+{
+    char line[16384];
+    long last_ms = -1;
+    while (fgets(line, sizeof(line), in)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        char *p = line;
+        long ms = strtol(p, &p, 10);
+        uint8_t values[LED_SEQUENCE_MAX_PIXELS * 3];
+        int n = 0;
+        while (*p == ',' && n < (int)sizeof(values)) {
+            values[n++] = (uint8_t)strtol(p + 1, &p, 10);
+        }
+        if (n < 3 || ms < last_ms) {
+            fprintf(stderr, "bad line: %s", line);
+            return false;
+        }
+        for (int i = 0; i < opt->leds; i++) {
+            memcpy(&frame[i * 3], n >= (i + 1) * 3 ? &values[i * 3] : values, 3);
+        }
+        if (!led_sequence_encode_frame(enc, frame, last_ms < 0 ? 0 : (uint32_t)(ms - last_ms))) {
+            return false;
+        }
+        last_ms = ms;
+    }
+    return true;
+}
+
+static bool encode_raw(led_sequence_encoder_t *enc, const options_t *opt, FILE *in, uint8_t *frame)
+{
+    uint32_t n = 0;
+    while (fread(frame, 3, opt->leds, in) == (size_t)opt->leds) {
+        // Delays on the tick grid, without drift from rounding
+        uint32_t delay = (uint32_t)((n + 1) * 1000ull / opt->fps - n * 1000ull / opt->fps);
+        if (!led_sequence_encode_frame(enc, frame, delay)) {
+            return false;
+        }
+        n++;
+    }
+    return true;
+}
+
+static bool encode_pattern(led_sequence_encoder_t *enc, const options_t *opt, const char *pattern, uint8_t *frame)
+{
+    uint32_t frames = (uint32_t)(opt->seconds * opt->fps);
+    for (uint32_t n = 0; n < frames; n++) {
+        if (!seq_gen_frame(pattern, n, opt->leds, opt->fps, frame)) {
+            fprintf(stderr, "unknown pattern %s\n", pattern);
+            exit(2);
+        }
+        uint32_t delay = (uint32_t)((n + 1) * 1000ull / opt->fps - n * 1000ull / opt->fps);
+        if (!led_sequence_encode_frame(enc, frame, delay)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s (--gen PATTERN --seconds N | --csv FILE | --raw FILE) --leds N [--fps N] [--hold MS]\n"
+            "          [--loop] [--name NAME] [--append] [--size N] -o IMAGE\n"
+            "       %s --list IMAGE\n",
+            prog, prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    options_t opt = { .leds = 0, .fps = 50, .seconds = 10, .partition_size = 0x70000, .name = "sequence" };
+    const char *gen = NULL, *csv = NULL, *raw = NULL;
+    bool hold_set = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--loop")) {
+            opt.flags |= LED_SEQUENCE_FLAG_LOOP;
+        } else if (!strcmp(argv[i], "--append")) {
+            opt.append = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--list")) {
+            return list(argv[i + 1]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--gen")) {
+            gen = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "--csv")) {
+            csv = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "--raw")) {
+            raw = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "--leds")) {
+            opt.leds = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--fps")) {
+            opt.fps = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--seconds")) {
+            opt.seconds = atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--hold")) {
+            opt.hold_ms = (uint32_t)atoi(argv[++i]);
+            hold_set = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--name")) {
+            opt.name = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "--size")) {
+            opt.partition_size = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-o")) {
+            opt.output = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!opt.output || (!gen + !csv + !raw) != 2 || opt.leds < 1 || opt.leds > LED_SEQUENCE_MAX_PIXELS ||
+        opt.fps < 1 || opt.fps > 1000) {
+        usage(argv[0]);
+    }
+    if (!hold_set) {
+        opt.hold_ms = 1000 / opt.fps;
+    }
+    
+    // Whatever is in the image already stays; the new sequence goes after it
+    size_t image_size = 0;
+    uint8_t *image = opt.append ? read_file(opt.output, &image_size) : NULL;
+    int existing = 0;
+    size_t used = image ? image_used(image, image_size, &existing) : 0;
+    if (used >= opt.partition_size) {
+        fprintf(stderr, "%s is full\n", opt.output);
+        return 1;
+    }
+    
+    size_t capacity = opt.partition_size - used;
+    uint8_t *out = malloc(capacity);
+    uint8_t *previous = malloc(opt.leds * 3);
+    uint8_t *frame = calloc(opt.leds, 3);
+    led_sequence_encoder_t enc;
+    led_sequence_encoder_init(&enc, (uint16_t)opt.leds, previous, out, capacity);
+    
+    bool fits;
+    if (gen) {
+        fits = encode_pattern(&enc, &opt, gen, frame);
+    } else {
+        FILE *in = fopen(csv ? csv : raw, csv ? "r" : "rb");
+        if (!in) {
+            perror(csv ? csv : raw);
+            return 1;
+        }
+        fits = csv ? encode_csv(&enc, &opt, in, frame) : encode_raw(&enc, &opt, in, frame);
+        fclose(in);
+    }
+    if (!fits) {
+        fprintf(stderr, "%s does not fit in the %zu bytes left after %d sequences\n", opt.name, capacity, existing);
+        return 1;
+    }
+    if (enc.frame_count == 0) {
+        fprintf(stderr, "no frames\n");
+        return 1;
+    }
+    size_t size = led_sequence_encoder_finish(&enc, opt.name, (uint16_t)opt.fps, opt.hold_ms, opt.flags);
+    
+    // Sector-aligned, padded like erased flash
+    FILE *f = fopen(opt.output, "wb");
+    if (!f) {
+        perror(opt.output);
+        return 1;
+    }
+    fwrite(image, 1, used, f);
+    fwrite(out, 1, size, f);
+    for (size_t pad = size; pad % LED_SEQUENCE_ALIGN; pad++) {
+        fputc(0xFF, f);
+    }
+    fclose(f);
+    
+    const led_sequence_header_t *h = (const led_sequence_header_t *)out;
+    printf("%s: %u frames, %u bytes (%.1f%% of raw), sequence %d of %s, %zu of %zu bytes used\n", opt.name,
+           h->frame_count, h->data_size, 100.0 * h->data_size / ((double)h->frame_count * opt.leds * 3), existing,
+           opt.output, used + led_sequence_image_size(h), opt.partition_size);
+    free(image);
+    free(out);
+    free(previous);
+    free(frame);
+    return 0;
+}
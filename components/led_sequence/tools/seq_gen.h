@@ -0,0 +1,64 @@
+// Synthetic frames shared by seq_encode and seq_bench. Each pattern stresses
+// a different op: breathe is one color (fills), chase moves a short tail
+// (skips), sparkle changes a few random pixels (skips and literals) and
+// rainbow scrolls a gradient, changing every pixel (literals).
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const seq_gen_patterns[] = { "breathe", "chase", "sparkle", "rainbow" };
+#define SEQ_GEN_PATTERNS (sizeof(seq_gen_patterns) / sizeof(seq_gen_patterns[0]))
+
+static void seq_gen_hue(double h, uint8_t *rgb)
+{
+    h -= floor(h);
+    for (int c = 0; c < 3; c++) {
+        double x = fabs(fmod(h * 6 + (4 - 2 * c), 6) - 3) - 1;
+        x = x < 0 ? 0 : x > 1 ? 1 : x;
+        rgb[c] = (uint8_t)lround(x * 255);
+    }
+}
+
+// Frame n of a pattern at fps into rgb (leds * 3 bytes); returns 0 for an unknown pattern
+static int seq_gen_frame(const char *pattern, uint32_t n, int leds, int fps, uint8_t *rgb)
+{
+    double t = (double)n / fps;
+    if (!strcmp(pattern, "breathe")) {
+        uint8_t color[3];
+        seq_gen_hue(t / 20, color);
+        double level = 0.5 - 0.5 * cos(t * 2 * M_PI / 4);
+        for (int i = 0; i < leds; i++) {
+            for (int c = 0; c < 3; c++) {
+                rgb[i * 3 + c] = (uint8_t)lround(color[c] * level);
+            }
+        }
+    } else if (!strcmp(pattern, "chase")) {
+        int head = (int)(t * 30) % leds;
+        memset(rgb, 0, leds * 3);
+        for (int k = 0; k < 6 && k < leds; k++) {
+            int i = (head - k + leds) % leds;
+            rgb[i * 3] = (uint8_t)(255 >> k);
+            rgb[i * 3 + 1] = (uint8_t)(96 >> k);
+        }
+    } else if (!strcmp(pattern, "sparkle")) {
+        // Each pixel lights up for 8 frames at a pseudo-random time
+        for (int i = 0; i < leds; i++) {
+            uint32_t phase = (uint32_t)i * 2654435761u >> 7;
+            uint32_t age = (n + phase) % 97;
+            uint8_t v = age < 8 ? (uint8_t)(255 - age * 32) : 0;
+            rgb[i * 3] = v;
+            rgb[i * 3 + 1] = v;
+            rgb[i * 3 + 2] = v;
+        }
+    } else if (!strcmp(pattern, "rainbow")) {
+        for (int i = 0; i < leds; i++) {
+            seq_gen_hue((double)i / leds + t / 5, &rgb[i * 3]);
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
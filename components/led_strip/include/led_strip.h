@@ -16,21 +16,71 @@ typedef struct led_strip_s led_strip_t;
  */
 typedef void *led_strip_dev_t;
 
+/**
+ * @brief Order and number of color channels on the wire
+ */
+typedef enum {
+    LED_PIXEL_FORMAT_GRB,   /*!< WS2812B and most clones */
+    LED_PIXEL_FORMAT_RGB,   /*!< WS2811 modules and some WS2812 variants */
+    LED_PIXEL_FORMAT_BRG,   /*!< Some WS2811 strings */
+    LED_PIXEL_FORMAT_GRBW,  /*!< SK6812 RGBW */
+    LED_PIXEL_FORMAT_RGBW,  /*!< RGBW variants with red first */
+} led_pixel_format_t;
+
+/**
+ * @brief Bytes per pixel of a pixel format (a constant expression)
+ */
+#define LED_PIXEL_FORMAT_BYTES(format) ((format) >= LED_PIXEL_FORMAT_GRBW ? 4 : 3)
+
+/**
+ * @brief Bit timing of the one-wire protocol
+ */
+typedef struct {
+    uint32_t t0h_ns;    /*!< High time of a 0 bit */
+    uint32_t t0l_ns;    /*!< Low time of a 0 bit */
+    uint32_t t1h_ns;    /*!< High time of a 1 bit */
+    uint32_t t1l_ns;    /*!< Low time of a 1 bit */
+    uint32_t reset_us;  /*!< Minimum low time that latches a frame */
+} led_strip_timing_t;
+
+/**
+ * @brief Timing presets
+ */
+#define LED_STRIP_TIMING_WS2812 { .t0h_ns = 350, .t0l_ns = 900, .t1h_ns = 900, .t1l_ns = 350, .reset_us = 50 }
+#define LED_STRIP_TIMING_SK6812 { .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 600, .t1l_ns = 600, .reset_us = 80 }
+#define LED_STRIP_TIMING_WS2811 { .t0h_ns = 250, .t0l_ns = 1000, .t1h_ns = 600, .t1l_ns = 650, .reset_us = 50 } /* 800 kHz mode */
+
+/**
+ * @brief Where each color channel lives in the pixel buffer
+ */
+typedef struct {
+    uint32_t pixel_count;       /*!< Number of pixels in the buffer */
+    uint8_t bytes_per_pixel;    /*!< 3 for RGB formats, 4 for RGBW */
+    uint8_t red_offset;         /*!< Byte offset of red within a pixel */
+    uint8_t green_offset;       /*!< Byte offset of green within a pixel */
+    uint8_t blue_offset;        /*!< Byte offset of blue within a pixel */
+    int8_t white_offset;        /*!< Byte offset of white, -1 if the format has none */
+} led_strip_layout_t;
+
 /**
  * @brief LED Strip Configuration Type
  */
 typedef struct {
-    uint32_t max_leds;       /*!< Maximum number of LEDs in the strip */
-    led_strip_dev_t dev;     /*!< LED strip device (e.g. RMT channel or SPI device) */
+    uint32_t max_leds;              /*!< Maximum number of LEDs in the strip */
+    led_strip_dev_t dev;            /*!< LED strip device (e.g. RMT channel or SPI device) */
+    led_pixel_format_t pixel_format; /*!< Channel order and count */
+    led_strip_timing_t timing;      /*!< Bit timing */
 } led_strip_config_t;
 
 /**
- * @brief Default LED Strip Configuration
+ * @brief Default LED Strip Configuration (WS2812B, GRB)
  */
 #define LED_STRIP_DEFAULT_CONFIG(number_of_leds, dev_handle) \
     {                                                 \
         .max_leds = number_of_leds,                   \
         .dev = dev_handle,                           \
+        .pixel_format = LED_PIXEL_FORMAT_GRB,         \
+        .timing = LED_STRIP_TIMING_WS2812,            \
     }
 
 /**
@@ -53,6 +103,24 @@ struct led_strip_s {
      */
     esp_err_t (*set_pixel)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
 
+    /**
+     * @brief Set RGBW for a specific pixel
+     *
+     * @note On strips without a white channel the white component is ignored
+     *
+     * @param strip: LED strip
+     * @param index: Index of pixel to set
+     * @param red: Red component
+     * @param green: Green component
+     * @param blue: Blue component
+     * @param white: White component
+     *
+     * @return
+     *      - ESP_OK: Set RGBW for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGBW for a specific pixel failed because of invalid parameters
+     */
+    esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
     /**
      * @brief Refresh memory colors to LEDs
      *
@@ -61,11 +129,85 @@ struct led_strip_s {
      *
      * @return
      *      - ESP_OK: Refresh successfully
-     *      - ESP_ERR_TIMEOUT: Refresh failed because of timeout
+     *      - ESP_ERR_TIMEOUT: Refresh failed because of timeout; if the previous frame was
+     *        still being sent, nothing new was sent
      *      - ESP_FAIL: Refresh failed because some other error occurred
      */
     esp_err_t (*refresh)(led_strip_t *strip, uint32_t timeout_ms);
 
+    /**
+     * @brief Start sending memory colors to LEDs without waiting
+     *
+     * @note The pixel buffer is read while the frame is sent; call wait_refresh_done
+     *       before changing pixels again
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Transmission started
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
+    /**
+     * @brief Wait for a refresh started by refresh_async to finish
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: Timeout value for waiting
+     *
+     * @return
+     *      - ESP_OK: No transmission in progress
+     *      - ESP_ERR_TIMEOUT: Still transmitting
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, uint32_t timeout_ms);
+
+    /**
+     * @brief Get direct access to the pixel buffer
+     *
+     * Pixels are stored in wire order; the layout says where each channel is,
+     * so producers can write straight into the buffer instead of calling
+     * set_pixel for every pixel. Announce each run of direct writes with
+     * mark_dirty before making it, and finish it with commit.
+     *
+     * @param strip: LED strip
+     * @param buffer: Receives the pixel buffer (pixel_count * bytes_per_pixel bytes)
+     * @param layout: Receives the buffer layout
+     *
+     * @return
+     *      - ESP_OK: Buffer returned
+     *      - ESP_ERR_INVALID_ARG: Invalid parameters
+     */
+    esp_err_t (*get_buffer)(led_strip_t *strip, uint8_t **buffer, led_strip_layout_t *layout);
+
+    /**
+     * @brief Announce direct writes to pixels of the buffer from get_buffer
+     *
+     * Call before writing the pixels. State the strip keeps about the buffer
+     * contents (the WS2812 power estimate) then only revisits these pixels,
+     * not the whole strip. Ranges marked before the same commit may overlap.
+     *
+     * @param strip: LED strip
+     * @param start: First pixel to be written
+     * @param count: Number of pixels
+     *
+     * @return
+     *      - ESP_OK: Pixels marked
+     *      - ESP_ERR_INVALID_ARG: Range outside the strip
+     */
+    esp_err_t (*mark_dirty)(led_strip_t *strip, uint32_t start, uint32_t count);
+
+    /**
+     * @brief Finish the direct writes announced with mark_dirty
+     *
+     * @note refresh and refresh_async commit pending writes themselves
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Writes taken into account
+     */
+    esp_err_t (*commit)(led_strip_t *strip);
+
     /**
      * @brief Clear LED strip (turn off all LEDs)
      *
@@ -94,12 +236,188 @@ struct led_strip_s {
 /**
  * @brief Create LED strip based on WS2812 driver (RMT peripheral)
  *
+ * Also drives SK6812 and WS2811 strips: byte order and timing come from the
+ * configuration. The RMT channel must already be configured.
+ *
  * @param config: LED strip configuration
  * @return
  *      LED strip instance or NULL
  */
 led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config);
 
+/**
+ * @brief Driver state ahead of the pixel buffer in static storage (checked when the driver is built)
+ */
+#define LED_STRIP_WS2812_STATE_SIZE (336)
+
+/**
+ * @brief Declare storage for led_strip_new_rmt_ws2812_static, sized at compile time
+ *
+ * Example: static LED_STRIP_WS2812_STORAGE(strip_storage, 60, LED_PIXEL_FORMAT_GRB);
+ */
+#define LED_STRIP_WS2812_STORAGE(name, max_leds, pixel_format) \
+    uint32_t name[(LED_STRIP_WS2812_STATE_SIZE + (max_leds) * LED_PIXEL_FORMAT_BYTES(pixel_format) + 3) / 4]
+
+/**
+ * @brief Create a WS2812 strip without allocating: state and pixel buffer live in storage
+ *
+ * Same as led_strip_new_rmt_ws2812 otherwise. del leaves the storage to the caller.
+ *
+ * @param config: LED strip configuration
+ * @param storage: Word-aligned storage, usually from LED_STRIP_WS2812_STORAGE
+ * @param size: Size of storage in bytes
+ * @return
+ *      LED strip instance, or NULL if the configuration is invalid or storage too small
+ */
+led_strip_t *led_strip_new_rmt_ws2812_static(const led_strip_config_t *config, void *storage, size_t size);
+
+/**
+ * @brief Result of verifying the RMT waveform of a WS2812 strip
+ */
+typedef struct {
+    uint32_t items;          /*!< RMT items produced (one per bit), test pattern included */
+    uint32_t timing_errors;  /*!< Items with a high or low period outside the datasheet tolerance */
+    uint32_t data_errors;    /*!< Bytes that decode to a different value than they should */
+    uint32_t frame_time_us;  /*!< Wire time of one refresh of the pixel buffer, including the reset gap */
+    uint32_t max_fps;        /*!< Refresh rate limit implied by frame_time_us */
+} led_strip_ws2812_timing_report_t;
+
+/**
+ * @brief Encode the current pixel buffer without transmitting and verify the waveform
+ *
+ * Runs the RMT encoder in the same chunked way as the RMT driver, decodes
+ * the items back to pixel bytes and checks every period against the strip's
+ * timing (+/-150ns) using the channel's real counter clock. A fixed test
+ * pattern (0x00, 0xFF, alternating bits) is encoded unscaled ahead of the
+ * buffer, so both bit shapes are checked even on a cleared strip. The pixel
+ * buffer is not modified.
+ *
+ * @param strip: LED strip created by led_strip_new_rmt_ws2812
+ * @param report: Filled with counts and wire time
+ * @return
+ *      - ESP_OK: Waveform decodes to the buffer and all periods are within tolerance
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ *      - ESP_FAIL: Timing or data errors (see report)
+ */
+esp_err_t led_strip_ws2812_verify(led_strip_t *strip, led_strip_ws2812_timing_report_t *report);
+
+/**
+ * @brief Brightness ceiling and supply budget of a WS2812 strip
+ *
+ * The draw is estimated as idle_ma_per_led for every LED plus ma_per_channel
+ * for each channel at full value, linear in the channel value.
+ */
+typedef struct {
+    uint32_t budget_ma;         /*!< Current the strip may draw, 0 for no limit */
+    uint16_t ma_per_channel;    /*!< Draw of one color channel at 255 (about 12-20 mA for WS2812B) */
+    uint16_t idle_ma_per_led;   /*!< Draw of a dark LED (about 1 mA) */
+    uint8_t max_brightness;     /*!< Brightness ceiling, 255 for full output */
+} led_strip_power_config_t;
+
+/**
+ * @brief Power limiter off: full brightness, no budget
+ */
+#define LED_STRIP_POWER_UNLIMITED { .budget_ma = 0, .ma_per_channel = 20, .idle_ma_per_led = 1, .max_brightness = 255 }
+
+/**
+ * @brief Power estimate of the last frame sent
+ */
+typedef struct {
+    uint32_t demand_ma;         /*!< Draw the buffer would cause at full brightness, after color correction */
+    uint32_t output_ma;         /*!< Estimated draw after brightness and budget scaling */
+    uint16_t scale;             /*!< Output scale applied, 256 = unscaled */
+    uint32_t limited_frames;    /*!< Frames the budget scaled below the brightness ceiling */
+} led_strip_power_stats_t;
+
+/**
+ * @brief Limit the brightness and the estimated current of a WS2812 strip
+ *
+ * Every refresh estimates the frame's current and scales the output to
+ * stay within the budget. Reductions take effect on the same frame, and
+ * recovery is smoothed over a few frames. The pixel buffer keeps the
+ * unscaled colors because scaling happens in the RMT encoder.
+ *
+ * The estimate is kept up to date by set_pixel at O(1) per changed pixel,
+ * and for direct writes by mark_dirty and commit at one add per byte of
+ * the marked pixels. Pixels that were not marked are never recounted.
+ * Under color correction it covers the corrected output (see
+ * led_strip_ws2812_set_color_correction).
+ *
+ * @param strip: LED strip created by led_strip_new_rmt_ws2812
+ * @param config: Limits; LED_STRIP_POWER_UNLIMITED turns limiting off
+ * @return
+ *      - ESP_OK: Limits set
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ */
+esp_err_t led_strip_ws2812_set_power_limit(led_strip_t *strip, const led_strip_power_config_t *config);
+
+/**
+ * @brief Get the power estimate of the last frame sent
+ *
+ * @param strip: LED strip created by led_strip_new_rmt_ws2812
+ * @param stats: Filled with the estimate
+ * @return
+ *      - ESP_OK: Stats returned
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ */
+esp_err_t led_strip_ws2812_get_power_stats(led_strip_t *strip, led_strip_power_stats_t *stats);
+
+/**
+ * @brief Unity in color correction matrices (Q12)
+ */
+#define LED_STRIP_COLOR_ONE (4096)
+
+/**
+ * @brief Color correction of a WS2812 strip
+ *
+ * Each output channel is a row of the matrix applied to the pixel's red,
+ * green and blue, clamped to 0-255, then multiplied by the pixel's own gain
+ * and by the brightness/power scale. White is only scaled. Coefficients may
+ * be negative (crosstalk compensation) and up to about 8.
+ */
+typedef struct {
+    int16_t matrix[3][3];       /*!< Rows for red, green and blue out, Q12 (LED_STRIP_COLOR_ONE = 1.0) */
+    const uint8_t *pixel_gains; /*!< Per-pixel gains in R, G, B(, W) order, bytes_per_pixel per pixel,
+                                     gain (g + 1) / 256 so 255 is unity; NULL for none. Must stay valid,
+                                     unchanged and in internal RAM while in use: it is read from the RMT
+                                     interrupt. To change gains, fill a second table and set that */
+} led_strip_color_correction_t;
+
+/**
+ * @brief No correction: identity matrix, no per-pixel gains
+ */
+#define LED_STRIP_COLOR_CORRECTION_NONE                                 \
+    {                                                                   \
+        .matrix = { { LED_STRIP_COLOR_ONE, 0, 0 },                      \
+                    { 0, LED_STRIP_COLOR_ONE, 0 },                      \
+                    { 0, 0, LED_STRIP_COLOR_ONE } },                    \
+        .pixel_gains = NULL,                                            \
+    }
+
+/**
+ * @brief Set the color correction of a WS2812 strip
+ *
+ * Applied in fixed point by the RMT encoder as the frame is sent, so the
+ * pixel buffer keeps the uncorrected colors, like brightness scaling. It
+ * costs 12 multiplies per pixel, linear in the strip length and well
+ * below the wire time of a pixel.
+ *
+ * The correction is copied and latched at the next refresh, after the
+ * frame being sent is out, so a frame never mixes two corrections. A
+ * previous gain table is no longer read once that refresh has started.
+ * The power estimate is of the corrected output: for each input channel,
+ * the positive coefficients of its matrix column times the highest gain of
+ * each output channel, which bounds the draw from above. Setting gains
+ * reads the whole table once to find those.
+ *
+ * @param strip: LED strip created by led_strip_new_rmt_ws2812
+ * @param correction: Matrix and gains; LED_STRIP_COLOR_CORRECTION_NONE turns correction off
+ * @return
+ *      - ESP_OK: Correction set
+ *      - ESP_ERR_INVALID_ARG: Invalid parameters
+ */
+esp_err_t led_strip_ws2812_set_color_correction(led_strip_t *strip, const led_strip_color_correction_t *correction);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
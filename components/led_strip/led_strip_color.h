@@ -0,0 +1,53 @@
+// Fixed-point color correction of one pixel, shared by the WS2812 encoder
+// and the host accuracy check in tools/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Matrix coefficients are Q12 (4096 = 1.0, LED_STRIP_COLOR_ONE)
+#define LED_COLOR_MATRIX_SHIFT (12)
+
+typedef struct {
+    int16_t matrix[9];          // Rows for red, green and blue out, columns red, green, blue in
+    const uint8_t *gains;       // Per-pixel gains in R, G, B(, W) order, (gain + 1) / 256; NULL for none
+    uint8_t gain_stride;        // Gain bytes per pixel
+} led_color_correct_t;
+
+// Clamp a Q12 channel sum, then apply scale (Q8) times gain (Q8) with a single rounding.
+// The product stays below 2^32: 0xFF00 * 0x10000 + 2^23.
+static inline __attribute__((always_inline)) uint8_t led_color_channel(int32_t sum, uint32_t factor)
+{
+    int32_t value = (sum + (1 << (LED_COLOR_MATRIX_SHIFT - 9))) >> (LED_COLOR_MATRIX_SHIFT - 8); // Q8
+    if (value < 0) {
+        value = 0;
+    } else if (value > (255 << 8)) {
+        value = 255 << 8;
+    }
+    return (uint8_t)(((uint32_t)value * factor + (1u << 23)) >> 24);
+}
+
+// Correct pixel index: in and out are R, G, B(, W); white is not mixed, only scaled
+static inline __attribute__((always_inline)) void led_color_correct(const led_color_correct_t *correct, uint32_t index,
+                                                                    uint32_t scale, const uint8_t *in, uint8_t *out,
+                                                                    bool white)
+{
+    const int16_t *m = correct->matrix;
+    const int32_t r = in[0], g = in[1], b = in[2];
+    uint32_t factor[4] = { scale << 8, scale << 8, scale << 8, scale << 8 };
+    if (correct->gains) {
+        const uint8_t *gain = &correct->gains[index * correct->gain_stride];
+        factor[0] = scale * (gain[0] + 1u);
+        factor[1] = scale * (gain[1] + 1u);
+        factor[2] = scale * (gain[2] + 1u);
+        if (white) {
+            factor[3] = scale * (gain[3] + 1u);
+        }
+    }
+    out[0] = led_color_channel(m[0] * r + m[1] * g + m[2] * b, factor[0]);
+    out[1] = led_color_channel(m[3] * r + m[4] * g + m[5] * b, factor[1]);
+    out[2] = led_color_channel(m[6] * r + m[7] * g + m[8] * b, factor[2]);
+    if (white) {
+        out[3] = led_color_channel(in[3] << LED_COLOR_MATRIX_SHIFT, factor[3]);
+    }
+}
@@ -3,87 +3,352 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
 #include "led_strip.h"
+#include "led_strip_color.h"
 #include "driver/rmt.h"
 
 static const char *TAG = "ws2812";
 
-// WS2812 timing parameters (in microseconds)
-#define WS2812_T0H_NS (350)
-#define WS2812_T0L_NS (900)
-#define WS2812_T1H_NS (900)
-#define WS2812_T1L_NS (350)
-
-// RMT clock period (in nanoseconds)
+// RMT clock period (in nanoseconds), used if the channel clock cannot be read
 #define RMT_CLK_DURATION_NS (25) // 1/(80MHz/2) = 25ns
 
+// Datasheet tolerance on each high/low period (same for WS2812B, SK6812 and WS2811)
+#define LED_TIMING_TOLERANCE_NS (150)
+
+// RMT items are fed to the translator in chunks of this many items when verifying
+#define WS2812_VERIFY_CHUNK_ITEMS (64)
+
+// Output scale is Q8: 256 sends the buffer unchanged
+#define WS2812_SCALE_ONE (256)
+
+// Power limiter: frames per step of the smoothed scale towards a higher target
+#define WS2812_POWER_RELEASE_SHIFT (3)
+
+/**
+ * @brief Per-strip encoder state, precomputed at creation
+ */
+typedef struct {
+    rmt_item32_t bits[2];   /*!< RMT items for a 0 bit and a 1 bit */
+    uint32_t scale;         /*!< Output scale for the frame being sent (Q8), latched at refresh */
+    bool correcting;        /*!< Color correction on for the frame being sent, latched at refresh */
+    led_color_correct_t correct; /*!< Matrix and gains for the frame being sent */
+    const uint8_t *frame;   /*!< Pixel buffer, to find pixel boundaries in a chunk */
+    uint8_t bytes_per_pixel;
+    uint8_t offsets[4];     /*!< Buffer offsets of red, green, blue and white in a pixel */
+} ws2812_encoder_t;
+
+/**
+ * @brief Correct the pixel at p (wire order) into out (wire order)
+ */
+static inline void IRAM_ATTR ws2812_correct_pixel(const ws2812_encoder_t *encoder, const uint8_t *p, uint32_t index,
+                                                  uint8_t *out)
+{
+    const uint8_t *offset = encoder->offsets;
+    const bool white = encoder->bytes_per_pixel == 4;
+    uint8_t in[4] = { p[offset[0]], p[offset[1]], p[offset[2]], white ? p[offset[3]] : 0 };
+    uint8_t corrected[4];
+    led_color_correct(&encoder->correct, index, encoder->scale, in, corrected, white);
+    out[offset[0]] = corrected[0];
+    out[offset[1]] = corrected[1];
+    out[offset[2]] = corrected[2];
+    if (white) {
+        out[offset[3]] = corrected[3];
+    }
+}
+
 /**
- * @brief Convert RGB data to RMT format
+ * @brief Encoder for corrected frames: whole pixels are corrected as they are reached
  *
- * @note For WS2812, the order of color components is GRB
+ * A chunk may start inside a pixel; the pixel is then corrected from its
+ * first byte, which is still in the buffer before src.
  */
-static void IRAM_ATTR ws2812_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
-                                         size_t wanted_num, size_t *translated_size, size_t *item_num)
+static inline void IRAM_ATTR ws2812_encode_corrected(const ws2812_encoder_t *encoder, const uint8_t *src,
+                                                     rmt_item32_t *dest, size_t src_size, size_t wanted_num,
+                                                     size_t *translated_size, size_t *item_num)
 {
-    if (src == NULL || dest == NULL) {
-        *translated_size = 0;
-        *item_num = 0;
+    const uint32_t bit0 = encoder->bits[0].val;
+    const uint32_t bit1 = encoder->bits[1].val;
+    const uint32_t bytes_per_pixel = encoder->bytes_per_pixel;
+    uint32_t position = src - encoder->frame;
+    uint32_t index = position / bytes_per_pixel;
+    uint32_t byte = position - index * bytes_per_pixel;
+    uint8_t pixel[4];
+    size_t size = 0;
+    size_t num = 0;
+    
+    if (byte != 0) {
+        ws2812_correct_pixel(encoder, src - byte, index, pixel);
+    }
+    while (size < src_size && num + 8 <= wanted_num) {
+        if (byte == 0) {
+            ws2812_correct_pixel(encoder, src + size, index, pixel);
+        }
+        uint8_t data = pixel[byte];
+        for (int i = 7; i >= 0; i--) {
+            dest->val = ((data >> i) & 1) ? bit1 : bit0;
+            dest++;
+        }
+        num += 8;
+        size++;
+        if (++byte == bytes_per_pixel) {
+            byte = 0;
+            index++;
+        }
+    }
+    *translated_size = size;
+    *item_num = num;
+}
+
+/**
+ * @brief Convert pixel bytes to RMT items, MSB first
+ *
+ * Byte order is already resolved when pixels are stored, so this is the same
+ * for every pixel format; only the bit items (timing) differ per strip.
+ * Brightness and power limiting scale each byte on the way out, and color
+ * correction each pixel, so the pixel buffer always keeps the unscaled colors.
+ */
+static inline void IRAM_ATTR ws2812_encode(const ws2812_encoder_t *encoder, const uint8_t *src, rmt_item32_t *dest,
+                                           size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    if (encoder->correcting) {
+        ws2812_encode_corrected(encoder, src, dest, src_size, wanted_num, translated_size, item_num);
         return;
     }
     
-    const rmt_item32_t bit0 = {{{ (WS2812_T0H_NS / RMT_CLK_DURATION_NS), 1, (WS2812_T0L_NS / RMT_CLK_DURATION_NS), 0 }}};
-    const rmt_item32_t bit1 = {{{ (WS2812_T1H_NS / RMT_CLK_DURATION_NS), 1, (WS2812_T1L_NS / RMT_CLK_DURATION_NS), 0 }}};
-    
+    const uint32_t bit0 = encoder->bits[0].val;
+    const uint32_t bit1 = encoder->bits[1].val;
+    const uint32_t scale = encoder->scale;
     size_t size = 0;
     size_t num = 0;
-    uint8_t *psrc = (uint8_t *)src;
-    rmt_item32_t *pdest = dest;
-    
-    while (size < src_size && num < wanted_num) {
-        uint8_t data = *psrc;
-        for (int i = 0; i < 8; i++) {
-            // MSB first
-            if (data & (1 << (7 - i))) {
-                pdest->val = bit1.val;
-            } else {
-                pdest->val = bit0.val;
-            }
-            num++;
-            pdest++;
+    
+    while (size < src_size && num + 8 <= wanted_num) {
+        uint8_t data = (src[size] * scale) >> 8;
+        for (int i = 7; i >= 0; i--) {
+            dest->val = ((data >> i) & 1) ? bit1 : bit0;
+            dest++;
         }
+        num += 8;
         size++;
-        psrc++;
     }
     *translated_size = size;
     *item_num = num;
 }
 
+/**
+ * @brief RMT translator callback, finds the strip's encoder through the translator context
+ */
+static void IRAM_ATTR ws2812_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
+                                         size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    ws2812_encoder_t *encoder = NULL;
+    if (src == NULL || dest == NULL || rmt_translator_get_context(item_num, (void **)&encoder) != ESP_OK) {
+        *translated_size = 0;
+        *item_num = 0;
+        return;
+    }
+    ws2812_encode(encoder, src, dest, src_size, wanted_num, translated_size, item_num);
+}
+
 typedef struct {
     led_strip_t base;
     rmt_channel_t rmt_channel;
     uint32_t strip_len;
+    uint32_t bytes_per_pixel;
+    led_strip_layout_t layout;
+    led_strip_timing_t timing;
+    uint32_t tick_ns;
+    ws2812_encoder_t encoder;
+    
+    // Power estimate: channel_sums holds the red, green, blue and white
+    // bytes of the buffer added up. set_pixel keeps them current with the
+    // difference it makes. Pixels announced by mark_dirty for direct writes,
+    // [dirty_start, dirty_end), are left out until commit adds them back.
+    uint32_t channel_sums[4];
+    uint32_t dirty_start;
+    uint32_t dirty_end;
+    led_strip_power_config_t power;
+    led_strip_power_stats_t power_stats;
+    
+    // Color correction as last set. The encoder holds the copy the frame
+    // being sent uses; refresh latches this one into it under correct_lock.
+    portMUX_TYPE correct_lock;
+    led_color_correct_t correct;
+    bool correcting;
+    uint32_t power_weights[4];  // Q12 bound on the corrected draw per unit of red, green, blue and white
+    
+    bool static_storage;    // Caller's storage, not freed on del
     uint8_t buffer[0];
 } ws2812_t;
 
-static esp_err_t ws2812_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+_Static_assert(sizeof(ws2812_t) <= LED_STRIP_WS2812_STATE_SIZE, "LED_STRIP_WS2812_STATE_SIZE is too small");
+
+/**
+ * @brief Define set_pixel/set_pixel_rgbw for one byte order
+ *
+ * Each pixel format gets its own pair of functions with the channel offsets as
+ * constants, selected once at creation, so storing a pixel has no format checks.
+ * Formats without a white channel ignore the white component; formats with one
+ * store it at w_off. A pixel inside the dirty range is recounted by commit,
+ * so its difference is not added here.
+ */
+#define WS2812_DEFINE_PIXEL_FORMAT_RGB(name, r_off, g_off, b_off)                                          \
+    static esp_err_t ws2812_set_pixel_rgbw_##name(led_strip_t *strip, uint32_t index, uint32_t red,           \
+                                                  uint32_t green, uint32_t blue, uint32_t white)              \
+    {                                                                                                         \
+        ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);                                              \
+        if (index >= ws2812->strip_len) {                                                                     \
+            return ESP_ERR_INVALID_ARG;                                                                       \
+        }                                                                                                     \
+        uint8_t *pixel = &ws2812->buffer[index * 3];                                                          \
+        if (index - ws2812->dirty_start >= ws2812->dirty_end - ws2812->dirty_start) {                         \
+            ws2812->channel_sums[0] += (red & 0xFF) - pixel[r_off];                                           \
+            ws2812->channel_sums[1] += (green & 0xFF) - pixel[g_off];                                         \
+            ws2812->channel_sums[2] += (blue & 0xFF) - pixel[b_off];                                          \
+        }                                                                                                     \
+        pixel[r_off] = red & 0xFF;                                                                            \
+        pixel[g_off] = green & 0xFF;                                                                          \
+        pixel[b_off] = blue & 0xFF;                                                                           \
+        return ESP_OK;                                                                                        \
+    }                                                                                                         \
+    static esp_err_t ws2812_set_pixel_##name(led_strip_t *strip, uint32_t index, uint32_t red,                \
+                                             uint32_t green, uint32_t blue)                                   \
+    {                                                                                                         \
+        return ws2812_set_pixel_rgbw_##name(strip, index, red, green, blue, 0);                               \
+    }
+
+#define WS2812_DEFINE_PIXEL_FORMAT_RGBW(name, r_off, g_off, b_off, w_off)                                  \
+    static esp_err_t ws2812_set_pixel_rgbw_##name(led_strip_t *strip, uint32_t index, uint32_t red,           \
+                                                  uint32_t green, uint32_t blue, uint32_t white)              \
+    {                                                                                                         \
+        ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);                                              \
+        if (index >= ws2812->strip_len) {                                                                     \
+            return ESP_ERR_INVALID_ARG;                                                                       \
+        }                                                                                                     \
+        uint8_t *pixel = &ws2812->buffer[index * 4];                                                          \
+        if (index - ws2812->dirty_start >= ws2812->dirty_end - ws2812->dirty_start) {                         \
+            ws2812->channel_sums[0] += (red & 0xFF) - pixel[r_off];                                           \
+            ws2812->channel_sums[1] += (green & 0xFF) - pixel[g_off];                                         \
+            ws2812->channel_sums[2] += (blue & 0xFF) - pixel[b_off];                                          \
+            ws2812->channel_sums[3] += (white & 0xFF) - pixel[w_off];                                         \
+        }                                                                                                     \
+        pixel[r_off] = red & 0xFF;                                                                            \
+        pixel[g_off] = green & 0xFF;                                                                          \
+        pixel[b_off] = blue & 0xFF;                                                                           \
+        pixel[w_off] = white & 0xFF;                                                                          \
+        return ESP_OK;                                                                                        \
+    }                                                                                                         \
+    static esp_err_t ws2812_set_pixel_##name(led_strip_t *strip, uint32_t index, uint32_t red,                \
+                                             uint32_t green, uint32_t blue)                                   \
+    {                                                                                                         \
+        return ws2812_set_pixel_rgbw_##name(strip, index, red, green, blue, 0);                               \
+    }
+
+WS2812_DEFINE_PIXEL_FORMAT_RGB(grb, 1, 0, 2)
+WS2812_DEFINE_PIXEL_FORMAT_RGB(rgb, 0, 1, 2)
+WS2812_DEFINE_PIXEL_FORMAT_RGB(brg, 1, 2, 0)
+WS2812_DEFINE_PIXEL_FORMAT_RGBW(grbw, 1, 0, 2, 3)
+WS2812_DEFINE_PIXEL_FORMAT_RGBW(rgbw, 0, 1, 2, 3)
+
+// Add (sign 1) or subtract (sign -1) the channels of pixels [start, end) to the sums
+static void ws2812_sum_pixels(ws2812_t *ws2812, uint32_t start, uint32_t end, int32_t sign)
 {
-    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
-    if (index >= ws2812->strip_len) {
-        return ESP_ERR_INVALID_ARG;
+    const uint8_t *offset = ws2812->encoder.offsets;
+    const uint32_t bytes_per_pixel = ws2812->bytes_per_pixel;
+    uint32_t sums[4] = { 0 };
+    const uint8_t *p = &ws2812->buffer[start * bytes_per_pixel];
+    for (uint32_t i = start; i < end; i++, p += bytes_per_pixel) {
+        sums[0] += p[offset[0]];
+        sums[1] += p[offset[1]];
+        sums[2] += p[offset[2]];
+        if (bytes_per_pixel == 4) {
+            sums[3] += p[offset[3]];
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        ws2812->channel_sums[c] += sign * sums[c];
     }
+}
+
+// Count the pixels written since mark_dirty back into the estimate
+static void ws2812_commit_dirty(ws2812_t *ws2812)
+{
+    if (ws2812->dirty_end > ws2812->dirty_start) {
+        ws2812_sum_pixels(ws2812, ws2812->dirty_start, ws2812->dirty_end, 1);
+    }
+    ws2812->dirty_start = 0;
+    ws2812->dirty_end = 0;
+}
+
+/**
+ * @brief Latch the color correction, estimate the frame's current and latch the output scale for it
+ *
+ * The previous frame must be out: its encoder state is replaced here.
+ * The estimate is of the corrected output. Reductions apply at once so the
+ * supply is never overdrawn; increases are smoothed over a few frames so a
+ * limited strip does not pump.
+ */
+static void ws2812_update_scale(ws2812_t *ws2812)
+{
+    const led_strip_power_config_t *power = &ws2812->power;
+    led_strip_power_stats_t *stats = &ws2812->power_stats;
+    uint32_t weights[4];
     
-    // In the order of GRB
-    uint32_t start = index * 3;
-    ws2812->buffer[start + 0] = green & 0xFF;
-    ws2812->buffer[start + 1] = red & 0xFF;
-    ws2812->buffer[start + 2] = blue & 0xFF;
-    return ESP_OK;
+    portENTER_CRITICAL(&ws2812->correct_lock);
+    ws2812->encoder.correct = ws2812->correct;
+    ws2812->encoder.correcting = ws2812->correcting;
+    memcpy(weights, ws2812->power_weights, sizeof(weights));
+    portEXIT_CRITICAL(&ws2812->correct_lock);
+    
+    ws2812_commit_dirty(ws2812);
+    uint64_t weighted = 0;
+    for (int c = 0; c < 4; c++) {
+        weighted += (uint64_t)ws2812->channel_sums[c] * weights[c];
+    }
+    if (ws2812->encoder.correcting) {
+        // Corrected bytes are rounded to nearest: up to half a step each
+        weighted += (uint64_t)ws2812->strip_len * ws2812->bytes_per_pixel << (LED_COLOR_MATRIX_SHIFT - 1);
+    }
+    
+    uint32_t idle_ma = power->idle_ma_per_led * ws2812->strip_len;
+    uint32_t active_ma = (uint32_t)((weighted >> LED_COLOR_MATRIX_SHIFT) * power->ma_per_channel / 255);
+    uint32_t ceiling = power->max_brightness + 1;
+    uint32_t target = ceiling;
+    if (power->budget_ma > 0 && active_ma > 0) {
+        uint32_t available = power->budget_ma > idle_ma ? power->budget_ma - idle_ma : 0;
+        uint32_t fit = (uint32_t)((uint64_t)available * WS2812_SCALE_ONE / active_ma);
+        if (fit < target) {
+            target = fit;
+        }
+    }
+    
+    uint32_t scale = ws2812->encoder.scale;
+    if (target <= scale) {
+        scale = target;
+    } else {
+        scale += (target - scale + (1 << WS2812_POWER_RELEASE_SHIFT) - 1) >> WS2812_POWER_RELEASE_SHIFT;
+    }
+    ws2812->encoder.scale = scale;
+    
+    stats->demand_ma = idle_ma + active_ma;
+    stats->output_ma = idle_ma + active_ma * scale / WS2812_SCALE_ONE;
+    stats->scale = scale;
+    if (scale < ceiling) {
+        stats->limited_frames++;
+    }
 }
 
 static esp_err_t ws2812_refresh(led_strip_t *strip, uint32_t timeout_ms)
 {
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
-    esp_err_t ret = rmt_write_sample(ws2812->rmt_channel, ws2812->buffer, ws2812->strip_len * 3, true);
+    // A frame still going out is translated from the latched state; leave
+    // it alone and report the timeout rather than latch over it
+    esp_err_t ret = rmt_wait_tx_done(ws2812->rmt_channel, pdMS_TO_TICKS(timeout_ms));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ws2812_update_scale(ws2812);
+    ret = rmt_write_sample(ws2812->rmt_channel, ws2812->buffer, ws2812->strip_len * ws2812->bytes_per_pixel, true);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "rmt_write_sample failed");
         return ret;
@@ -91,48 +356,454 @@ static esp_err_t ws2812_refresh(led_strip_t *strip, uint32_t timeout_ms)
     return rmt_wait_tx_done(ws2812->rmt_channel, pdMS_TO_TICKS(timeout_ms));
 }
 
+static esp_err_t ws2812_refresh_async(led_strip_t *strip)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    // rmt_write_sample would wait for the previous frame too, but only after
+    // its encoder state had been replaced
+    esp_err_t ret = rmt_wait_tx_done(ws2812->rmt_channel, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ws2812_update_scale(ws2812);
+    ret = rmt_write_sample(ws2812->rmt_channel, ws2812->buffer, ws2812->strip_len * ws2812->bytes_per_pixel, false);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "rmt_write_sample failed");
+    }
+    return ret;
+}
+
+static esp_err_t ws2812_wait_refresh_done(led_strip_t *strip, uint32_t timeout_ms)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    return rmt_wait_tx_done(ws2812->rmt_channel, pdMS_TO_TICKS(timeout_ms));
+}
+
+static esp_err_t ws2812_get_buffer(led_strip_t *strip, uint8_t **buffer, led_strip_layout_t *layout)
+{
+    if (!buffer || !layout) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    *buffer = ws2812->buffer;
+    *layout = ws2812->layout;
+    return ESP_OK;
+}
+
+/**
+ * @brief Take pixels about to be written directly out of the power estimate
+ *
+ * The dirty range only grows until commit; only pixels it newly covers are
+ * subtracted, so marking costs one add per byte of the range once per frame.
+ */
+static esp_err_t ws2812_mark_dirty(led_strip_t *strip, uint32_t start, uint32_t count)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    if (start > ws2812->strip_len || count > ws2812->strip_len - start) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (count == 0) {
+        return ESP_OK;
+    }
+    uint32_t end = start + count;
+    if (ws2812->dirty_end == ws2812->dirty_start) {
+        ws2812_sum_pixels(ws2812, start, end, -1);
+        ws2812->dirty_start = start;
+        ws2812->dirty_end = end;
+        return ESP_OK;
+    }
+    if (start < ws2812->dirty_start) {
+        ws2812_sum_pixels(ws2812, start, ws2812->dirty_start, -1);
+        ws2812->dirty_start = start;
+    }
+    if (end > ws2812->dirty_end) {
+        ws2812_sum_pixels(ws2812, ws2812->dirty_end, end, -1);
+        ws2812->dirty_end = end;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_commit(led_strip_t *strip)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    ws2812_commit_dirty(ws2812);
+    return ESP_OK;
+}
+
 static esp_err_t ws2812_clear(led_strip_t *strip, uint32_t timeout_ms)
 {
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
     // Write zero to all LEDs
-    memset(ws2812->buffer, 0, ws2812->strip_len * 3);
+    memset(ws2812->buffer, 0, ws2812->strip_len * ws2812->bytes_per_pixel);
+    memset(ws2812->channel_sums, 0, sizeof(ws2812->channel_sums));
+    ws2812->dirty_start = 0;
+    ws2812->dirty_end = 0;
     return ws2812_refresh(strip, timeout_ms);
 }
 
 static esp_err_t ws2812_del(led_strip_t *strip)
 {
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
-    free(ws2812);
+    if (!ws2812->static_storage) {
+        free(ws2812);
+    }
     return ESP_OK;
 }
 
-led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config)
+// Check that one period in ticks is within tolerance of the nominal time
+static bool ws2812_period_ok(uint32_t ticks, uint32_t tick_ns, uint32_t nominal_ns)
+{
+    uint32_t ns = ticks * tick_ns;
+    return ns + LED_TIMING_TOLERANCE_NS >= nominal_ns && ns <= nominal_ns + LED_TIMING_TOLERANCE_NS;
+}
+
+// Convert a period to RMT ticks, rounded to nearest
+static uint32_t ws2812_ns_to_ticks(uint32_t ns, uint32_t tick_ns)
+{
+    return (ns + tick_ns / 2) / tick_ns;
+}
+
+// What the encoder should send for the buffer byte at p
+static uint8_t ws2812_expected_byte(const ws2812_encoder_t *encoder, const uint8_t *p)
+{
+    if (!encoder->correcting) {
+        return (*p * encoder->scale) >> 8;
+    }
+    uint32_t position = p - encoder->frame;
+    uint32_t index = position / encoder->bytes_per_pixel;
+    uint32_t byte = position - index * encoder->bytes_per_pixel;
+    uint8_t pixel[4];
+    ws2812_correct_pixel(encoder, p - byte, index, pixel);
+    return pixel[byte];
+}
+
+// Bytes verified ahead of the pixel buffer, sent unscaled: every bit shape,
+// both levels in a row and runs across the verify chunks, whatever the strip
+// is showing (a freshly cleared strip only has 0 bits)
+static const uint8_t ws2812_verify_pattern[] = {
+    0x00, 0xFF, 0xAA, 0x55, 0xFF, 0x00, 0x55, 0xAA, 0x0F, 0xF0, 0x01, 0x80,
+};
+
+/**
+ * @brief Encode len bytes at src the way the RMT driver does and check the items
+ *
+ * Fixed-size item chunks are fed from wherever the previous chunk stopped.
+ * Each byte is decoded back, MSB first, and compared with what the encoder
+ * should send for it; every period is checked against the timing.
+ */
+static esp_err_t ws2812_verify_bytes(const ws2812_encoder_t *encoder, const led_strip_timing_t *timing,
+                                     uint32_t tick_ns, const uint8_t *src, size_t remaining,
+                                     led_strip_ws2812_timing_report_t *report, uint64_t *wire_ns)
 {
-    if (!config || config->max_leds == 0) {
+    rmt_item32_t items[WS2812_VERIFY_CHUNK_ITEMS];
+    
+    while (remaining > 0) {
+        size_t translated = 0;
+        size_t item_num = 0;
+        ws2812_encode(encoder, src, items, remaining, WS2812_VERIFY_CHUNK_ITEMS, &translated, &item_num);
+        if (translated == 0 || item_num != translated * 8) {
+            ESP_LOGE(TAG, "Translator produced %u items for %u bytes", (unsigned)item_num, (unsigned)translated);
+            return ESP_FAIL;
+        }
+        
+        for (size_t b = 0; b < translated; b++) {
+            uint8_t decoded = 0;
+            for (int i = 0; i < 8; i++) {
+                const rmt_item32_t *item = &items[b * 8 + i];
+                bool one = item->duration0 * tick_ns > (timing->t0h_ns + timing->t1h_ns) / 2;
+                bool ok = item->level0 == 1 && item->level1 == 0;
+                if (one) {
+                    ok = ok && ws2812_period_ok(item->duration0, tick_ns, timing->t1h_ns)
+                            && ws2812_period_ok(item->duration1, tick_ns, timing->t1l_ns);
+                } else {
+                    ok = ok && ws2812_period_ok(item->duration0, tick_ns, timing->t0h_ns)
+                            && ws2812_period_ok(item->duration1, tick_ns, timing->t0l_ns);
+                }
+                if (!ok) {
+                    report->timing_errors++;
+                }
+                decoded = (decoded << 1) | (one ? 1 : 0);
+                if (wire_ns) {
+                    *wire_ns += (uint64_t)(item->duration0 + item->duration1) * tick_ns;
+                }
+            }
+            if (decoded != ws2812_expected_byte(encoder, src + b)) {
+                report->data_errors++;
+            }
+            report->items += 8;
+        }
+        src += translated;
+        remaining -= translated;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_ws2812_verify(led_strip_t *strip, led_strip_ws2812_timing_report_t *report)
+{
+    if (!strip || !report) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    const led_strip_timing_t *timing = &ws2812->timing;
+    memset(report, 0, sizeof(*report));
+    
+    // Use the real counter clock of the channel, not the one the encoder was built for
+    uint32_t counter_hz = 0;
+    esp_err_t ret = rmt_get_counter_clock(ws2812->rmt_channel, &counter_hz);
+    if (ret != ESP_OK || counter_hz == 0) {
+        ESP_LOGE(TAG, "Failed to read RMT counter clock");
+        return ret != ESP_OK ? ret : ESP_FAIL;
+    }
+    uint32_t tick_ns = 1000000000UL / counter_hz;
+    if (tick_ns != ws2812->tick_ns) {
+        ESP_LOGW(TAG, "RMT tick is %luns, encoder assumes %luns", (unsigned long)tick_ns, (unsigned long)ws2812->tick_ns);
+    }
+    
+    // The test pattern goes through the strip's bit items without scaling or
+    // correction, so it decodes to itself
+    ws2812_encoder_t raw = ws2812->encoder;
+    raw.scale = WS2812_SCALE_ONE;
+    raw.correcting = false;
+    raw.frame = ws2812_verify_pattern;
+    ret = ws2812_verify_bytes(&raw, timing, tick_ns, ws2812_verify_pattern, sizeof(ws2812_verify_pattern), report,
+                              NULL);
+    
+    // Then the pixel buffer as the next refresh would send it
+    uint64_t wire_ns = 0;
+    if (ret == ESP_OK) {
+        ret = ws2812_verify_bytes(&ws2812->encoder, timing, tick_ns, ws2812->buffer,
+                                  ws2812->strip_len * ws2812->bytes_per_pixel, report, &wire_ns);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Wire time includes the reset gap that latches the frame
+    report->frame_time_us = (uint32_t)(wire_ns / 1000) + timing->reset_us;
+    report->max_fps = 1000000UL / report->frame_time_us;
+    
+    if (report->timing_errors || report->data_errors) {
+        ESP_LOGE(TAG, "Verify failed: %lu timing errors, %lu data errors",
+                 (unsigned long)report->timing_errors, (unsigned long)report->data_errors);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_ws2812_set_power_limit(led_strip_t *strip, const led_strip_power_config_t *config)
+{
+    if (!strip || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    ws2812->power = *config;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_ws2812_get_power_stats(led_strip_t *strip, led_strip_power_stats_t *stats)
+{
+    if (!strip || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    *stats = ws2812->power_stats;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_ws2812_set_color_correction(led_strip_t *strip, const led_strip_color_correction_t *correction)
+{
+    if (!strip || !correction) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, base);
+    led_color_correct_t correct = {
+        .gains = correction->pixel_gains,
+        .gain_stride = ws2812->bytes_per_pixel,
+    };
+    bool identity = true;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            int16_t m = correction->matrix[row][col];
+            correct.matrix[row * 3 + col] = m;
+            identity = identity && m == (row == col ? LED_STRIP_COLOR_ONE : 0);
+        }
+    }
+    
+    // Highest gain of each output channel over the strip, (g + 1) / 256
+    uint32_t max_gain[4] = { 256, 256, 256, 256 };
+    if (correct.gains) {
+        memset(max_gain, 0, sizeof(max_gain));
+        for (uint32_t i = 0; i < ws2812->strip_len * ws2812->bytes_per_pixel; i++) {
+            uint32_t c = i % ws2812->bytes_per_pixel;
+            if (correct.gains[i] + 1u > max_gain[c]) {
+                max_gain[c] = correct.gains[i] + 1u;
+            }
+        }
+    }
+    
+    // Output channel c is at most the positive coefficients of its row times
+    // the inputs (clamping only lowers it), times its highest gain. Summed
+    // over the rows that bounds the draw per unit of each input channel.
+    uint32_t weights[4];
+    for (int col = 0; col < 3; col++) {
+        uint32_t weight = 0;
+        for (int row = 0; row < 3; row++) {
+            int16_t m = correct.matrix[row * 3 + col];
+            weight += m > 0 ? m * max_gain[row] : 0;
+        }
+        weights[col] = (weight + 255) >> 8;
+    }
+    weights[3] = max_gain[3] << (LED_COLOR_MATRIX_SHIFT - 8);
+    
+    // Latched at the next refresh, so a frame being sent is not affected
+    portENTER_CRITICAL(&ws2812->correct_lock);
+    ws2812->correct = correct;
+    ws2812->correcting = !identity || correct.gains != NULL;
+    memcpy(ws2812->power_weights, weights, sizeof(weights));
+    portEXIT_CRITICAL(&ws2812->correct_lock);
+    return ESP_OK;
+}
+
+// Create a strip in storage (size bytes, word aligned), or on the heap if it is NULL
+static led_strip_t *ws2812_create(const led_strip_config_t *config, void *storage, size_t size)
+{
+    if (!config || config->max_leds == 0 || ((uintptr_t)storage & 3)) {
         ESP_LOGE(TAG, "Invalid arguments");
         return NULL;
     }
     
-    // Allocate memory for the strip (header + data buffer)
-    uint32_t strip_len = config->max_leds;
-    ws2812_t *ws2812 = calloc(1, sizeof(ws2812_t) + strip_len * 3);
-    if (!ws2812) {
-        ESP_LOGE(TAG, "Failed to allocate memory for led_strip");
+    // Resolve the byte order once; the chosen functions have it built in
+    uint32_t bytes_per_pixel;
+    led_strip_layout_t layout;
+    esp_err_t (*set_pixel)(led_strip_t *, uint32_t, uint32_t, uint32_t, uint32_t);
+    esp_err_t (*set_pixel_rgbw)(led_strip_t *, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+    switch (config->pixel_format) {
+    case LED_PIXEL_FORMAT_GRB:
+        bytes_per_pixel = 3;
+        layout = (led_strip_layout_t){ .bytes_per_pixel = 3, .red_offset = 1, .green_offset = 0, .blue_offset = 2, .white_offset = -1 };
+        set_pixel = ws2812_set_pixel_grb;
+        set_pixel_rgbw = ws2812_set_pixel_rgbw_grb;
+        break;
+    case LED_PIXEL_FORMAT_RGB:
+        bytes_per_pixel = 3;
+        layout = (led_strip_layout_t){ .bytes_per_pixel = 3, .red_offset = 0, .green_offset = 1, .blue_offset = 2, .white_offset = -1 };
+        set_pixel = ws2812_set_pixel_rgb;
+        set_pixel_rgbw = ws2812_set_pixel_rgbw_rgb;
+        break;
+    case LED_PIXEL_FORMAT_BRG:
+        bytes_per_pixel = 3;
+        layout = (led_strip_layout_t){ .bytes_per_pixel = 3, .red_offset = 1, .green_offset = 2, .blue_offset = 0, .white_offset = -1 };
+        set_pixel = ws2812_set_pixel_brg;
+        set_pixel_rgbw = ws2812_set_pixel_rgbw_brg;
+        break;
+    case LED_PIXEL_FORMAT_GRBW:
+        bytes_per_pixel = 4;
+        layout = (led_strip_layout_t){ .bytes_per_pixel = 4, .red_offset = 1, .green_offset = 0, .blue_offset = 2, .white_offset = 3 };
+        set_pixel = ws2812_set_pixel_grbw;
+        set_pixel_rgbw = ws2812_set_pixel_rgbw_grbw;
+        break;
+    case LED_PIXEL_FORMAT_RGBW:
+        bytes_per_pixel = 4;
+        layout = (led_strip_layout_t){ .bytes_per_pixel = 4, .red_offset = 0, .green_offset = 1, .blue_offset = 2, .white_offset = 3 };
+        set_pixel = ws2812_set_pixel_rgbw;
+        set_pixel_rgbw = ws2812_set_pixel_rgbw_rgbw;
+        break;
+    default:
+        ESP_LOGE(TAG, "Unsupported pixel format %d", config->pixel_format);
+        return NULL;
+    }
+    
+    // Build the bit items for this strip's timing at the channel's tick
+    rmt_channel_t channel = (rmt_channel_t)config->dev;
+    const led_strip_timing_t *timing = &config->timing;
+    uint32_t counter_hz = 0;
+    uint32_t tick_ns = RMT_CLK_DURATION_NS;
+    if (rmt_get_counter_clock(channel, &counter_hz) == ESP_OK && counter_hz > 0) {
+        tick_ns = 1000000000UL / counter_hz;
+    }
+    uint32_t t0h = ws2812_ns_to_ticks(timing->t0h_ns, tick_ns);
+    uint32_t t0l = ws2812_ns_to_ticks(timing->t0l_ns, tick_ns);
+    uint32_t t1h = ws2812_ns_to_ticks(timing->t1h_ns, tick_ns);
+    uint32_t t1l = ws2812_ns_to_ticks(timing->t1l_ns, tick_ns);
+    if (t1h <= t0h || t0l >= (1 << 15) || t1l >= (1 << 15) || t0h == 0 || t1l == 0 ||
+        !ws2812_period_ok(t0h, tick_ns, timing->t0h_ns) || !ws2812_period_ok(t0l, tick_ns, timing->t0l_ns) ||
+        !ws2812_period_ok(t1h, tick_ns, timing->t1h_ns) || !ws2812_period_ok(t1l, tick_ns, timing->t1l_ns)) {
+        ESP_LOGE(TAG, "Timing cannot be generated with a %luns RMT tick", (unsigned long)tick_ns);
         return NULL;
     }
     
-    // Configure RMT translator
-    rmt_translator_init((rmt_channel_t)config->dev, ws2812_rmt_adapter);
+    // Header + data buffer
+    uint32_t strip_len = config->max_leds;
+    size_t needed = sizeof(ws2812_t) + strip_len * bytes_per_pixel;
+    ws2812_t *ws2812;
+    if (storage) {
+        if (size < needed) {
+            ESP_LOGE(TAG, "Static storage too small: %u bytes, need %u", (unsigned)size, (unsigned)needed);
+            return NULL;
+        }
+        ws2812 = memset(storage, 0, needed);
+        ws2812->static_storage = true;
+    } else {
+        ws2812 = calloc(1, needed);
+        if (!ws2812) {
+            ESP_LOGE(TAG, "Failed to allocate memory for led_strip");
+            return NULL;
+        }
+    }
+    
+    ws2812->encoder.bits[0] = (rmt_item32_t){{{ t0h, 1, t0l, 0 }}};
+    ws2812->encoder.bits[1] = (rmt_item32_t){{{ t1h, 1, t1l, 0 }}};
+    ws2812->encoder.scale = WS2812_SCALE_ONE;
+    ws2812->encoder.frame = ws2812->buffer;
+    ws2812->encoder.bytes_per_pixel = bytes_per_pixel;
+    ws2812->encoder.offsets[0] = layout.red_offset;
+    ws2812->encoder.offsets[1] = layout.green_offset;
+    ws2812->encoder.offsets[2] = layout.blue_offset;
+    ws2812->encoder.offsets[3] = layout.white_offset >= 0 ? layout.white_offset : 0;
+    ws2812->power = (led_strip_power_config_t)LED_STRIP_POWER_UNLIMITED;
+    portMUX_INITIALIZE(&ws2812->correct_lock);
+    for (int c = 0; c < 4; c++) {
+        ws2812->power_weights[c] = LED_STRIP_COLOR_ONE;
+    }
+    
+    // Configure RMT translator, with the encoder as its context
+    rmt_translator_init(channel, ws2812_rmt_adapter);
+    rmt_translator_set_context(channel, &ws2812->encoder);
     
     // Fill in function pointers
-    ws2812->base.set_pixel = ws2812_set_pixel;
+    ws2812->base.set_pixel = set_pixel;
+    ws2812->base.set_pixel_rgbw = set_pixel_rgbw;
     ws2812->base.refresh = ws2812_refresh;
+    ws2812->base.refresh_async = ws2812_refresh_async;
+    ws2812->base.wait_refresh_done = ws2812_wait_refresh_done;
+    ws2812->base.get_buffer = ws2812_get_buffer;
+    ws2812->base.mark_dirty = ws2812_mark_dirty;
+    ws2812->base.commit = ws2812_commit;
     ws2812->base.clear = ws2812_clear;
     ws2812->base.del = ws2812_del;
     
     // Save parameters
-    ws2812->rmt_channel = (rmt_channel_t)config->dev;
+    ws2812->rmt_channel = channel;
     ws2812->strip_len = strip_len;
+    ws2812->bytes_per_pixel = bytes_per_pixel;
+    ws2812->layout = layout;
+    ws2812->layout.pixel_count = strip_len;
+    ws2812->timing = *timing;
+    ws2812->tick_ns = tick_ns;
     
     return &ws2812->base;
-}
\ No newline at end of file
+}
+
+led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config)
+{
+    return ws2812_create(config, NULL, 0);
+}
+
+led_strip_t *led_strip_new_rmt_ws2812_static(const led_strip_config_t *config, void *storage, size_t size)
+{
+    if (!storage) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return NULL;
+    }
+    return ws2812_create(config, storage, size);
+}
@@ -0,0 +1,167 @@
+// Check the WS2812 encoder's fixed-point color correction against a float reference.
+//
+// Runs the same per-pixel code as the RMT encoder (led_strip_color.h) over
+// random correction matrices, per-pixel gains and brightness scales, and
+// compares every output channel with the correction done in double
+// precision from the unquantized matrix. The identity matrix must pass
+// colors through unchanged. Also times the correction per pixel.
+//
+//     cc -O2 -I.. -o color_correct_check color_correct_check.c -lm
+//     ./color_correct_check                  200 random setups, 65536 colors each
+//     ./color_correct_check --exhaustive     every 24-bit color for each setup (slow)
+//     ./color_correct_check --setups 2000 --seed 7
+//
+// Exits 1 if any channel is more than 1 step from the reference, or if the
+// identity matrix changes a color.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "led_strip_color.h"
+
+#define PIXELS 64
+
+typedef struct {
+    double matrix[9];
+    uint8_t gains[PIXELS * 4];
+    uint32_t scale;             // Q8, 256 = unscaled
+    bool white;
+} setup_t;
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * (rand() / (double)RAND_MAX);
+}
+
+// Mostly white balance and crosstalk, sometimes strong mixing that clips
+static void random_setup(setup_t *setup, int n)
+{
+    double spread = n % 4 == 3 ? 1.5 : 0.15;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            setup->matrix[row * 3 + col] = row == col ? uniform(0.6, 1.2) : uniform(-spread, spread);
+        }
+    }
+    for (int i = 0; i < PIXELS * 4; i++) {
+        setup->gains[i] = n % 2 ? (uint8_t)(160 + rand() % 96) : 255;
+    }
+    setup->scale = n % 3 == 0 ? 256 : 1 + rand() % 256;
+    setup->white = n % 5 == 4;
+}
+
+static void quantize(const setup_t *setup, led_color_correct_t *correct)
+{
+    for (int i = 0; i < 9; i++) {
+        correct->matrix[i] = (int16_t)lround(setup->matrix[i] * (1 << LED_COLOR_MATRIX_SHIFT));
+    }
+    correct->gains = setup->gains;
+    correct->gain_stride = setup->white ? 4 : 3;
+}
+
+static void reference(const setup_t *setup, uint32_t index, const uint8_t *in, double *out)
+{
+    const uint8_t *gain = &setup->gains[index * (setup->white ? 4 : 3)];
+    for (int c = 0; c < 3; c++) {
+        double v = setup->matrix[c * 3] * in[0] + setup->matrix[c * 3 + 1] * in[1] + setup->matrix[c * 3 + 2] * in[2];
+        v = v < 0 ? 0 : v > 255 ? 255 : v;
+        out[c] = v * setup->scale / 256.0 * (gain[c] + 1) / 256.0;
+    }
+    if (setup->white) {
+        out[3] = in[3] * setup->scale / 256.0 * (gain[3] + 1) / 256.0;
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    int setups = 200;
+    bool exhaustive = false;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--exhaustive")) {
+            exhaustive = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--setups")) {
+            setups = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--seed")) {
+            seed = (unsigned)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--setups N] [--seed N] [--exhaustive]\n", argv[0]);
+            return 2;
+        }
+    }
+    srand(seed);
+    
+    // Identity, no gains, full scale: every color must come through unchanged
+    led_color_correct_t identity = { .matrix = { 4096, 0, 0, 0, 4096, 0, 0, 0, 4096 } };
+    uint32_t identity_errors = 0;
+    for (uint32_t rgb = 0; rgb < (1u << 24); rgb++) {
+        uint8_t in[4] = { rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF, rgb & 0xFF }, out[4];
+        led_color_correct(&identity, 0, 256, in, out, true);
+        identity_errors += memcmp(in, out, 4) != 0;
+    }
+    
+    uint64_t channels = 0, off_by_one = 0, bad = 0;
+    double max_error = 0;
+    uint32_t colors = exhaustive ? 1u << 24 : 65536;
+    static setup_t setup;
+    for (int n = 0; n < setups; n++) {
+        random_setup(&setup, n);
+        led_color_correct_t correct;
+        quantize(&setup, &correct);
+        for (uint32_t k = 0; k < colors; k++) {
+            uint32_t rgb = exhaustive ? k : (uint32_t)rand() & 0xFFFFFF;
+            uint32_t index = k % PIXELS;
+            uint8_t in[4] = { rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF, (rgb * 7) & 0xFF }, out[4];
+            double expected[4];
+            led_color_correct(&correct, index, setup.scale, in, out, setup.white);
+            reference(&setup, index, in, expected);
+            for (int c = 0; c < (setup.white ? 4 : 3); c++) {
+                double error = fabs(out[c] - expected[c]);
+                if (error > max_error) {
+                    max_error = error;
+                }
+                int step = abs(out[c] - (int)lround(expected[c]));
+                off_by_one += step == 1;
+                if (step > 1) {
+                    if (bad++ < 5) {
+                        printf("setup %d pixel %u color %06x channel %d: %u, reference %.3f\n", n, index, rgb, c,
+                               out[c], expected[c]);
+                    }
+                }
+                channels++;
+            }
+        }
+    }
+    
+    // Time a strip's worth of pixels with gains, as the encoder runs it
+    random_setup(&setup, 1);
+    led_color_correct_t correct;
+    quantize(&setup, &correct);
+    static uint8_t frame[PIXELS * 3], output[PIXELS * 3];
+    for (int i = 0; i < PIXELS * 3; i++) {
+        frame[i] = (uint8_t)rand();
+    }
+    const int rounds = 20000;
+    uint64_t start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t p = 0; p < PIXELS; p++) {
+            led_color_correct(&correct, p, 200, &frame[p * 3], &output[p * 3], false);
+        }
+        frame[r % sizeof(frame)] ^= output[(r * 7) % sizeof(output)]; // Keep the loop from being hoisted
+    }
+    double ns_per_pixel = (now_ns() - start) / (double)rounds / PIXELS;
+    
+    printf("identity: %u of %u colors changed\n", identity_errors, 1u << 24);
+    printf("%d setups, %llu channels: max error %.3f steps, %.4f%% rounded the other way, %llu off by more than 1\n",
+           setups, (unsigned long long)channels, max_error, 100.0 * off_by_one / channels, (unsigned long long)bad);
+    printf("%.1f ns per pixel on this host\n", ns_per_pixel);
+    return identity_errors || bad ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// The legacy RMT TX API the WS2812 driver uses. ws2812_check.c implements it:
+// rmt_write_sample runs the registered translator in chunks, the way the
+// RMT driver refills its memory block, and keeps the items for decoding.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef intptr_t rmt_channel_t;     // An enum on target; wide enough here for the led_strip_dev_t cast
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef void (*sample_to_rmt_t)(const void *src, rmt_item32_t *dest, size_t src_size, size_t wanted_num,
+                                size_t *translated_size, size_t *item_num);
+
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t *clock_hz);
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn);
+esp_err_t rmt_translator_set_context(rmt_channel_t channel, void *context);
+esp_err_t rmt_translator_get_context(const size_t *item_num, void **context);
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t *src, size_t src_size, bool wait_tx_done);
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time);
@@ -0,0 +1,560 @@
+// Check the WS2812 driver's RMT waveform on the host, across counter clocks.
+//
+// Builds led_strip_rmt_ws2812.c against a host RMT (the legacy TX API,
+// implemented below): rmt_write_sample runs the driver's translator in
+// chunks the way the RMT driver refills its memory block, and the items are
+// decoded here independently of the driver, with every high and low period
+// checked against the datasheet timing (+/-150 ns). For each counter clock
+// and timing preset the strip must either be rejected at create because a
+// period cannot be hit within tolerance, or send test patterns (0x00, 0xFF,
+// alternating bits) that decode to the expected wire bytes at any chunk
+// size; led_strip_ws2812_verify must agree, and fail once the channel
+// clock no longer matches the one the items were built for.
+//
+//     cc -O2 -Ihost -I../../../tools/host -I.. -I../include -o ws2812_check ws2812_check.c ../led_strip_rmt_ws2812.c
+//     ./ws2812_check          summary per clock and timing
+//     ./ws2812_check -v       with the driver's error and warning logs
+//
+// A table check then sends known RGB(W) colors in every pixel format and
+// compares the decoded wire bytes with the format's byte order, and a
+// check writes the buffer directly between mark_dirty and commit and
+// compares the reported demand with a recount of the buffer. Under color
+// correction the estimate must cover what is actually sent, and a budget
+// must hold for the corrected output. Last, a refresh while the channel is
+// still busy must time out without sending.
+//
+// Exits 1 if a waveform does not decode to the expected bytes, a period is
+// out of tolerance, verify and the decoder disagree, the power estimate
+// drifts from the buffer, or a refresh sends over a busy channel.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "led_strip.h"
+
+#define LEDS            16
+#define MAX_ITEMS       (LEDS * 4 * 8)
+#define TOLERANCE_NS    150
+#define BLOCK_ITEMS     64      // Items in one RMT memory block
+
+int host_log_verbose = 0;
+
+// The simulated RMT channel
+static struct {
+    uint32_t counter_hz;
+    sample_to_rmt_t translator;
+    struct {
+        size_t item_num;            // The translator finds its context from this field
+        void *context;
+    } ctx;
+    size_t first_chunk, chunk;      // Items asked for in the first and later translator calls
+    rmt_item32_t items[MAX_ITEMS];
+    size_t item_count;
+    bool busy;                      // A frame is still going out: waits time out
+    uint32_t writes;
+} rmt;
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t *clock_hz)
+{
+    *clock_hz = rmt.counter_hz;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn)
+{
+    rmt.translator = fn;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_set_context(rmt_channel_t channel, void *context)
+{
+    rmt.ctx.context = context;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_get_context(const size_t *item_num, void **context)
+{
+    *context = __containerof(item_num, __typeof__(rmt.ctx), item_num)->context;
+    return ESP_OK;
+}
+
+// Fill the memory block, then refill it half a block at a time as it drains
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t *src, size_t src_size, bool wait_tx_done)
+{
+    size_t wanted = rmt.first_chunk;
+    rmt.writes++;
+    rmt.item_count = 0;
+    while (src_size > 0) {
+        size_t translated = 0;
+        if (rmt.item_count + wanted > MAX_ITEMS) {
+            wanted = MAX_ITEMS - rmt.item_count;
+        }
+        rmt.translator(src, &rmt.items[rmt.item_count], src_size, wanted, &translated, &rmt.ctx.item_num);
+        if (translated == 0) {
+            return ESP_FAIL;
+        }
+        rmt.item_count += rmt.ctx.item_num;
+        src += translated;
+        src_size -= translated;
+        wanted = rmt.chunk;
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time)
+{
+    return rmt.busy ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+static bool period_ok(uint32_t ticks, uint32_t tick_ns, uint32_t nominal_ns)
+{
+    int32_t error = (int32_t)(ticks * tick_ns) - (int32_t)nominal_ns;
+    return error >= -TOLERANCE_NS && error <= TOLERANCE_NS;
+}
+
+// Whether a timing can be generated at a tick: every period rounds to
+// within tolerance and the two high times stay apart
+static bool timing_possible(const led_strip_timing_t *timing, uint32_t tick_ns)
+{
+    uint32_t ns[4] = { timing->t0h_ns, timing->t0l_ns, timing->t1h_ns, timing->t1l_ns };
+    uint32_t ticks[4];
+    for (int i = 0; i < 4; i++) {
+        ticks[i] = (ns[i] + tick_ns / 2) / tick_ns;
+        if (ticks[i] == 0 || ticks[i] >= (1 << 15) || !period_ok(ticks[i], tick_ns, ns[i])) {
+            return false;
+        }
+    }
+    return ticks[2] > ticks[0];
+}
+
+// Decode the last write MSB first, as a WS2812 would, and compare it with the
+// expected wire bytes; returns the number of bad items and bytes
+static int decode_wire(const led_strip_timing_t *timing, uint32_t tick_ns, const uint8_t *expected, size_t len,
+                       uint64_t *wire_ns)
+{
+    int bad = 0;
+    *wire_ns = 0;
+    if (rmt.item_count != len * 8) {
+        printf("  %u items for %u bytes\n", (unsigned)rmt.item_count, (unsigned)len);
+        return 1;
+    }
+    for (size_t b = 0; b < len; b++) {
+        uint8_t byte = 0;
+        for (int i = 0; i < 8; i++) {
+            const rmt_item32_t *item = &rmt.items[b * 8 + i];
+            uint32_t high = item->duration0 * tick_ns;
+            bool one = high > (timing->t0h_ns + timing->t1h_ns) / 2;
+            bool ok = item->level0 == 1 && item->level1 == 0 &&
+                      period_ok(item->duration0, tick_ns, one ? timing->t1h_ns : timing->t0h_ns) &&
+                      period_ok(item->duration1, tick_ns, one ? timing->t1l_ns : timing->t0l_ns);
+            if (!ok) {
+                bad++;
+            }
+            byte = (byte << 1) | one;
+            *wire_ns += (uint64_t)(item->duration0 + item->duration1) * tick_ns;
+        }
+        if (byte != expected[b]) {
+            if (bad++ == 0) {
+                printf("  byte %u: 0x%02X, expected 0x%02X\n", (unsigned)b, byte, expected[b]);
+            }
+        }
+    }
+    return bad;
+}
+
+// Pixel i gets three bytes of the pattern; expected holds them in GRB order
+static void fill_pattern(led_strip_t *strip, uint8_t *expected, uint32_t scale)
+{
+    static const uint8_t pattern[] = { 0x00, 0xFF, 0xAA, 0x55, 0x0F, 0xF0, 0x81, 0x7E, 0x01 };
+    for (int i = 0; i < LEDS; i++) {
+        uint8_t r = pattern[(i * 3) % sizeof(pattern)];
+        uint8_t g = pattern[(i * 3 + 1) % sizeof(pattern)];
+        uint8_t b = pattern[(i * 3 + 2) % sizeof(pattern)];
+        strip->set_pixel(strip, i, r, g, b);
+        expected[i * 3] = (g * scale) >> 8;
+        expected[i * 3 + 1] = (r * scale) >> 8;
+        expected[i * 3 + 2] = (b * scale) >> 8;
+    }
+}
+
+static void check_clock(uint32_t counter_hz, const char *name, led_strip_timing_t timing)
+{
+    static uint32_t storage[(LED_STRIP_WS2812_STATE_SIZE + LEDS * 4 + 3) / 4];
+    uint32_t tick_ns = 1000000000UL / counter_hz;
+    led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(LEDS, (led_strip_dev_t)0);
+    config.timing = timing;
+    
+    memset(&rmt, 0, sizeof(rmt));
+    rmt.counter_hz = counter_hz;
+    led_strip_t *strip = led_strip_new_rmt_ws2812_static(&config, storage, sizeof(storage));
+    bool possible = timing_possible(&timing, tick_ns);
+    if (!strip) {
+        printf("  %2lu MHz %-7s rejected at create (%lu ns tick)\n", (unsigned long)(counter_hz / 1000000), name,
+               (unsigned long)tick_ns);
+        CHECK(!possible, "%s rejected at %lu ns although every period fits", name, (unsigned long)tick_ns);
+        return;
+    }
+    CHECK(possible, "%s accepted at %lu ns although a period is out of tolerance", name, (unsigned long)tick_ns);
+    
+    // Full brightness at the RMT driver's chunking and at sizes that split
+    // bytes and pixels differently
+    static const size_t chunks[][2] = { { BLOCK_ITEMS, BLOCK_ITEMS / 2 }, { 8, 8 }, { 24, 40 }, { 100, 17 } };
+    uint8_t expected[LEDS * 3];
+    uint64_t wire_ns = 0;
+    fill_pattern(strip, expected, 256);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        rmt.first_chunk = chunks[c][0];
+        rmt.chunk = chunks[c][1];
+        CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+        int bad = decode_wire(&timing, tick_ns, expected, sizeof(expected), &wire_ns);
+        CHECK(bad == 0, "%s: %d bad items or bytes with %u/%u item chunks", name, bad, (unsigned)chunks[c][0],
+              (unsigned)chunks[c][1]);
+    }
+    
+    led_strip_ws2812_timing_report_t report;
+    esp_err_t ret = led_strip_ws2812_verify(strip, &report);
+    uint32_t frame_us = (uint32_t)(wire_ns / 1000) + timing.reset_us;
+    CHECK(ret == ESP_OK, "%s: verify %s, %lu timing and %lu data errors", name, esp_err_to_name(ret),
+          (unsigned long)report.timing_errors, (unsigned long)report.data_errors);
+    uint32_t verify_items = report.items;
+    CHECK(report.frame_time_us == frame_us, "%s: verify frame time %lu us, decoded %lu us", name,
+          (unsigned long)report.frame_time_us, (unsigned long)frame_us);
+    
+    // Half brightness: the encoder scales, the buffer keeps the colors
+    led_strip_power_config_t power = LED_STRIP_POWER_UNLIMITED;
+    power.max_brightness = 127;
+    led_strip_ws2812_set_power_limit(strip, &power);
+    fill_pattern(strip, expected, 128);
+    rmt.first_chunk = BLOCK_ITEMS;
+    rmt.chunk = BLOCK_ITEMS / 2;
+    strip->refresh(strip, 100);
+    CHECK(decode_wire(&timing, tick_ns, expected, sizeof(expected), &wire_ns) == 0, "%s: scaled frame", name);
+    CHECK(led_strip_ws2812_verify(strip, &report) == ESP_OK, "%s: verify of the scaled frame failed", name);
+    
+    // A cleared strip only has 0 bits; verify still checks 1 bits with its pattern
+    strip->clear(strip, 100);
+    ret = led_strip_ws2812_verify(strip, &report);
+    CHECK(ret == ESP_OK && report.items > LEDS * 3 * 8, "%s: verify of a cleared strip: %s, %lu items", name,
+          esp_err_to_name(ret), (unsigned long)report.items);
+    
+    // The channel clock changed after create: the items are the wrong length
+    rmt.counter_hz = counter_hz / 2;
+    ret = led_strip_ws2812_verify(strip, &report);
+    CHECK(ret == ESP_FAIL && report.timing_errors > 0, "%s: verify passed at half the counter clock", name);
+    
+    printf("  %2lu MHz %-7s %lu us per frame, %lu fps max, verify %lu items\n",
+           (unsigned long)(counter_hz / 1000000), name, (unsigned long)frame_us, (unsigned long)(1000000 / frame_us),
+           (unsigned long)verify_items);
+    strip->del(strip);
+}
+
+// Two pixels: one set with white, then one without; 3-byte formats drop
+// white and must not touch the next pixel with it
+static void check_formats(void)
+{
+    static const struct {
+        const char *name;
+        led_pixel_format_t format;
+        uint8_t wire[8];            // Both pixels in wire order
+        led_strip_layout_t layout;
+    } formats[] = {
+        { "GRB", LED_PIXEL_FORMAT_GRB, { 0x22, 0x11, 0x33, 0xB2, 0xA1, 0xC3 }, { 0, 3, 1, 0, 2, -1 } },
+        { "RGB", LED_PIXEL_FORMAT_RGB, { 0x11, 0x22, 0x33, 0xA1, 0xB2, 0xC3 }, { 0, 3, 0, 1, 2, -1 } },
+        { "BRG", LED_PIXEL_FORMAT_BRG, { 0x33, 0x11, 0x22, 0xC3, 0xA1, 0xB2 }, { 0, 3, 1, 2, 0, -1 } },
+        { "GRBW", LED_PIXEL_FORMAT_GRBW, { 0x22, 0x11, 0x33, 0x44, 0xB2, 0xA1, 0xC3, 0x00 }, { 0, 4, 1, 0, 2, 3 } },
+        { "RGBW", LED_PIXEL_FORMAT_RGBW, { 0x11, 0x22, 0x33, 0x44, 0xA1, 0xB2, 0xC3, 0x00 }, { 0, 4, 0, 1, 2, 3 } },
+    };
+    static uint32_t storage[(LED_STRIP_WS2812_STATE_SIZE + 2 * 4 + 3) / 4];
+    const led_strip_timing_t timing = LED_STRIP_TIMING_WS2812;
+    const uint32_t tick_ns = 25;
+    
+    printf("pixel formats\n");
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(2, (led_strip_dev_t)0);
+        config.pixel_format = formats[f].format;
+        memset(&rmt, 0, sizeof(rmt));
+        rmt.counter_hz = 1000000000UL / tick_ns;
+        rmt.first_chunk = BLOCK_ITEMS;
+        rmt.chunk = BLOCK_ITEMS / 2;
+        led_strip_t *strip = led_strip_new_rmt_ws2812_static(&config, storage, sizeof(storage));
+        if (!strip) {
+            CHECK(false, "%s: create failed", formats[f].name);
+            continue;
+        }
+        
+        strip->set_pixel(strip, 1, 0xA1, 0xB2, 0xC3);
+        strip->set_pixel_rgbw(strip, 0, 0x11, 0x22, 0x33, 0x44);
+        strip->refresh(strip, 100);
+        size_t bpp = LED_PIXEL_FORMAT_BYTES(formats[f].format);
+        uint64_t wire_ns;
+        int bad = decode_wire(&timing, tick_ns, formats[f].wire, 2 * bpp, &wire_ns);
+        
+        // The layout handed to direct writers says the same
+        uint8_t *buffer;
+        led_strip_layout_t layout, want = formats[f].layout;
+        strip->get_buffer(strip, &buffer, &layout);
+        bool layout_ok = layout.pixel_count == 2 && layout.bytes_per_pixel == want.bytes_per_pixel &&
+                         layout.red_offset == want.red_offset && layout.green_offset == want.green_offset &&
+                         layout.blue_offset == want.blue_offset && layout.white_offset == want.white_offset;
+        
+        // Demand counts every stored channel, white included
+        led_strip_power_stats_t stats;
+        led_strip_ws2812_get_power_stats(strip, &stats);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < 2 * bpp; i++) {
+            sum += formats[f].wire[i];
+        }
+        uint32_t demand = 2 + sum * 20 / 255;   // LED_STRIP_POWER_UNLIMITED: 1 mA idle, 20 mA per channel
+        
+        printf("  %-5s", formats[f].name);
+        for (size_t i = 0; i < 2 * bpp; i++) {
+            printf(i == bpp ? " | %02X" : " %02X", buffer[i]);
+        }
+        printf("\n");
+        CHECK(bad == 0, "%s: wire bytes differ from the format's byte order", formats[f].name);
+        CHECK(layout_ok, "%s: layout does not match the byte order", formats[f].name);
+        CHECK(stats.demand_ma == demand, "%s: demand %lu mA, expected %lu", formats[f].name,
+              (unsigned long)stats.demand_ma, (unsigned long)demand);
+        strip->del(strip);
+    }
+}
+
+// Demand the driver should report for the buffer as it is (LED_STRIP_POWER_UNLIMITED)
+static uint32_t buffer_demand(led_strip_t *strip)
+{
+    uint8_t *buffer;
+    led_strip_layout_t layout;
+    strip->get_buffer(strip, &buffer, &layout);
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < layout.pixel_count * layout.bytes_per_pixel; i++) {
+        sum += buffer[i];
+    }
+    return layout.pixel_count + sum * 20 / 255;
+}
+
+static void check_demand(led_strip_t *strip, const char *what)
+{
+    led_strip_power_stats_t stats;
+    strip->refresh(strip, 100);
+    led_strip_ws2812_get_power_stats(strip, &stats);
+    uint32_t demand = buffer_demand(strip);
+    CHECK(stats.demand_ma == demand, "%s: demand %lu mA, buffer holds %lu", what, (unsigned long)stats.demand_ma,
+          (unsigned long)demand);
+}
+
+// Wire bytes of the last write added up, decoded as a WS2812 would
+static uint32_t wire_sum(const led_strip_timing_t *timing, uint32_t tick_ns)
+{
+    uint32_t sum = 0;
+    for (size_t b = 0; b < rmt.item_count / 8; b++) {
+        uint8_t byte = 0;
+        for (int i = 0; i < 8; i++) {
+            byte = (byte << 1) | (rmt.items[b * 8 + i].duration0 * tick_ns > (timing->t0h_ns + timing->t1h_ns) / 2);
+        }
+        sum += byte;
+    }
+    return sum;
+}
+
+// The power estimate is of the corrected output: never below what is sent,
+// and a budget holds even when correction boosts a channel
+static void check_correction(void)
+{
+    static uint32_t storage[(LED_STRIP_WS2812_STATE_SIZE + LEDS * 3 + 3) / 4];
+    static uint8_t gains[LEDS * 3];
+    const led_strip_timing_t timing = LED_STRIP_TIMING_WS2812;
+    const uint32_t tick_ns = 25;
+    led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(LEDS, (led_strip_dev_t)0);
+    memset(&rmt, 0, sizeof(rmt));
+    rmt.counter_hz = 1000000000UL / tick_ns;
+    rmt.first_chunk = BLOCK_ITEMS;
+    rmt.chunk = BLOCK_ITEMS / 2;
+    led_strip_t *strip = led_strip_new_rmt_ws2812_static(&config, storage, sizeof(storage));
+    if (!strip) {
+        CHECK(false, "correction: create failed");
+        return;
+    }
+    for (size_t i = 0; i < sizeof(gains); i++) {
+        gains[i] = i % 5 ? 255 : 127;
+    }
+    
+    static const struct {
+        const char *name;
+        int16_t matrix[3][3];
+        bool gains;
+    } setups[] = {
+        { "identity", { { 4096, 0, 0 }, { 0, 4096, 0 }, { 0, 0, 4096 } }, false },
+        { "white balance", { { 4096, 0, 0 }, { 0, 3277, 0 }, { 0, 0, 2458 } }, false },
+        { "boost", { { 6144, -1229, 0 }, { 819, 4915, 0 }, { 0, 410, 5734 } }, false },
+        { "boost, gains", { { 6144, -1229, 0 }, { 819, 4915, 0 }, { 0, 410, 5734 } }, true },
+    };
+    uint8_t expected[LEDS * 3];
+    fill_pattern(strip, expected, 256);
+    uint32_t plain = buffer_demand(strip);
+    
+    printf("color correction\n");
+    for (size_t i = 0; i < sizeof(setups) / sizeof(setups[0]); i++) {
+        led_strip_color_correction_t correction = { .pixel_gains = setups[i].gains ? gains : NULL };
+        memcpy(correction.matrix, setups[i].matrix, sizeof(correction.matrix));
+        led_strip_ws2812_set_color_correction(strip, &correction);
+        
+        led_strip_power_config_t power = LED_STRIP_POWER_UNLIMITED;
+        led_strip_ws2812_set_power_limit(strip, &power);
+        led_strip_power_stats_t stats;
+        for (int frame = 0; frame < 64; frame++) {
+            strip->refresh(strip, 100); // Recover from the previous budget
+        }
+        led_strip_ws2812_get_power_stats(strip, &stats);
+        uint32_t sent = LEDS + wire_sum(&timing, tick_ns) * 20 / 255;
+        CHECK(stats.demand_ma >= sent, "%s: estimate %lu mA below the %lu mA sent", setups[i].name,
+              (unsigned long)stats.demand_ma, (unsigned long)sent);
+        if (i == 0) {
+            CHECK(stats.demand_ma == plain, "identity: estimate %lu mA, buffer holds %lu",
+                  (unsigned long)stats.demand_ma, (unsigned long)plain);
+        }
+        
+        // A budget well under the corrected demand is met by what is sent
+        power.budget_ma = stats.demand_ma / 2;
+        led_strip_ws2812_set_power_limit(strip, &power);
+        strip->refresh(strip, 100);
+        uint32_t limited = LEDS + wire_sum(&timing, tick_ns) * 20 / 255;
+        CHECK(limited <= power.budget_ma, "%s: %lu mA sent over a %lu mA budget", setups[i].name,
+              (unsigned long)limited, (unsigned long)power.budget_ma);
+        printf("  %-14s estimate %4lu mA, sent %4lu mA; budget %4lu mA, sent %4lu mA\n", setups[i].name,
+               (unsigned long)stats.demand_ma, (unsigned long)sent, (unsigned long)power.budget_ma,
+               (unsigned long)limited);
+    }
+    strip->del(strip);
+}
+
+// Direct writes announced with mark_dirty: the estimate after commit must
+// match a recount of the buffer, however the ranges overlap
+static void check_dirty(void)
+{
+    static uint32_t storage[(LED_STRIP_WS2812_STATE_SIZE + LEDS * 3 + 3) / 4];
+    led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(LEDS, (led_strip_dev_t)0);
+    memset(&rmt, 0, sizeof(rmt));
+    rmt.counter_hz = 40000000;
+    rmt.first_chunk = BLOCK_ITEMS;
+    rmt.chunk = BLOCK_ITEMS / 2;
+    led_strip_t *strip = led_strip_new_rmt_ws2812_static(&config, storage, sizeof(storage));
+    if (!strip) {
+        CHECK(false, "dirty: create failed");
+        return;
+    }
+    uint8_t expected[LEDS * 3];
+    uint8_t *buffer;
+    led_strip_layout_t layout;
+    strip->get_buffer(strip, &buffer, &layout);
+    
+    printf("direct writes\n");
+    fill_pattern(strip, expected, 256);
+    check_demand(strip, "set_pixel");
+    
+    // Overlapping and disjoint marks grow one range; set_pixel inside it and
+    // outside it both end up counted once
+    CHECK(strip->mark_dirty(strip, 2, 4) == ESP_OK, "mark_dirty(2, 4) failed");
+    CHECK(strip->mark_dirty(strip, 4, 4) == ESP_OK, "mark_dirty(4, 4) failed");
+    CHECK(strip->mark_dirty(strip, 0, 1) == ESP_OK, "mark_dirty(0, 1) failed");
+    memset(&buffer[0], 0xFF, 8 * 3);
+    strip->set_pixel(strip, 3, 0x10, 0x20, 0x30);
+    strip->set_pixel(strip, 12, 0xFF, 0xFF, 0xFF);
+    check_demand(strip, "overlapping marks");
+    
+    // commit ends the range: set_pixel counts its difference again
+    CHECK(strip->mark_dirty(strip, 10, 6) == ESP_OK, "mark_dirty(10, 6) failed");
+    memset(&buffer[10 * 3], 0x40, 6 * 3);
+    CHECK(strip->commit(strip) == ESP_OK, "commit failed");
+    strip->set_pixel(strip, 11, 0x01, 0x02, 0x03);
+    check_demand(strip, "commit then set_pixel");
+    
+    // A range left open across clear is dropped with the old contents
+    strip->mark_dirty(strip, 0, LEDS);
+    strip->clear(strip, 100);
+    strip->set_pixel(strip, 5, 0x80, 0x80, 0x80);
+    check_demand(strip, "clear");
+    
+    CHECK(strip->mark_dirty(strip, LEDS - 1, 2) == ESP_ERR_INVALID_ARG, "range past the end accepted");
+    CHECK(strip->mark_dirty(strip, LEDS + 1, 0) == ESP_ERR_INVALID_ARG, "start past the end accepted");
+    CHECK(strip->mark_dirty(strip, LEDS, 0) == ESP_OK, "empty range at the end rejected");
+    check_demand(strip, "rejected ranges");
+    printf("  demand matches a recount after marks, commit and clear\n");
+    strip->del(strip);
+}
+
+// A refresh while the previous frame is still going out must time out
+// without latching or writing anything, and go through once it is done
+static void check_busy(void)
+{
+    static uint32_t storage[(LED_STRIP_WS2812_STATE_SIZE + LEDS * 3 + 3) / 4];
+    led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(LEDS, (led_strip_dev_t)0);
+    memset(&rmt, 0, sizeof(rmt));
+    rmt.counter_hz = 40000000;
+    rmt.first_chunk = BLOCK_ITEMS;
+    rmt.chunk = BLOCK_ITEMS / 2;
+    led_strip_t *strip = led_strip_new_rmt_ws2812_static(&config, storage, sizeof(storage));
+    if (!strip) {
+        CHECK(false, "busy: create failed");
+        return;
+    }
+    
+    printf("busy channel\n");
+    strip->set_pixel(strip, 0, 0x12, 0x34, 0x56);
+    uint32_t writes = rmt.writes;
+    rmt.busy = true;
+    esp_err_t ret = strip->refresh(strip, 10);
+    CHECK(ret == ESP_ERR_TIMEOUT, "refresh on a busy channel returned %s", esp_err_to_name(ret));
+    CHECK(rmt.writes == writes, "refresh on a busy channel wrote a frame");
+    
+    rmt.busy = false;
+    ret = strip->refresh(strip, 10);
+    CHECK(ret == ESP_OK && rmt.writes == writes + 1, "refresh after the channel freed up failed");
+    printf("  refresh times out without writing, then sends\n");
+    strip->del(strip);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-v")) {
+        host_log_verbose = 1;
+    } else if (argc > 1) {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+    
+    // 80 MHz APB divided by clk_div 1, 2 (the application's), 4, 8, 10 and 40
+    static const uint32_t clocks[] = { 80000000, 40000000, 20000000, 10000000, 8000000, 2000000 };
+    static const struct {
+        const char *name;
+        led_strip_timing_t timing;
+    } timings[] = {
+        { "WS2812", LED_STRIP_TIMING_WS2812 },
+        { "SK6812", LED_STRIP_TIMING_SK6812 },
+        { "WS2811", LED_STRIP_TIMING_WS2811 },
+    };
+    
+    printf("waveform\n");
+    for (size_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        for (size_t t = 0; t < sizeof(timings) / sizeof(timings[0]); t++) {
+            check_clock(clocks[c], timings[t].name, timings[t].timing);
+        }
+    }
+    check_formats();
+    check_dirty();
+    check_correction();
+    check_busy();
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
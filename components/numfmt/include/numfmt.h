@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Buffer sizes (including the terminating NUL) for the fixed-width formatters
+ */
+#define NUMFMT_HEX_U8_LEN   3   /*!< "FF" */
+#define NUMFMT_DEC_U8_LEN   4   /*!< "255", right aligned like "%3d" */
+#define NUMFMT_DEC_U32_LEN  11  /*!< "4294967295" */
+#define NUMFMT_HEX_U32_LEN  9   /*!< "FFFFFFFF" */
+
+/**
+ * @brief Format a byte as two upper-case hex digits (same output as "%02X")
+ *
+ * @param out: Destination, at least NUMFMT_HEX_U8_LEN bytes
+ * @param value: Value to format
+ *
+ * @return
+ *      Pointer to the terminating NUL written into out
+ */
+char *numfmt_hex_u8(char *out, uint8_t value);
+
+/**
+ * @brief Format a byte as a right aligned 3-character decimal field (same output as "%3d")
+ *
+ * @param out: Destination, at least NUMFMT_DEC_U8_LEN bytes
+ * @param value: Value to format
+ *
+ * @return
+ *      Pointer to the terminating NUL written into out
+ */
+char *numfmt_dec_u8(char *out, uint8_t value);
+
+/**
+ * @brief Format an unsigned integer as decimal, right aligned in a field of at least width characters
+ *
+ * @param out: Destination, at least max(width, NUMFMT_DEC_U32_LEN - 1) + 1 bytes
+ * @param value: Value to format
+ * @param width: Minimum field width; shorter numbers are padded on the left
+ * @param pad: Padding character (' ' or '0')
+ *
+ * @return
+ *      Pointer to the terminating NUL written into out
+ */
+char *numfmt_dec_u32(char *out, uint32_t value, size_t width, char pad);
+
+/**
+ * @brief Format an unsigned integer as zero-padded upper-case hex of exactly digits characters
+ *
+ * @param out: Destination, at least digits + 1 bytes
+ * @param value: Value to format; higher digits beyond the field are dropped
+ * @param digits: Number of hex digits to emit (1..8)
+ *
+ * @return
+ *      Pointer to the terminating NUL written into out
+ */
+char *numfmt_hex_u32(char *out, uint32_t value, size_t digits);
+
+#ifdef __cplusplus
+}
+#endif
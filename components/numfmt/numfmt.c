@@ -0,0 +1,111 @@
+#include <string.h>
+#include "numfmt.h"
+
+// Two hex digits for every byte value, indexed by value * 2
+static const char hex_pairs[] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// Right aligned "%3d" field for every byte value, indexed by value * 3
+static const char dec_triplets[] =
+    "  0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15"
+    " 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31"
+    " 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47"
+    " 48 49 50 51 52 53 54 55 56 57 58 59 60 61 62 63"
+    " 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79"
+    " 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95"
+    " 96 97 98 99100101102103104105106107108109110111"
+    "112113114115116117118119120121122123124125126127"
+    "128129130131132133134135136137138139140141142143"
+    "144145146147148149150151152153154155156157158159"
+    "160161162163164165166167168169170171172173174175"
+    "176177178179180181182183184185186187188189190191"
+    "192193194195196197198199200201202203204205206207"
+    "208209210211212213214215216217218219220221222223"
+    "224225226227228229230231232233234235236237238239"
+    "240241242243244245246247248249250251252253254255";
+
+// Two decimal digits for 0-99, indexed by value * 2
+static const char dec_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+char *numfmt_hex_u8(char *out, uint8_t value)
+{
+    const char *src = &hex_pairs[value * 2];
+    out[0] = src[0];
+    out[1] = src[1];
+    out[2] = '\0';
+    return out + 2;
+}
+
+char *numfmt_dec_u8(char *out, uint8_t value)
+{
+    const char *src = &dec_triplets[value * 3];
+    out[0] = src[0];
+    out[1] = src[1];
+    out[2] = src[2];
+    out[3] = '\0';
+    return out + 3;
+}
+
+char *numfmt_dec_u32(char *out, uint32_t value, size_t width, char pad)
+{
+    // Build the digits right-to-left, two at a time, in a scratch buffer on the stack
+    char digits[NUMFMT_DEC_U32_LEN - 1];
+    char *p = digits + sizeof(digits);
+    
+    while (value >= 100) {
+        const char *src = &dec_pairs[(value % 100) * 2];
+        value /= 100;
+        *--p = src[1];
+        *--p = src[0];
+    }
+    if (value >= 10) {
+        const char *src = &dec_pairs[value * 2];
+        *--p = src[1];
+        *--p = src[0];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    
+    size_t len = (size_t)(digits + sizeof(digits) - p);
+    size_t fill = (width > len) ? width - len : 0;
+    memset(out, pad, fill);
+    memcpy(out + fill, p, len);
+    out[fill + len] = '\0';
+    return out + fill + len;
+}
+
+char *numfmt_hex_u32(char *out, uint32_t value, size_t digits)
+{
+    if (digits > 8) {
+        digits = 8;
+    }
+    
+    for (size_t i = digits; i > 0; i--) {
+        out[i - 1] = hex_digits[value & 0x0F];
+        value >>= 4;
+    }
+    out[digits] = '\0';
+    return out + digits;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Framed pixel protocols understood by the parser
+ *
+ * Adalight: "Ada", count-1 (16 bit big endian), checksum (hi ^ lo ^ 0x55), then RGB per pixel.
+ * TPM2:     0xC9, 0xDA, payload size (16 bit big endian), RGB payload, 0x36.
+ */
+typedef enum {
+    PIXEL_STREAM_ADALIGHT,
+    PIXEL_STREAM_TPM2,
+} pixel_stream_protocol_t;
+
+/**
+ * @brief Pixel buffer the payload is written into
+ *
+ * Usually the LED strip's own buffer (see led_strip_t::get_buffer), so
+ * received bytes land in wire order without an intermediate frame copy.
+ */
+typedef struct {
+    uint8_t *buffer;            /*!< Pixel buffer */
+    uint32_t pixel_count;       /*!< Pixels in the buffer; extra payload is discarded */
+    uint8_t bytes_per_pixel;    /*!< Stride between pixels */
+    uint8_t offset[3];          /*!< Byte offset of red, green and blue within a pixel */
+} pixel_stream_target_t;
+
+/**
+ * @brief Frame callbacks, called from pixel_stream_feed
+ */
+typedef struct {
+    void (*frame_begin)(void *ctx);     /*!< Header accepted; the buffer is about to be written */
+    void (*frame_end)(void *ctx, bool valid, pixel_stream_protocol_t protocol); /*!< Payload complete; valid is false on a framing error */
+    void *ctx;
+} pixel_stream_callbacks_t;
+
+/**
+ * @brief Parser counters
+ */
+typedef struct {
+    uint32_t frames;            /*!< Valid frames */
+    uint32_t bad_frames;        /*!< Header checksum or end byte errors */
+    uint32_t skipped_bytes;     /*!< Bytes discarded while looking for a header */
+    uint32_t bytes;             /*!< All bytes fed */
+} pixel_stream_stats_t;
+
+/**
+ * @brief Parser state (treat as opaque; public so it can be statically allocated)
+ */
+typedef struct {
+    pixel_stream_target_t target;
+    pixel_stream_callbacks_t callbacks;
+    pixel_stream_stats_t stats;
+    pixel_stream_protocol_t protocol;
+    uint8_t state;
+    uint8_t header[2];
+    uint32_t remaining;         /*!< Payload bytes left in the frame */
+    uint32_t pixel;             /*!< Pixel the next payload byte belongs to */
+    uint8_t channel;            /*!< Channel the next payload byte belongs to */
+} pixel_stream_t;
+
+/**
+ * @brief Initialize a parser
+ *
+ * @param stream: Parser state
+ * @param target: Buffer to write pixels into
+ * @param callbacks: Frame callbacks (members may be NULL)
+ */
+void pixel_stream_init(pixel_stream_t *stream, const pixel_stream_target_t *target, const pixel_stream_callbacks_t *callbacks);
+
+/**
+ * @brief Drop any partial frame and look for the next header
+ *
+ * @param stream: Parser state
+ */
+void pixel_stream_reset(pixel_stream_t *stream);
+
+/**
+ * @brief Parse received bytes
+ *
+ * Has no platform dependencies, so it can be driven from a UART, a pty on a
+ * host or a test buffer alike.
+ *
+ * @param stream: Parser state
+ * @param data: Received bytes
+ * @param len: Number of bytes
+ *
+ * @return
+ *      Number of valid frames completed
+ */
+uint32_t pixel_stream_feed(pixel_stream_t *stream, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,171 @@
+#include <string.h>
+#include "pixel_stream.h"
+
+#define TPM2_START          0xC9
+#define TPM2_TYPE_DATA      0xDA
+#define TPM2_END            0x36
+#define ADALIGHT_CHECK_XOR  0x55
+
+// Parser states
+enum {
+    STATE_HUNT,         // Looking for 'A' or the TPM2 start byte
+    STATE_ADA_D,
+    STATE_ADA_A,
+    STATE_ADA_HI,
+    STATE_ADA_LO,
+    STATE_ADA_CHECK,
+    STATE_TPM2_TYPE,
+    STATE_TPM2_HI,
+    STATE_TPM2_LO,
+    STATE_PAYLOAD,
+    STATE_TPM2_END,
+};
+
+void pixel_stream_init(pixel_stream_t *stream, const pixel_stream_target_t *target, const pixel_stream_callbacks_t *callbacks)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->target = *target;
+    if (callbacks) {
+        stream->callbacks = *callbacks;
+    }
+    stream->state = STATE_HUNT;
+}
+
+void pixel_stream_reset(pixel_stream_t *stream)
+{
+    if (stream->state == STATE_PAYLOAD || stream->state == STATE_TPM2_END) {
+        // The frame was started; tell the owner it will not complete
+        stream->stats.bad_frames++;
+        if (stream->callbacks.frame_end) {
+            stream->callbacks.frame_end(stream->callbacks.ctx, false, stream->protocol);
+        }
+    }
+    stream->state = STATE_HUNT;
+}
+
+static void frame_start(pixel_stream_t *stream, pixel_stream_protocol_t protocol, uint32_t payload)
+{
+    stream->protocol = protocol;
+    stream->remaining = payload;
+    stream->pixel = 0;
+    stream->channel = 0;
+    if (stream->callbacks.frame_begin) {
+        stream->callbacks.frame_begin(stream->callbacks.ctx);
+    }
+}
+
+static uint32_t frame_finish(pixel_stream_t *stream, bool valid)
+{
+    if (valid) {
+        stream->stats.frames++;
+    } else {
+        stream->stats.bad_frames++;
+    }
+    if (stream->callbacks.frame_end) {
+        stream->callbacks.frame_end(stream->callbacks.ctx, valid, stream->protocol);
+    }
+    stream->state = STATE_HUNT;
+    return valid ? 1 : 0;
+}
+
+// Copy payload bytes into their channel slots; returns bytes consumed
+static size_t copy_payload(pixel_stream_t *stream, const uint8_t *data, size_t len)
+{
+    const pixel_stream_target_t *target = &stream->target;
+    size_t n = len < stream->remaining ? len : stream->remaining;
+    uint32_t pixel = stream->pixel;
+    uint8_t channel = stream->channel;
+    uint8_t *dst = target->buffer + pixel * target->bytes_per_pixel;
+    
+    for (size_t i = 0; i < n; i++) {
+        if (pixel < target->pixel_count) {
+            dst[target->offset[channel]] = data[i];
+        }
+        if (++channel == 3) {
+            channel = 0;
+            pixel++;
+            dst += target->bytes_per_pixel;
+        }
+    }
+    
+    stream->pixel = pixel;
+    stream->channel = channel;
+    stream->remaining -= n;
+    return n;
+}
+
+uint32_t pixel_stream_feed(pixel_stream_t *stream, const uint8_t *data, size_t len)
+{
+    uint32_t frames = 0;
+    size_t i = 0;
+    stream->stats.bytes += len;
+    
+    while (i < len) {
+        if (stream->state == STATE_PAYLOAD) {
+            i += copy_payload(stream, data + i, len - i);
+            if (stream->remaining == 0) {
+                if (stream->protocol == PIXEL_STREAM_TPM2) {
+                    stream->state = STATE_TPM2_END;
+                } else {
+                    frames += frame_finish(stream, true);
+                }
+            }
+            continue;
+        }
+        
+        uint8_t byte = data[i++];
+        switch (stream->state) {
+        case STATE_HUNT:
+            if (byte == 'A') {
+                stream->state = STATE_ADA_D;
+            } else if (byte == TPM2_START) {
+                stream->state = STATE_TPM2_TYPE;
+            } else {
+                stream->stats.skipped_bytes++;
+            }
+            break;
+        case STATE_ADA_D:
+            stream->state = byte == 'd' ? STATE_ADA_A : (byte == 'A' ? STATE_ADA_D : STATE_HUNT);
+            break;
+        case STATE_ADA_A:
+            stream->state = byte == 'a' ? STATE_ADA_HI : (byte == 'A' ? STATE_ADA_D : STATE_HUNT);
+            break;
+        case STATE_ADA_HI:
+            stream->header[0] = byte;
+            stream->state = STATE_ADA_LO;
+            break;
+        case STATE_ADA_LO:
+            stream->header[1] = byte;
+            stream->state = STATE_ADA_CHECK;
+            break;
+        case STATE_ADA_CHECK:
+            if (byte != (stream->header[0] ^ stream->header[1] ^ ADALIGHT_CHECK_XOR)) {
+                stream->stats.bad_frames++;
+                stream->state = STATE_HUNT;
+                break;
+            }
+            frame_start(stream, PIXEL_STREAM_ADALIGHT, (((uint32_t)stream->header[0] << 8 | stream->header[1]) + 1) * 3);
+            stream->state = STATE_PAYLOAD;
+            break;
+        case STATE_TPM2_TYPE:
+            // Only data frames carry pixels; commands are ignored
+            stream->state = byte == TPM2_TYPE_DATA ? STATE_TPM2_HI : STATE_HUNT;
+            break;
+        case STATE_TPM2_HI:
+            stream->header[0] = byte;
+            stream->state = STATE_TPM2_LO;
+            break;
+        case STATE_TPM2_LO:
+            frame_start(stream, PIXEL_STREAM_TPM2, (uint32_t)stream->header[0] << 8 | byte);
+            stream->state = stream->remaining ? STATE_PAYLOAD : STATE_TPM2_END;
+            break;
+        case STATE_TPM2_END:
+            frames += frame_finish(stream, byte == TPM2_END);
+            break;
+        default:
+            stream->state = STATE_HUNT;
+            break;
+        }
+    }
+    return frames;
+}
@@ -0,0 +1,195 @@
+// Receive Adalight and TPM2 pixel frames on the host with the pixel_stream parser.
+//
+// Reads a byte stream from a file, a serial port, stdin or a pty of its
+// own, feeds it through pixel_stream.c in the chunk sizes a UART driver
+// delivers, and reports each frame and the parser counters: valid frames,
+// bad frames and bytes skipped while resynchronizing. Pairs with
+// pixel_stream_send.py to check framing and recovery without a board.
+//
+//     cc -O2 -I../include -o pixel_stream_recv pixel_stream_recv.c ../pixel_stream.c
+//     ./pixel_stream_send.py - --fps 0 --frames 100 --corrupt 10 > stream.bin
+//     ./pixel_stream_recv stream.bin --expect 90,10
+//
+//     ./pixel_stream_recv --pty --frames 300 &      prints the pty to send to
+//     ./pixel_stream_send.py /dev/pts/N --protocol tpm2 --frames 300 --corrupt 7
+//
+// Options: --pty (open a pty instead of reading a path), --leds N (pixels
+// kept, default 4), --chunk N (bytes per feed, default 64), --frames N (stop
+// after N valid and bad frames), --expect F,B (exit 1 unless exactly F valid
+// and B bad frames arrived), --quiet (summary only).
+// Exits 1 if no valid frame arrived or the counts differ from --expect.
+
+#define _GNU_SOURCE     // posix_openpt, cfmakeraw
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "pixel_stream.h"
+
+#define MAX_PIXELS          1024
+#define BYTES_PER_PIXEL     3
+#define IDLE_TIMEOUT_MS     2000    // Stop once a sender that has started goes quiet
+
+typedef struct {
+    uint8_t pixels[MAX_PIXELS * BYTES_PER_PIXEL];
+    int pixel_count;
+    bool quiet;
+    uint32_t frames;            // Valid and bad frames reported by frame_end
+} receiver_t;
+
+static const char *protocol_name(pixel_stream_protocol_t protocol)
+{
+    return protocol == PIXEL_STREAM_TPM2 ? "tpm2" : "adalight";
+}
+
+static void frame_end(void *ctx, bool valid, pixel_stream_protocol_t protocol)
+{
+    receiver_t *rx = ctx;
+    rx->frames++;
+    if (rx->quiet) {
+        return;
+    }
+    if (!valid) {
+        printf("frame %u (%s): bad end byte\n", rx->frames, protocol_name(protocol));
+        return;
+    }
+    const uint8_t *last = &rx->pixels[(rx->pixel_count - 1) * BYTES_PER_PIXEL];
+    printf("frame %u (%s): first %02x%02x%02x last %02x%02x%02x\n", rx->frames, protocol_name(protocol),
+           rx->pixels[0], rx->pixels[1], rx->pixels[2], last[0], last[1], last[2]);
+}
+
+// Binary data must pass the line discipline untouched
+static void make_raw(int fd)
+{
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+}
+
+// Master side of a new pty. The slave stays open here too so the stream
+// does not end each time a sender closes it.
+static int open_pty(int *slave)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    const char *name = ptsname(master);
+    *slave = open(name, O_RDWR | O_NOCTTY);
+    if (*slave < 0) {
+        perror(name);
+        return -1;
+    }
+    make_raw(*slave);
+    fprintf(stderr, "send to %s\n", name);
+    return master;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [PATH | - | --pty] [--leds N] [--chunk N] [--frames N] [--expect F,B] [--quiet]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static receiver_t rx;
+    const char *path = NULL;
+    bool pty = false;
+    int chunk = 64, frames = 0;
+    long expect_frames = -1, expect_bad = -1;
+    rx.pixel_count = 4;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pty")) {
+            pty = true;
+        } else if (!strcmp(argv[i], "--quiet")) {
+            rx.quiet = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--leds")) {
+            rx.pixel_count = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--chunk")) {
+            chunk = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--frames")) {
+            frames = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--expect")) {
+            if (sscanf(argv[++i], "%ld,%ld", &expect_frames, &expect_bad) != 2) {
+                usage(argv[0]);
+            }
+        } else if (argv[i][0] != '-' || !strcmp(argv[i], "-")) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (rx.pixel_count < 1 || rx.pixel_count > MAX_PIXELS || chunk < 1 || (pty == (path != NULL))) {
+        usage(argv[0]);
+    }
+    
+    int fd, slave = -1;
+    if (pty) {
+        fd = open_pty(&slave);
+    } else if (!strcmp(path, "-")) {
+        fd = STDIN_FILENO;
+    } else {
+        fd = open(path, O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror(path);
+        }
+    }
+    if (fd < 0) {
+        return 2;
+    }
+    make_raw(fd);
+    
+    pixel_stream_t stream;
+    pixel_stream_target_t target = {
+        .buffer = rx.pixels,
+        .pixel_count = rx.pixel_count,
+        .bytes_per_pixel = BYTES_PER_PIXEL,
+        .offset = { 0, 1, 2 },
+    };
+    pixel_stream_callbacks_t callbacks = {
+        .frame_end = frame_end,
+        .ctx = &rx,
+    };
+    pixel_stream_init(&stream, &target, &callbacks);
+    
+    // Adalight checksum errors never start a frame, so count them from the stats
+    uint8_t *buf = malloc(chunk);
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (!frames || stream.stats.frames + stream.stats.bad_frames < (uint32_t)frames) {
+        int ready = poll(&pfd, 1, IDLE_TIMEOUT_MS);
+        if (ready == 0 && stream.stats.bytes) {
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        ssize_t len = read(fd, buf, chunk);
+        if (len <= 0) {
+            break; // End of a file or pipe
+        }
+        pixel_stream_feed(&stream, buf, len);
+    }
+    pixel_stream_reset(&stream); // A frame cut off by the end of the stream counts as bad
+    free(buf);
+    if (slave >= 0) {
+        close(slave);
+    }
+    
+    const pixel_stream_stats_t *s = &stream.stats;
+    printf("%u bytes, %u frames, %u bad frames, %u skipped bytes\n", s->bytes, s->frames, s->bad_frames,
+           s->skipped_bytes);
+    if (expect_frames >= 0 && (s->frames != expect_frames || s->bad_frames != expect_bad)) {
+        printf("expected %ld frames and %ld bad frames\n", expect_frames, expect_bad);
+        return 1;
+    }
+    return s->frames ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Send Adalight or TPM2 pixel frames to a serial port, pty or file.
+
+Generates a test pattern at a fixed frame rate in the framing that
+pixel_stream.c parses, so the receiver can be exercised without an ambient
+lighting application. Frames can be deliberately corrupted to check that
+the device counts drops and resynchronizes. Writing to a file or "-"
+(stdout) produces a byte stream that can be replayed or piped into a pty;
+pixel_stream_recv.c parses it on the host and reports what it counted.
+
+    pixel_stream_send.py /dev/ttyUSB0 --leds 4 --fps 60
+    pixel_stream_send.py /dev/ttyUSB0 --protocol tpm2 --color ff8000
+    pixel_stream_send.py - --frames 100 --corrupt 10 > stream.bin
+"""
+
+import argparse
+import colorsys
+import sys
+import time
+
+
+def adalight_frame(pixels, corrupt=False):
+    count = len(pixels) - 1
+    hi, lo = count >> 8, count & 0xFF
+    check = hi ^ lo ^ 0x55
+    if corrupt:
+        check ^= 0xFF
+    return b"Ada" + bytes((hi, lo, check)) + b"".join(bytes(p) for p in pixels)
+
+
+def tpm2_frame(pixels, corrupt=False):
+    payload = b"".join(bytes(p) for p in pixels)
+    end = 0x00 if corrupt else 0x36
+    return bytes((0xC9, 0xDA, len(payload) >> 8, len(payload) & 0xFF)) + payload + bytes((end,))
+
+
+def rainbow(leds, frame, fps):
+    pixels = []
+    for i in range(leds):
+        hue = (frame / (fps * 5.0) + i / float(leds)) % 1.0
+        r, g, b = colorsys.hsv_to_rgb(hue, 1.0, 1.0)
+        pixels.append((int(r * 255), int(g * 255), int(b * 255)))
+    return pixels
+
+
+def open_output(path, baud):
+    if path == "-":
+        return sys.stdout.buffer
+    try:
+        import serial  # pyserial, for real ports
+
+        return serial.Serial(path, baud)
+    except (ImportError, ValueError, OSError):
+        # ptys and plain files need no line settings
+        return open(path, "wb", buffering=0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port, pty, file, or - for stdout")
+    parser.add_argument("--protocol", choices=("adalight", "tpm2"), default="adalight")
+    parser.add_argument("--leds", type=int, default=4, help="pixels per frame (default 4)")
+    parser.add_argument("--fps", type=float, default=60.0, help="frame rate (default 60, 0 = as fast as possible)")
+    parser.add_argument("--frames", type=int, default=0, help="stop after this many frames (default: run forever)")
+    parser.add_argument("--baud", type=int, default=921600, help="baud rate for real serial ports")
+    parser.add_argument("--color", help="send a solid RRGGBB color instead of a rainbow")
+    parser.add_argument("--corrupt", type=int, default=0, help="corrupt every Nth frame")
+    args = parser.parse_args()
+
+    build = adalight_frame if args.protocol == "adalight" else tpm2_frame
+    solid = None
+    if args.color:
+        value = int(args.color.lstrip("#"), 16)
+        solid = [((value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF)] * args.leds
+
+    out = open_output(args.port, args.baud)
+    period = 1.0 / args.fps if args.fps > 0 else 0.0
+    next_time = time.monotonic()
+    sent = corrupted = 0
+    try:
+        while not args.frames or sent < args.frames:
+            corrupt = args.corrupt > 0 and (sent + 1) % args.corrupt == 0
+            pixels = solid or rainbow(args.leds, sent, args.fps or 60.0)
+            out.write(build(pixels, corrupt))
+            out.flush()
+            sent += 1
+            corrupted += corrupt
+            if period:
+                next_time += period
+                time.sleep(max(0.0, next_time - time.monotonic()))
+    except KeyboardInterrupt:
+        pass
+    print("sent %d frames (%d corrupted)" % (sent, corrupted), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""Generate the SSD1306 glyph tables.
+
+The 6x8 base font is the source of truth. Larger native sizes are derived
+from it with diagonal edge-smoothing (not plain pixel doubling), and
+every glyph is emitted page-aligned in SSD1306 column-major order: for each
+8-pixel page of the glyph, one byte per column, LSB at the top. Rendering a
+glyph at a page-aligned y is therefore a straight copy of width bytes per page.
+
+Run by the ssd1306 component at build time:
+    gen_fonts.py --output <build>/ssd1306_fonts.c --check golden_glyphs.txt
+--check compares glyphs against the reviewed bitmaps in golden_glyphs.txt
+and exits 1 on any difference, so a change to the base font or the
+smoothing cannot slip into a build unnoticed. After an intended change,
+review the new glyphs with --preview <size> [chars] and rewrite the file:
+    gen_fonts.py --write-golden golden_glyphs.txt
+"""
+
+import argparse
+import sys
+
+# 6x8 base font, ' ' to '~', one byte per column, LSB at the top
+FONT_6X8 = [
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x00],  # sp
+    [0x00, 0x00, 0x00, 0x2F, 0x00, 0x00],  # !
+    [0x00, 0x00, 0x07, 0x00, 0x07, 0x00],  # "
+    [0x00, 0x14, 0x7F, 0x14, 0x7F, 0x14],  # #
+    [0x00, 0x24, 0x2A, 0x7F, 0x2A, 0x12],  # $
+    [0x00, 0x62, 0x64, 0x08, 0x13, 0x23],  # %
+    [0x00, 0x36, 0x49, 0x55, 0x22, 0x50],  # &
+    [0x00, 0x00, 0x05, 0x03, 0x00, 0x00],  # '
+    [0x00, 0x00, 0x1C, 0x22, 0x41, 0x00],  # (
+    [0x00, 0x00, 0x41, 0x22, 0x1C, 0x00],  # )
+    [0x00, 0x14, 0x08, 0x3E, 0x08, 0x14],  # *
+    [0x00, 0x08, 0x08, 0x3E, 0x08, 0x08],  # +
+    [0x00, 0x00, 0x00, 0xA0, 0x60, 0x00],  # ,
+    [0x00, 0x08, 0x08, 0x08, 0x08, 0x08],  # -
+    [0x00, 0x00, 0x60, 0x60, 0x00, 0x00],  # .
+    [0x00, 0x20, 0x10, 0x08, 0x04, 0x02],  # /
+    [0x00, 0x3E, 0x51, 0x49, 0x45, 0x3E],  # 0
+    [0x00, 0x00, 0x42, 0x7F, 0x40, 0x00],  # 1
+    [0x00, 0x42, 0x61, 0x51, 0x49, 0x46],  # 2
+    [0x00, 0x21, 0x41, 0x45, 0x4B, 0x31],  # 3
+    [0x00, 0x18, 0x14, 0x12, 0x7F, 0x10],  # 4
+    [0x00, 0x27, 0x45, 0x45, 0x45, 0x39],  # 5
+    [0x00, 0x3C, 0x4A, 0x49, 0x49, 0x30],  # 6
+    [0x00, 0x01, 0x71, 0x09, 0x05, 0x03],  # 7
+    [0x00, 0x36, 0x49, 0x49, 0x49, 0x36],  # 8
+    [0x00, 0x06, 0x49, 0x49, 0x29, 0x1E],  # 9
+    [0x00, 0x00, 0x36, 0x36, 0x00, 0x00],  # :
+    [0x00, 0x00, 0x56, 0x36, 0x00, 0x00],  # ;
+    [0x00, 0x08, 0x14, 0x22, 0x41, 0x00],  # <
+    [0x00, 0x14, 0x14, 0x14, 0x14, 0x14],  # =
+    [0x00, 0x00, 0x41, 0x22, 0x14, 0x08],  # >
+    [0x00, 0x02, 0x01, 0x51, 0x09, 0x06],  # ?
+    [0x00, 0x32, 0x49, 0x59, 0x51, 0x3E],  # @
+    [0x00, 0x7C, 0x12, 0x11, 0x12, 0x7C],  # A
+    [0x00, 0x7F, 0x49, 0x49, 0x49, 0x36],  # B
+    [0x00, 0x3E, 0x41, 0x41, 0x41, 0x22],  # C
+    [0x00, 0x7F, 0x41, 0x41, 0x22, 0x1C],  # D
+    [0x00, 0x7F, 0x49, 0x49, 0x49, 0x41],  # E
+    [0x00, 0x7F, 0x09, 0x09, 0x09, 0x01],  # F
+    [0x00, 0x3E, 0x41, 0x49, 0x49, 0x7A],  # G
+    [0x00, 0x7F, 0x08, 0x08, 0x08, 0x7F],  # H
+    [0x00, 0x00, 0x41, 0x7F, 0x41, 0x00],  # I
+    [0x00, 0x20, 0x40, 0x41, 0x3F, 0x01],  # J
+    [0x00, 0x7F, 0x08, 0x14, 0x22, 0x41],  # K
+    [0x00, 0x7F, 0x40, 0x40, 0x40, 0x40],  # L
+    [0x00, 0x7F, 0x02, 0x0C, 0x02, 0x7F],  # M
+    [0x00, 0x7F, 0x04, 0x08, 0x10, 0x7F],  # N
+    [0x00, 0x3E, 0x41, 0x41, 0x41, 0x3E],  # O
+    [0x00, 0x7F, 0x09, 0x09, 0x09, 0x06],  # P
+    [0x00, 0x3E, 0x41, 0x51, 0x21, 0x5E],  # Q
+    [0x00, 0x7F, 0x09, 0x19, 0x29, 0x46],  # R
+    [0x00, 0x46, 0x49, 0x49, 0x49, 0x31],  # S
+    [0x00, 0x01, 0x01, 0x7F, 0x01, 0x01],  # T
+    [0x00, 0x3F, 0x40, 0x40, 0x40, 0x3F],  # U
+    [0x00, 0x1F, 0x20, 0x40, 0x20, 0x1F],  # V
+    [0x00, 0x3F, 0x40, 0x38, 0x40, 0x3F],  # W
+    [0x00, 0x63, 0x14, 0x08, 0x14, 0x63],  # X
+    [0x00, 0x07, 0x08, 0x70, 0x08, 0x07],  # Y
+    [0x00, 0x61, 0x51, 0x49, 0x45, 0x43],  # Z
+    [0x00, 0x00, 0x7F, 0x41, 0x41, 0x00],  # [
+    [0x00, 0x55, 0x2A, 0x55, 0x2A, 0x55],  # 55
+    [0x00, 0x00, 0x41, 0x41, 0x7F, 0x00],  # ]
+    [0x00, 0x04, 0x02, 0x01, 0x02, 0x04],  # ^
+    [0x00, 0x40, 0x40, 0x40, 0x40, 0x40],  # _
+    [0x00, 0x00, 0x01, 0x02, 0x04, 0x00],  # '
+    [0x00, 0x20, 0x54, 0x54, 0x54, 0x78],  # a
+    [0x00, 0x7F, 0x48, 0x44, 0x44, 0x38],  # b
+    [0x00, 0x38, 0x44, 0x44, 0x44, 0x20],  # c
+    [0x00, 0x38, 0x44, 0x44, 0x48, 0x7F],  # d
+    [0x00, 0x38, 0x54, 0x54, 0x54, 0x18],  # e
+    [0x00, 0x08, 0x7E, 0x09, 0x01, 0x02],  # f
+    [0x00, 0x18, 0xA4, 0xA4, 0xA4, 0x7C],  # g
+    [0x00, 0x7F, 0x08, 0x04, 0x04, 0x78],  # h
+    [0x00, 0x00, 0x44, 0x7D, 0x40, 0x00],  # i
+    [0x00, 0x40, 0x80, 0x84, 0x7D, 0x00],  # j
+    [0x00, 0x7F, 0x10, 0x28, 0x44, 0x00],  # k
+    [0x00, 0x00, 0x41, 0x7F, 0x40, 0x00],  # l
+    [0x00, 0x7C, 0x04, 0x18, 0x04, 0x78],  # m
+    [0x00, 0x7C, 0x08, 0x04, 0x04, 0x78],  # n
+    [0x00, 0x38, 0x44, 0x44, 0x44, 0x38],  # o
+    [0x00, 0xFC, 0x24, 0x24, 0x24, 0x18],  # p
+    [0x00, 0x18, 0x24, 0x24, 0x18, 0xFC],  # q
+    [0x00, 0x7C, 0x08, 0x04, 0x04, 0x08],  # r
+    [0x00, 0x48, 0x54, 0x54, 0x54, 0x20],  # s
+    [0x00, 0x04, 0x3F, 0x44, 0x40, 0x20],  # t
+    [0x00, 0x3C, 0x40, 0x40, 0x20, 0x7C],  # u
+    [0x00, 0x1C, 0x20, 0x40, 0x20, 0x1C],  # v
+    [0x00, 0x3C, 0x40, 0x30, 0x40, 0x3C],  # w
+    [0x00, 0x44, 0x28, 0x10, 0x28, 0x44],  # x
+    [0x00, 0x1C, 0xA0, 0xA0, 0xA0, 0x7C],  # y
+    [0x00, 0x44, 0x64, 0x54, 0x4C, 0x44],  # z
+    [0x00, 0x00, 0x08, 0x36, 0x41, 0x00],  # {
+    [0x00, 0x00, 0x00, 0x7F, 0x00, 0x00],  # |
+    [0x00, 0x00, 0x41, 0x36, 0x08, 0x00],  # }
+    [0x00, 0x08, 0x04, 0x08, 0x10, 0x08],  # ~
+]
+
+FIRST_CHAR = 0x20
+LAST_CHAR = 0x7E
+
+# name, scale, first char, last char
+FONTS = [
+    ("ssd1306_font_6x8", 1, FIRST_CHAR, LAST_CHAR),
+    ("ssd1306_font_12x16", 2, FIRST_CHAR, LAST_CHAR),
+    ("ssd1306_font_18x24", 3, FIRST_CHAR, LAST_CHAR),
+    # Large value-field font: space, digits and hex letters only
+    ("ssd1306_font_24x32", 4, ord(" "), ord("F")),
+]
+
+
+def glyph_bitmap(ch):
+    """Return the base glyph as rows of 0/1 pixels (8 rows x 6 columns)."""
+    cols = FONT_6X8[ord(ch) - FIRST_CHAR]
+    return [[(cols[x] >> y) & 1 for x in range(6)] for y in range(8)]
+
+
+def pixel(bitmap, x, y):
+    if 0 <= y < len(bitmap) and 0 <= x < len(bitmap[0]):
+        return bitmap[y][x]
+    return 0
+
+
+def smooth_scale(bitmap, scale):
+    """Scale by an integer factor, filling the outer corner of each diagonal step.
+
+    Pixels are only ever added, never removed, so the 1-pixel strokes of the
+    base font keep their weight: an empty source pixel whose two orthogonal
+    neighbours towards a corner are set (and whose diagonal neighbour there is
+    not, i.e. a real diagonal rather than a solid block) gets that corner of its
+    scaled block filled. The fill is a triangle of scale - 1 sub-pixels.
+    """
+    h, w = len(bitmap), len(bitmap[0])
+    out = [[0] * (w * scale) for _ in range(h * scale)]
+    for y in range(h):
+        for x in range(w):
+            if bitmap[y][x]:
+                for dy in range(scale):
+                    for dx in range(scale):
+                        out[y * scale + dy][x * scale + dx] = 1
+                continue
+            # (horizontal neighbour dx, vertical neighbour dy) for each corner
+            for cx, cy in ((-1, -1), (1, -1), (-1, 1), (1, 1)):
+                if not (pixel(bitmap, x + cx, y) and pixel(bitmap, x, y + cy)):
+                    continue
+                if pixel(bitmap, x + cx, y + cy):
+                    continue
+                for dy in range(scale):
+                    for dx in range(scale):
+                        # Distance from the corner in sub-pixels
+                        ux = dx if cx < 0 else scale - 1 - dx
+                        uy = dy if cy < 0 else scale - 1 - dy
+                        if ux + uy < scale - 1:
+                            out[y * scale + dy][x * scale + dx] = 1
+    return out
+
+
+def scaled_glyph(ch, scale):
+    bitmap = glyph_bitmap(ch)
+    if scale == 4:
+        # Two smoothing passes give rounder curves than one 4x pass
+        return smooth_scale(smooth_scale(bitmap, 2), 2)
+    if scale > 1:
+        return smooth_scale(bitmap, scale)
+    return bitmap
+
+
+def pack_pages(bitmap):
+    """Pack a bitmap into page-major, column-major SSD1306 bytes."""
+    h, w = len(bitmap), len(bitmap[0])
+    data = []
+    for page in range(h // 8):
+        for x in range(w):
+            byte = 0
+            for bit in range(8):
+                byte |= bitmap[page * 8 + bit][x] << bit
+            data.append(byte)
+    return data
+
+
+def emit_c(out):
+    out.write("// Generated by components/ssd1306/fontgen/gen_fonts.py - do not edit\n\n")
+    out.write('#include "ssd1306_fonts.h"\n')
+    for name, scale, first, last in FONTS:
+        width, height = 6 * scale, 8 * scale
+        out.write("\n// %dx%d, '%s' to '%s'\n" % (width, height, chr(first), chr(last)))
+        out.write("static const uint8_t %s_glyphs[] = {\n" % name)
+        for code in range(first, last + 1):
+            data = pack_pages(scaled_glyph(chr(code), scale))
+            label = {0x20: "sp", 0x5C: "backslash"}.get(code, chr(code))
+            for offset in range(0, len(data), 16):
+                chunk = ", ".join("0x%02X" % b for b in data[offset:offset + 16])
+                comment = "  // %s" % label if offset == 0 else ""
+                out.write("    %s,%s\n" % (chunk, comment))
+        out.write("};\n\n")
+        out.write("const ssd1306_font_t %s = {\n" % name)
+        out.write("    .width = %d,\n" % width)
+        out.write("    .height = %d,\n" % height)
+        out.write("    .first_char = 0x%02X,\n" % first)
+        out.write("    .last_char = 0x%02X,\n" % last)
+        out.write("    .glyphs = %s_glyphs,\n" % name)
+        out.write("};\n")
+
+
+def preview(size, chars):
+    scale = size // 8
+    for ch in chars:
+        print("'%s'" % ch)
+        for row in scaled_glyph(ch, scale):
+            print("".join("#" if p else "." for p in row))
+        print()
+
+
+# Glyphs kept in golden_glyphs.txt: curves, diagonals and the value-field
+# digits, at every size (the 32-pixel font stops at 'F')
+GOLDEN = [(8, "0AMgs/"), (16, "0AMgs/"), (24, "0AMgs/"), (32, "08AF")]
+
+
+def render(bitmap):
+    return ["".join("#" if p else "." for p in row) for row in bitmap]
+
+
+def write_golden(path):
+    with open(path, "w") as out:
+        out.write("# Expected glyphs of gen_fonts.py, checked with --check at build time.\n")
+        out.write("# Regenerate after an intended change: gen_fonts.py --write-golden %s\n" % path.split("/")[-1])
+        for size, chars in GOLDEN:
+            for ch in chars:
+                out.write("\nglyph %d %s\n" % (size, ch))
+                for row in render(scaled_glyph(ch, size // 8)):
+                    out.write(row + "\n")
+
+
+def read_golden(path):
+    """Return {(size, char): rows} from a golden file."""
+    glyphs = {}
+    rows = None
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not line or line.startswith("#"):
+                continue
+            if line.startswith("glyph "):
+                _, size, ch = line.split(" ", 2)
+                rows = glyphs.setdefault((int(size), ch), [])
+            elif rows is not None:
+                rows.append(line)
+    return glyphs
+
+
+def check_golden(path):
+    """Compare generated glyphs with the golden file; return the number of mismatches."""
+    glyphs = read_golden(path)
+    failures = 0
+    if not glyphs:
+        sys.stderr.write("%s: no glyphs\n" % path)
+        return 1
+    for (size, ch), expected in sorted(glyphs.items()):
+        actual = render(scaled_glyph(ch, size // 8))
+        if actual != expected:
+            failures += 1
+            sys.stderr.write("%s: '%s' at size %d differs (expected | generated)\n" % (path, ch, size))
+            for y in range(max(len(expected), len(actual))):
+                e = expected[y] if y < len(expected) else ""
+                a = actual[y] if y < len(actual) else ""
+                sys.stderr.write(("  %-32s | %s%s" % (e, a, "" if e == a else "  <")).rstrip() + "\n")
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--output", help="C file to write")
+    parser.add_argument("--preview", type=int, choices=[8, 16, 24, 32], help="print glyphs of this height")
+    parser.add_argument("--check", metavar="GOLDEN", help="exit 1 if glyphs differ from this golden file")
+    parser.add_argument("--write-golden", metavar="GOLDEN", help="write the golden file from the current glyphs")
+    parser.add_argument("chars", nargs="?", default="0123456789ABCDEF", help="characters to preview")
+    args = parser.parse_args()
+
+    if args.check and check_golden(args.check):
+        sys.exit(1)
+    if args.write_golden:
+        write_golden(args.write_golden)
+    elif args.preview:
+        preview(args.preview, args.chars)
+    elif args.output:
+        with open(args.output, "w") as out:
+            emit_c(out)
+    else:
+        emit_c(sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "driver/i2c.h"
+#include <stdbool.h>
+#include "driver/i2c_master.h"
+#include "driver/spi_master.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,6 +11,7 @@ extern "C" {
 // SSD1306 OLED display dimensions
 #define SSD1306_WIDTH           128
 #define SSD1306_HEIGHT          64
+#define SSD1306_FRAME_BYTES     (SSD1306_WIDTH * SSD1306_HEIGHT / 8)
 
 // SSD1306 commands
 #define SSD1306_CMD_SET_CONTRAST            0x81
@@ -37,13 +40,97 @@ extern "C" {
 #define SSD1306_ORIENTATION_NORMAL          0 // Normal orientation
 #define SSD1306_ORIENTATION_180_DEGREES     1 // Rotated 180 degrees
 
+// Contrast set at init; lower values dim the panel and slow OLED wear
+#define SSD1306_DEFAULT_CONTRAST            0xCF
+
+// I2C clock speeds
+#define SSD1306_I2C_SPEED_FAST          400000  // Fast-mode, the datasheet maximum
+#define SSD1306_I2C_SPEED_FAST_PLUS     1000000 // Fast-mode Plus, validated per panel at create
+
+// SPI clock
+#define SSD1306_SPI_CLOCK_HZ            10000000 // Datasheet maximum for 4-wire SPI
+
 // SSD1306 handle type
 typedef void* ssd1306_handle_t;
 
+// I2C device configuration
+typedef struct {
+    i2c_master_bus_handle_t bus;    // Bus from i2c_new_master_bus
+    uint16_t i2c_addr;              // 7-bit I2C address (usually 0x3C)
+    uint32_t scl_speed_hz;          // SCL speed; above 400 kHz falls back to 400 kHz if the panel fails validation
+    bool async;                     // Queue transfers and return immediately (bus needs trans_queue_depth > 0)
+    uint32_t power_on_delay_ms;     // Wait before the init sequence (0 if the panel is known to be powered up)
+} ssd1306_config_t;
+
+#define SSD1306_DEFAULT_CONFIG(bus_handle, addr) \
+    {                                           \
+        .bus = bus_handle,                      \
+        .i2c_addr = addr,                       \
+        .scl_speed_hz = SSD1306_I2C_SPEED_FAST, \
+        .async = false,                         \
+        .power_on_delay_ms = 100,               \
+    }
+
+// 4-wire SPI device configuration. The bus must be set up by the caller with
+// spi_bus_initialize(host, ..., SPI_DMA_CH_AUTO) and a max_transfer_sz of at
+// least SSD1306_FRAME_BYTES, so frames go out as single DMA transactions.
+typedef struct {
+    spi_host_device_t host;         // Initialized SPI bus
+    int cs_gpio;                    // Chip select
+    int dc_gpio;                    // Data/command select
+    int rst_gpio;                   // Reset (RES#), -1 if tied to the board reset
+    uint32_t clock_hz;              // SCLK frequency
+    bool async;                     // Queue transfers and return immediately
+    uint32_t power_on_delay_ms;     // Wait before the init sequence
+} ssd1306_spi_config_t;
+
+#define SSD1306_DEFAULT_SPI_CONFIG(spi_host, cs, dc) \
+    {                                               \
+        .host = spi_host,                           \
+        .cs_gpio = cs,                              \
+        .dc_gpio = dc,                              \
+        .rst_gpio = -1,                             \
+        .clock_hz = SSD1306_SPI_CLOCK_HZ,           \
+        .async = false,                             \
+        .power_on_delay_ms = 100,                   \
+    }
+
+// Called when a frame from ssd1306_refresh_gram has been sent (status is ESP_OK
+// or the bus error). In async mode this runs in the bus ISR: keep it short and
+// place it in IRAM.
+typedef void (*ssd1306_frame_done_cb_t)(ssd1306_handle_t dev, esp_err_t status, void *user_ctx);
+
+// Bus traffic counters, cumulative since create or the last reset
+typedef struct {
+    uint32_t frames;        // ssd1306_refresh_gram calls
+    uint32_t transactions;  // Bus write transactions
+    uint32_t bytes;         // Bytes written, including control bytes (D/C level on SPI)
+    uint32_t errors;        // Failed transactions
+} ssd1306_stats_t;
+
+// Storage for the static create variants: device state, GRAM and frame
+// buffer, so the display needs no heap. SPI sends straight from it, so it
+// must be DMA-capable: static DMA_ATTR ssd1306_static_t display_storage;
+#define SSD1306_STATIC_SIZE     (2 * SSD1306_FRAME_BYTES + 1536)
+
+typedef struct {
+    uint32_t reserved[SSD1306_STATIC_SIZE / 4];
+} ssd1306_static_t;
+
 // Function declarations
-ssd1306_handle_t ssd1306_create(i2c_port_t i2c_port, uint8_t i2c_addr);
+ssd1306_handle_t ssd1306_create(const ssd1306_config_t *config);
+ssd1306_handle_t ssd1306_create_spi(const ssd1306_spi_config_t *config);
+
+// Same as above, with the device in storage; delete leaves it to the caller
+ssd1306_handle_t ssd1306_create_static(const ssd1306_config_t *config, ssd1306_static_t *storage);
+ssd1306_handle_t ssd1306_create_spi_static(const ssd1306_spi_config_t *config, ssd1306_static_t *storage);
 void ssd1306_delete(ssd1306_handle_t dev);
+
+// Send gram to the panel. In async mode the frame is snapshotted and queued,
+// and the call returns once the previous frame has left the frame buffer.
 esp_err_t ssd1306_refresh_gram(ssd1306_handle_t dev);
+void ssd1306_register_frame_done_cb(ssd1306_handle_t dev, ssd1306_frame_done_cb_t cb, void *user_ctx);
+esp_err_t ssd1306_wait_idle(ssd1306_handle_t dev, uint32_t timeout_ms);
 esp_err_t ssd1306_clear_screen(ssd1306_handle_t dev, uint8_t chFill);
 void ssd1306_set_position(ssd1306_handle_t dev, uint8_t page, uint8_t column);
 void ssd1306_draw_pixel(ssd1306_handle_t dev, uint8_t x, uint8_t y, uint8_t color);
@@ -51,9 +138,27 @@ void ssd1306_fill_rectangle(ssd1306_handle_t dev, uint8_t x1, uint8_t y1, uint8_
 void ssd1306_display_char(ssd1306_handle_t dev, uint8_t x, uint8_t y, uint8_t ch, uint8_t font_size, uint8_t mode);
 void ssd1306_display_string(ssd1306_handle_t dev, uint8_t x, uint8_t y, const uint8_t *str, uint8_t font_size, uint8_t mode);
 
+// Bus traffic counters
+void ssd1306_get_stats(ssd1306_handle_t dev, ssd1306_stats_t *stats);
+void ssd1306_reset_stats(ssd1306_handle_t dev);
+
 // New function to set display orientation
 esp_err_t ssd1306_set_orientation(ssd1306_handle_t dev, uint8_t orientation);
 
+// Clear the bus and run the init sequence again, for a panel that stopped
+// answering (bus glitch, brown-out). Waits for queued transfers first and
+// returns ESP_OK only if every init command went through. GRAM is kept and
+// goes out with the next refresh; contrast, display on/off and offset are
+// back at their init values.
+esp_err_t ssd1306_recover(ssd1306_handle_t dev);
+
+// Power and burn-in controls: one short command transaction each, no frame
+// resend. Safe to call from any task, including while another draws; a call
+// waiting on a busy or failing bus gives up with ESP_ERR_TIMEOUT.
+esp_err_t ssd1306_set_contrast(ssd1306_handle_t dev, uint8_t contrast);
+esp_err_t ssd1306_set_display_on(ssd1306_handle_t dev, bool on);
+esp_err_t ssd1306_set_display_offset(ssd1306_handle_t dev, uint8_t rows);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Glyph table in SSD1306 layout. Each glyph is height/8 pages of width bytes,
+// page after page, one byte per column with the LSB at the top. Tables are
+// generated at build time by fontgen/gen_fonts.py.
+typedef struct {
+    uint8_t width;          // Glyph width in pixels (includes spacing column)
+    uint8_t height;         // Glyph height in pixels, multiple of 8
+    uint8_t first_char;     // First character in the table
+    uint8_t last_char;      // Last character in the table
+    const uint8_t *glyphs;  // Glyph data, (last_char - first_char + 1) glyphs
+} ssd1306_font_t;
+
+// Available fonts
+extern const ssd1306_font_t ssd1306_font_6x8;    // font_size 8
+extern const ssd1306_font_t ssd1306_font_12x16;  // font_size 16
+extern const ssd1306_font_t ssd1306_font_18x24;  // font_size 24
+extern const ssd1306_font_t ssd1306_font_24x32;  // font_size 32, ' ' to 'F' only (value fields)
+
+// Look up the font for a font_size (8, 16, 24 or 32); other sizes use 6x8
+const ssd1306_font_t *ssd1306_get_font(uint8_t font_size);
+
+// Glyph data for a character, substituting '?' for characters not in the font
+static inline const uint8_t *ssd1306_font_glyph(const ssd1306_font_t *font, uint8_t ch)
+{
+    if (ch < font->first_char || ch > font->last_char) {
+        ch = '?';
+    }
+    return font->glyphs + (uint32_t)(ch - font->first_char) * font->width * (font->height / 8);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,154 +1,186 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
-#include "driver/i2c.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "ssd1306.h"
+#include "ssd1306_bus.h"
+#include "ssd1306_fonts.h"
 
 static const char *TAG = "SSD1306";
 
-// Font data for characters (6x8 pixel font)
-static const uint8_t font6x8[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // sp
-    0x00, 0x00, 0x00, 0x2f, 0x00, 0x00, // !
-    0x00, 0x00, 0x07, 0x00, 0x07, 0x00, // "
-    0x00, 0x14, 0x7f, 0x14, 0x7f, 0x14, // #
-    0x00, 0x24, 0x2a, 0x7f, 0x2a, 0x12, // $
-    0x00, 0x62, 0x64, 0x08, 0x13, 0x23, // %
-    0x00, 0x36, 0x49, 0x55, 0x22, 0x50, // &
-    0x00, 0x00, 0x05, 0x03, 0x00, 0x00, // '
-    0x00, 0x00, 0x1c, 0x22, 0x41, 0x00, // (
-    0x00, 0x00, 0x41, 0x22, 0x1c, 0x00, // )
-    0x00, 0x14, 0x08, 0x3E, 0x08, 0x14, // *
-    0x00, 0x08, 0x08, 0x3E, 0x08, 0x08, // +
-    0x00, 0x00, 0x00, 0xA0, 0x60, 0x00, // ,
-    0x00, 0x08, 0x08, 0x08, 0x08, 0x08, // -
-    0x00, 0x00, 0x60, 0x60, 0x00, 0x00, // .
-    0x00, 0x20, 0x10, 0x08, 0x04, 0x02, // /
-    0x00, 0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
-    0x00, 0x00, 0x42, 0x7F, 0x40, 0x00, // 1
-    0x00, 0x42, 0x61, 0x51, 0x49, 0x46, // 2
-    0x00, 0x21, 0x41, 0x45, 0x4B, 0x31, // 3
-    0x00, 0x18, 0x14, 0x12, 0x7F, 0x10, // 4
-    0x00, 0x27, 0x45, 0x45, 0x45, 0x39, // 5
-    0x00, 0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
-    0x00, 0x01, 0x71, 0x09, 0x05, 0x03, // 7
-    0x00, 0x36, 0x49, 0x49, 0x49, 0x36, // 8
-    0x00, 0x06, 0x49, 0x49, 0x29, 0x1E, // 9
-    0x00, 0x00, 0x36, 0x36, 0x00, 0x00, // :
-    0x00, 0x00, 0x56, 0x36, 0x00, 0x00, // ;
-    0x00, 0x08, 0x14, 0x22, 0x41, 0x00, // <
-    0x00, 0x14, 0x14, 0x14, 0x14, 0x14, // =
-    0x00, 0x00, 0x41, 0x22, 0x14, 0x08, // >
-    0x00, 0x02, 0x01, 0x51, 0x09, 0x06, // ?
-    0x00, 0x32, 0x49, 0x59, 0x51, 0x3E, // @
-    0x00, 0x7C, 0x12, 0x11, 0x12, 0x7C, // A
-    0x00, 0x7F, 0x49, 0x49, 0x49, 0x36, // B
-    0x00, 0x3E, 0x41, 0x41, 0x41, 0x22, // C
-    0x00, 0x7F, 0x41, 0x41, 0x22, 0x1C, // D
-    0x00, 0x7F, 0x49, 0x49, 0x49, 0x41, // E
-    0x00, 0x7F, 0x09, 0x09, 0x09, 0x01, // F
-    0x00, 0x3E, 0x41, 0x49, 0x49, 0x7A, // G
-    0x00, 0x7F, 0x08, 0x08, 0x08, 0x7F, // H
-    0x00, 0x00, 0x41, 0x7F, 0x41, 0x00, // I
-    0x00, 0x20, 0x40, 0x41, 0x3F, 0x01, // J
-    0x00, 0x7F, 0x08, 0x14, 0x22, 0x41, // K
-    0x00, 0x7F, 0x40, 0x40, 0x40, 0x40, // L
-    0x00, 0x7F, 0x02, 0x0C, 0x02, 0x7F, // M
-    0x00, 0x7F, 0x04, 0x08, 0x10, 0x7F, // N
-    0x00, 0x3E, 0x41, 0x41, 0x41, 0x3E, // O
-    0x00, 0x7F, 0x09, 0x09, 0x09, 0x06, // P
-    0x00, 0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
-    0x00, 0x7F, 0x09, 0x19, 0x29, 0x46, // R
-    0x00, 0x46, 0x49, 0x49, 0x49, 0x31, // S
-    0x00, 0x01, 0x01, 0x7F, 0x01, 0x01, // T
-    0x00, 0x3F, 0x40, 0x40, 0x40, 0x3F, // U
-    0x00, 0x1F, 0x20, 0x40, 0x20, 0x1F, // V
-    0x00, 0x3F, 0x40, 0x38, 0x40, 0x3F, // W
-    0x00, 0x63, 0x14, 0x08, 0x14, 0x63, // X
-    0x00, 0x07, 0x08, 0x70, 0x08, 0x07, // Y
-    0x00, 0x61, 0x51, 0x49, 0x45, 0x43, // Z
-    0x00, 0x00, 0x7F, 0x41, 0x41, 0x00, // [
-    0x00, 0x55, 0x2A, 0x55, 0x2A, 0x55, // 55
-    0x00, 0x00, 0x41, 0x41, 0x7F, 0x00, // ]
-    0x00, 0x04, 0x02, 0x01, 0x02, 0x04, // ^
-    0x00, 0x40, 0x40, 0x40, 0x40, 0x40, // _
-    0x00, 0x00, 0x01, 0x02, 0x04, 0x00, // '
-    0x00, 0x20, 0x54, 0x54, 0x54, 0x78, // a
-    0x00, 0x7F, 0x48, 0x44, 0x44, 0x38, // b
-    0x00, 0x38, 0x44, 0x44, 0x44, 0x20, // c
-    0x00, 0x38, 0x44, 0x44, 0x48, 0x7F, // d
-    0x00, 0x38, 0x54, 0x54, 0x54, 0x18, // e
-    0x00, 0x08, 0x7E, 0x09, 0x01, 0x02, // f
-    0x00, 0x18, 0xA4, 0xA4, 0xA4, 0x7C, // g
-    0x00, 0x7F, 0x08, 0x04, 0x04, 0x78, // h
-    0x00, 0x00, 0x44, 0x7D, 0x40, 0x00, // i
-    0x00, 0x40, 0x80, 0x84, 0x7D, 0x00, // j
-    0x00, 0x7F, 0x10, 0x28, 0x44, 0x00, // k
-    0x00, 0x00, 0x41, 0x7F, 0x40, 0x00, // l
-    0x00, 0x7C, 0x04, 0x18, 0x04, 0x78, // m
-    0x00, 0x7C, 0x08, 0x04, 0x04, 0x78, // n
-    0x00, 0x38, 0x44, 0x44, 0x44, 0x38, // o
-    0x00, 0xFC, 0x24, 0x24, 0x24, 0x18, // p
-    0x00, 0x18, 0x24, 0x24, 0x18, 0xFC, // q
-    0x00, 0x7C, 0x08, 0x04, 0x04, 0x08, // r
-    0x00, 0x48, 0x54, 0x54, 0x54, 0x20, // s
-    0x00, 0x04, 0x3F, 0x44, 0x40, 0x20, // t
-    0x00, 0x3C, 0x40, 0x40, 0x20, 0x7C, // u
-    0x00, 0x1C, 0x20, 0x40, 0x20, 0x1C, // v
-    0x00, 0x3C, 0x40, 0x30, 0x40, 0x3C, // w
-    0x00, 0x44, 0x28, 0x10, 0x28, 0x44, // x
-    0x00, 0x1C, 0xA0, 0xA0, 0xA0, 0x7C, // y
-    0x00, 0x44, 0x64, 0x54, 0x4C, 0x44, // z
-    0x00, 0x00, 0x08, 0x36, 0x41, 0x00, // {
-    0x00, 0x00, 0x00, 0x7F, 0x00, 0x00, // |
-    0x00, 0x00, 0x41, 0x36, 0x08, 0x00, // }
-    0x00, 0x08, 0x04, 0x08, 0x10, 0x08  // ~
-};
-
-// SSD1306 device structure
+#define SSD1306_TX_TIMEOUT_MS    100   // Wait for the bus lock, a free ring slot or the frame buffer
+#define SSD1306_TX_QUEUE_DEPTH   8     // Transactions in flight in async mode
+#define SSD1306_TX_CMD_MAX       16    // Control byte + commands in one queued command transaction
+#define SSD1306_FRAME_SIZE       SSD1306_FRAME_BYTES
+#define SSD1306_STATUS_DISPLAY_OFF 0x40 // Status register bit D6
+
+// Kind of a queued transaction
+typedef enum {
+    SSD1306_TX_CMD,
+    SSD1306_TX_FRAME,
+} ssd1306_tx_kind_t;
+
+// One slot of the async transaction ring. Command bytes are copied into the
+// slot because the caller's buffer is gone before the transfer runs; frame
+// data stays in the device's frame buffer.
+typedef struct {
+    ssd1306_tx_kind_t kind;
+    uint8_t buf[SSD1306_TX_CMD_MAX];
+} ssd1306_tx_slot_t;
+
+// SSD1306 device structure. Allocated DMA-capable (or in the caller's
+// DMA-capable static storage): SPI sends the frame buffer and command slots
+// straight from here. Everything the device uses lives inside it.
 typedef struct {
-    i2c_port_t i2c_port;    // I2C port number
-    uint8_t i2c_addr;       // I2C device address
+    ssd1306_bus_t *bus;                 // Transport (I2C or SPI), in bus_storage
+    ssd1306_bus_storage_t bus_storage;
+    bool static_storage;                // Not freed on delete
+    bool async;                         // Transfers are queued, not waited for
+    uint32_t power_on_delay_ms;         // Delay before the init sequence
+    
+    // Queued transaction engine (async mode). Transactions complete in
+    // submission order, so slot N completes before slot N+1.
+    ssd1306_tx_slot_t slots[SSD1306_TX_QUEUE_DEPTH];
+    uint32_t submitted;                 // Transactions queued (task side)
+    volatile uint32_t completed;        // Transactions finished (ISR side)
+    SemaphoreHandle_t slots_free;       // Counts free slots
+    SemaphoreHandle_t frame_free;       // Given while frame_buf is not being sent
+    ssd1306_frame_done_cb_t frame_done_cb;
+    void *frame_done_ctx;
+    
+    // Held while a public call talks to the panel, so commands from one task
+    // never split another task's frame. Taken with a timeout: a call stuck
+    // behind a failing bus gives up instead of waiting for it.
+    SemaphoreHandle_t bus_lock;
+    StaticSemaphore_t slots_free_buf, frame_free_buf, bus_lock_buf;
+    
+    ssd1306_stats_t stats;  // Bus traffic counters
+    uint8_t frame_buf[1 + SSD1306_FRAME_SIZE]; // Data control byte + snapshot of gram being sent
     uint8_t gram[SSD1306_HEIGHT/8][SSD1306_WIDTH]; // Graphics RAM (1 bit per pixel)
 } ssd1306_dev_t;
 
-// Write command to SSD1306
-static esp_err_t ssd1306_write_cmd(ssd1306_handle_t dev, uint8_t cmd)
+_Static_assert(sizeof(ssd1306_dev_t) <= sizeof(ssd1306_static_t), "SSD1306_STATIC_SIZE is too small");
+
+// Transaction finished (bus ISR context, async mode only)
+static bool IRAM_ATTR ssd1306_on_trans_done(void *arg, bool ok)
 {
-    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
-    uint8_t write_buf[2] = {0x00, cmd}; // Control byte (0x00) + command
+    ssd1306_dev_t *device = (ssd1306_dev_t *)arg;
+    ssd1306_tx_slot_t *slot = &device->slots[device->completed % SSD1306_TX_QUEUE_DEPTH];
+    BaseType_t woken = pdFALSE;
     
-    return i2c_master_write_to_device(device->i2c_port, device->i2c_addr, write_buf, sizeof(write_buf), 100 / portTICK_PERIOD_MS);
+    device->completed++;
+    if (!ok) {
+        device->stats.errors++;
+    }
+    if (slot->kind == SSD1306_TX_FRAME) {
+        xSemaphoreGiveFromISR(device->frame_free, &woken);
+        if (device->frame_done_cb) {
+            device->frame_done_cb((ssd1306_handle_t)device, ok ? ESP_OK : ESP_FAIL, device->frame_done_ctx);
+        }
+    }
+    xSemaphoreGiveFromISR(device->slots_free, &woken);
+    return woken == pdTRUE;
 }
 
-// Write data to SSD1306
-static esp_err_t ssd1306_write_data(ssd1306_handle_t dev, uint8_t *data, size_t size)
+// Send one transaction (control byte + payload) and account for it.
+// In async mode the transaction is queued and this returns immediately.
+// At debug log level every transaction is dumped in hex, control byte
+// included whatever the transport; tools/ssd1306_emu.py replays such a log
+// into a virtual panel.
+static esp_err_t ssd1306_transmit(ssd1306_dev_t *device, ssd1306_tx_kind_t kind, const uint8_t *buf, size_t len)
 {
-    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    ESP_LOGD(TAG, "tx %u", (unsigned)len);
+    ESP_LOG_BUFFER_HEX_LEVEL(TAG, buf, len, ESP_LOG_DEBUG);
     
-    // Need 1 byte for control byte (0x40) + data size
-    uint8_t *write_buf = malloc(size + 1);
-    if (!write_buf) {
-        ESP_LOGE(TAG, "Failed to allocate memory for write buffer");
-        return ESP_ERR_NO_MEM;
+    device->stats.transactions++;
+    device->stats.bytes += len;
+    
+    if (!device->async) {
+        esp_err_t ret = device->bus->transmit(device->bus, buf, len);
+        if (ret != ESP_OK) {
+            device->stats.errors++;
+        }
+        return ret;
+    }
+    
+    // Claim the next slot; blocks only if the whole ring is in flight
+    if (xSemaphoreTake(device->slots_free, pdMS_TO_TICKS(SSD1306_TX_TIMEOUT_MS)) != pdTRUE) {
+        device->stats.errors++;
+        return ESP_ERR_TIMEOUT;
+    }
+    ssd1306_tx_slot_t *slot = &device->slots[device->submitted % SSD1306_TX_QUEUE_DEPTH];
+    slot->kind = kind;
+    if (kind == SSD1306_TX_CMD) {
+        memcpy(slot->buf, buf, len);
+        buf = slot->buf;
+    }
+    device->submitted++;
+    
+    esp_err_t ret = device->bus->transmit(device->bus, buf, len);
+    if (ret != ESP_OK) {
+        // Never queued: release the slot again
+        device->submitted--;
+        device->stats.errors++;
+        xSemaphoreGive(device->slots_free);
     }
+    return ret;
+}
+
+// Write a sequence of commands in one transaction
+static esp_err_t ssd1306_write_cmds(ssd1306_handle_t dev, const uint8_t *cmds, size_t count)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    uint8_t write_buf[SSD1306_TX_CMD_MAX];
     
-    write_buf[0] = 0x40; // Control byte (0x40) for data
-    memcpy(write_buf + 1, data, size);
+    if (count > sizeof(write_buf) - 1) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    write_buf[0] = SSD1306_CONTROL_CMD; // Control byte + commands
+    memcpy(write_buf + 1, cmds, count);
     
-    esp_err_t ret = i2c_master_write_to_device(device->i2c_port, device->i2c_addr, write_buf, size + 1, 100 / portTICK_PERIOD_MS);
+    return ssd1306_transmit(device, SSD1306_TX_CMD, write_buf, count + 1);
+}
+
+// Write command to SSD1306
+static esp_err_t ssd1306_write_cmd(ssd1306_handle_t dev, uint8_t cmd)
+{
+    return ssd1306_write_cmds(dev, &cmd, 1);
+}
+
+// Take the bus lock for a public call
+static bool ssd1306_lock(ssd1306_dev_t *device)
+{
+    return xSemaphoreTake(device->bus_lock, pdMS_TO_TICKS(SSD1306_TX_TIMEOUT_MS)) == pdTRUE;
+}
+
+// Write commands from a public call: takes the bus lock
+static esp_err_t ssd1306_send_cmds(ssd1306_handle_t dev, const uint8_t *cmds, size_t count)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
     
-    free(write_buf);
+    if (!ssd1306_lock(device)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = ssd1306_write_cmds(dev, cmds, count);
+    xSemaphoreGive(device->bus_lock);
     return ret;
 }
 
 // Initialize the SSD1306 OLED display
 static esp_err_t ssd1306_init(ssd1306_handle_t dev)
 {
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
     esp_err_t ret;
     
     // Delay slightly before initialization
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    if (device->power_on_delay_ms > 0) {
+        vTaskDelay(pdMS_TO_TICKS(device->power_on_delay_ms));
+    }
     
     // Initialize display - basic initialization sequence for SSD1306
     ret = ssd1306_write_cmd(dev, SSD1306_CMD_DISPLAY_OFF);
@@ -196,7 +228,7 @@ static esp_err_t ssd1306_init(ssd1306_handle_t dev)
     
     ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_CONTRAST);
     if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_cmd(dev, 0xCF); // Contrast value
+    ret = ssd1306_write_cmd(dev, SSD1306_DEFAULT_CONTRAST); // Contrast value
     if (ret != ESP_OK) return ret;
     
     ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_PRECHARGE);
@@ -221,36 +253,226 @@ static esp_err_t ssd1306_init(ssd1306_handle_t dev)
     return ESP_OK;
 }
 
-// Create a new SSD1306 device instance
-ssd1306_handle_t ssd1306_create(i2c_port_t i2c_port, uint8_t i2c_addr)
+// Check that the panel answers correctly at the current I2C speed by reading
+// the status register: after init the display must report ON (D6 clear)
+static esp_err_t ssd1306_validate_link(ssd1306_dev_t *dev)
+{
+    uint8_t status = 0xFF;
+    esp_err_t ret = ssd1306_bus_i2c_read_status(dev->bus, &status);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return (status & SSD1306_STATUS_DISPLAY_OFF) ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+}
+
+// Set up a device in storage, or allocate one if it is NULL; the transport
+// is attached by the caller
+static ssd1306_dev_t *ssd1306_new_dev(uint32_t power_on_delay_ms, ssd1306_static_t *storage)
 {
-    ssd1306_dev_t *dev = malloc(sizeof(ssd1306_dev_t));
+    ssd1306_dev_t *dev;
+    if (storage) {
+        dev = memset(storage, 0, sizeof(ssd1306_dev_t));
+        dev->static_storage = true;
+    } else {
+        dev = heap_caps_calloc(1, sizeof(ssd1306_dev_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+        if (!dev) {
+            ESP_LOGE(TAG, "Failed to allocate memory for SSD1306 device");
+            return NULL;
+        }
+    }
+    
+    dev->power_on_delay_ms = power_on_delay_ms;
+    dev->frame_buf[0] = SSD1306_CONTROL_DATA; // Control byte for data
+    dev->bus_lock = xSemaphoreCreateMutexStatic(&dev->bus_lock_buf);
+    return dev;
+}
+
+static void ssd1306_release_dev(ssd1306_dev_t *dev)
+{
+    vSemaphoreDelete(dev->bus_lock);
+    if (!dev->static_storage) {
+        free(dev);
+    }
+}
+
+// Release a device that never made it out of create
+static void ssd1306_free_dev(ssd1306_dev_t *dev)
+{
+    if (dev->bus) {
+        dev->bus->del(dev->bus);
+    }
+    ssd1306_release_dev(dev);
+}
+
+// Switch an initialized device to queued transfers if asked to
+static void ssd1306_enable_async(ssd1306_dev_t *dev)
+{
+    dev->slots_free = xSemaphoreCreateCountingStatic(SSD1306_TX_QUEUE_DEPTH, SSD1306_TX_QUEUE_DEPTH,
+                                                     &dev->slots_free_buf);
+    dev->frame_free = xSemaphoreCreateBinaryStatic(&dev->frame_free_buf);
+    if (dev->bus->enable_async(dev->bus, ssd1306_on_trans_done, dev) != ESP_OK) {
+        ESP_LOGW(TAG, "Async transfers unavailable, using blocking writes");
+        vSemaphoreDelete(dev->slots_free);
+        vSemaphoreDelete(dev->frame_free);
+        dev->slots_free = NULL;
+        dev->frame_free = NULL;
+    } else {
+        xSemaphoreGive(dev->frame_free);
+        dev->async = true;
+    }
+}
+
+// Create an SSD1306 device on I2C, in storage or on the heap
+static ssd1306_handle_t ssd1306_create_on_i2c(const ssd1306_config_t *config, ssd1306_static_t *storage)
+{
+    if (!config || !config->bus) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return NULL;
+    }
+    
+    ssd1306_dev_t *dev = ssd1306_new_dev(config->power_on_delay_ms, storage);
     if (!dev) {
-        ESP_LOGE(TAG, "Failed to allocate memory for SSD1306 device");
         return NULL;
     }
     
-    // Initialize device structure
-    dev->i2c_port = i2c_port;
-    dev->i2c_addr = i2c_addr;
-    memset(dev->gram, 0, sizeof(dev->gram));
+    // Bring the panel up synchronously; async transfers are enabled afterwards
+    uint32_t speed = config->scl_speed_hz ? config->scl_speed_hz : SSD1306_I2C_SPEED_FAST;
+    if (ssd1306_bus_init_i2c(&dev->bus_storage, config->bus, config->i2c_addr, speed, &dev->bus) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SSD1306 at 0x%02X to the I2C bus", config->i2c_addr);
+        ssd1306_free_dev(dev);
+        return NULL;
+    }
     
-    // Initialize display
+    esp_err_t ret = ssd1306_init((ssd1306_handle_t)dev);
+    if (ret == ESP_OK && speed > SSD1306_I2C_SPEED_FAST) {
+        // Fast-mode Plus is beyond the SSD1306 datasheet; keep it only if the panel copes
+        ret = ssd1306_validate_link(dev);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Panel failed validation at %lu Hz (%s)", (unsigned long)speed, esp_err_to_name(ret));
+        }
+    }
+    if (ret != ESP_OK && speed > SSD1306_I2C_SPEED_FAST) {
+        ESP_LOGW(TAG, "Falling back to %d Hz", SSD1306_I2C_SPEED_FAST);
+        dev->bus->del(dev->bus);
+        dev->bus = NULL;
+        ret = ssd1306_bus_init_i2c(&dev->bus_storage, config->bus, config->i2c_addr, SSD1306_I2C_SPEED_FAST,
+                                   &dev->bus);
+        if (ret == ESP_OK) {
+            ret = ssd1306_init((ssd1306_handle_t)dev);
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize SSD1306 display");
+        ssd1306_free_dev(dev);
+        return NULL;
+    }
+    
+    if (config->async) {
+        // The I2C bus must have been created with a non-zero trans_queue_depth
+        ssd1306_enable_async(dev);
+    }
+    
+    ESP_LOGI(TAG, "SSD1306 at 0x%02X, %lu Hz, %s transfers", config->i2c_addr,
+             (unsigned long)dev->bus->clock_hz, dev->async ? "async" : "blocking");
+    return (ssd1306_handle_t)dev;
+}
+
+// Create an SSD1306 device on 4-wire SPI, in storage or on the heap
+static ssd1306_handle_t ssd1306_create_on_spi(const ssd1306_spi_config_t *config, ssd1306_static_t *storage)
+{
+    if (!config || config->dc_gpio < 0) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return NULL;
+    }
+    
+    ssd1306_dev_t *dev = ssd1306_new_dev(config->power_on_delay_ms, storage);
+    if (!dev) {
+        return NULL;
+    }
+    
+    if (ssd1306_bus_init_spi(&dev->bus_storage, config, &dev->bus) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SSD1306 to SPI host %d", (int)config->host);
+        ssd1306_free_dev(dev);
+        return NULL;
+    }
+    
+    // 4-wire SPI is write-only, so there is no status read to validate the link
     if (ssd1306_init((ssd1306_handle_t)dev) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize SSD1306 display");
-        free(dev);
+        ssd1306_free_dev(dev);
         return NULL;
     }
     
+    if (config->async) {
+        ssd1306_enable_async(dev);
+    }
+    
+    ESP_LOGI(TAG, "SSD1306 on SPI host %d, %lu Hz, %s transfers", (int)config->host,
+             (unsigned long)dev->bus->clock_hz, dev->async ? "async" : "blocking");
     return (ssd1306_handle_t)dev;
 }
 
+ssd1306_handle_t ssd1306_create(const ssd1306_config_t *config)
+{
+    return ssd1306_create_on_i2c(config, NULL);
+}
+
+ssd1306_handle_t ssd1306_create_spi(const ssd1306_spi_config_t *config)
+{
+    return ssd1306_create_on_spi(config, NULL);
+}
+
+ssd1306_handle_t ssd1306_create_static(const ssd1306_config_t *config, ssd1306_static_t *storage)
+{
+    return storage ? ssd1306_create_on_i2c(config, storage) : NULL;
+}
+
+ssd1306_handle_t ssd1306_create_spi_static(const ssd1306_spi_config_t *config, ssd1306_static_t *storage)
+{
+    return storage ? ssd1306_create_on_spi(config, storage) : NULL;
+}
+
 // Delete SSD1306 device
 void ssd1306_delete(ssd1306_handle_t dev)
 {
-    if (dev) {
-        free(dev);
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    if (!device) {
+        return;
+    }
+    
+    ssd1306_wait_idle(dev, SSD1306_TX_TIMEOUT_MS * SSD1306_TX_QUEUE_DEPTH);
+    device->bus->del(device->bus);
+    if (device->slots_free) {
+        vSemaphoreDelete(device->slots_free);
+    }
+    if (device->frame_free) {
+        vSemaphoreDelete(device->frame_free);
+    }
+    ssd1306_release_dev(device);
+}
+
+// Register a callback for finished frames
+void ssd1306_register_frame_done_cb(ssd1306_handle_t dev, ssd1306_frame_done_cb_t cb, void *user_ctx)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    device->frame_done_cb = cb;
+    device->frame_done_ctx = user_ctx;
+}
+
+// Wait until all queued transactions have finished
+esp_err_t ssd1306_wait_idle(ssd1306_handle_t dev, uint32_t timeout_ms)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    if (!device->async) {
+        return ESP_OK; // Blocking writes are always finished
     }
+    
+    if (!ssd1306_lock(device)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = device->bus->wait_idle(device->bus, timeout_ms);
+    xSemaphoreGive(device->bus_lock);
+    return ret;
 }
 
 // Refresh display with graphics RAM content
@@ -259,24 +481,86 @@ esp_err_t ssd1306_refresh_gram(ssd1306_handle_t dev)
     ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
     esp_err_t ret;
     
-    // Set column address range
-    ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_COLUMN_ADDR);
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_cmd(dev, 0); // Start column
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_cmd(dev, SSD1306_WIDTH - 1); // End column
-    if (ret != ESP_OK) return ret;
+    if (!ssd1306_lock(device)) {
+        return ESP_ERR_TIMEOUT;
+    }
     
-    // Set page address range
-    ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_PAGE_ADDR);
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_cmd(dev, 0); // Start page
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_cmd(dev, (SSD1306_HEIGHT / 8) - 1); // End page
-    if (ret != ESP_OK) return ret;
+    // The frame buffer is reused; wait for the previous frame to leave it
+    if (device->async && xSemaphoreTake(device->frame_free, pdMS_TO_TICKS(SSD1306_TX_TIMEOUT_MS)) != pdTRUE) {
+        xSemaphoreGive(device->bus_lock);
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    // Snapshot gram so drawing can continue while the frame is sent
+    memcpy(device->frame_buf + 1, device->gram, SSD1306_FRAME_SIZE);
+    
+    device->stats.frames++;
+    ESP_LOGD(TAG, "frame %lu", (unsigned long)device->stats.frames);
+    
+    // Set column and page address range in one transaction
+    const uint8_t window[] = {
+        SSD1306_CMD_SET_COLUMN_ADDR, 0, SSD1306_WIDTH - 1,
+        SSD1306_CMD_SET_PAGE_ADDR, 0, (SSD1306_HEIGHT / 8) - 1,
+    };
+    ret = ssd1306_write_cmds(dev, window, sizeof(window));
+    if (ret == ESP_OK) {
+        // Write entire display content
+        ret = ssd1306_transmit(device, SSD1306_TX_FRAME, device->frame_buf, sizeof(device->frame_buf));
+    }
     
-    // Write entire display content
-    return ssd1306_write_data(dev, (uint8_t *)device->gram, sizeof(device->gram));
+    if (device->async) {
+        if (ret != ESP_OK) {
+            xSemaphoreGive(device->frame_free); // Frame never queued
+        }
+    } else if (device->frame_done_cb) {
+        device->frame_done_cb(dev, ret, device->frame_done_ctx);
+    }
+    xSemaphoreGive(device->bus_lock);
+    return ret;
+}
+
+// Finish the transfers queued since errors was read and fail if any of them
+// did: queued transfers report a NACK or timeout only in the error count
+static esp_err_t ssd1306_check_sent(ssd1306_dev_t *device, esp_err_t ret, uint32_t errors)
+{
+    if (ret == ESP_OK && device->async) {
+        ret = device->bus->wait_idle(device->bus, SSD1306_TX_TIMEOUT_MS * SSD1306_TX_QUEUE_DEPTH);
+    }
+    if (ret == ESP_OK && device->stats.errors != errors) {
+        ret = ESP_FAIL;
+    }
+    return ret;
+}
+
+// Clear the bus and run the init sequence again
+esp_err_t ssd1306_recover(ssd1306_handle_t dev)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    esp_err_t ret = ESP_OK;
+    
+    if (!ssd1306_lock(device)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    // Queued transactions end within their own timeout, failed or not
+    if (device->async) {
+        ret = device->bus->wait_idle(device->bus, SSD1306_TX_TIMEOUT_MS * SSD1306_TX_QUEUE_DEPTH);
+    }
+    if (ret == ESP_OK && device->bus->recover) {
+        ret = device->bus->recover(device->bus);
+    }
+    
+    // One command first: a panel that still does not answer costs a single
+    // timeout, not one per command of the init sequence
+    uint32_t errors = device->stats.errors;
+    if (ret == ESP_OK) {
+        ret = ssd1306_check_sent(device, ssd1306_write_cmd(dev, SSD1306_CMD_DISPLAY_OFF), errors);
+    }
+    if (ret == ESP_OK) {
+        ret = ssd1306_check_sent(device, ssd1306_init(dev), errors);
+    }
+    xSemaphoreGive(device->bus_lock);
+    return ret;
 }
 
 // Clear screen with specified fill pattern
@@ -297,9 +581,12 @@ esp_err_t ssd1306_clear_screen(ssd1306_handle_t dev, uint8_t chFill)
 // Set cursor position for drawing
 void ssd1306_set_position(ssd1306_handle_t dev, uint8_t page, uint8_t column)
 {
-    ssd1306_write_cmd(dev, 0xB0 | page);                // Set page address
-    ssd1306_write_cmd(dev, 0x00 | (column & 0x0F));     // Set column lower address
-    ssd1306_write_cmd(dev, 0x10 | (column >> 4));       // Set column higher address
+    const uint8_t cmds[] = {
+        0xB0 | page,                // Set page address
+        0x00 | (column & 0x0F),     // Set column lower address
+        0x10 | (column >> 4),       // Set column higher address
+    };
+    ssd1306_send_cmds(dev, cmds, sizeof(cmds));
 }
 
 // Draw a single pixel
@@ -331,37 +618,71 @@ void ssd1306_fill_rectangle(ssd1306_handle_t dev, uint8_t x1, uint8_t y1, uint8_
     }
 }
 
+// Look up the font for a font size
+const ssd1306_font_t *ssd1306_get_font(uint8_t font_size)
+{
+    switch (font_size) {
+    case 16:
+        return &ssd1306_font_12x16;
+    case 24:
+        return &ssd1306_font_18x24;
+    case 32:
+        return &ssd1306_font_24x32;
+    default:
+        return &ssd1306_font_6x8;
+    }
+}
+
 // Display a single character
 void ssd1306_display_char(ssd1306_handle_t dev, uint8_t x, uint8_t y, uint8_t ch, uint8_t font_size, uint8_t mode)
 {
     ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    const ssd1306_font_t *font = ssd1306_get_font(font_size);
     
-    // Only ASCII characters are supported
-    if (ch < ' ' || ch > '~') {
-        ch = '?';
+    if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT) {
+        return; // Out of bounds
     }
     
-    // Get character's font data
-    ch -= ' ';  // Offset from space character
-    const uint8_t *font_data = &font6x8[ch * 6];
+    const uint8_t *glyph = ssd1306_font_glyph(font, ch);
+    uint8_t invert = mode ? 0xFF : 0x00;
+    uint8_t width = font->width;
+    if (x + width > SSD1306_WIDTH) {
+        width = SSD1306_WIDTH - x; // Clip at the right edge
+    }
     
-    for (uint8_t col = 0; col < 6; col++) {
-        uint8_t font_col = font_data[col];
+    // Glyphs are stored page by page, so each glyph page maps onto one GRAM
+    // page (aligned y) or straddles two (unaligned y)
+    uint8_t page = y / 8;
+    uint8_t shift = y % 8;
+    for (uint8_t p = 0; p < font->height / 8; p++, page++) {
+        const uint8_t *src = glyph + p * font->width;
+        if (page >= SSD1306_HEIGHT / 8) {
+            break;
+        }
         
-        for (uint8_t row = 0; row < 8; row++) {
-            uint8_t pixel = (font_col & (1 << row)) ? 1 : 0;
-            
-            // Handle display mode (normal or inverted)
-            if (mode) pixel = !pixel;
-            
-            // Handle font size
-            if (font_size == 16) {  // Double size
-                ssd1306_draw_pixel(dev, x + col*2, y + row*2, pixel);
-                ssd1306_draw_pixel(dev, x + col*2 + 1, y + row*2, pixel);
-                ssd1306_draw_pixel(dev, x + col*2, y + row*2 + 1, pixel);
-                ssd1306_draw_pixel(dev, x + col*2 + 1, y + row*2 + 1, pixel);
-            } else {  // Normal size
-                ssd1306_draw_pixel(dev, x + col, y + row, pixel);
+        if (shift == 0) {
+            // Aligned: straight copy of the page bytes
+            if (!invert) {
+                memcpy(&device->gram[page][x], src, width);
+            } else {
+                for (uint8_t col = 0; col < width; col++) {
+                    device->gram[page][x + col] = src[col] ^ invert;
+                }
+            }
+            continue;
+        }
+        
+        // Unaligned: split each byte between this page and the next
+        uint8_t upper_mask = 0xFF << shift;
+        uint8_t lower_mask = 0xFF >> (8 - shift);
+        bool has_next = (page + 1) < (SSD1306_HEIGHT / 8);
+        for (uint8_t col = 0; col < width; col++) {
+            uint8_t bits = src[col] ^ invert;
+            uint8_t *dst = &device->gram[page][x + col];
+            *dst = (*dst & ~upper_mask) | (uint8_t)(bits << shift);
+            if (has_next) {
+                uint8_t *next = &device->gram[page + 1][x + col];
+                *next = (*next & ~lower_mask) | (bits >> (8 - shift));
             }
         }
     }
@@ -370,7 +691,8 @@ void ssd1306_display_char(ssd1306_handle_t dev, uint8_t x, uint8_t y, uint8_t ch
 // Display a string
 void ssd1306_display_string(ssd1306_handle_t dev, uint8_t x, uint8_t y, const uint8_t *str, uint8_t font_size, uint8_t mode)
 {
-    uint8_t char_width = (font_size == 16) ? 12 : 6;  // Width for single or double size
+    const ssd1306_font_t *font = ssd1306_get_font(font_size);
+    uint8_t char_width = font->width;
     
     while (*str) {
         ssd1306_display_char(dev, x, y, *str, font_size, mode);
@@ -379,33 +701,62 @@ void ssd1306_display_string(ssd1306_handle_t dev, uint8_t x, uint8_t y, const ui
         // Handle string wrapping
         if (x > SSD1306_WIDTH - char_width) {
             x = 0;
-            y += (font_size == 16) ? 16 : 8;
+            y += font->height;
         }
         
         str++;
     }
 }
 
+// Get bus traffic counters
+void ssd1306_get_stats(ssd1306_handle_t dev, ssd1306_stats_t *stats)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    *stats = device->stats;
+}
+
+// Reset bus traffic counters
+void ssd1306_reset_stats(ssd1306_handle_t dev)
+{
+    ssd1306_dev_t *device = (ssd1306_dev_t *)dev;
+    memset(&device->stats, 0, sizeof(device->stats));
+}
+
 // Set display orientation
 esp_err_t ssd1306_set_orientation(ssd1306_handle_t dev, uint8_t orientation)
 {
-    esp_err_t ret;
+    uint8_t cmds[2];
     
     if (orientation == SSD1306_ORIENTATION_180_DEGREES) {
         // For 180-degree rotation (flipping the display)
-        ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_SEGMENT_REMAP | 0x01); // Flipped segment mapping (0xA1)
-        if (ret != ESP_OK) return ret;
-        
-        ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_COM_SCAN_MODE | 0x08); // Flipped COM scan (0xC8)
-        if (ret != ESP_OK) return ret;
+        cmds[0] = SSD1306_CMD_SET_SEGMENT_REMAP | 0x01; // Flipped segment mapping (0xA1)
+        cmds[1] = SSD1306_CMD_SET_COM_SCAN_MODE | 0x08; // Flipped COM scan (0xC8)
     } else {
         // For normal orientation
-        ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_SEGMENT_REMAP); // Normal segment mapping (0xA0)
-        if (ret != ESP_OK) return ret;
-        
-        ret = ssd1306_write_cmd(dev, SSD1306_CMD_SET_COM_SCAN_MODE); // Normal COM scan (0xC0)
-        if (ret != ESP_OK) return ret;
+        cmds[0] = SSD1306_CMD_SET_SEGMENT_REMAP;        // Normal segment mapping (0xA0)
+        cmds[1] = SSD1306_CMD_SET_COM_SCAN_MODE;        // Normal COM scan (0xC0)
     }
     
-    return ESP_OK;
+    return ssd1306_send_cmds(dev, cmds, sizeof(cmds));
+}
+
+// Set panel contrast (segment drive current)
+esp_err_t ssd1306_set_contrast(ssd1306_handle_t dev, uint8_t contrast)
+{
+    const uint8_t cmds[] = { SSD1306_CMD_SET_CONTRAST, contrast };
+    return ssd1306_send_cmds(dev, cmds, sizeof(cmds));
+}
+
+// Switch the panel on or into sleep; GRAM is kept while it sleeps
+esp_err_t ssd1306_set_display_on(ssd1306_handle_t dev, bool on)
+{
+    const uint8_t cmd = on ? SSD1306_CMD_DISPLAY_ON : SSD1306_CMD_DISPLAY_OFF;
+    return ssd1306_send_cmds(dev, &cmd, 1);
+}
+
+// Shift the picture vertically by remapping COM lines; rows wrap around
+esp_err_t ssd1306_set_display_offset(ssd1306_handle_t dev, uint8_t rows)
+{
+    const uint8_t cmds[] = { SSD1306_CMD_SET_DISPLAY_OFFSET, rows % SSD1306_HEIGHT };
+    return ssd1306_send_cmds(dev, cmds, sizeof(cmds));
 }
\ No newline at end of file
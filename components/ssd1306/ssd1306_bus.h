@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Transport behind the SSD1306 driver. Every transaction is written the way
+// I2C carries it: a control byte (0x00 commands, 0x40 GRAM data) followed by
+// the payload. The SPI backend turns the control byte into the D/C line, so
+// the driver, its debug log and tools/ssd1306_emu.py are the same for both.
+#define SSD1306_CONTROL_CMD     0x00
+#define SSD1306_CONTROL_DATA    0x40
+
+typedef struct ssd1306_bus_s ssd1306_bus_t;
+
+// A queued transaction has finished (ISR context). Returns true if it woke
+// a higher-priority task.
+typedef bool (*ssd1306_bus_done_cb_t)(void *ctx, bool ok);
+
+struct ssd1306_bus_s {
+    // Send control byte + payload. Blocking until the bus is async; after
+    // that it returns once queued, buf must stay valid until done is called,
+    // and transactions complete in submission order.
+    esp_err_t (*transmit)(ssd1306_bus_t *bus, const uint8_t *buf, size_t len);
+    
+    // Switch to queued transfers reporting to done
+    esp_err_t (*enable_async)(ssd1306_bus_t *bus, ssd1306_bus_done_cb_t done, void *ctx);
+    
+    // Wait until every queued transaction has finished
+    esp_err_t (*wait_idle)(ssd1306_bus_t *bus, uint32_t timeout_ms);
+    
+    // Free a bus the panel is holding (SDA stuck low after a glitch or a
+    // reset mid-byte). NULL when the transport has nothing to clear.
+    esp_err_t (*recover)(ssd1306_bus_t *bus);
+    
+    void (*del)(ssd1306_bus_t *bus);
+    
+    const char *name;       // "i2c" or "spi", for logs
+    uint32_t clock_hz;      // Bus clock in use
+};
+
+// Backend state. Defined here so the device can embed it: a display needs
+// no memory beyond its device structure.
+typedef struct {
+    ssd1306_bus_t base;
+    i2c_master_bus_handle_t bus;
+    i2c_master_dev_handle_t dev;
+    ssd1306_bus_done_cb_t done;
+    void *done_ctx;
+} ssd1306_bus_i2c_t;
+
+#define SSD1306_SPI_QUEUE_DEPTH 8       // Transactions in flight, at least the driver's ring depth
+
+typedef struct ssd1306_bus_spi_s ssd1306_bus_spi_t;
+
+// Queued transaction plus what the callbacks need to know about it
+typedef struct {
+    spi_transaction_t t;
+    ssd1306_bus_spi_t *spi;
+    bool data;                  // D/C level: GRAM data or commands
+} ssd1306_spi_trans_t;
+
+struct ssd1306_bus_spi_s {
+    ssd1306_bus_t base;
+    spi_device_handle_t dev;
+    int dc_gpio;
+    ssd1306_spi_trans_t trans[SSD1306_SPI_QUEUE_DEPTH];
+    uint32_t submitted;         // Transactions queued
+    uint32_t in_flight;         // Queued and not yet collected with get_trans_result
+    ssd1306_bus_done_cb_t done;
+    void *done_ctx;
+};
+
+typedef union {
+    ssd1306_bus_i2c_t i2c;
+    ssd1306_bus_spi_t spi;
+} ssd1306_bus_storage_t;
+
+// Set up a transport in storage; del detaches it from the bus and leaves
+// the storage to the caller
+esp_err_t ssd1306_bus_init_i2c(ssd1306_bus_storage_t *storage, i2c_master_bus_handle_t bus, uint16_t addr,
+                               uint32_t scl_speed_hz, ssd1306_bus_t **ret_bus);
+
+// Read the I2C status byte; bit D6 is set while the display is off
+esp_err_t ssd1306_bus_i2c_read_status(ssd1306_bus_t *bus, uint8_t *status);
+
+esp_err_t ssd1306_bus_init_spi(ssd1306_bus_storage_t *storage, const ssd1306_spi_config_t *config,
+                               ssd1306_bus_t **ret_bus);
+
+#ifdef __cplusplus
+}
+#endif
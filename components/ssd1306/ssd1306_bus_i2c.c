@@ -0,0 +1,88 @@
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_attr.h"
+#include "driver/i2c_master.h"
+#include "ssd1306_bus.h"
+
+#define SSD1306_I2C_TIMEOUT_MS  100     // Per-transaction timeout
+
+static bool IRAM_ATTR ssd1306_i2c_on_trans_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+    ssd1306_bus_i2c_t *i2c = (ssd1306_bus_i2c_t *)arg;
+    return i2c->done(i2c->done_ctx, evt_data->event == I2C_EVENT_DONE);
+}
+
+static esp_err_t ssd1306_i2c_transmit(ssd1306_bus_t *bus, const uint8_t *buf, size_t len)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    return i2c_master_transmit(i2c->dev, buf, len, SSD1306_I2C_TIMEOUT_MS);
+}
+
+static esp_err_t ssd1306_i2c_enable_async(ssd1306_bus_t *bus, ssd1306_bus_done_cb_t done, void *ctx)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    
+    // The I2C bus must have been created with a non-zero trans_queue_depth
+    i2c->done = done;
+    i2c->done_ctx = ctx;
+    i2c_master_event_callbacks_t cbs = {
+        .on_trans_done = ssd1306_i2c_on_trans_done,
+    };
+    return i2c_master_register_event_callbacks(i2c->dev, &cbs, i2c);
+}
+
+static esp_err_t ssd1306_i2c_wait_idle(ssd1306_bus_t *bus, uint32_t timeout_ms)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    if (!i2c->done) {
+        return ESP_OK; // Blocking writes are always finished
+    }
+    return i2c_master_bus_wait_all_done(i2c->bus, (int)timeout_ms);
+}
+
+// The driver's bus reset clocks SCL (nine pulses, by the controller or
+// bit-banged) until the panel releases SDA, then sends a STOP
+static esp_err_t ssd1306_i2c_recover(ssd1306_bus_t *bus)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    return i2c_master_bus_reset(i2c->bus);
+}
+
+static void ssd1306_i2c_del(ssd1306_bus_t *bus)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    i2c_master_bus_rm_device(i2c->dev);
+}
+
+esp_err_t ssd1306_bus_i2c_read_status(ssd1306_bus_t *bus, uint8_t *status)
+{
+    ssd1306_bus_i2c_t *i2c = __containerof(bus, ssd1306_bus_i2c_t, base);
+    return i2c_master_receive(i2c->dev, status, 1, SSD1306_I2C_TIMEOUT_MS);
+}
+
+esp_err_t ssd1306_bus_init_i2c(ssd1306_bus_storage_t *storage, i2c_master_bus_handle_t bus, uint16_t addr,
+                               uint32_t scl_speed_hz, ssd1306_bus_t **ret_bus)
+{
+    ssd1306_bus_i2c_t *i2c = memset(&storage->i2c, 0, sizeof(ssd1306_bus_i2c_t));
+    
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_speed_hz,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(bus, &dev_config, &i2c->dev);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    i2c->bus = bus;
+    i2c->base.transmit = ssd1306_i2c_transmit;
+    i2c->base.enable_async = ssd1306_i2c_enable_async;
+    i2c->base.wait_idle = ssd1306_i2c_wait_idle;
+    i2c->base.recover = ssd1306_i2c_recover;
+    i2c->base.del = ssd1306_i2c_del;
+    i2c->base.name = "i2c";
+    i2c->base.clock_hz = scl_speed_hz;
+    *ret_bus = &i2c->base;
+    return ESP_OK;
+}
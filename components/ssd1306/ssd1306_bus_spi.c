@@ -0,0 +1,140 @@
+#include <string.h>
+#include <sys/cdefs.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "ssd1306_bus.h"
+
+#define SSD1306_SPI_TIMEOUT_MS  100     // Per-transaction timeout
+#define SSD1306_SPI_RESET_US    10      // RES# low time (datasheet minimum 3 us)
+
+// D/C has to be valid before the first clock edge of the transaction
+static void IRAM_ATTR ssd1306_spi_pre_cb(spi_transaction_t *t)
+{
+    ssd1306_spi_trans_t *st = (ssd1306_spi_trans_t *)t->user;
+    gpio_set_level(st->spi->dc_gpio, st->data);
+}
+
+static void IRAM_ATTR ssd1306_spi_post_cb(spi_transaction_t *t)
+{
+    ssd1306_spi_trans_t *st = (ssd1306_spi_trans_t *)t->user;
+    ssd1306_bus_spi_t *spi = st->spi;
+    if (spi->done && spi->done(spi->done_ctx, true)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// Collect finished transactions so the driver's result queue never fills
+static esp_err_t ssd1306_spi_collect(ssd1306_bus_spi_t *spi, TickType_t wait)
+{
+    spi_transaction_t *done;
+    while (spi->in_flight > 0) {
+        if (spi_device_get_trans_result(spi->dev, &done, wait) != ESP_OK) {
+            return ESP_ERR_TIMEOUT;
+        }
+        spi->in_flight--;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ssd1306_spi_transmit(ssd1306_bus_t *bus, const uint8_t *buf, size_t len)
+{
+    ssd1306_bus_spi_t *spi = __containerof(bus, ssd1306_bus_spi_t, base);
+    
+    // The control byte becomes the D/C line and is not sent
+    ssd1306_spi_trans_t local;
+    ssd1306_spi_trans_t *st = spi->done ? &spi->trans[spi->submitted % SSD1306_SPI_QUEUE_DEPTH] : &local;
+    *st = (ssd1306_spi_trans_t){
+        .t = {
+            .length = (len - 1) * 8,
+            .tx_buffer = buf + 1,
+            .user = st,
+        },
+        .spi = spi,
+        .data = buf[0] == SSD1306_CONTROL_DATA,
+    };
+    
+    if (!spi->done) {
+        return spi_device_polling_transmit(spi->dev, &st->t);
+    }
+    
+    ssd1306_spi_collect(spi, 0);
+    esp_err_t ret = spi_device_queue_trans(spi->dev, &st->t, pdMS_TO_TICKS(SSD1306_SPI_TIMEOUT_MS));
+    if (ret == ESP_OK) {
+        spi->submitted++;
+        spi->in_flight++;
+    }
+    return ret;
+}
+
+static esp_err_t ssd1306_spi_enable_async(ssd1306_bus_t *bus, ssd1306_bus_done_cb_t done, void *ctx)
+{
+    ssd1306_bus_spi_t *spi = __containerof(bus, ssd1306_bus_spi_t, base);
+    spi->done_ctx = ctx;
+    spi->done = done;
+    return ESP_OK;
+}
+
+static esp_err_t ssd1306_spi_wait_idle(ssd1306_bus_t *bus, uint32_t timeout_ms)
+{
+    ssd1306_bus_spi_t *spi = __containerof(bus, ssd1306_bus_spi_t, base);
+    return ssd1306_spi_collect(spi, pdMS_TO_TICKS(timeout_ms));
+}
+
+static void ssd1306_spi_del(ssd1306_bus_t *bus)
+{
+    ssd1306_bus_spi_t *spi = __containerof(bus, ssd1306_bus_spi_t, base);
+    spi_bus_remove_device(spi->dev);
+}
+
+esp_err_t ssd1306_bus_init_spi(ssd1306_bus_storage_t *storage, const ssd1306_spi_config_t *config,
+                               ssd1306_bus_t **ret_bus)
+{
+    ssd1306_bus_spi_t *spi = memset(&storage->spi, 0, sizeof(ssd1306_bus_spi_t));
+    
+    uint64_t pins = 1ULL << config->dc_gpio;
+    if (config->rst_gpio >= 0) {
+        pins |= 1ULL << config->rst_gpio;
+    }
+    const gpio_config_t io_config = {
+        .pin_bit_mask = pins,
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    esp_err_t ret = gpio_config(&io_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // SPI modules bring RES# out; pulse it so the controller starts from reset
+    if (config->rst_gpio >= 0) {
+        gpio_set_level(config->rst_gpio, 0);
+        esp_rom_delay_us(SSD1306_SPI_RESET_US);
+        gpio_set_level(config->rst_gpio, 1);
+        esp_rom_delay_us(SSD1306_SPI_RESET_US);
+    }
+    
+    const spi_device_interface_config_t dev_config = {
+        .mode = 0,
+        .clock_speed_hz = config->clock_hz,
+        .spics_io_num = config->cs_gpio,
+        .queue_size = SSD1306_SPI_QUEUE_DEPTH,
+        .pre_cb = ssd1306_spi_pre_cb,
+        .post_cb = ssd1306_spi_post_cb,
+    };
+    ret = spi_bus_add_device(config->host, &dev_config, &spi->dev);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    spi->dc_gpio = config->dc_gpio;
+    spi->base.transmit = ssd1306_spi_transmit;
+    spi->base.enable_async = ssd1306_spi_enable_async;
+    spi->base.wait_idle = ssd1306_spi_wait_idle;
+    spi->base.del = ssd1306_spi_del;
+    spi->base.name = "spi";
+    spi->base.clock_hz = config->clock_hz;
+    *ret_bus = &spi->base;
+    return ESP_OK;
+}
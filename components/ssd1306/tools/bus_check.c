@@ -0,0 +1,547 @@
+// Check the SSD1306 I2C and SPI transports against each other on the host.
+//
+// Builds the driver with both transports, ssd1306_bus_i2c.c and
+// ssd1306_bus_spi.c, against host I2C, SPI and GPIO drivers that hand every
+// transaction to the controller model in host/panel_model.h. The same
+// drawing and command script runs over I2C and SPI, blocking and async, and
+// each transaction is logged as its D/C level and payload bytes: for I2C
+// from the control byte, for SPI from the D/C pin as the transaction's
+// pre_cb left it. The SPI simulation poisons D/C before every transaction,
+// checks it holds through the transfer, calls post_cb once afterwards and,
+// when async, runs transactions a few behind the queue so the driver's
+// buffers must stay valid until done. All four logs must match byte for
+// byte, decode cleanly and leave the same GDDRAM.
+//
+//     python3 ../fontgen/gen_fonts.py --output ssd1306_fonts.c
+//     cc -O2 -Ihost -I../../../tools/host -I.. -I../include -o bus_check bus_check.c ../ssd1306.c ../ssd1306_bus_i2c.c ../ssd1306_bus_spi.c ssd1306_fonts.c
+//     ./bus_check           summary per transport
+//     ./bus_check -v        with stream violations and driver logs
+//
+// run_host_checks.sh builds and runs it with the other host checks. Exits 1
+// on a stream violation, a D/C or payload mismatch, or a callback that was
+// skipped or repeated.
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "ssd1306.h"
+#include "ssd1306_bus.h"
+#include "panel_model.h"
+
+#define SPI_HOST            1
+#define CS_GPIO             10
+#define DC_GPIO             9
+#define RST_GPIO            8
+#define GPIO_COUNT          64
+#define LEVEL_UNSET         -1      // D/C before a transaction's pre_cb has run
+#define HW_LAG              3       // Async transactions the simulated bus runs behind the queue
+#define QUEUE_MAX           16
+#define LOG_RECORDS         256
+#define LOG_BYTES           (32 * 1024)
+
+uint32_t host_now_ms = 0;
+void (*host_idle_hook)(void) = NULL;
+uint32_t host_now_us = 0;
+uint32_t host_isr_yields = 0;
+int host_log_verbose = 0;
+
+struct i2c_master_bus_t {
+    int unused;
+};
+
+struct i2c_master_dev_t {
+    int unused;
+};
+
+struct spi_device_t {
+    int unused;
+};
+
+// What went over the wire, one record per transaction
+typedef struct {
+    struct {
+        uint8_t dc;                 // 1 for GRAM data, 0 for commands
+        uint32_t len;
+        uint32_t offset;            // Payload position in bytes[]
+    } records[LOG_RECORDS];
+    uint8_t bytes[LOG_BYTES];
+    uint32_t count;
+    uint32_t used;
+} tx_log_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+} i2c_pending_t;
+
+static struct {
+    panel_t panel;
+    tx_log_t *log;
+    
+    // GPIO
+    int level[GPIO_COUNT];
+    uint64_t outputs;               // Pins configured as outputs
+    uint32_t rst_low_us;            // RES# low time of the last reset pulse
+    uint32_t rst_fall_us;
+    bool rst_pulsed;                // RES# went low and back high
+    bool traffic;                   // A transaction has run
+    bool traffic_before_reset;
+    
+    // I2C
+    struct i2c_master_bus_t i2c_bus;
+    struct i2c_master_dev_t i2c_dev;
+    i2c_master_callback_t i2c_done;
+    void *i2c_done_arg;
+    i2c_pending_t i2c_queue[QUEUE_MAX];
+    int i2c_queued;
+    
+    // SPI
+    struct spi_device_t spi_dev;
+    spi_device_interface_config_t spi_config;
+    bool spi_added;
+    spi_transaction_t *spi_queue[QUEUE_MAX];    // Queued, not yet on the wire
+    int spi_queued;
+    spi_transaction_t *spi_done[QUEUE_MAX];     // Finished, not yet collected
+    int spi_collectable;
+    uint32_t pre_calls, post_calls;
+    
+    uint32_t transactions;
+    uint32_t max_in_flight;
+} sim;
+
+static ssd1306_static_t storage;
+static tx_log_t logs[4];
+static uint32_t frames_done;
+static int failures = 0;
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+static void log_transaction(bool dc, const uint8_t *payload, size_t len)
+{
+    tx_log_t *log = sim.log;
+    sim.transactions++;
+    sim.traffic = true;
+    if (log->count == LOG_RECORDS || log->used + len > LOG_BYTES) {
+        CHECK(false, "transaction log full");
+        return;
+    }
+    log->records[log->count].dc = dc;
+    log->records[log->count].len = len;
+    log->records[log->count].offset = log->used;
+    memcpy(&log->bytes[log->used], payload, len);
+    log->used += len;
+    log->count++;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    CHECK(config->mode == GPIO_MODE_OUTPUT, "D/C and RES# configured with mode %d", config->mode);
+    sim.outputs |= config->pin_bit_mask;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    CHECK(gpio_num >= 0 && gpio_num < GPIO_COUNT && (sim.outputs >> gpio_num) & 1,
+          "GPIO %d driven without being an output", gpio_num);
+    if (gpio_num == RST_GPIO) {
+        if (!level) {
+            sim.rst_fall_us = host_now_us;
+            sim.traffic_before_reset |= sim.traffic;
+        } else if (sim.level[RST_GPIO] == 0) {
+            sim.rst_low_us = host_now_us - sim.rst_fall_us;
+            sim.rst_pulsed = true;
+        }
+    }
+    sim.level[gpio_num] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+// I2C: a write is the control byte and its payload
+static void i2c_run(const uint8_t *buf, size_t len)
+{
+    CHECK(len >= 2 && (buf[0] == SSD1306_CONTROL_CMD || buf[0] == SSD1306_CONTROL_DATA),
+          "I2C write of %zu bytes with control byte 0x%02X", len, len ? buf[0] : 0);
+    if (len >= 2) {
+        log_transaction(buf[0] == SSD1306_CONTROL_DATA, buf + 1, len - 1);
+    }
+    panel_i2c_write(&sim.panel, buf, len);
+}
+
+static void i2c_run_queued(void)
+{
+    i2c_pending_t p = sim.i2c_queue[0];
+    memmove(&sim.i2c_queue[0], &sim.i2c_queue[1], --sim.i2c_queued * sizeof(sim.i2c_queue[0]));
+    i2c_run(p.buf, p.len);
+    i2c_master_event_data_t evt = { .event = I2C_EVENT_DONE };
+    sim.i2c_done(&sim.i2c_dev, &evt, sim.i2c_done_arg);
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *ret_dev)
+{
+    CHECK(config->device_address == 0x3C, "address 0x%02X", config->device_address);
+    *ret_dev = &sim.i2c_dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev)
+{
+    CHECK(sim.i2c_queued == 0, "device removed with %d writes queued", sim.i2c_queued);
+    sim.i2c_done = NULL;
+    return ESP_OK;
+}
+
+// With callbacks registered a write is queued and runs HW_LAG writes later
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *buf, size_t len, int timeout_ms)
+{
+    if (!sim.i2c_done) {
+        i2c_run(buf, len);
+        return ESP_OK;
+    }
+    if (sim.i2c_queued == QUEUE_MAX) {
+        CHECK(false, "I2C queue overflow");
+        return ESP_ERR_TIMEOUT;
+    }
+    sim.i2c_queue[sim.i2c_queued++] = (i2c_pending_t){ buf, len };
+    if ((uint32_t)sim.i2c_queued > sim.max_in_flight) {
+        sim.max_in_flight = sim.i2c_queued;
+    }
+    while (sim.i2c_queued > HW_LAG) {
+        i2c_run_queued();
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *buf, size_t len, int timeout_ms)
+{
+    buf[0] = sim.panel.display_on ? 0x00 : 0x40;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t dev, const i2c_master_event_callbacks_t *cbs,
+                                              void *arg)
+{
+    sim.i2c_done = cbs->on_trans_done;
+    sim.i2c_done_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms)
+{
+    while (sim.i2c_queued > 0) {
+        i2c_run_queued();
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus)
+{
+    return ESP_OK;
+}
+
+// SPI: D/C is whatever pre_cb drove, and must hold until post_cb
+static void spi_run(spi_transaction_t *t)
+{
+    sim.level[DC_GPIO] = LEVEL_UNSET;
+    sim.pre_calls++;
+    sim.spi_config.pre_cb(t);
+    int dc = sim.level[DC_GPIO];
+    CHECK(dc == 0 || dc == 1, "transaction %u: D/C not driven by pre_cb", sim.transactions);
+    CHECK(t->length % 8 == 0 && t->length > 0, "transaction %u: %zu bits", sim.transactions, t->length);
+    
+    const uint8_t *payload = t->tx_buffer;
+    size_t len = t->length / 8;
+    log_transaction(dc == 1, payload, len);
+    for (size_t i = 0; i < len; i++) {
+        if (dc == 1) {
+            panel_data(&sim.panel, payload[i]);
+        } else {
+            panel_command(&sim.panel, payload[i]);
+        }
+    }
+    CHECK(sim.level[DC_GPIO] == dc, "transaction %u: D/C changed during the transfer", sim.transactions);
+    
+    sim.post_calls++;
+    sim.spi_config.post_cb(t);
+}
+
+static void spi_run_queued(void)
+{
+    spi_transaction_t *t = sim.spi_queue[0];
+    memmove(&sim.spi_queue[0], &sim.spi_queue[1], --sim.spi_queued * sizeof(sim.spi_queue[0]));
+    spi_run(t);
+    sim.spi_done[sim.spi_collectable++] = t;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle)
+{
+    CHECK(host == SPI_HOST, "SPI host %d", host);
+    CHECK(config->mode == 0, "SPI mode %d, the SSD1306 samples on the rising edge", config->mode);
+    CHECK(config->clock_speed_hz > 0 && config->clock_speed_hz <= SSD1306_SPI_CLOCK_HZ, "SPI clock %d Hz",
+          config->clock_speed_hz);
+    CHECK(config->spics_io_num == CS_GPIO, "CS on GPIO %d", config->spics_io_num);
+    CHECK(config->queue_size > 0 && config->queue_size <= QUEUE_MAX, "queue size %d", config->queue_size);
+    CHECK(config->pre_cb && config->post_cb, "transaction callbacks missing");
+    CHECK(!sim.traffic, "device added after traffic");
+    sim.spi_config = *config;
+    sim.spi_added = true;
+    *handle = &sim.spi_dev;
+    return config->pre_cb && config->post_cb ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    CHECK(sim.spi_queued == 0 && sim.spi_collectable == 0, "device removed with %d queued and %d uncollected",
+          sim.spi_queued, sim.spi_collectable);
+    sim.spi_added = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+    CHECK(sim.spi_queued == 0 && sim.spi_collectable == 0, "polling transfer with queued transactions");
+    spi_run(trans);
+    return ESP_OK;
+}
+
+// Queued and uncollected transactions together may not exceed queue_size
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks_to_wait)
+{
+    int in_flight = sim.spi_queued + sim.spi_collectable;
+    if (in_flight >= sim.spi_config.queue_size) {
+        CHECK(false, "SPI queue full: %d queued, %d uncollected", sim.spi_queued, sim.spi_collectable);
+        host_now_ms += ticks_to_wait;
+        return ESP_ERR_TIMEOUT;
+    }
+    sim.spi_queue[sim.spi_queued++] = trans;
+    if ((uint32_t)in_flight + 1 > sim.max_in_flight) {
+        sim.max_in_flight = in_flight + 1;
+    }
+    while (sim.spi_queued > HW_LAG) {
+        spi_run_queued();
+    }
+    return ESP_OK;
+}
+
+// Waiting lets the hardware finish the next transaction
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t ticks_to_wait)
+{
+    if (sim.spi_collectable == 0 && sim.spi_queued > 0 && ticks_to_wait > 0) {
+        spi_run_queued();
+    }
+    if (sim.spi_collectable == 0) {
+        host_now_ms += ticks_to_wait;
+        return ESP_ERR_TIMEOUT;
+    }
+    *trans = sim.spi_done[0];
+    memmove(&sim.spi_done[0], &sim.spi_done[1], --sim.spi_collectable * sizeof(sim.spi_done[0]));
+    return ESP_OK;
+}
+
+// The task is waiting for a transaction to finish: the bus catches up
+static void bus_idle(void)
+{
+    while (sim.i2c_queued > 0) {
+        i2c_run_queued();
+    }
+    while (sim.spi_queued > 0) {
+        spi_run_queued();
+    }
+}
+
+static void on_frame_done(ssd1306_handle_t dev, esp_err_t status, void *ctx)
+{
+    CHECK(status == ESP_OK, "frame done with %s", esp_err_to_name(status));
+    frames_done++;
+}
+
+static ssd1306_handle_t create(bool spi, bool async, tx_log_t *log)
+{
+    memset(&sim, 0, sizeof(sim));
+    for (int i = 0; i < GPIO_COUNT; i++) {
+        sim.level[i] = LEVEL_UNSET;
+    }
+    sim.panel.verbose = host_log_verbose;
+    panel_reset(&sim.panel);
+    sim.log = log;
+    memset(log, 0, sizeof(*log));
+    frames_done = 0;
+    host_isr_yields = 0;
+    host_idle_hook = bus_idle;
+    
+    ssd1306_handle_t dev;
+    if (spi) {
+        ssd1306_spi_config_t config = SSD1306_DEFAULT_SPI_CONFIG(SPI_HOST, CS_GPIO, DC_GPIO);
+        config.rst_gpio = RST_GPIO;
+        config.async = async;
+        dev = ssd1306_create_spi_static(&config, &storage);
+    } else {
+        ssd1306_config_t config = SSD1306_DEFAULT_CONFIG(&sim.i2c_bus, 0x3C);
+        config.async = async;
+        dev = ssd1306_create_static(&config, &storage);
+    }
+    if (dev) {
+        ssd1306_register_frame_done_cb(dev, on_frame_done, NULL);
+    }
+    return dev;
+}
+
+static void refresh(ssd1306_handle_t dev)
+{
+    CHECK(ssd1306_refresh_gram(dev) == ESP_OK, "refresh failed");
+}
+
+// Frames and commands every transport must put on the wire identically
+static void run_script(ssd1306_handle_t dev)
+{
+    ssd1306_clear_screen(dev, 0xA5);
+    refresh(dev);
+    
+    ssd1306_clear_screen(dev, 0x00);
+    for (int i = 0; i < SSD1306_HEIGHT; i++) {
+        ssd1306_draw_pixel(dev, i * 2, i, 1);
+    }
+    ssd1306_fill_rectangle(dev, 100, 3, 120, 20, 1);
+    ssd1306_display_string(dev, 0, 0, (const uint8_t *)"Hue 359", 8, 0);
+    ssd1306_display_string(dev, 30, 29, (const uint8_t *)"7%", 24, 1);
+    refresh(dev);
+    
+    // Drawing straight after an async refresh must not reach the queued frame
+    ssd1306_fill_rectangle(dev, 0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, 1);
+    CHECK(ssd1306_wait_idle(dev, 250) == ESP_OK, "wait_idle failed");
+    
+    CHECK(ssd1306_set_contrast(dev, 0x10) == ESP_OK, "contrast failed");
+    CHECK(ssd1306_set_display_offset(dev, 2) == ESP_OK, "offset failed");
+    CHECK(ssd1306_set_orientation(dev, SSD1306_ORIENTATION_NORMAL) == ESP_OK, "orientation failed");
+    CHECK(ssd1306_set_display_on(dev, false) == ESP_OK, "display off failed");
+    CHECK(ssd1306_set_display_on(dev, true) == ESP_OK, "display on failed");
+    ssd1306_set_position(dev, 3, 0x5A);
+    
+    ssd1306_clear_screen(dev, 0x00);
+    ssd1306_display_string(dev, 48, 8, (const uint8_t *)"AB", 16, 0);
+    refresh(dev);
+    refresh(dev);
+    CHECK(ssd1306_wait_idle(dev, 250) == ESP_OK, "wait_idle failed");
+}
+
+// Absolute checks on the reference log, so a fault shared by every
+// transport is not mistaken for agreement
+static void check_reference(const tx_log_t *log)
+{
+    static const uint8_t contrast[] = { 0x81, 0x10 };
+    bool fill = false, contrast_sent = false;
+    for (uint32_t i = 0; i < log->count; i++) {
+        const uint8_t *p = &log->bytes[log->records[i].offset];
+        uint32_t len = log->records[i].len;
+        if (log->records[i].dc && len == SSD1306_FRAME_BYTES && !fill) {
+            fill = true;
+            for (uint32_t b = 0; b < len; b++) {
+                fill &= p[b] == 0xA5;
+            }
+            CHECK(fill, "first frame is not the 0xA5 fill");
+        }
+        if (!log->records[i].dc && len == sizeof(contrast) && !memcmp(p, contrast, len)) {
+            contrast_sent = true;
+        }
+    }
+    CHECK(fill, "no full-frame GRAM data transaction");
+    CHECK(contrast_sent, "no contrast command 81 10 with D/C low");
+}
+
+static void compare_logs(const char *name, const tx_log_t *log, const tx_log_t *ref)
+{
+    CHECK(log->count == ref->count, "%s: %u transactions, reference %u", name, log->count, ref->count);
+    uint32_t count = log->count < ref->count ? log->count : ref->count;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *a = &log->bytes[log->records[i].offset];
+        const uint8_t *b = &ref->bytes[ref->records[i].offset];
+        if (log->records[i].dc != ref->records[i].dc) {
+            CHECK(false, "%s: transaction %u D/C %s, reference %s", name, i, log->records[i].dc ? "data" : "command",
+                  ref->records[i].dc ? "data" : "command");
+            return;
+        }
+        if (log->records[i].len != ref->records[i].len || memcmp(a, b, log->records[i].len)) {
+            CHECK(false, "%s: transaction %u payload (%u bytes, first %02X) differs from the reference (%u bytes, "
+                  "first %02X)", name, i, log->records[i].len, a[0], ref->records[i].len, b[0]);
+            return;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-v")) {
+        host_log_verbose = 1;
+    } else if (argc > 1) {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+    
+    static const struct {
+        const char *name;
+        bool spi, async;
+    } runs[] = {
+        { "i2c blocking", false, false },
+        { "i2c async", false, true },
+        { "spi blocking", true, false },
+        { "spi async", true, true },
+    };
+    static uint8_t reference_gram[PANEL_PAGES][PANEL_WIDTH];
+    
+    for (int r = 0; r < 4; r++) {
+        printf("%s\n", runs[r].name);
+        ssd1306_handle_t dev = create(runs[r].spi, runs[r].async, &logs[r]);
+        CHECK(dev != NULL, "%s: create failed", runs[r].name);
+        if (!dev) {
+            continue;
+        }
+        run_script(dev);
+        ssd1306_stats_t stats;
+        ssd1306_get_stats(dev, &stats);
+        uint32_t frames = stats.frames;
+        ssd1306_delete(dev);
+        
+        uint32_t data = 0;
+        for (uint32_t i = 0; i < logs[r].count; i++) {
+            data += logs[r].records[i].dc;
+        }
+        printf("  %u transactions (%u GRAM data), %u frames, up to %u in flight\n", logs[r].count, data, frames_done,
+               sim.max_in_flight);
+        CHECK(sim.panel.errors == 0, "%s: %u stream violation(s)", runs[r].name, sim.panel.errors);
+        CHECK(sim.panel.cmd == 0, "%s: command 0x%02X left waiting for arguments", runs[r].name, sim.panel.cmd);
+        CHECK(frames_done == frames, "%s: %u frame done callbacks for %u frames", runs[r].name, frames_done, frames);
+        CHECK(!runs[r].async || sim.max_in_flight > 1, "%s: nothing was ever queued", runs[r].name);
+        
+        if (runs[r].spi) {
+            CHECK(sim.pre_calls == logs[r].count && sim.post_calls == logs[r].count,
+                  "%s: pre_cb %u and post_cb %u times for %u transactions", runs[r].name, sim.pre_calls,
+                  sim.post_calls, logs[r].count);
+            CHECK((sim.outputs >> DC_GPIO & 1) && (sim.outputs >> RST_GPIO & 1), "D/C or RES# not an output");
+            CHECK(sim.rst_pulsed && !sim.traffic_before_reset && sim.rst_low_us >= 3,
+                  "%s: RES# pulse %s, %u us low", runs[r].name, sim.rst_pulsed ? "late" : "missing", sim.rst_low_us);
+            CHECK(!sim.spi_added, "%s: device not removed", runs[r].name);
+        }
+        
+        if (r == 0) {
+            check_reference(&logs[0]);
+            memcpy(reference_gram, sim.panel.gram, sizeof(reference_gram));
+        } else {
+            compare_logs(runs[r].name, &logs[r], &logs[0]);
+            CHECK(!memcmp(sim.panel.gram, reference_gram, sizeof(reference_gram)), "%s: GDDRAM differs from %s",
+                  runs[r].name, runs[0].name);
+        }
+    }
+    
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
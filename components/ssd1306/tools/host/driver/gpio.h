@@ -0,0 +1,18 @@
+// The GPIO calls the SPI transport makes for D/C and RES#; bus_check.c
+// records the levels
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum { GPIO_MODE_DISABLE, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT } gpio_mode_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
@@ -0,0 +1,36 @@
+// The ESP-IDF SPI master API the driver uses. bus_check.c implements it on
+// a simulated panel that runs queued transactions behind the driver, with
+// the pre/post transaction callbacks called as the ISR would.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int spi_host_device_t;
+typedef struct spi_device_t *spi_device_handle_t;
+
+typedef struct {
+    size_t length;              // Bits
+    const void *tx_buffer;
+    void *user;
+} spi_transaction_t;
+
+typedef void (*transaction_cb_t)(spi_transaction_t *trans);
+
+typedef struct {
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle);
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks_to_wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t ticks_to_wait);
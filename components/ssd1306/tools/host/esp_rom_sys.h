@@ -0,0 +1,12 @@
+// Busy-wait delays for host builds: advance the virtual clock
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+extern uint32_t host_now_us;
+
+static inline void esp_rom_delay_us(uint32_t us)
+{
+    host_now_us += us;
+}
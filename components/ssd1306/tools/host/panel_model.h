@@ -0,0 +1,204 @@
+// SSD1306 controller model for host checks of the driver.
+//
+// Decodes the byte stream the way the controller does (tools/ssd1306_emu.py
+// does the same for monitor logs): control bytes, commands and their
+// arguments, horizontal/vertical/page addressing inside the column and page
+// windows, segment remap, COM scan direction, start line and display offset.
+// It is stricter than the silicon and counts what a correct driver never
+// sends: control bytes other than 0x00/0x40, unknown commands, a data write
+// while a command still waits for arguments, and GDDRAM writes before the
+// addressing mode was set.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PANEL_WIDTH     128
+#define PANEL_HEIGHT    64
+#define PANEL_PAGES     (PANEL_HEIGHT / 8)
+
+enum { PANEL_MODE_HORIZONTAL, PANEL_MODE_VERTICAL, PANEL_MODE_PAGE };
+
+typedef struct {
+    uint8_t gram[PANEL_PAGES][PANEL_WIDTH];
+    uint8_t mode;
+    bool mode_set;                  // Addressing mode written since reset
+    uint8_t col_start, col_end, page_start, page_end;
+    uint8_t col, page;
+    bool seg_remap, com_reverse, inverted, all_on, display_on;
+    uint8_t start_line, offset, contrast, mux, charge_pump;
+    uint8_t cmd;                    // Command waiting for arguments, 0 if none
+    uint8_t args[2];
+    uint8_t nargs;
+    uint32_t commands;              // Commands executed
+    uint32_t data_bytes;            // GDDRAM bytes written
+    uint32_t errors;                // Stream violations, described on stderr when verbose
+    bool verbose;
+} panel_t;
+
+static inline void panel_error(panel_t *panel, const char *what, unsigned value)
+{
+    panel->errors++;
+    if (panel->verbose) {
+        fprintf(stderr, "  panel: %s (0x%02X)\n", what, value);
+    }
+}
+
+// Controller state after RES# or power-up
+static inline void panel_reset(panel_t *panel)
+{
+    bool verbose = panel->verbose;
+    memset(panel, 0, sizeof(*panel));
+    panel->verbose = verbose;
+    panel->mode = PANEL_MODE_PAGE;
+    panel->col_end = PANEL_WIDTH - 1;
+    panel->page_end = PANEL_PAGES - 1;
+    panel->contrast = 0x7F;
+    panel->mux = PANEL_HEIGHT - 1;
+}
+
+// Argument bytes a command takes; -1 for a byte that is no command
+static inline int panel_cmd_args(uint8_t cmd)
+{
+    switch (cmd) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+    case 0x21: case 0x22:
+        return 2;
+    default:
+        break;
+    }
+    if (cmd <= 0x1F || (cmd >= 0x40 && cmd <= 0x7F) || (cmd >= 0xA0 && cmd <= 0xA7) ||
+        cmd == 0xAE || cmd == 0xAF || (cmd >= 0xB0 && cmd <= 0xB7) || cmd == 0xC0 || cmd == 0xC8 ||
+        cmd == 0xE3) {
+        return 0;
+    }
+    return -1;
+}
+
+static inline void panel_execute(panel_t *panel, uint8_t cmd, const uint8_t *args)
+{
+    panel->commands++;
+    if (cmd == 0x20) {
+        panel->mode = args[0] & 0x03;
+        panel->mode_set = true;
+    } else if (cmd == 0x21) {
+        panel->col_start = panel->col = args[0] & 0x7F;
+        panel->col_end = args[1] & 0x7F;
+    } else if (cmd == 0x22) {
+        panel->page_start = panel->page = args[0] & 0x07;
+        panel->page_end = args[1] & 0x07;
+    } else if (cmd == 0x81) {
+        panel->contrast = args[0];
+    } else if (cmd == 0x8D) {
+        panel->charge_pump = args[0];
+    } else if (cmd == 0xA8) {
+        panel->mux = args[0] & 0x3F;
+    } else if (cmd == 0xD3) {
+        panel->offset = args[0] & 0x3F;
+    } else if (cmd <= 0x0F) {
+        panel->col = (panel->col & 0xF0) | cmd;
+    } else if (cmd <= 0x1F) {
+        panel->col = (panel->col & 0x0F) | ((cmd & 0x07) << 4);
+    } else if (cmd >= 0x40 && cmd <= 0x7F) {
+        panel->start_line = cmd & 0x3F;
+    } else if (cmd == 0xA0 || cmd == 0xA1) {
+        panel->seg_remap = cmd == 0xA1;
+    } else if (cmd == 0xA4 || cmd == 0xA5) {
+        panel->all_on = cmd == 0xA5;
+    } else if (cmd == 0xA6 || cmd == 0xA7) {
+        panel->inverted = cmd == 0xA7;
+    } else if (cmd == 0xAE || cmd == 0xAF) {
+        panel->display_on = cmd == 0xAF;
+    } else if (cmd >= 0xB0 && cmd <= 0xB7) {
+        panel->page = cmd & 0x07;
+    } else if (cmd == 0xC0 || cmd == 0xC8) {
+        panel->com_reverse = cmd == 0xC8;
+    }
+    // Timing, pre-charge, COM pins and VCOMH do not change the image
+}
+
+// One byte with D/C low
+static inline void panel_command(panel_t *panel, uint8_t byte)
+{
+    if (panel->cmd) {
+        panel->args[panel->nargs++] = byte;
+        if (panel->nargs == panel_cmd_args(panel->cmd)) {
+            panel_execute(panel, panel->cmd, panel->args);
+            panel->cmd = 0;
+        }
+        return;
+    }
+    int nargs = panel_cmd_args(byte);
+    if (nargs < 0) {
+        panel_error(panel, "unknown command", byte);
+    } else if (nargs == 0) {
+        panel_execute(panel, byte, NULL);
+    } else {
+        panel->cmd = byte;
+        panel->nargs = 0;
+    }
+}
+
+// One byte with D/C high
+static inline void panel_data(panel_t *panel, uint8_t byte)
+{
+    if (panel->cmd) {
+        panel_error(panel, "data while a command waits for arguments", panel->cmd);
+        panel->cmd = 0;
+    }
+    if (!panel->mode_set) {
+        panel_error(panel, "data before the addressing mode was set", byte);
+    }
+    panel->gram[panel->page][panel->col] = byte;
+    panel->data_bytes++;
+    if (panel->mode == PANEL_MODE_HORIZONTAL) {
+        if (++panel->col > panel->col_end) {
+            panel->col = panel->col_start;
+            panel->page = panel->page < panel->page_end ? panel->page + 1 : panel->page_start;
+        }
+    } else if (panel->mode == PANEL_MODE_VERTICAL) {
+        if (++panel->page > panel->page_end) {
+            panel->page = panel->page_start;
+            panel->col = panel->col < panel->col_end ? panel->col + 1 : panel->col_start;
+        }
+    } else {
+        panel->col = (panel->col + 1) % PANEL_WIDTH; // Page mode wraps within the page
+    }
+}
+
+// One I2C write after the address byte: a control byte and its payload
+static inline void panel_i2c_write(panel_t *panel, const uint8_t *buf, size_t len)
+{
+    if (len < 2) {
+        panel_error(panel, "transaction without payload", len);
+        return;
+    }
+    if (buf[0] != 0x00 && buf[0] != 0x40) {
+        panel_error(panel, "control byte", buf[0]);
+        return;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (buf[0] == 0x40) {
+            panel_data(panel, buf[i]);
+        } else {
+            panel_command(panel, buf[i]);
+        }
+    }
+}
+
+// Pixel as seen on the glass, (0, 0) top left
+static inline int panel_pixel(const panel_t *panel, int x, int y)
+{
+    if (!panel->display_on) {
+        return 0;
+    }
+    int com = panel->com_reverse ? PANEL_HEIGHT - 1 - y : y;
+    int row = (com + panel->start_line + panel->offset) % PANEL_HEIGHT;
+    int seg = panel->seg_remap ? PANEL_WIDTH - 1 - x : x;
+    int on = panel->all_on || ((panel->gram[row / 8][seg] >> (row % 8)) & 1);
+    return on ^ panel->inverted;
+}
@@ -0,0 +1,411 @@
+// Inject I2C faults into the SSD1306 driver on the host.
+//
+// Builds the driver and its I2C transport against a simulated bus (the
+// ESP-IDF I2C master API, implemented below) and a virtual clock, then runs
+// each fault in blocking and async mode: a panel that does not answer
+// (NACK), SDA held low until the bus is cleared (stuck), SDA shorted so
+// clearing does not help (held), a single failed transaction (glitch) and
+// SDA going low while the panel sleeps, so the wake commands are the first
+// to hit it (wake). Every driver call is timed on the virtual clock, so the tool checks that
+// a failing bus costs each call a bounded wait, and that ssd1306_recover
+// clears the bus, runs the init sequence again and brings frames back.
+//
+//     python3 ../fontgen/gen_fonts.py --output ssd1306_fonts.c
+//     cc -O2 -Ihost -I../../../tools/host -I.. -I../include -o i2c_fault_sim i2c_fault_sim.c ../ssd1306.c ../ssd1306_bus_i2c.c ssd1306_fonts.c
+//     ./i2c_fault_sim         summary per scenario
+//     ./i2c_fault_sim -v      with the driver's error and warning logs
+//
+// Exits 1 if a call waits longer than its bound or the panel does not come
+// back after recovery.
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "ssd1306.h"
+#include "ssd1306_bus.h"
+
+#define POWER_ON_DELAY_MS   100
+#define I2C_TIMEOUT_MS      100     // SSD1306_I2C_TIMEOUT_MS in ssd1306_bus_i2c.c
+#define FRAMES              20
+
+// Longest a call may wait: a frame is a window command and the data, a
+// command call one transaction, create and recover the power-on delay and
+// one timeout (the init sequence stops at its first failure)
+#define FRAME_BOUND_MS      (2 * I2C_TIMEOUT_MS)
+#define COMMAND_BOUND_MS    I2C_TIMEOUT_MS
+#define RECOVER_BOUND_MS    (POWER_ON_DELAY_MS + I2C_TIMEOUT_MS)
+#define HEALTH_FAIL_LIMIT   3       // DISPLAY_HEALTH_FAIL_LIMIT in main/display_health.h
+
+typedef enum {
+    FAULT_NONE,
+    FAULT_NACK,     // No panel answers its address
+    FAULT_STUCK,    // SDA held low; a bus clear frees it
+    FAULT_HELD,     // SDA shorted low; a bus clear does not help
+} fault_t;
+
+uint32_t host_now_ms = 0;
+void (*host_idle_hook)(void) = NULL;
+int host_log_verbose = 0;
+
+struct i2c_master_bus_t {
+    int unused;
+};
+
+struct i2c_master_dev_t {
+    int unused;
+};
+
+// The simulated bus and panel
+static struct {
+    struct i2c_master_bus_t bus;
+    struct i2c_master_dev_t dev;
+    fault_t fault;
+    int glitches;                   // Transactions left to fail
+    bool display_on;                // Panel got DISPLAY_ON since its controller reset
+    uint32_t transactions;
+    uint32_t bus_resets;
+    i2c_master_callback_t done;     // Async mode: completion callback
+    void *done_arg;
+} sim;
+
+static ssd1306_static_t storage;
+static int failures = 0;
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+// One transaction on the wire
+static esp_err_t sim_transfer(const uint8_t *buf, size_t len, int timeout_ms)
+{
+    sim.transactions++;
+    switch (sim.fault) {
+    case FAULT_STUCK:
+    case FAULT_HELD:
+        host_now_ms += timeout_ms;
+        return ESP_ERR_TIMEOUT;
+    case FAULT_NACK:
+        return ESP_FAIL;
+    case FAULT_NONE:
+        break;
+    }
+    if (sim.glitches > 0) {
+        sim.glitches--;
+        return ESP_FAIL;
+    }
+    
+    // The init sequence and ssd1306_set_display_on send single commands
+    if (buf && len == 2 && buf[0] == SSD1306_CONTROL_CMD) {
+        if (buf[1] == SSD1306_CMD_DISPLAY_ON) {
+            sim.display_on = true;
+        } else if (buf[1] == SSD1306_CMD_DISPLAY_OFF) {
+            sim.display_on = false;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *ret_dev)
+{
+    *ret_dev = &sim.dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev)
+{
+    sim.done = NULL;
+    return ESP_OK;
+}
+
+// Async transfers complete at once, reporting to the callback as the ISR would
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *buf, size_t len, int timeout_ms)
+{
+    esp_err_t ret = sim_transfer(buf, len, timeout_ms);
+    if (!sim.done) {
+        return ret;
+    }
+    i2c_master_event_data_t evt = {
+        .event = ret == ESP_OK ? I2C_EVENT_DONE : ret == ESP_ERR_TIMEOUT ? I2C_EVENT_TIMEOUT : I2C_EVENT_NACK,
+    };
+    sim.done(dev, &evt, sim.done_arg);
+    return ESP_OK;
+}
+
+// Status byte: D6 set while the display is off
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *buf, size_t len, int timeout_ms)
+{
+    esp_err_t ret = sim_transfer(NULL, 0, timeout_ms);
+    if (ret == ESP_OK) {
+        buf[0] = sim.display_on ? 0x00 : 0x40;
+    }
+    return ret;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t dev, const i2c_master_event_callbacks_t *cbs,
+                                              void *arg)
+{
+    sim.done = cbs->on_trans_done;
+    sim.done_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms)
+{
+    return ESP_OK;
+}
+
+// Nine SCL pulses and a STOP: the panel lets go of SDA unless it is shorted
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus)
+{
+    sim.bus_resets++;
+    if (sim.fault == FAULT_STUCK) {
+        sim.fault = FAULT_NONE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ssd1306_bus_init_spi(ssd1306_bus_storage_t *storage, const ssd1306_spi_config_t *config,
+                               ssd1306_bus_t **ret_bus)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static void sim_reset(fault_t fault)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.fault = fault;
+}
+
+static ssd1306_handle_t create(bool async, uint32_t *ms)
+{
+    ssd1306_config_t config = SSD1306_DEFAULT_CONFIG(&sim.bus, 0x3C);
+    config.async = async;
+    config.power_on_delay_ms = POWER_ON_DELAY_MS;
+    uint32_t start = host_now_ms;
+    ssd1306_handle_t dev = ssd1306_create_static(&config, &storage);
+    *ms = host_now_ms - start;
+    return dev;
+}
+
+// Send frames, returning how many went through and the longest call
+static int send_frames(ssd1306_handle_t dev, int count, uint32_t *worst_ms)
+{
+    int sent = 0;
+    *worst_ms = 0;
+    for (int i = 0; i < count; i++) {
+        ssd1306_draw_pixel(dev, i, i, 1);
+        uint32_t start = host_now_ms;
+        ssd1306_stats_t before, after;
+        ssd1306_get_stats(dev, &before);
+        esp_err_t ret = ssd1306_refresh_gram(dev);
+        if (ret == ESP_OK) {
+            ret = ssd1306_wait_idle(dev, 250);
+        }
+        ssd1306_get_stats(dev, &after);
+        if (ret == ESP_OK && after.errors == before.errors) {
+            sent++;
+        }
+        if (host_now_ms - start > *worst_ms) {
+            *worst_ms = host_now_ms - start;
+        }
+    }
+    return sent;
+}
+
+static uint32_t timed_recover(ssd1306_handle_t dev, esp_err_t *ret)
+{
+    uint32_t start = host_now_ms;
+    *ret = ssd1306_recover(dev);
+    return host_now_ms - start;
+}
+
+// A panel that never answers: create gives up after the first command
+static void scenario_absent(bool async)
+{
+    sim_reset(FAULT_NACK);
+    uint32_t ms;
+    ssd1306_handle_t dev = create(async, &ms);
+    printf("  absent:  create %s after %u ms, %u transactions\n", dev ? "succeeded" : "failed", ms,
+           sim.transactions);
+    CHECK(dev == NULL, "create succeeded without a panel");
+    CHECK(ms <= RECOVER_BOUND_MS, "create took %u ms (bound %d)", ms, RECOVER_BOUND_MS);
+}
+
+// SDA stuck low mid-run, as after a glitch or a panel brown-out mid-byte
+static void scenario_stuck(bool async)
+{
+    sim_reset(FAULT_NONE);
+    uint32_t ms, worst;
+    ssd1306_handle_t dev = create(async, &ms);
+    CHECK(dev != NULL, "create failed on a healthy bus");
+    if (!dev) {
+        return;
+    }
+    CHECK(send_frames(dev, FRAMES, &worst) == FRAMES, "frames failed on a healthy bus");
+    
+    sim.fault = FAULT_STUCK;
+    sim.display_on = false;
+    int sent = send_frames(dev, FRAMES, &worst);
+    uint32_t start = host_now_ms;
+    esp_err_t cmd = ssd1306_set_contrast(dev, 0x10);
+    uint32_t cmd_ms = host_now_ms - start;
+    printf("  stuck:   %d of %d frames, worst frame %u ms, command %u ms (%s)\n", sent, FRAMES, worst, cmd_ms,
+           esp_err_to_name(cmd));
+    CHECK(sent == 0, "frames reported sent on a stuck bus");
+    CHECK(worst <= FRAME_BOUND_MS, "a frame took %u ms (bound %d)", worst, FRAME_BOUND_MS);
+    CHECK(cmd_ms <= COMMAND_BOUND_MS, "command took %u ms (bound %d)", cmd_ms, COMMAND_BOUND_MS);
+    CHECK(async || cmd != ESP_OK, "command reported sent on a stuck bus"); // Async only counts the error
+    
+    esp_err_t ret;
+    ms = timed_recover(dev, &ret);
+    sent = send_frames(dev, FRAMES, &worst);
+    printf("  stuck:   recover %s in %u ms, %u bus clear(s), panel %s, %d of %d frames after\n",
+           esp_err_to_name(ret), ms, sim.bus_resets, sim.display_on ? "on" : "off", sent, FRAMES);
+    CHECK(ret == ESP_OK, "recover failed: %s", esp_err_to_name(ret));
+    CHECK(sim.bus_resets == 1, "bus cleared %u times", sim.bus_resets);
+    CHECK(sim.display_on, "panel not re-initialized");
+    CHECK(ms <= RECOVER_BOUND_MS, "recover took %u ms (bound %d)", ms, RECOVER_BOUND_MS);
+    CHECK(sent == FRAMES, "only %d of %d frames after recovery", sent, FRAMES);
+    ssd1306_delete(dev);
+}
+
+// SDA shorted: recovery fails fast every time, then works once the short is gone
+static void scenario_held(bool async)
+{
+    sim_reset(FAULT_NONE);
+    uint32_t ms, worst;
+    ssd1306_handle_t dev = create(async, &ms);
+    if (!dev) {
+        CHECK(false, "create failed on a healthy bus");
+        return;
+    }
+    
+    sim.fault = FAULT_HELD;
+    uint32_t transactions = sim.transactions;
+    uint32_t slowest = 0;
+    esp_err_t ret = ESP_OK;
+    for (int attempt = 0; attempt < 5; attempt++) {
+        ms = timed_recover(dev, &ret);
+        CHECK(ret != ESP_OK, "recover succeeded on a shorted bus");
+        slowest = ms > slowest ? ms : slowest;
+    }
+    printf("  held:    5 recoveries failed (%s), slowest %u ms, %u transactions\n", esp_err_to_name(ret), slowest,
+           sim.transactions - transactions);
+    CHECK(slowest <= RECOVER_BOUND_MS, "recover took %u ms (bound %d)", slowest, RECOVER_BOUND_MS);
+    
+    sim.fault = FAULT_NONE;
+    ms = timed_recover(dev, &ret);
+    int sent = send_frames(dev, FRAMES, &worst);
+    printf("  held:    short removed, recover %s, %d of %d frames after\n", esp_err_to_name(ret), sent, FRAMES);
+    CHECK(ret == ESP_OK && sent == FRAMES, "display did not come back");
+    ssd1306_delete(dev);
+}
+
+// One failed transaction: that frame is lost, the next goes through
+static void scenario_glitch(bool async)
+{
+    sim_reset(FAULT_NONE);
+    uint32_t ms, worst;
+    ssd1306_handle_t dev = create(async, &ms);
+    if (!dev) {
+        CHECK(false, "create failed on a healthy bus");
+        return;
+    }
+    
+    sim.glitches = 1;
+    int sent = send_frames(dev, FRAMES, &worst);
+    printf("  glitch:  %d of %d frames, worst frame %u ms\n", sent, FRAMES, worst);
+    CHECK(sent == FRAMES - 1, "%d of %d frames after a single glitch", sent, FRAMES);
+    ssd1306_delete(dev);
+}
+
+static esp_err_t set_display_on(ssd1306_handle_t dev, uint8_t on)
+{
+    return ssd1306_set_display_on(dev, on);
+}
+
+// A panel command as display power sends it: failed if the call or, for a
+// queued command, the error count says so. Returns how long it took.
+static uint32_t send_command(ssd1306_handle_t dev, esp_err_t (*command)(ssd1306_handle_t, uint8_t), uint8_t arg,
+                             bool *failed)
+{
+    ssd1306_stats_t before, after;
+    ssd1306_get_stats(dev, &before);
+    uint32_t start = host_now_ms;
+    esp_err_t ret = command(dev, arg);
+    if (ret == ESP_OK) {
+        ret = ssd1306_wait_idle(dev, 250);
+    }
+    ssd1306_get_stats(dev, &after);
+    *failed = ret != ESP_OK || after.errors != before.errors;
+    return host_now_ms - start;
+}
+
+// SDA stuck while the panel sleeps: the wake commands fail within their
+// bound and count toward display health like frames, so the display goes
+// offline and recovery brings the panel back on
+static void scenario_wake(bool async)
+{
+    sim_reset(FAULT_NONE);
+    uint32_t ms, worst;
+    ssd1306_handle_t dev = create(async, &ms);
+    if (!dev) {
+        CHECK(false, "create failed on a healthy bus");
+        return;
+    }
+    bool failed;
+    send_command(dev, set_display_on, false, &failed);
+    CHECK(!failed && !sim.display_on, "display off failed on a healthy bus");
+    
+    sim.fault = FAULT_STUCK;
+    int streak = 0;
+    ms = send_command(dev, set_display_on, true, &failed);
+    streak += failed;
+    uint32_t slowest = send_command(dev, ssd1306_set_contrast, 0xCF, &failed);
+    streak += failed;
+    slowest = ms > slowest ? ms : slowest;
+    
+    // The governor resumes after the wake; its first frame completes the streak
+    streak += send_frames(dev, 1, &worst) == 0;
+    printf("  wake:    %d failed transfers, slowest command %u ms, panel %s\n", streak, slowest,
+           sim.display_on ? "on" : "off");
+    CHECK(slowest <= COMMAND_BOUND_MS, "wake command took %u ms (bound %d)", slowest, COMMAND_BOUND_MS);
+    CHECK(worst <= FRAME_BOUND_MS, "a frame took %u ms (bound %d)", worst, FRAME_BOUND_MS);
+    CHECK(streak >= HEALTH_FAIL_LIMIT, "only %d failures reported, display stays online", streak);
+    
+    esp_err_t ret;
+    ms = timed_recover(dev, &ret);
+    int sent = send_frames(dev, FRAMES, &worst);
+    printf("  wake:    recover %s in %u ms, panel %s, %d of %d frames after\n", esp_err_to_name(ret), ms,
+           sim.display_on ? "on" : "off", sent, FRAMES);
+    CHECK(ret == ESP_OK && sim.display_on, "panel did not come back on");
+    CHECK(sent == FRAMES, "only %d of %d frames after recovery", sent, FRAMES);
+    ssd1306_delete(dev);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-v")) {
+        host_log_verbose = 1;
+    } else if (argc > 1) {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+    
+    for (int async = 0; async <= 1; async++) {
+        printf("%s transfers\n", async ? "async" : "blocking");
+        scenario_absent(async);
+        scenario_stuck(async);
+        scenario_held(async);
+        scenario_glitch(async);
+        scenario_wake(async);
+    }
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,336 @@
+// Check the SSD1306 driver's I2C traffic against a model of the controller.
+//
+// Builds the driver and its I2C transport against a host I2C master that
+// hands every write to the controller model in host/panel_model.h. The model
+// checks the command/data stream (control bytes, command arguments, data
+// only once addressing is set up) and keeps the GDDRAM, so each frame is
+// compared byte for byte with a reference drawn here pixel by pixel, and
+// the image on the glass with the orientation, offset and power commands
+// applied. Runs with blocking and async transfers.
+//
+//     python3 ../fontgen/gen_fonts.py --output ssd1306_fonts.c
+//     cc -O2 -Ihost -I../../../tools/host -I.. -I../include -o panel_check panel_check.c ../ssd1306.c ../ssd1306_bus_i2c.c ssd1306_fonts.c
+//     ./panel_check           summary per scene
+//     ./panel_check -v        with stream violations and driver logs
+//
+// run_host_checks.sh builds and runs it with the other host checks. Exits 1
+// on a stream violation or a frame that differs from the reference.
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "ssd1306.h"
+#include "ssd1306_bus.h"
+#include "ssd1306_fonts.h"
+#include "panel_model.h"
+
+#define FRAME_TX_BYTES      (1 + SSD1306_FRAME_BYTES)
+
+uint32_t host_now_ms = 0;
+void (*host_idle_hook)(void) = NULL;
+int host_log_verbose = 0;
+
+struct i2c_master_bus_t {
+    int unused;
+};
+
+struct i2c_master_dev_t {
+    int unused;
+};
+
+static struct {
+    struct i2c_master_bus_t bus;
+    struct i2c_master_dev_t dev;
+    panel_t panel;
+    uint16_t addr;
+    uint32_t scl_speed_hz;
+    uint32_t writes;
+    uint32_t last_len;              // Length of the last write
+    i2c_master_callback_t done;
+    void *done_arg;
+} sim;
+
+static ssd1306_static_t storage;
+static uint8_t expect[SSD1306_HEIGHT / 8][SSD1306_WIDTH];   // What GDDRAM should hold after a refresh
+static int failures = 0;
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *ret_dev)
+{
+    CHECK(config->dev_addr_length == I2C_ADDR_BIT_LEN_7, "10-bit address");
+    sim.addr = config->device_address;
+    sim.scl_speed_hz = config->scl_speed_hz;
+    *ret_dev = &sim.dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev)
+{
+    sim.done = NULL;
+    return ESP_OK;
+}
+
+// Async writes complete at once, reporting to the callback as the ISR would
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *buf, size_t len, int timeout_ms)
+{
+    sim.writes++;
+    sim.last_len = len;
+    panel_i2c_write(&sim.panel, buf, len);
+    if (sim.done) {
+        i2c_master_event_data_t evt = { .event = I2C_EVENT_DONE };
+        sim.done(dev, &evt, sim.done_arg);
+    }
+    return ESP_OK;
+}
+
+// Status byte: D6 set while the display is off
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *buf, size_t len, int timeout_ms)
+{
+    buf[0] = sim.panel.display_on ? 0x00 : 0x40;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t dev, const i2c_master_event_callbacks_t *cbs,
+                                              void *arg)
+{
+    sim.done = cbs->on_trans_done;
+    sim.done_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus)
+{
+    return ESP_OK;
+}
+
+esp_err_t ssd1306_bus_init_spi(ssd1306_bus_storage_t *storage, const ssd1306_spi_config_t *config,
+                               ssd1306_bus_t **ret_bus)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// Reference drawing, one pixel at a time and independent of the driver's
+// page arithmetic
+static void expect_pixel(int x, int y, int on)
+{
+    if (x < 0 || x >= SSD1306_WIDTH || y < 0 || y >= SSD1306_HEIGHT) {
+        return;
+    }
+    if (on) {
+        expect[y / 8][x] |= 1 << (y % 8);
+    } else {
+        expect[y / 8][x] &= ~(1 << (y % 8));
+    }
+}
+
+static void expect_string(int x, int y, const char *str, uint8_t font_size, uint8_t mode)
+{
+    const ssd1306_font_t *font = ssd1306_get_font(font_size);
+    for (; *str; str++, x += font->width) {
+        const uint8_t *glyph = ssd1306_font_glyph(font, (uint8_t)*str);
+        for (int gx = 0; gx < font->width; gx++) {
+            for (int gy = 0; gy < font->height; gy++) {
+                int bit = (glyph[(gy / 8) * font->width + gx] >> (gy % 8)) & 1;
+                expect_pixel(x + gx, y + gy, bit ^ (mode ? 1 : 0));
+            }
+        }
+    }
+}
+
+// Send a frame and compare what reached GDDRAM with the reference
+static void check_frame(ssd1306_handle_t dev, const char *scene)
+{
+    uint32_t writes = sim.writes;
+    uint32_t data_bytes = sim.panel.data_bytes;
+    esp_err_t ret = ssd1306_refresh_gram(dev);
+    if (ret == ESP_OK) {
+        ret = ssd1306_wait_idle(dev, 250);
+    }
+    CHECK(ret == ESP_OK, "%s: refresh %s", scene, esp_err_to_name(ret));
+    CHECK(sim.writes - writes == 2, "%s: %u writes for a frame", scene, sim.writes - writes);
+    CHECK(sim.last_len == FRAME_TX_BYTES, "%s: frame write of %u bytes", scene, sim.last_len);
+    CHECK(sim.panel.data_bytes - data_bytes == SSD1306_FRAME_BYTES, "%s: %u GDDRAM bytes", scene,
+          sim.panel.data_bytes - data_bytes);
+    CHECK(sim.panel.col == 0 && sim.panel.page == 0, "%s: frame left the pointer at page %u column %u", scene,
+          sim.panel.page, sim.panel.col);
+    
+    int wrong = 0;
+    for (int page = 0; page < SSD1306_HEIGHT / 8; page++) {
+        for (int col = 0; col < SSD1306_WIDTH; col++) {
+            if (sim.panel.gram[page][col] != expect[page][col]) {
+                if (wrong++ == 0) {
+                    printf("  page %d column %d: 0x%02X, expected 0x%02X\n", page, col, sim.panel.gram[page][col],
+                           expect[page][col]);
+                }
+            }
+        }
+    }
+    CHECK(wrong == 0, "%s: %d GDDRAM bytes differ", scene, wrong);
+}
+
+static void check_stream(const char *scene)
+{
+    CHECK(sim.panel.errors == 0, "%s: %u stream violation(s)", scene, sim.panel.errors);
+    CHECK(sim.panel.cmd == 0, "%s: command 0x%02X left waiting for arguments", scene, sim.panel.cmd);
+}
+
+static ssd1306_handle_t create(bool async, uint32_t scl_speed_hz)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.panel.verbose = host_log_verbose;
+    panel_reset(&sim.panel);
+    
+    ssd1306_config_t config = SSD1306_DEFAULT_CONFIG(&sim.bus, 0x3C);
+    config.async = async;
+    config.scl_speed_hz = scl_speed_hz;
+    return ssd1306_create_static(&config, &storage);
+}
+
+// The init sequence leaves the controller in the state the driver draws for
+static void scene_init(ssd1306_handle_t dev)
+{
+    const panel_t *p = &sim.panel;
+    printf("  init:    %u commands in %u writes, panel %s, contrast 0x%02X\n", p->commands, sim.writes,
+           p->display_on ? "on" : "off", p->contrast);
+    check_stream("init");
+    CHECK(sim.addr == 0x3C, "address 0x%02X", sim.addr);
+    CHECK(p->display_on, "panel left off");
+    CHECK(p->mode_set && p->mode == PANEL_MODE_HORIZONTAL, "addressing mode %u", p->mode);
+    CHECK(p->contrast == SSD1306_DEFAULT_CONTRAST, "contrast 0x%02X", p->contrast);
+    CHECK(p->mux == SSD1306_HEIGHT - 1, "multiplex ratio %u", p->mux);
+    CHECK(p->charge_pump == 0x14, "charge pump 0x%02X", p->charge_pump);
+    CHECK(p->seg_remap && p->com_reverse, "not mounted for 180 degrees");
+    CHECK(p->offset == 0 && p->start_line == 0 && !p->inverted && !p->all_on, "picture shifted or inverted");
+}
+
+// Fills, pixels, rectangles and text at aligned and unaligned rows
+static void scene_draw(ssd1306_handle_t dev)
+{
+    CHECK(ssd1306_clear_screen(dev, 0xA5) == ESP_OK, "clear failed");
+    memset(expect, 0xA5, sizeof(expect));
+    check_frame(dev, "fill");
+    
+    CHECK(ssd1306_clear_screen(dev, 0x00) == ESP_OK, "clear failed");
+    memset(expect, 0, sizeof(expect));
+    check_frame(dev, "clear");
+    
+    for (int i = 0; i < SSD1306_HEIGHT; i++) {
+        ssd1306_draw_pixel(dev, i * 2, i, 1);
+        expect_pixel(i * 2, i, 1);
+    }
+    ssd1306_draw_pixel(dev, SSD1306_WIDTH, 0, 1);     // Out of bounds: ignored
+    ssd1306_fill_rectangle(dev, 100, 3, 120, 20, 1);
+    ssd1306_fill_rectangle(dev, 104, 7, 110, 12, 0);
+    for (int x = 100; x <= 120; x++) {
+        for (int y = 3; y <= 20; y++) {
+            expect_pixel(x, y, !(x >= 104 && x <= 110 && y >= 7 && y <= 12));
+        }
+    }
+    check_frame(dev, "shapes");
+    
+    // Every size at a page-aligned and an unaligned row, one of them inverted;
+    // the last string runs off the right edge and is clipped
+    static const struct {
+        uint8_t x, y, size, mode;
+        const char *text;
+    } strings[] = {
+        { 0, 0, 8, 0, "Hue 359" },
+        { 0, 11, 8, 1, "gM/~" },
+        { 48, 8, 16, 0, "AB" },
+        { 0, 27, 16, 1, "s0" },
+        { 30, 29, 24, 0, "7%" },
+        { 80, 32, 32, 0, "8F" },
+    };
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        ssd1306_display_string(dev, strings[i].x, strings[i].y, (const uint8_t *)strings[i].text, strings[i].size,
+                               strings[i].mode);
+        expect_string(strings[i].x, strings[i].y, strings[i].text, strings[i].size, strings[i].mode);
+    }
+    check_frame(dev, "text");
+    check_stream("draw");
+    printf("  draw:    4 frames match the reference, %u GDDRAM bytes\n", sim.panel.data_bytes);
+}
+
+// Panel commands change what the glass shows without a new frame
+static void scene_commands(ssd1306_handle_t dev)
+{
+    const panel_t *p = &sim.panel;
+    uint32_t data_bytes = p->data_bytes;
+    
+    // Mounted upside down: GDDRAM (0, 0) is the bottom right pixel of the glass
+    ssd1306_clear_screen(dev, 0x00);
+    ssd1306_draw_pixel(dev, 0, 0, 1);
+    ssd1306_refresh_gram(dev);
+    CHECK(panel_pixel(p, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1) && !panel_pixel(p, 0, 0),
+          "180 degree mount not applied");
+    
+    CHECK(ssd1306_set_orientation(dev, SSD1306_ORIENTATION_NORMAL) == ESP_OK, "orientation failed");
+    CHECK(!p->seg_remap && !p->com_reverse && panel_pixel(p, 0, 0), "normal orientation not applied");
+    
+    CHECK(ssd1306_set_display_offset(dev, 70) == ESP_OK, "offset failed");
+    CHECK(p->offset == 6 && panel_pixel(p, 0, SSD1306_HEIGHT - 6), "offset %u, expected 6", p->offset);
+    ssd1306_set_display_offset(dev, 0);
+    
+    CHECK(ssd1306_set_contrast(dev, 0x10) == ESP_OK && p->contrast == 0x10, "contrast 0x%02X", p->contrast);
+    CHECK(ssd1306_set_display_on(dev, false) == ESP_OK && !p->display_on && !panel_pixel(p, 0, 0),
+          "panel still on");
+    CHECK(ssd1306_set_display_on(dev, true) == ESP_OK && p->display_on, "panel still off");
+    
+    ssd1306_set_position(dev, 3, 0x5A);
+    CHECK(p->page == 3 && p->col == 0x5A, "position page %u column %u", p->page, p->col);
+    
+    CHECK(ssd1306_set_orientation(dev, SSD1306_ORIENTATION_180_DEGREES) == ESP_OK, "orientation failed");
+    check_stream("commands");
+    printf("  control: orientation, offset, contrast, power and position, %u GDDRAM bytes\n",
+           p->data_bytes - data_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-v")) {
+        host_log_verbose = 1;
+    } else if (argc > 1) {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+    
+    for (int async = 0; async <= 1; async++) {
+        printf("%s transfers\n", async ? "async" : "blocking");
+        ssd1306_handle_t dev = create(async, SSD1306_I2C_SPEED_FAST);
+        CHECK(dev != NULL, "create failed");
+        if (!dev) {
+            continue;
+        }
+        scene_init(dev);
+        scene_draw(dev);
+        scene_commands(dev);
+        ssd1306_delete(dev);
+    }
+    
+    // Fast-mode Plus is kept once the status read confirms the panel is on
+    printf("fast-mode plus\n");
+    ssd1306_handle_t dev = create(false, SSD1306_I2C_SPEED_FAST_PLUS);
+    CHECK(dev != NULL && sim.scl_speed_hz == SSD1306_I2C_SPEED_FAST_PLUS, "fell back to %u Hz", sim.scl_speed_hz);
+    if (dev) {
+        check_stream("fast-mode plus");
+        printf("  init:    %u Hz kept after the status read\n", sim.scl_speed_hz);
+        ssd1306_delete(dev);
+    }
+    
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
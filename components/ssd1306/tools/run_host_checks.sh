@@ -0,0 +1,35 @@
+#!/bin/sh
+# Build the SSD1306 host checks against the driver sources and run them.
+#
+#     tools/run_host_checks.sh          build in a temporary directory
+#     tools/run_host_checks.sh -v       pass -v to every check
+#     CC=clang tools/run_host_checks.sh
+#
+# Exits non-zero if a build or a check fails.
+set -e
+
+tools=$(cd "$(dirname "$0")" && pwd)
+component=$(dirname "$tools")
+shims=$(cd "$component/../../tools/host" && pwd)
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+cc=${CC:-cc}
+cflags="-O2 -Wall -I$tools/host -I$shims -I$component -I$component/include"
+
+python3 "$component/fontgen/gen_fonts.py" --output "$out/ssd1306_fonts.c" \
+    --check "$component/fontgen/golden_glyphs.txt"
+
+$cc $cflags -o "$out/panel_check" "$tools/panel_check.c" "$component/ssd1306.c" \
+    "$component/ssd1306_bus_i2c.c" "$out/ssd1306_fonts.c"
+$cc $cflags -o "$out/i2c_fault_sim" "$tools/i2c_fault_sim.c" "$component/ssd1306.c" \
+    "$component/ssd1306_bus_i2c.c" "$out/ssd1306_fonts.c"
+$cc $cflags -o "$out/bus_check" "$tools/bus_check.c" "$component/ssd1306.c" \
+    "$component/ssd1306_bus_i2c.c" "$component/ssd1306_bus_spi.c" "$out/ssd1306_fonts.c"
+
+status=0
+for check in panel_check i2c_fault_sim bus_check; do
+    echo "== $check"
+    "$out/$check" "$@" || status=1
+done
+exit $status
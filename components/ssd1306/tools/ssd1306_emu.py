@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""Replay an SSD1306 transaction log into a virtual 128x64 panel.
+
+With the SSD1306 log tag at debug level, ssd1306.c logs every bus write as
+"tx <len>" followed by a hex dump, and each ssd1306_refresh_gram as
+"frame <n>". Writes are logged in I2C form, control byte first, on both
+transports; on SPI the control byte is the D/C line rather than a byte on
+the wire. This tool decodes that stream the way the controller would:
+control bytes, horizontal/vertical/page addressing, column/page windows,
+segment remap, COM scan direction, start line and display offset. It keeps
+the 128x64 GDDRAM, writes PBM or PNG snapshots of what the panel shows and
+reports bus transactions, bytes and wire time per frame for either transport.
+
+    idf.py monitor | tee oled.log
+    ssd1306_emu.py oled.log --snapshot last.png
+    ssd1306_emu.py oled.log --every frames/frame_%04d.pbm --stats
+    ssd1306_emu.py oled.log --stats --bus spi --clock 10000000
+"""
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+
+WIDTH = 128
+HEIGHT = 64
+PAGES = HEIGHT // 8
+
+# Commands followed by argument bytes, and how many
+CMD_ARGS = {
+    0x20: 1,  # memory addressing mode
+    0x21: 2,  # column address window
+    0x22: 2,  # page address window
+    0x81: 1,  # contrast
+    0x8D: 1,  # charge pump
+    0xA8: 1,  # multiplex ratio
+    0xD3: 1,  # display offset
+    0xD5: 1,  # clock divide
+    0xD9: 1,  # pre-charge
+    0xDA: 1,  # COM pins
+    0xDB: 1,  # VCOMH deselect
+}
+
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+LINE = re.compile(r"SSD1306: (?:tx (\d+)|frame (\d+)|((?:[0-9a-fA-F]{2} ?)+))\s*$")
+
+MODE_HORIZONTAL, MODE_VERTICAL, MODE_PAGE = 0, 1, 2
+
+DEFAULT_CLOCK = {"i2c": 400000, "spi": 10000000}
+
+
+def wire_bits(bus, payload):
+    """Clock cycles one logged transaction takes on the wire."""
+    if bus == "i2c":
+        # Start, address byte, control byte and data at 9 bits per byte with ACK, stop
+        return 1 + 9 * (1 + len(payload)) + 1
+    # SPI: the control byte is the D/C line, data is 8 bits per byte
+    return 8 * (len(payload) - 1)
+
+
+class Ssd1306:
+    def __init__(self):
+        self.gram = [[0] * WIDTH for _ in range(PAGES)]
+        self.mode = MODE_PAGE  # controller reset default
+        self.col_start, self.col_end = 0, WIDTH - 1
+        self.page_start, self.page_end = 0, PAGES - 1
+        self.col, self.page = 0, 0
+        self.seg_remap = False
+        self.com_reverse = False
+        self.start_line = 0
+        self.offset = 0
+        self.inverted = False
+        self.display_on = False
+        self.all_on = False
+        self.contrast = 0x7F
+        self._cmd = None
+        self._args = []
+
+    # Command stream
+
+    def command(self, byte):
+        if self._cmd is not None:
+            self._args.append(byte)
+            if len(self._args) == CMD_ARGS[self._cmd]:
+                self._execute(self._cmd, self._args)
+                self._cmd, self._args = None, []
+            return
+        if byte in CMD_ARGS:
+            self._cmd, self._args = byte, []
+            return
+        self._execute(byte, [])
+
+    def _execute(self, cmd, args):
+        if cmd == 0x20:
+            self.mode = args[0] & 0x03
+        elif cmd == 0x21:
+            self.col_start, self.col_end = args[0] & 0x7F, args[1] & 0x7F
+            self.col = self.col_start
+        elif cmd == 0x22:
+            self.page_start, self.page_end = args[0] & 0x07, args[1] & 0x07
+            self.page = self.page_start
+        elif cmd == 0x81:
+            self.contrast = args[0]
+        elif cmd == 0xD3:
+            self.offset = args[0] & 0x3F
+        elif cmd <= 0x0F:
+            self.col = (self.col & 0xF0) | cmd
+        elif cmd <= 0x1F:
+            self.col = (self.col & 0x0F) | ((cmd & 0x07) << 4)
+        elif 0x40 <= cmd <= 0x7F:
+            self.start_line = cmd & 0x3F
+        elif cmd in (0xA0, 0xA1):
+            self.seg_remap = cmd == 0xA1
+        elif cmd in (0xA4, 0xA5):
+            self.all_on = cmd == 0xA5
+        elif cmd in (0xA6, 0xA7):
+            self.inverted = cmd == 0xA7
+        elif cmd in (0xAE, 0xAF):
+            self.display_on = cmd == 0xAF
+        elif 0xB0 <= cmd <= 0xB7:
+            self.page = cmd & 0x07
+        elif cmd in (0xC0, 0xC8):
+            self.com_reverse = cmd == 0xC8
+        # Anything else (timing, charge pump, scrolling) does not change the image
+
+    # Data stream
+
+    def data(self, byte):
+        self.gram[self.page][self.col] = byte
+        if self.mode == MODE_HORIZONTAL:
+            self.col += 1
+            if self.col > self.col_end:
+                self.col = self.col_start
+                self.page = self.page + 1 if self.page < self.page_end else self.page_start
+        elif self.mode == MODE_VERTICAL:
+            self.page += 1
+            if self.page > self.page_end:
+                self.page = self.page_start
+                self.col = self.col + 1 if self.col < self.col_end else self.col_start
+        else:
+            # Page mode wraps within the page
+            self.col = (self.col + 1) % WIDTH
+
+    def transaction(self, payload):
+        """Decode one I2C write (without the address byte)."""
+        i = 0
+        while i < len(payload):
+            control = payload[i]
+            i += 1
+            continuation = control & 0x80
+            is_data = control & 0x40
+            if continuation:
+                # Co=1: exactly one byte follows, then another control byte
+                if i < len(payload):
+                    (self.data if is_data else self.command)(payload[i])
+                    i += 1
+                continue
+            for byte in payload[i:]:
+                (self.data if is_data else self.command)(byte)
+            break
+
+    # Panel output
+
+    def pixels(self):
+        """Rows of 0/1 as seen on the glass, top row first."""
+        rows = []
+        for y in range(HEIGHT):
+            com = HEIGHT - 1 - y if self.com_reverse else y
+            ram_row = (com + self.start_line + self.offset) % HEIGHT
+            row = []
+            for x in range(WIDTH):
+                seg = WIDTH - 1 - x if self.seg_remap else x
+                on = (self.gram[ram_row // 8][seg] >> (ram_row % 8)) & 1
+                if self.all_on:
+                    on = 1
+                if self.inverted:
+                    on ^= 1
+                if not self.display_on:
+                    on = 0
+                row.append(on)
+            rows.append(row)
+        return rows
+
+
+def write_pbm(path, rows):
+    with open(path, "w") as out:
+        out.write("P1\n%d %d\n" % (WIDTH, HEIGHT))
+        for row in rows:
+            out.write(" ".join(str(p) for p in row) + "\n")
+
+
+def write_png(path, rows):
+    # 1-bit grayscale, white = lit pixel
+    raw = b""
+    for row in rows:
+        packed = bytearray(WIDTH // 8)
+        for x, p in enumerate(row):
+            if p:
+                packed[x // 8] |= 0x80 >> (x % 8)
+        raw += b"\x00" + bytes(packed)
+
+    def chunk(kind, body):
+        data = kind + body
+        return struct.pack(">I", len(body)) + data + struct.pack(">I", zlib.crc32(data) & 0xFFFFFFFF)
+
+    with open(path, "wb") as out:
+        out.write(b"\x89PNG\r\n\x1a\n")
+        out.write(chunk(b"IHDR", struct.pack(">IIBBBBB", WIDTH, HEIGHT, 1, 0, 0, 0, 0)))
+        out.write(chunk(b"IDAT", zlib.compress(raw, 9)))
+        out.write(chunk(b"IEND", b""))
+
+
+def write_snapshot(path, panel, rotate=False):
+    rows = panel.pixels()
+    if rotate:
+        # Panel mounted upside down: show it the way the viewer sees it
+        rows = [row[::-1] for row in rows[::-1]]
+    if path.lower().endswith(".png"):
+        write_png(path, rows)
+    else:
+        write_pbm(path, rows)
+
+
+def parse_log(stream):
+    """Yield ("frame", n) and ("tx", bytes) events from a monitor log."""
+    pending = None
+    expected = 0
+    for line in stream:
+        match = LINE.search(ANSI.sub("", line))
+        if not match:
+            continue
+        tx_len, frame, hex_bytes = match.groups()
+        if frame is not None:
+            yield "frame", int(frame)
+        elif tx_len is not None:
+            pending, expected = bytearray(), int(tx_len)
+        elif pending is not None:
+            pending.extend(bytes.fromhex(hex_bytes.replace(" ", "")))
+            if len(pending) >= expected:
+                yield "tx", bytes(pending[:expected])
+                pending = None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="monitor log (default: stdin)")
+    parser.add_argument("--snapshot", help="write the final panel image (.pbm or .png)")
+    parser.add_argument("--every", help="write a snapshot after every frame, e.g. out/frame_%%04d.png")
+    parser.add_argument("--rotate", action="store_true", help="rotate snapshots 180 degrees (upside-down mount)")
+    parser.add_argument("--stats", action="store_true", help="print transactions and bytes per frame")
+    parser.add_argument("--bus", choices=("i2c", "spi"), default="i2c",
+                        help="transport to compute wire time for (default: i2c)")
+    parser.add_argument("--clock", type=int, help="bus clock in Hz (default: 400 kHz I2C, 10 MHz SPI)")
+    args = parser.parse_args()
+    clock = args.clock or DEFAULT_CLOCK[args.bus]
+
+    panel = Ssd1306()
+    stream = open(args.log) if args.log else sys.stdin
+    frame = None
+    frame_tx = frame_bytes = frame_bits = 0
+    total_tx = total_bytes = total_bits = frames = 0
+
+    def end_frame():
+        if frame is None:
+            return
+        if args.stats:
+            print("frame %d: %d transactions, %d bytes, %.0f us on %s" %
+                  (frame, frame_tx, frame_bytes, frame_bits * 1e6 / clock, args.bus))
+        if args.every:
+            write_snapshot(args.every % frame, panel, args.rotate)
+
+    for kind, value in parse_log(stream):
+        if kind == "frame":
+            end_frame()
+            frame, frame_tx, frame_bytes, frame_bits = value, 0, 0, 0
+            frames += 1
+        else:
+            panel.transaction(value)
+            bits = wire_bits(args.bus, value)
+            frame_tx += 1
+            frame_bytes += len(value)
+            frame_bits += bits
+            total_tx += 1
+            total_bytes += len(value)
+            total_bits += bits
+    end_frame()
+
+    if args.snapshot:
+        write_snapshot(args.snapshot, panel, args.rotate)
+    if args.stats:
+        print("total: %d frames, %d transactions, %d bytes" % (frames, total_tx, total_bytes))
+        if frames:
+            print("average: %.1f transactions, %.1f bytes per frame" % (total_tx / frames, total_bytes / frames))
+            frame_us = total_bits * 1e6 / clock / frames
+            print("wire time: %.0f us per frame on %s at %d Hz (%.0f frames/s max)" %
+                  (frame_us, args.bus, clock, 1e6 / frame_us if frame_us else 0))
+
+
+if __name__ == "__main__":
+    main()
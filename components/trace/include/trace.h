@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Whether spans are recorded; always on in host builds
+ */
+#if !defined(ESP_PLATFORM) || CONFIG_TRACE_ENABLE
+#define TRACE_ENABLED (1)
+#else
+#define TRACE_ENABLED (0)
+#endif
+
+/**
+ * @brief Spans per buffer; there is one buffer per core (per thread on the host)
+ */
+#ifdef CONFIG_TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS (CONFIG_TRACE_BUFFER_EVENTS)
+#else
+#define TRACE_BUFFER_EVENTS (4096)
+#endif
+
+/**
+ * @brief Capture state and counters
+ */
+typedef struct {
+    bool active;                /*!< Recording; a capture stops by itself when a buffer fills */
+    uint32_t events;            /*!< Spans recorded since trace_start */
+    uint32_t dropped;           /*!< Spans lost to a full buffer */
+    uint32_t duration_us;       /*!< From trace_start to the end of the last span */
+} trace_stats_t;
+
+/**
+ * @brief Output function for trace_export_chrome, called with consecutive pieces of the JSON text
+ */
+typedef void (*trace_write_fn)(const char *text, size_t len, void *ctx);
+
+#if TRACE_ENABLED
+
+/**
+ * @brief Clear the buffers and start recording
+ */
+void trace_start(void);
+
+/**
+ * @brief Stop recording; spans still open are not recorded
+ */
+void trace_stop(void);
+
+/**
+ * @brief Start a span
+ *
+ * @return Timestamp to pass to trace_end, or 0 when not recording
+ */
+int64_t trace_begin(void);
+
+/**
+ * @brief End a span and record it
+ *
+ * Lock-free: each core (thread on the host) writes its own buffer and
+ * reserves entries with an atomic increment, so a task preempted mid-record
+ * only delays its own entry. Safe to call from any task, not from ISRs.
+ *
+ * @param name Span name; must stay valid until the trace is exported (a string literal)
+ * @param start_us Value returned by trace_begin
+ */
+void trace_end(const char *name, int64_t start_us);
+
+/**
+ * @brief Record a span measured elsewhere, e.g. with perf_begin
+ *
+ * Spans that started before trace_start are ignored.
+ */
+void trace_span(const char *name, int64_t start_us, int64_t end_us);
+
+/**
+ * @brief Name the calling thread in exported traces
+ *
+ * Only needed on the host; on the device FreeRTOS task names are used.
+ */
+void trace_name_thread(const char *name);
+
+void trace_get_stats(trace_stats_t *stats);
+
+/**
+ * @brief Write the recorded spans as Chrome trace event JSON
+ *
+ * The output opens in Perfetto (ui.perfetto.dev) and chrome://tracing, with
+ * one track per task. Recording must be stopped first.
+ *
+ * @return Number of spans written
+ */
+uint32_t trace_export_chrome(trace_write_fn write, void *ctx);
+
+#else
+
+static inline void trace_start(void) {}
+static inline void trace_stop(void) {}
+static inline int64_t trace_begin(void) { return 0; }
+static inline void trace_end(const char *name, int64_t start_us) {}
+static inline void trace_span(const char *name, int64_t start_us, int64_t end_us) {}
+static inline void trace_name_thread(const char *name) {}
+static inline void trace_get_stats(trace_stats_t *stats) { *stats = (trace_stats_t){ 0 }; }
+static inline uint32_t trace_export_chrome(trace_write_fn write, void *ctx) { return 0; }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Capture a span trace from the device console into a Chrome trace JSON file.
+
+Runs "trace start", waits, then "trace dump" on the console port and keeps
+the JSON between the dump markers, dropping log lines that other tasks print
+in between. The result opens in ui.perfetto.dev or chrome://tracing. With
+--log, the JSON is cut out of a saved console log instead (e.g. the output
+of "idf.py monitor" after typing "trace dump"). Needs pyserial for ports.
+
+    trace_capture.py /dev/ttyUSB0 --seconds 3 -o device.json
+    trace_capture.py --log monitor.log -o device.json
+"""
+
+import argparse
+import json
+import re
+import sys
+import time
+
+BEGIN = "--- trace begin ---"
+END = "--- trace end ---"
+LOG_LINE = re.compile(r"^(\x1b\[[0-9;]*m)?[EWIDV] \(\d+\)")
+
+
+def extract(lines):
+    """Returns the JSON text of the last dump in lines, or None."""
+    result = None
+    body = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        if line.endswith(BEGIN):
+            body = []
+        elif line.startswith(END) and body is not None:
+            result = "\n".join(body)
+            body = None
+        elif body is not None and line and not LOG_LINE.match(line):
+            body.append(line)
+    return result
+
+
+def capture(port, baud, seconds):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is needed to talk to the device: pip install pyserial")
+    with serial.Serial(port, baud, timeout=1) as ser:
+        ser.write(b"\ntrace start\n")
+        time.sleep(seconds)
+        ser.reset_input_buffer()
+        ser.write(b"trace dump\n")
+        lines = []
+        deadline = time.monotonic() + 60
+        while time.monotonic() < deadline:
+            line = ser.readline().decode("utf-8", "replace")
+            if not line:
+                continue
+            lines.append(line)
+            if line.startswith(END):
+                break
+        return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?", help="console serial port")
+    parser.add_argument("--baud", type=int, default=115200, help="console baud rate (default 115200)")
+    parser.add_argument("--seconds", type=float, default=2.0, help="capture length (default 2)")
+    parser.add_argument("--log", help="extract from a saved console log instead of a port")
+    parser.add_argument("-o", "--output", default="trace.json", help="output file (default trace.json)")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, encoding="utf-8", errors="replace") as f:
+            lines = f.readlines()
+    elif args.port:
+        lines = capture(args.port, args.baud, args.seconds)
+    else:
+        parser.error("give a port or --log")
+
+    text = extract(lines)
+    if text is None:
+        sys.exit("no complete trace dump found")
+    trace = json.loads(text)  # Fails loudly on a dump cut short
+    spans = [e for e in trace["traceEvents"] if e.get("ph") == "X"]
+    with open(args.output, "w") as f:
+        json.dump(trace, f)
+    end = max((e["ts"] + e["dur"] for e in spans), default=0)
+    print("%d spans over %.1f ms written to %s" % (len(spans), end / 1000.0, args.output), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,247 @@
+// Timing model of the picker's pipeline on the host, traced with the trace component.
+//
+// One thread per firmware task, each doing what its counterpart does with
+// sleeps standing in for the hardware: the main loop polls inputs and hands
+// colors to the transition engine and display governor; the transition
+// engine interpolates at 100 frames/s and refreshes the strip; the display
+// governor renders and flushes frames. The button task polls a device on the
+// display's I2C bus, as buttons behind an I/O expander would, to show bus
+// contention next to the display flush. The spans carry the device's names, so
+// a host trace and a device capture ("trace dump", trace_capture.py) open
+// side by side in Perfetto.
+//
+//     cc -O2 -pthread -I../include -o trace_sim trace_sim.c ../trace.c
+//     ./trace_sim --seconds 2 --output sim.json      then open sim.json in ui.perfetto.dev
+//     ./trace_sim --spi                              4-wire SPI display instead of I2C
+//
+// Options: --leds N (strip length, default 4), --i2c-hz N (default 400000),
+// --spi, --seconds N (default 2), --output FILE (default trace.json).
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+#define MAIN_LOOP_INTERVAL_MS   50
+#define TRANSITION_INTERVAL_MS  10
+#define BUTTON_INTERVAL_MS      20
+#define DISPLAY_FRAME_BYTES     1024
+#define SPI_CLOCK_HZ            10000000
+
+typedef struct {
+    int leds;
+    uint32_t i2c_hz;
+    bool spi;
+    volatile bool running;
+    pthread_mutex_t lock;
+    pthread_cond_t display_wake;
+    bool display_pending;
+    pthread_mutex_t bus;            // Display and I/O expander share the I2C bus
+    uint32_t bus_wait_max_us;
+} sim_t;
+
+static void sleep_us(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Busy work standing in for CPU time, so it shows up as such
+static void spin_us(uint32_t us)
+{
+    int64_t end = now_us() + us;
+    while (now_us() < end) {
+    }
+}
+
+static void lock_bus(sim_t *sim)
+{
+    int64_t start = now_us();
+    pthread_mutex_lock(&sim->bus);
+    int64_t waited = now_us() - start;
+    if (waited > sim->bus_wait_max_us) {
+        sim->bus_wait_max_us = (uint32_t)waited;
+    }
+    trace_span("bus_wait", start, start + waited);
+}
+
+static void *main_loop(void *arg)
+{
+    sim_t *sim = arg;
+    trace_name_thread("main");
+    for (int i = 0; sim->running; i++) {
+        int64_t loop_start = trace_begin();
+        int64_t start = trace_begin();
+        spin_us(120); // Three ADC reads
+        trace_end("inputs", start);
+        
+        // The color changes every few loops, as when a pot is turned
+        if (i % 3 == 0) {
+            start = trace_begin();
+            pthread_mutex_lock(&sim->lock);
+            sim->display_pending = true;
+            pthread_cond_signal(&sim->display_wake);
+            pthread_mutex_unlock(&sim->lock);
+            trace_end("update_oled_display", start);
+        }
+        trace_end("main_loop", loop_start);
+        sleep_us(MAIN_LOOP_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+static void *transition_task(void *arg)
+{
+    sim_t *sim = arg;
+    trace_name_thread("transition");
+    // 24 bits of 1.25 us per LED plus the latch
+    uint32_t frame_us = sim->leds * 30 + 280;
+    while (sim->running) {
+        int64_t start = trace_begin();
+        spin_us(15);
+        trace_end("transition", start);
+        
+        start = trace_begin();
+        int64_t refresh_start = trace_begin();
+        sleep_us(frame_us);
+        trace_end("ws2812_refresh", refresh_start);
+        trace_end("led_refresh", start);
+        sleep_us(TRANSITION_INTERVAL_MS * 1000 - frame_us);
+    }
+    return NULL;
+}
+
+static void *display_task(void *arg)
+{
+    sim_t *sim = arg;
+    trace_name_thread("display");
+    // Start, address and 9 bits per byte on I2C; 8 bits on SPI
+    uint32_t flush_us = sim->spi ? DISPLAY_FRAME_BYTES * 8 * 1000000ull / SPI_CLOCK_HZ
+                                 : (DISPLAY_FRAME_BYTES + 1) * 9 * 1000000ull / sim->i2c_hz;
+    while (sim->running) {
+        pthread_mutex_lock(&sim->lock);
+        while (!sim->display_pending && sim->running) {
+            pthread_cond_wait(&sim->display_wake, &sim->lock);
+        }
+        sim->display_pending = false;
+        pthread_mutex_unlock(&sim->lock);
+        
+        int64_t start = trace_begin();
+        spin_us(400); // Clear and draw three rows of text
+        trace_end("display_render", start);
+        
+        start = trace_begin();
+        if (!sim->spi) {
+            lock_bus(sim);
+        }
+        int64_t refresh_start = trace_begin();
+        sleep_us(flush_us);
+        trace_end("ssd1306_refresh_gram", refresh_start);
+        if (!sim->spi) {
+            pthread_mutex_unlock(&sim->bus);
+        }
+        trace_end("display_flush", start);
+    }
+    return NULL;
+}
+
+static void *button_task(void *arg)
+{
+    sim_t *sim = arg;
+    trace_name_thread("input");
+    // One register read: address, register, repeated start, data
+    uint32_t read_us = 4 * 9 * 1000000ull / sim->i2c_hz;
+    while (sim->running) {
+        int64_t start = trace_begin();
+        lock_bus(sim);
+        sleep_us(read_us);
+        pthread_mutex_unlock(&sim->bus);
+        spin_us(10);
+        trace_end("input", start);
+        sleep_us(BUTTON_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+static void write_file(const char *text, size_t len, void *ctx)
+{
+    fwrite(text, 1, len, ctx);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--leds N] [--i2c-hz N] [--spi] [--seconds N] [--output FILE]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static sim_t sim = {
+        .leds = 4,
+        .i2c_hz = 400000,
+        .running = true,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .display_wake = PTHREAD_COND_INITIALIZER,
+        .bus = PTHREAD_MUTEX_INITIALIZER,
+    };
+    int seconds = 2;
+    const char *output = "trace.json";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--spi")) {
+            sim.spi = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--leds")) {
+            sim.leds = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--i2c-hz")) {
+            sim.i2c_hz = (uint32_t)atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--seconds")) {
+            seconds = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--output")) {
+            output = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (sim.leds < 1 || sim.leds > 300 || sim.i2c_hz < 10000 || seconds < 1) {
+        usage(argv[0]);
+    }
+    
+    trace_start();
+    pthread_t threads[4];
+    void *(*tasks[4])(void *) = { main_loop, transition_task, display_task, button_task };
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, tasks[i], &sim);
+    }
+    sleep_us(seconds * 1000000u);
+    sim.running = false;
+    pthread_mutex_lock(&sim.lock);
+    pthread_cond_signal(&sim.display_wake);
+    pthread_mutex_unlock(&sim.lock);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    trace_stop();
+    
+    FILE *f = fopen(output, "w");
+    if (!f) {
+        perror(output);
+        return 1;
+    }
+    uint32_t count = trace_export_chrome(write_file, f);
+    fclose(f);
+    
+    trace_stats_t stats;
+    trace_get_stats(&stats);
+    printf("%u spans over %u ms (%u dropped) written to %s; longest bus wait %u us\n", count,
+           stats.duration_us / 1000, stats.dropped, output, sim.bus_wait_max_us);
+    return count ? 0 : 1;
+}
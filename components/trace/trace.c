@@ -0,0 +1,260 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#define TRACE_BUFFERS       (portNUM_PROCESSORS)
+#define TRACE_PROCESS_NAME  CONFIG_IDF_TARGET
+#else
+#include <time.h>
+#define TRACE_BUFFERS       (8)     // Threads traced on the host; later ones are dropped
+#define TRACE_PROCESS_NAME  "host"
+#endif
+
+#define TRACE_MAX_THREADS   (32)    // Tracks in an export; spans of further tasks share one
+
+typedef struct {
+    const char *name;           // Stored last: NULL until the rest of the entry is written
+    const void *thread;         // Task handle on the device, buffer on the host
+    uint32_t start_us;          // From trace_start
+    uint32_t duration_us;
+} trace_event_t;
+
+typedef struct {
+    uint32_t head;              // Next entry, reserved with an atomic increment
+    const char *thread_name;    // Host only, see trace_name_thread
+    trace_event_t events[TRACE_BUFFER_EVENTS];
+} trace_buffer_t;
+
+static trace_buffer_t buffers[TRACE_BUFFERS];
+static bool active = false;
+static int64_t base_us = 0;
+static int64_t stop_us = 0;
+static uint32_t dropped = 0;
+
+static int64_t now_us(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// Each core has its own buffer, so tasks on different cores never contend
+// for a counter; on the host each thread gets one the first time it records
+static trace_buffer_t *current_buffer(const void **thread)
+{
+#ifdef ESP_PLATFORM
+    *thread = xTaskGetCurrentTaskHandle();
+    return &buffers[xPortGetCoreID()];
+#else
+    static _Thread_local trace_buffer_t *buffer = NULL;
+    static uint32_t next_buffer = 0;
+    if (buffer == NULL) {
+        uint32_t i = __atomic_fetch_add(&next_buffer, 1, __ATOMIC_RELAXED);
+        if (i >= TRACE_BUFFERS) {
+            return NULL;
+        }
+        buffer = &buffers[i];
+    }
+    *thread = buffer;
+    return buffer;
+#endif
+}
+
+void trace_start(void)
+{
+    __atomic_store_n(&active, false, __ATOMIC_RELAXED);
+    for (int i = 0; i < TRACE_BUFFERS; i++) {
+        buffers[i].head = 0;
+        memset(buffers[i].events, 0, sizeof(buffers[i].events));
+    }
+    dropped = 0;
+    base_us = now_us();
+    __atomic_store_n(&active, true, __ATOMIC_RELEASE);
+}
+
+void trace_stop(void)
+{
+    if (__atomic_exchange_n(&active, false, __ATOMIC_RELAXED)) {
+        stop_us = now_us();
+    }
+}
+
+int64_t trace_begin(void)
+{
+    return __atomic_load_n(&active, __ATOMIC_RELAXED) ? now_us() : 0;
+}
+
+void trace_end(const char *name, int64_t start_us)
+{
+    if (start_us != 0) {
+        trace_span(name, start_us, now_us());
+    }
+}
+
+void trace_span(const char *name, int64_t start_us, int64_t end_us)
+{
+    if (!__atomic_load_n(&active, __ATOMIC_ACQUIRE) || start_us < base_us) {
+        return;
+    }
+    const void *thread;
+    trace_buffer_t *buffer = current_buffer(&thread);
+    if (buffer == NULL) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    uint32_t slot = __atomic_fetch_add(&buffer->head, 1, __ATOMIC_RELAXED);
+    if (slot >= TRACE_BUFFER_EVENTS) {
+        // The first full buffer ends the capture, so every track covers the same window
+        if (__atomic_exchange_n(&active, false, __ATOMIC_RELAXED)) {
+            stop_us = end_us;
+        }
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    trace_event_t *event = &buffer->events[slot];
+    event->thread = thread;
+    event->start_us = (uint32_t)(start_us - base_us);
+    event->duration_us = (uint32_t)(end_us - start_us);
+    __atomic_store_n(&event->name, name, __ATOMIC_RELEASE);
+}
+
+void trace_name_thread(const char *name)
+{
+#ifndef ESP_PLATFORM
+    const void *thread;
+    trace_buffer_t *buffer = current_buffer(&thread);
+    if (buffer != NULL) {
+        buffer->thread_name = name;
+    }
+#endif
+}
+
+static uint32_t buffer_count(const trace_buffer_t *buffer)
+{
+    uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_RELAXED);
+    return head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+}
+
+void trace_get_stats(trace_stats_t *stats)
+{
+    stats->active = __atomic_load_n(&active, __ATOMIC_RELAXED);
+    stats->events = 0;
+    for (int i = 0; i < TRACE_BUFFERS; i++) {
+        stats->events += buffer_count(&buffers[i]);
+    }
+    stats->dropped = dropped;
+    stats->duration_us = base_us ? (uint32_t)((stats->active ? now_us() : stop_us) - base_us) : 0;
+}
+
+static void emit(trace_write_fn write, void *ctx, const char *format, ...)
+{
+    char text[160];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len > 0) {
+        write(text, len < (int)sizeof(text) ? (size_t)len : sizeof(text) - 1, ctx);
+    }
+}
+
+// Track of a thread: 1 up in order of first appearance, 0 for the overflow track
+static int thread_track(const void **threads, int *count, const void *thread)
+{
+    for (int i = 0; i < *count; i++) {
+        if (threads[i] == thread) {
+            return i + 1;
+        }
+    }
+    if (*count == TRACE_MAX_THREADS) {
+        return 0;
+    }
+    threads[(*count)++] = thread;
+    return *count;
+}
+
+#if defined(ESP_PLATFORM) && CONFIG_FREERTOS_USE_TRACE_FACILITY
+static TaskStatus_t task_status[TRACE_MAX_THREADS];
+static UBaseType_t task_count = 0;
+#endif
+
+// Names are looked up at export time; a task deleted since keeps only its number
+static const char *thread_name(const void *thread)
+{
+#ifdef ESP_PLATFORM
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    for (UBaseType_t i = 0; i < task_count; i++) {
+        if (task_status[i].xHandle == thread) {
+            return task_status[i].pcTaskName;
+        }
+    }
+#endif
+    return NULL;
+#else
+    return ((const trace_buffer_t *)thread)->thread_name;
+#endif
+}
+
+uint32_t trace_export_chrome(trace_write_fn write, void *ctx)
+{
+    static const void *threads[TRACE_MAX_THREADS];
+    int thread_count = 0;
+    uint32_t exported = 0;
+    
+    emit(write, ctx, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    emit(write, ctx, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+         TRACE_PROCESS_NAME);
+    for (int b = 0; b < TRACE_BUFFERS; b++) {
+        const trace_buffer_t *buffer = &buffers[b];
+        uint32_t count = buffer_count(buffer);
+        for (uint32_t i = 0; i < count; i++) {
+            const trace_event_t *event = &buffer->events[i];
+            const char *name = __atomic_load_n(&event->name, __ATOMIC_ACQUIRE);
+            if (name == NULL) {
+                continue; // Still being written when recording stopped
+            }
+            int track = thread_track(threads, &thread_count, event->thread);
+#ifdef ESP_PLATFORM
+            emit(write, ctx, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lu,\"dur\":%lu,\"args\":{\"cpu\":%d}}",
+                 name, track, (unsigned long)event->start_us, (unsigned long)event->duration_us, b);
+#else
+            emit(write, ctx, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lu,\"dur\":%lu}",
+                 name, track, (unsigned long)event->start_us, (unsigned long)event->duration_us);
+#endif
+            exported++;
+        }
+    }
+    
+#if defined(ESP_PLATFORM) && CONFIG_FREERTOS_USE_TRACE_FACILITY
+    task_count = uxTaskGetSystemState(task_status, TRACE_MAX_THREADS, NULL);
+#endif
+    for (int i = 0; i < thread_count; i++) {
+        const char *name = thread_name(threads[i]);
+        if (name != NULL) {
+            emit(write, ctx, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 i + 1, name);
+        } else {
+            emit(write, ctx, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"task %d\"}}",
+                 i + 1, i + 1);
+        }
+    }
+    if (thread_count == TRACE_MAX_THREADS) {
+        emit(write, ctx, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"other\"}}");
+    }
+    emit(write, ctx, "\n]}\n");
+    return exported;
+}
+
+#endif
@@ -0,0 +1,300 @@
+#include <string.h>
+#include "audio_input.h"
+#include "main.h"
+#include "esp_timer.h"
+#include "audio_spectrum.h"
+#include "perf.h"
+
+// The ADC interleaves the microphone with each aux channel (mic, aux0, mic,
+// aux1, ...), so microphone samples stay evenly spaced at twice the pattern
+// rate of one aux channel
+#define AUDIO_PATTERN_MAX       (2 * AUDIO_MAX_AUX_CHANNELS)
+#define AUDIO_START_TIMEOUT_MS  50      // Wait for the first aux readings after start
+
+static adc_continuous_handle_t adc_handle = NULL;
+static audio_spectrum_t *spectrum = NULL;
+static TaskHandle_t capture_task_handle = NULL;
+static adc_channel_t mic;
+static volatile bool running = false;
+
+// Written by the capture task
+static int16_t samples[AUDIO_FFT_SIZE];
+static int sample_fill = 0;
+
+static portMUX_TYPE audio_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t levels[AUDIO_BAND_COUNT];
+static uint16_t aux_raw[SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)];
+static uint32_t aux_fresh = 0;          // Bit per channel read since start
+static uint32_t aux_wanted = 0;
+static audio_input_stats_t stats;
+static uint64_t analysis_sum_us = 0;
+
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(capture_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *ctx)
+{
+    portENTER_CRITICAL_ISR(&audio_lock);
+    stats.overruns++;
+    portEXIT_CRITICAL_ISR(&audio_lock);
+    return false;
+}
+
+static void analyze_frame(void)
+{
+    uint8_t frame_levels[AUDIO_BAND_COUNT];
+    int64_t start = perf_begin();
+    audio_spectrum_process(spectrum, samples, frame_levels);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    perf_end(PERF_STAGE_AUDIO_ANALYSIS, start);
+    
+    portENTER_CRITICAL(&audio_lock);
+    memcpy(levels, frame_levels, sizeof(levels));
+    stats.frames++;
+    analysis_sum_us += elapsed;
+    stats.analysis_avg_us = (uint32_t)(analysis_sum_us / stats.frames);
+    if (elapsed > stats.analysis_max_us) {
+        stats.analysis_max_us = elapsed;
+    }
+    portEXIT_CRITICAL(&audio_lock);
+}
+
+static void audio_capture_task(void *pvParameter)
+{
+    static uint8_t buffer[AUDIO_READ_CONVERSIONS * SOC_ADC_DIGI_RESULT_BYTES];
+    
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        uint32_t len;
+        while (adc_continuous_read(adc_handle, buffer, sizeof(buffer), &len, 0) == ESP_OK) {
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+                const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&buffer[i];
+                uint32_t channel = result->type2.channel;
+                uint32_t raw = result->type2.data;
+                
+                if (channel == mic) {
+                    // Mid-scale is silence; the analyzer removes the remaining offset
+                    samples[sample_fill++] = (int16_t)(((int32_t)raw - 2048) << 4);
+                    if (sample_fill == AUDIO_FFT_SIZE) {
+                        analyze_frame();
+                        sample_fill = 0;
+                    }
+                } else if (channel < SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)) {
+                    portENTER_CRITICAL(&audio_lock);
+                    aux_raw[channel] = raw;
+                    aux_fresh |= 1u << channel;
+                    portEXIT_CRITICAL(&audio_lock);
+                }
+            }
+        }
+    }
+}
+
+esp_err_t audio_input_init(adc_channel_t mic_channel, const adc_channel_t *aux_channels, int aux_count)
+{
+    if (aux_count < 0 || aux_count > AUDIO_MAX_AUX_CHANNELS || (aux_count && !aux_channels)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mic = mic_channel;
+    
+    audio_spectrum_config_t spectrum_config = AUDIO_SPECTRUM_DEFAULT_CONFIG(AUDIO_SAMPLE_RATE_HZ);
+    spectrum_config.fft_size = AUDIO_FFT_SIZE;
+    spectrum_config.band_count = AUDIO_BAND_COUNT;
+    esp_err_t ret = audio_spectrum_new(&spectrum_config, &spectrum);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create spectrum analyzer");
+        return ret;
+    }
+    
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = 4 * AUDIO_READ_CONVERSIONS * SOC_ADC_DIGI_RESULT_BYTES,
+        .conv_frame_size = AUDIO_READ_CONVERSIONS * SOC_ADC_DIGI_RESULT_BYTES,
+    };
+    ret = adc_continuous_new_handle(&handle_config, &adc_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create ADC continuous handle");
+        return ret;
+    }
+    
+    adc_digi_pattern_config_t pattern[AUDIO_PATTERN_MAX];
+    int pattern_num = 0;
+    int slots = aux_count ? aux_count : 1;
+    for (int i = 0; i < slots; i++) {
+        pattern[pattern_num++] = (adc_digi_pattern_config_t){
+            .atten = ADC_ATTEN_DB_12,
+            .channel = mic_channel,
+            .unit = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        if (aux_count) {
+            pattern[pattern_num++] = (adc_digi_pattern_config_t){
+                .atten = ADC_ATTEN_DB_12, // Same as the oneshot pot readings
+                .channel = aux_channels[i],
+                .unit = ADC_UNIT_1,
+                .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+            };
+            aux_wanted |= 1u << aux_channels[i];
+        }
+    }
+    
+    adc_continuous_config_t adc_config = {
+        .pattern_num = pattern_num,
+        .adc_pattern = pattern,
+        .sample_freq_hz = AUDIO_SAMPLE_RATE_HZ * (aux_count ? 2 : 1),
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    ret = adc_continuous_config(adc_handle, &adc_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure ADC continuous mode");
+        return ret;
+    }
+    
+    if (xTaskCreate(audio_capture_task, "audio", 4096, NULL, 5, &capture_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = on_pool_ovf,
+    };
+    ret = adc_continuous_register_event_callbacks(adc_handle, &callbacks, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "Audio input on ADC1 channel %d, %d Hz, %s FFT", mic_channel, AUDIO_SAMPLE_RATE_HZ,
+             audio_spectrum_backend());
+    return ESP_OK;
+}
+
+esp_err_t audio_input_start(void)
+{
+    if (!adc_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (running) {
+        return ESP_OK;
+    }
+    
+    // The capture task is idle while stopped: reads fail until the start below
+    sample_fill = 0;
+    portENTER_CRITICAL(&audio_lock);
+    aux_fresh = 0;
+    memset(levels, 0, sizeof(levels));
+    portEXIT_CRITICAL(&audio_lock);
+    
+    esp_err_t ret = adc_continuous_start(adc_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    running = true;
+    
+    // Callers switch their aux reads over as soon as this returns, so wait
+    // until every aux channel has a reading from the new mode
+    int64_t deadline = esp_timer_get_time() + AUDIO_START_TIMEOUT_MS * 1000;
+    for (;;) {
+        portENTER_CRITICAL(&audio_lock);
+        bool ready = (aux_fresh & aux_wanted) == aux_wanted;
+        portEXIT_CRITICAL(&audio_lock);
+        if (ready) {
+            break;
+        }
+        if (esp_timer_get_time() > deadline) {
+            audio_input_stop();
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    
+    ESP_LOGI(TAG, "Audio capture started");
+    return ESP_OK;
+}
+
+esp_err_t audio_input_stop(void)
+{
+    if (!running) {
+        return ESP_OK;
+    }
+    running = false;
+    esp_err_t ret = adc_continuous_stop(adc_handle);
+    ESP_LOGI(TAG, "Audio capture stopped");
+    return ret;
+}
+
+bool audio_input_is_running(void)
+{
+    return running;
+}
+
+bool audio_input_get_levels(uint8_t *out)
+{
+    if (!running) {
+        return false;
+    }
+    portENTER_CRITICAL(&audio_lock);
+    memcpy(out, levels, sizeof(levels));
+    portEXIT_CRITICAL(&audio_lock);
+    return true;
+}
+
+esp_err_t audio_input_read_aux(adc_channel_t channel, int *raw)
+{
+    if (!running || channel >= SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    portENTER_CRITICAL(&audio_lock);
+    if (aux_fresh & (1u << channel)) {
+        *raw = aux_raw[channel];
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&audio_lock);
+    return ret;
+}
+
+void audio_input_get_stats(audio_input_stats_t *out)
+{
+    portENTER_CRITICAL(&audio_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&audio_lock);
+}
+
+esp_err_t audio_input_benchmark(uint32_t frames, uint32_t *fft_ns, uint32_t *analysis_ns)
+{
+    audio_spectrum_config_t config = AUDIO_SPECTRUM_DEFAULT_CONFIG(AUDIO_SAMPLE_RATE_HZ);
+    config.fft_size = AUDIO_FFT_SIZE;
+    config.band_count = AUDIO_BAND_COUNT;
+    audio_spectrum_t *bench;
+    if (frames == 0 || audio_spectrum_new(&config, &bench) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // A 1 kHz square wave: harmonics in every upper band
+    static int16_t tone[AUDIO_FFT_SIZE];
+    for (int i = 0; i < AUDIO_FFT_SIZE; i++) {
+        tone[i] = (i * 1000 * 2 / AUDIO_SAMPLE_RATE_HZ) & 1 ? -16384 : 16384;
+    }
+    uint8_t bench_levels[AUDIO_BAND_COUNT];
+    audio_spectrum_process(bench, tone, bench_levels);
+    
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < frames; i++) {
+        audio_spectrum_run_fft(bench);
+    }
+    *fft_ns = (uint32_t)((esp_timer_get_time() - start) * 1000 / frames);
+    
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < frames; i++) {
+        audio_spectrum_process(bench, tone, bench_levels);
+    }
+    *analysis_ns = (uint32_t)((esp_timer_get_time() - start) * 1000 / frames);
+    
+    audio_spectrum_del(bench);
+    return ESP_OK;
+}
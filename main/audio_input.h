@@ -0,0 +1,46 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_adc/adc_continuous.h"
+
+// Audio capture configuration
+#define AUDIO_SAMPLE_RATE_HZ    16000   // Microphone samples per second
+#define AUDIO_FFT_SIZE          256     // Samples per analysis frame: 16 ms, 62.5 Hz per bin
+#define AUDIO_BAND_COUNT        6       // Spectrum bands; thirds drive red, green and blue
+#define AUDIO_READ_CONVERSIONS  128     // ADC results per DMA frame, microphone and aux together
+#define AUDIO_MAX_AUX_CHANNELS  4       // Other ADC1 channels sampled between microphone samples
+
+typedef struct {
+    uint32_t frames;            // Frames analyzed
+    uint32_t overruns;          // DMA pool overflows (samples lost)
+    uint32_t analysis_avg_us;   // Window, FFT and band mapping of one frame
+    uint32_t analysis_max_us;
+} audio_input_stats_t;
+
+// Set up microphone capture on mic_channel of ADC1 in continuous mode.
+// ADC1 works in one mode at a time, so the aux channels (the pots) are
+// sampled in the same pattern as the microphone while capture runs; read
+// them with audio_input_read_aux instead of adc_oneshot_read.
+esp_err_t audio_input_init(adc_channel_t mic_channel, const adc_channel_t *aux_channels, int aux_count);
+
+// Start and stop sampling; call from the task that reads the aux channels
+esp_err_t audio_input_start(void);
+esp_err_t audio_input_stop(void);
+
+bool audio_input_is_running(void);
+
+// Latest band levels (AUDIO_BAND_COUNT, 0-255, lowest first); false while stopped
+bool audio_input_get_levels(uint8_t *levels);
+
+// Latest raw reading of an aux channel; ESP_ERR_INVALID_STATE while stopped
+esp_err_t audio_input_read_aux(adc_channel_t channel, int *raw);
+
+void audio_input_get_stats(audio_input_stats_t *stats);
+
+// Time one FFT and one full analysis of a test tone in ns, averaged over frames
+esp_err_t audio_input_benchmark(uint32_t frames, uint32_t *fft_ns, uint32_t *analysis_ns);
+
+#endif // AUDIO_INPUT_H
@@ -0,0 +1,43 @@
+#include "boot_profile.h"
+#include "main.h"
+#include "esp_timer.h"
+
+typedef struct {
+    const char *name;
+    int64_t time_us;
+} boot_milestone_t;
+
+static boot_milestone_t milestones[BOOT_PROFILE_MAX_MILESTONES];
+static int milestone_count = 0;
+static portMUX_TYPE milestone_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_profile_mark(const char *name)
+{
+    int64_t now = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&milestone_lock);
+    if (milestone_count < BOOT_PROFILE_MAX_MILESTONES) {
+        milestones[milestone_count].name = name;
+        milestones[milestone_count].time_us = now;
+        milestone_count++;
+    }
+    portEXIT_CRITICAL(&milestone_lock);
+}
+
+void boot_profile_report(void)
+{
+    boot_milestone_t copy[BOOT_PROFILE_MAX_MILESTONES];
+    int count;
+    
+    portENTER_CRITICAL(&milestone_lock);
+    count = milestone_count;
+    memcpy(copy, milestones, count * sizeof(copy[0]));
+    portEXIT_CRITICAL(&milestone_lock);
+    
+    ESP_LOGI(TAG, "Boot milestones (us since timer start):");
+    int64_t prev = 0;
+    for (int i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  %8lld  (+%7lld)  %s", copy[i].time_us, copy[i].time_us - prev, copy[i].name);
+        prev = copy[i].time_us;
+    }
+}
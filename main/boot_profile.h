@@ -0,0 +1,15 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+// Boot-time milestones, timestamped with esp_timer (microseconds since the
+// timer started, early in startup before app_main)
+
+#define BOOT_PROFILE_MAX_MILESTONES 16
+
+// Record a milestone; safe to call from any task. name must be a string literal.
+void boot_profile_mark(const char *name);
+
+// Log all milestones recorded so far with their times and deltas
+void boot_profile_report(void);
+
+#endif // BOOT_PROFILE_H
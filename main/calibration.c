@@ -0,0 +1,152 @@
+#include "calibration.h"
+#include <string.h>
+#include "main.h"
+#include "nvs.h"
+
+#define CALIBRATION_KEY      "calibration"
+#define CALIBRATION_STRIDE   LED_PIXEL_FORMAT_BYTES(LED_PIXEL_FORMAT)
+
+// What NVS holds; a blob of another size (strip length or format changed) is ignored
+typedef struct {
+    int16_t matrix[3][3];
+    bool pixel_gains;           // Per-LED gain table in use
+    uint8_t gains[LED_COUNT * CALIBRATION_STRIDE];
+} calibration_t;
+
+static calibration_t calibration;
+static led_strip_t *calibrated_strip = NULL;
+
+// The driver reads the gain table from the RMT interrupt while frames go
+// out, so it is never edited in place: each change is copied into the table
+// the strip is not using and that one is set
+static uint8_t strip_gains[2][LED_COUNT * CALIBRATION_STRIDE];
+static int strip_gains_set = 0;         // Table last given to the strip
+
+static void set_identity(void)
+{
+    memset(&calibration, 0, sizeof(calibration));
+    for (int i = 0; i < 3; i++) {
+        calibration.matrix[i][i] = LED_STRIP_COLOR_ONE;
+    }
+    memset(calibration.gains, 255, sizeof(calibration.gains));
+}
+
+static esp_err_t apply(void)
+{
+    led_strip_color_correction_t correction = LED_STRIP_COLOR_CORRECTION_NONE;
+    if (calibration.pixel_gains) {
+        // The table overwritten here is the one set before last. The strip
+        // still has it latched if it has not refreshed since, so a frame
+        // reading it must finish first; the next refresh latches the newer one.
+        calibrated_strip->wait_refresh_done(calibrated_strip, 100);
+        strip_gains_set ^= 1;
+        memcpy(strip_gains[strip_gains_set], calibration.gains, sizeof(calibration.gains));
+        correction.pixel_gains = strip_gains[strip_gains_set];
+    }
+    memcpy(correction.matrix, calibration.matrix, sizeof(correction.matrix));
+    return led_strip_ws2812_set_color_correction(calibrated_strip, &correction);
+}
+
+// Apply, then write to NVS right away: changes come from the console, one at a time
+static esp_err_t apply_and_save(void)
+{
+    if (!calibrated_strip) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = apply();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    nvs_handle_t nvs;
+    ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, CALIBRATION_KEY, &calibration, sizeof(calibration));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save calibration: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t calibration_init(led_strip_t *strip)
+{
+    calibrated_strip = strip;
+    set_identity();
+    
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return ESP_OK; // Nothing saved yet
+    }
+    size_t len = sizeof(calibration);
+    esp_err_t ret = nvs_get_blob(nvs, CALIBRATION_KEY, &calibration, &len);
+    nvs_close(nvs);
+    if (ret != ESP_OK || len != sizeof(calibration)) {
+        if (ret == ESP_OK || ret == ESP_ERR_NVS_INVALID_LENGTH) {
+            ESP_LOGW(TAG, "Saved calibration is for another strip; ignoring it");
+        }
+        set_identity();
+        return ESP_OK;
+    }
+    
+    ESP_LOGI(TAG, "Restored color calibration (%lu LEDs with own gains)",
+             (unsigned long)calibration_adjusted_pixels());
+    return apply();
+}
+
+esp_err_t calibration_set_matrix(const int16_t matrix[3][3])
+{
+    memcpy(calibration.matrix, matrix, sizeof(calibration.matrix));
+    return apply_and_save();
+}
+
+void calibration_get_matrix(int16_t matrix[3][3])
+{
+    memcpy(matrix, calibration.matrix, sizeof(calibration.matrix));
+}
+
+esp_err_t calibration_set_pixel_gain(uint32_t index, const uint8_t *gains)
+{
+    if (index >= LED_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(&calibration.gains[index * CALIBRATION_STRIDE], gains, CALIBRATION_STRIDE);
+    calibration.pixel_gains = true;
+    return apply_and_save();
+}
+
+bool calibration_get_pixel_gain(uint32_t index, uint8_t *gains)
+{
+    if (!calibration.pixel_gains || index >= LED_COUNT) {
+        return false;
+    }
+    memcpy(gains, &calibration.gains[index * CALIBRATION_STRIDE], CALIBRATION_STRIDE);
+    return true;
+}
+
+uint32_t calibration_adjusted_pixels(void)
+{
+    uint32_t count = 0;
+    if (!calibration.pixel_gains) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < LED_COUNT; i++) {
+        for (int c = 0; c < CALIBRATION_STRIDE; c++) {
+            if (calibration.gains[i * CALIBRATION_STRIDE + c] != 255) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+esp_err_t calibration_reset(void)
+{
+    set_identity();
+    return apply_and_save();
+}
@@ -0,0 +1,33 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip.h"
+
+// Color calibration of the main strip: a 3x3 matrix for white balance and
+// crosstalk, and optional per-LED gains for mismatched LEDs. Applied by the
+// strip driver as frames are sent and kept in NVS across restarts.
+
+// Load the saved calibration and apply it to the strip
+esp_err_t calibration_init(led_strip_t *strip);
+
+// Matrix in Q12 (LED_STRIP_COLOR_ONE = 1.0), rows for red, green and blue out
+esp_err_t calibration_set_matrix(const int16_t matrix[3][3]);
+void calibration_get_matrix(int16_t matrix[3][3]);
+
+// Gains of one LED in R, G, B(, W) order, 255 = unity. The first one set
+// turns on the per-LED gain table, with every other LED at unity.
+esp_err_t calibration_set_pixel_gain(uint32_t index, const uint8_t *gains);
+
+// Gains of one LED; returns false if the table is off or index is out of range
+bool calibration_get_pixel_gain(uint32_t index, uint8_t *gains);
+
+// Number of LEDs with a gain other than unity
+uint32_t calibration_adjusted_pixels(void);
+
+// Back to the identity matrix without per-LED gains
+esp_err_t calibration_reset(void);
+
+#endif // CALIBRATION_H
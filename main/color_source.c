@@ -0,0 +1,379 @@
+#include "color_source.h"
+#include "main.h"
+#include "esp_timer.h"
+#include "audio_input.h"
+
+// Potentiometer source
+typedef struct {
+    color_source_t base;
+    adc_oneshot_unit_handle_t adc1_handle;
+    color_rgb_t last;
+    color_rgb_t takeover;       // Pot positions when the held color was synced
+    bool holding;
+    bool started;
+} pots_source_t;
+
+static void pots_sample(pots_source_t *pots, color_rgb_t *color)
+{
+    color->r = read_potentiometer(pots->adc1_handle, RED_POT_ADC_CHANNEL);
+    color->g = read_potentiometer(pots->adc1_handle, GREEN_POT_ADC_CHANNEL);
+    color->b = read_potentiometer(pots->adc1_handle, BLUE_POT_ADC_CHANNEL);  // Use the fixed channel from main.h
+}
+
+static bool pots_read(color_source_t *source, color_rgb_t *color)
+{
+    pots_source_t *pots = __containerof(source, pots_source_t, base);
+    color_rgb_t sample;
+    pots_sample(pots, &sample);
+    
+    // Soft takeover: pots are absolute, so they only replace a color set
+    // elsewhere once one of them is actually turned
+    if (pots->holding) {
+        if (abs(sample.r - pots->takeover.r) < POT_TAKEOVER_THRESHOLD &&
+            abs(sample.g - pots->takeover.g) < POT_TAKEOVER_THRESHOLD &&
+            abs(sample.b - pots->takeover.b) < POT_TAKEOVER_THRESHOLD) {
+            return false;
+        }
+        pots->holding = false;
+        ESP_LOGI(TAG, "Pots took over from held color");
+    }
+    
+    if (pots->started && sample.r == pots->last.r && sample.g == pots->last.g && sample.b == pots->last.b) {
+        return false;
+    }
+    pots->started = true;
+    pots->last = sample;
+    *color = sample;
+    return true;
+}
+
+static void pots_sync(color_source_t *source, const color_rgb_t *current)
+{
+    pots_source_t *pots = __containerof(source, pots_source_t, base);
+    
+    // Keep the original positions while already holding, so slow turns still add up
+    if (!pots->holding) {
+        pots_sample(pots, &pots->takeover);
+        pots->holding = true;
+    }
+    pots->last = *current;
+    pots->started = true;
+}
+
+color_source_t *color_source_new_pots(adc_oneshot_unit_handle_t adc1_handle)
+{
+    pots_source_t *pots = calloc(1, sizeof(pots_source_t));
+    if (!pots) {
+        return NULL;
+    }
+    pots->adc1_handle = adc1_handle;
+    pots->base.name = "pots";
+    pots->base.read = pots_read;
+    pots->base.sync = pots_sync;
+    return &pots->base;
+}
+
+// Encoder source
+typedef struct {
+    color_source_t base;
+    encoder_handle_t encoders[3];
+    color_rgb_t last;
+    bool started;
+} encoders_source_t;
+
+static bool encoders_read(color_source_t *source, color_rgb_t *color)
+{
+    encoders_source_t *enc = __containerof(source, encoders_source_t, base);
+    color_rgb_t sample = {
+        .r = (uint8_t)encoder_read(enc->encoders[0]),
+        .g = (uint8_t)encoder_read(enc->encoders[1]),
+        .b = (uint8_t)encoder_read(enc->encoders[2]),
+    };
+    
+    if (enc->started && sample.r == enc->last.r && sample.g == enc->last.g && sample.b == enc->last.b) {
+        return false;
+    }
+    enc->started = true;
+    enc->last = sample;
+    *color = sample;
+    return true;
+}
+
+static void encoders_sync(color_source_t *source, const color_rgb_t *current)
+{
+    encoders_source_t *enc = __containerof(source, encoders_source_t, base);
+    
+    // Encoders are relative; the next turn continues from the shown color
+    encoder_set_value(enc->encoders[0], current->r);
+    encoder_set_value(enc->encoders[1], current->g);
+    encoder_set_value(enc->encoders[2], current->b);
+    enc->last = *current;
+    enc->started = true;
+}
+
+color_source_t *color_source_new_encoders(encoder_handle_t red, encoder_handle_t green, encoder_handle_t blue)
+{
+    if (!red || !green || !blue) {
+        return NULL;
+    }
+    encoders_source_t *enc = calloc(1, sizeof(encoders_source_t));
+    if (!enc) {
+        return NULL;
+    }
+    enc->encoders[0] = red;
+    enc->encoders[1] = green;
+    enc->encoders[2] = blue;
+    enc->base.name = "encoders";
+    enc->base.read = encoders_read;
+    enc->base.sync = encoders_sync;
+    return &enc->base;
+}
+
+// Mailbox source: preset recall and serial commands post colors from other tasks
+typedef struct {
+    color_source_t base;
+    portMUX_TYPE lock;
+    color_rgb_t color;
+    color_effect_t effect;          // Posted with color (presets only)
+    uint8_t effect_speed;
+    bool pending;
+    color_effect_t read_effect;     // Came with the color the last read returned
+    uint8_t read_speed;
+} mailbox_source_t;
+
+static bool mailbox_read(color_source_t *source, color_rgb_t *color)
+{
+    mailbox_source_t *mailbox = __containerof(source, mailbox_source_t, base);
+    bool pending;
+    
+    portENTER_CRITICAL(&mailbox->lock);
+    pending = mailbox->pending;
+    if (pending) {
+        *color = mailbox->color;
+        mailbox->read_effect = mailbox->effect;
+        mailbox->read_speed = mailbox->effect_speed;
+        mailbox->pending = false;
+    }
+    portEXIT_CRITICAL(&mailbox->lock);
+    return pending;
+}
+
+static void mailbox_sync(color_source_t *source, const color_rgb_t *current)
+{
+    // Nothing to follow; the next posted color replaces whatever is shown
+}
+
+static void mailbox_post(color_source_t *source, const color_rgb_t *color, color_effect_t effect, uint8_t speed)
+{
+    mailbox_source_t *mailbox = __containerof(source, mailbox_source_t, base);
+    
+    portENTER_CRITICAL(&mailbox->lock);
+    mailbox->color = *color;
+    mailbox->effect = effect;
+    mailbox->effect_speed = speed;
+    mailbox->pending = true;
+    portEXIT_CRITICAL(&mailbox->lock);
+}
+
+static color_source_t *mailbox_new(const char *name)
+{
+    mailbox_source_t *mailbox = calloc(1, sizeof(mailbox_source_t));
+    if (!mailbox) {
+        return NULL;
+    }
+    portMUX_INITIALIZE(&mailbox->lock);
+    mailbox->base.name = name;
+    mailbox->base.read = mailbox_read;
+    mailbox->base.sync = mailbox_sync;
+    return &mailbox->base;
+}
+
+color_source_t *color_source_new_preset(void)
+{
+    return mailbox_new("preset");
+}
+
+void color_source_preset_set(color_source_t *source, const color_rgb_t *color, color_effect_t effect, uint8_t speed)
+{
+    mailbox_post(source, color, effect, speed);
+}
+
+void color_source_preset_get_effect(color_source_t *source, color_effect_t *effect, uint8_t *speed)
+{
+    mailbox_source_t *mailbox = __containerof(source, mailbox_source_t, base);
+    *effect = mailbox->read_effect;
+    *speed = mailbox->read_speed;
+}
+
+color_source_t *color_source_new_serial(void)
+{
+    return mailbox_new("serial");
+}
+
+void color_source_serial_push(color_source_t *source, const color_rgb_t *color)
+{
+    mailbox_post(source, color, EFFECT_NONE, 0);
+}
+
+// Effect source
+#define EFFECT_PERIOD_SLOW_MS  30000   // Cycle time at speed 0
+#define EFFECT_PERIOD_FAST_MS  1000    // Cycle time at speed 255
+#define EFFECT_HUE_RANGE       1536    // 6 sectors of 256
+
+typedef struct {
+    color_source_t base;
+    portMUX_TYPE lock;
+    color_effect_t effect;
+    uint32_t period_ms;
+    color_rgb_t base_color;
+    uint16_t base_hue;
+    uint8_t base_sat;
+    uint8_t base_val;
+    int64_t start_us;
+    color_rgb_t last;
+} effect_source_t;
+
+static color_rgb_t hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val)
+{
+    uint8_t frac = hue & 0xFF;
+    uint8_t p = val * (255 - sat) / 255;
+    uint8_t q = val * (255 - sat * frac / 255) / 255;
+    uint8_t t = val * (255 - sat * (255 - frac) / 255) / 255;
+    
+    switch ((hue >> 8) % 6) {
+    case 0:  return (color_rgb_t){ val, t, p };
+    case 1:  return (color_rgb_t){ q, val, p };
+    case 2:  return (color_rgb_t){ p, val, t };
+    case 3:  return (color_rgb_t){ p, q, val };
+    case 4:  return (color_rgb_t){ t, p, val };
+    default: return (color_rgb_t){ val, p, q };
+    }
+}
+
+static void rgb_to_hsv(const color_rgb_t *rgb, uint16_t *hue, uint8_t *sat, uint8_t *val)
+{
+    int max = rgb->r > rgb->g ? (rgb->r > rgb->b ? rgb->r : rgb->b) : (rgb->g > rgb->b ? rgb->g : rgb->b);
+    int min = rgb->r < rgb->g ? (rgb->r < rgb->b ? rgb->r : rgb->b) : (rgb->g < rgb->b ? rgb->g : rgb->b);
+    int delta = max - min;
+    int h = 0;
+    
+    if (delta > 0) {
+        if (max == rgb->r) {
+            h = (rgb->g - rgb->b) * 256 / delta;
+        } else if (max == rgb->g) {
+            h = 512 + (rgb->b - rgb->r) * 256 / delta;
+        } else {
+            h = 1024 + (rgb->r - rgb->g) * 256 / delta;
+        }
+        if (h < 0) {
+            h += EFFECT_HUE_RANGE;
+        }
+    }
+    *hue = (uint16_t)h;
+    *sat = max ? (uint8_t)(delta * 255 / max) : 0;
+    *val = (uint8_t)max;
+}
+
+// Loudest band of each third of the spectrum: bass, mids, treble
+static color_rgb_t audio_to_rgb(const uint8_t *levels)
+{
+    uint8_t rgb[3] = { 0 };
+    for (int i = 0; i < AUDIO_BAND_COUNT; i++) {
+        uint8_t *channel = &rgb[i * 3 / AUDIO_BAND_COUNT];
+        if (levels[i] > *channel) {
+            *channel = levels[i];
+        }
+    }
+    return (color_rgb_t){ rgb[0], rgb[1], rgb[2] };
+}
+
+static bool effect_read(color_source_t *source, color_rgb_t *color)
+{
+    effect_source_t *fx = __containerof(source, effect_source_t, base);
+    color_rgb_t out;
+    
+    // Taken before the effect lock; it has its own
+    uint8_t levels[AUDIO_BAND_COUNT] = { 0 };
+    audio_input_get_levels(levels);
+    
+    portENTER_CRITICAL(&fx->lock);
+    int64_t elapsed_ms = (esp_timer_get_time() - fx->start_us) / 1000;
+    uint32_t phase = (uint32_t)((elapsed_ms % fx->period_ms) * 65536 / fx->period_ms); // Q16
+    
+    switch (fx->effect) {
+    case EFFECT_HUE_CYCLE:
+        // Grays have no hue to rotate; cycle fully saturated colors at their brightness
+        out = hsv_to_rgb((fx->base_hue + phase * EFFECT_HUE_RANGE / 65536) % EFFECT_HUE_RANGE,
+                         fx->base_sat ? fx->base_sat : 255, fx->base_val);
+        break;
+    case EFFECT_BREATHE: {
+        // Triangle wave between 1/8 and full brightness
+        uint32_t level = phase < 32768 ? phase * 2 : (65535 - phase) * 2;
+        level = 8192 + (level * 7 >> 3);
+        out.r = (uint8_t)((fx->base_color.r * level) >> 16);
+        out.g = (uint8_t)((fx->base_color.g * level) >> 16);
+        out.b = (uint8_t)((fx->base_color.b * level) >> 16);
+        break;
+    }
+    case EFFECT_AUDIO:
+        // Follows the music at full range; the speed and base color are not used
+        out = audio_to_rgb(levels);
+        break;
+    default:
+        out = fx->base_color;
+        break;
+    }
+    portEXIT_CRITICAL(&fx->lock);
+    
+    if (out.r == fx->last.r && out.g == fx->last.g && out.b == fx->last.b) {
+        return false;
+    }
+    fx->last = out;
+    *color = out;
+    return true;
+}
+
+static void effect_sync(color_source_t *source, const color_rgb_t *current)
+{
+    // Effects run from their own base color
+}
+
+color_source_t *color_source_new_effect(void)
+{
+    effect_source_t *fx = calloc(1, sizeof(effect_source_t));
+    if (!fx) {
+        return NULL;
+    }
+    portMUX_INITIALIZE(&fx->lock);
+    fx->effect = EFFECT_NONE;
+    fx->period_ms = EFFECT_PERIOD_SLOW_MS;
+    fx->base.name = "effect";
+    fx->base.read = effect_read;
+    fx->base.sync = effect_sync;
+    return &fx->base;
+}
+
+void color_source_effect_set(color_source_t *source, color_effect_t effect, uint8_t speed, const color_rgb_t *base)
+{
+    effect_source_t *fx = __containerof(source, effect_source_t, base);
+    
+    // The microphone is only sampled while the audio effect runs
+    if (effect == EFFECT_AUDIO) {
+        esp_err_t ret = audio_input_start();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Audio input unavailable (%s), showing the base color", esp_err_to_name(ret));
+            effect = EFFECT_NONE;
+        }
+    } else {
+        audio_input_stop();
+    }
+    
+    portENTER_CRITICAL(&fx->lock);
+    fx->effect = effect < EFFECT_COUNT ? effect : EFFECT_NONE;
+    fx->period_ms = EFFECT_PERIOD_SLOW_MS - (uint32_t)speed * (EFFECT_PERIOD_SLOW_MS - EFFECT_PERIOD_FAST_MS) / 255;
+    fx->base_color = *base;
+    rgb_to_hsv(base, &fx->base_hue, &fx->base_sat, &fx->base_val);
+    fx->start_us = esp_timer_get_time();
+    fx->last.r = ~base->r; // Force the first read to report
+    portEXIT_CRITICAL(&fx->lock);
+}
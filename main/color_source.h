@@ -0,0 +1,76 @@
+#ifndef COLOR_SOURCE_H
+#define COLOR_SOURCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_adc/adc_oneshot.h"
+#include "encoder.h"
+
+// An 8-bit sRGB color
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} color_rgb_t;
+
+// Effects run by the effect source (stored in picker_state_t.effect)
+typedef enum {
+    EFFECT_NONE = 0,            // Static color
+    EFFECT_HUE_CYCLE,           // Rotate the hue of the base color
+    EFFECT_BREATHE,             // Fade the base color up and down
+    EFFECT_AUDIO,               // Spectrum of the audio input: bass red, mids green, treble blue
+    EFFECT_COUNT,
+} color_effect_t;
+
+typedef struct color_source_s color_source_t;
+
+// A producer of target colors. Sources are polled by the main loop; the
+// transition engine fades between the colors they produce.
+struct color_source_s {
+    const char *name;
+    
+    /**
+    * @brief Sample the source
+    *
+    * @param source: color source
+    * @param color: receives the new target color
+    * @return
+    *      - true: the source produced a new color
+    *      - false: nothing new
+    */
+    bool (*read)(color_source_t *source, color_rgb_t *color);
+    
+    /**
+    * @brief Another source changed the color; continue from it
+    *
+    * @param source: color source
+    * @param current: color now being shown
+    */
+    void (*sync)(color_source_t *source, const color_rgb_t *current);
+};
+
+// Potentiometers; after a sync the synced color is held until a pot is turned
+color_source_t *color_source_new_pots(adc_oneshot_unit_handle_t adc1_handle);
+
+// Rotary encoders for red, green and blue
+color_source_t *color_source_new_encoders(encoder_handle_t red, encoder_handle_t green, encoder_handle_t blue);
+
+// A fixed color set from another task, e.g. a recalled preset, with the
+// effect to run on it (EFFECT_NONE for a static color). Color and effect are
+// posted together, so the main loop never sees one without the other.
+color_source_t *color_source_new_preset(void);
+void color_source_preset_set(color_source_t *source, const color_rgb_t *color, color_effect_t effect, uint8_t speed);
+
+// Effect posted with the color the last read returned (main loop only)
+void color_source_preset_get_effect(color_source_t *source, color_effect_t *effect, uint8_t *speed);
+
+// Animated effects based on a color. Set effects from the main loop: the
+// audio effect switches ADC1, which the pots are read from, to audio capture.
+color_source_t *color_source_new_effect(void);
+void color_source_effect_set(color_source_t *source, color_effect_t effect, uint8_t speed, const color_rgb_t *base);
+
+// Colors pushed by a serial command stream
+color_source_t *color_source_new_serial(void);
+void color_source_serial_push(color_source_t *source, const color_rgb_t *color);
+
+#endif // COLOR_SOURCE_H
@@ -0,0 +1,427 @@
+#include "console.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include "main.h"
+#include "calibration.h"
+#include "sequence.h"
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "perf.h"
+#include "trace.h"
+
+typedef struct {
+    const char *name;
+    volatile bool *flag;
+    const char *help;
+} console_toggle_t;
+
+static console_toggle_t toggles[CONSOLE_MAX_TOGGLES];
+static int toggle_count = 0;
+static uint32_t baseline_free = 0;      // Free heap once startup finished, 0 until marked
+
+esp_err_t console_register_toggle(const char *name, volatile bool *flag, const char *help)
+{
+    if (toggle_count >= CONSOLE_MAX_TOGGLES) {
+        return ESP_ERR_NO_MEM;
+    }
+    toggles[toggle_count++] = (console_toggle_t){ name, flag, help };
+    return ESP_OK;
+}
+
+// perf [reset]: per-stage timing histograms and frame counters
+static int cmd_perf(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        perf_reset();
+        printf("Counters cleared\n");
+        return 0;
+    }
+    
+    for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+        perf_stage_stats_t s;
+        perf_get_stage(i, &s);
+        printf("%-15s n=%-8lu avg=%-6lu max=%lu us\n", perf_stage_name(i), (unsigned long)s.count,
+               (unsigned long)(s.count ? s.total_us / s.count : 0), (unsigned long)s.max_us);
+        if (s.count == 0) {
+            continue;
+        }
+        // One row per occupied bucket: upper bound and a bar scaled to the largest bucket
+        uint32_t peak = 0;
+        for (int b = 0; b < PERF_HIST_BUCKETS; b++) {
+            if (s.buckets[b] > peak) {
+                peak = s.buckets[b];
+            }
+        }
+        for (int b = 0; b < PERF_HIST_BUCKETS; b++) {
+            if (s.buckets[b] == 0) {
+                continue;
+            }
+            char bar[41];
+            int len = (int)((uint64_t)s.buckets[b] * 40 / peak);
+            memset(bar, '#', len);
+            bar[len] = '\0';
+            if (b == PERF_HIST_BUCKETS - 1) {
+                printf("  >=%6lu us %8lu %s\n", 1UL << b, (unsigned long)s.buckets[b], bar);
+            } else {
+                printf("  < %6lu us %8lu %s\n", 2UL << b, (unsigned long)s.buckets[b], bar);
+            }
+        }
+    }
+    
+    printf("\n");
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        printf("%-18s %lu\n", perf_counter_name(i), (unsigned long)perf_get_counter(i));
+    }
+    return 0;
+}
+
+// heap: current and lowest free memory
+static int cmd_heap(int argc, char **argv)
+{
+    printf("free:          %lu bytes\n", (unsigned long)esp_get_free_heap_size());
+    printf("minimum free:  %lu bytes\n", (unsigned long)esp_get_minimum_free_heap_size());
+    printf("largest block: %lu bytes\n", (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    printf("internal free: %lu bytes (minimum %lu)\n",
+           (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+           (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    if (baseline_free) {
+        // Stays at zero when nothing allocates after startup (static memory mode)
+        printf("since startup: %ld bytes\n", (long)baseline_free - (long)esp_get_free_heap_size());
+    }
+    return 0;
+}
+
+// tasks: stack high-water marks and CPU load since the previous call
+static int cmd_tasks(int argc, char **argv)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    static TaskStatus_t status[CONSOLE_MAX_TASKS];
+    static struct {
+        TaskHandle_t handle;
+        uint32_t runtime;
+    } previous[CONSOLE_MAX_TASKS];
+    static int previous_count = 0;
+    static uint32_t previous_total = 0;
+    
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, CONSOLE_MAX_TASKS, &total);
+    if (count == 0) {
+        printf("More than %d tasks\n", CONSOLE_MAX_TASKS);
+        return 1;
+    }
+    
+    uint32_t elapsed = total - previous_total;
+    uint32_t idle = 0;
+    static const char states[] = "XRBSD?";
+    printf("%-16s %c %4s %6s %5s\n", "task", 'S', "prio", "stack", "cpu%");
+    for (UBaseType_t i = 0; i < count; i++) {
+        uint32_t delta = status[i].ulRunTimeCounter;
+        for (int p = 0; p < previous_count; p++) {
+            if (previous[p].handle == status[i].xHandle) {
+                delta -= previous[p].runtime;
+                break;
+            }
+        }
+        // Run time is summed over both cores, so a busy task on one core shows 50%
+        uint32_t pct10 = elapsed ? (uint32_t)((uint64_t)delta * 1000 / elapsed / portNUM_PROCESSORS) : 0;
+        if (strncmp(status[i].pcTaskName, "IDLE", 4) == 0) {
+            idle += pct10;
+        }
+        printf("%-16s %c %4u %6lu %3lu.%lu\n", status[i].pcTaskName,
+               states[status[i].eCurrentState < 5 ? status[i].eCurrentState : 5],
+               (unsigned)status[i].uxCurrentPriority, (unsigned long)status[i].usStackHighWaterMark,
+               (unsigned long)(pct10 / 10), (unsigned long)(pct10 % 10));
+    }
+    printf("CPU load: %lu.%lu%%\n", (unsigned long)((1000 - idle) / 10), (unsigned long)((1000 - idle) % 10));
+    
+    for (UBaseType_t i = 0; i < count; i++) {
+        previous[i].handle = status[i].xHandle;
+        previous[i].runtime = status[i].ulRunTimeCounter;
+    }
+    previous_count = count;
+    previous_total = total;
+    return 0;
+#else
+    printf("Enable CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS\n");
+    return 1;
+#endif
+}
+
+// set [name on|off]: list or change runtime switches
+static int cmd_set(int argc, char **argv)
+{
+    if (argc == 1) {
+        for (int i = 0; i < toggle_count; i++) {
+            printf("%-16s %-3s  %s\n", toggles[i].name, *toggles[i].flag ? "on" : "off", toggles[i].help);
+        }
+        return 0;
+    }
+    if (argc != 3) {
+        printf("Usage: set [name on|off]\n");
+        return 1;
+    }
+    
+    for (int i = 0; i < toggle_count; i++) {
+        if (strcmp(argv[1], toggles[i].name) == 0) {
+            if (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "1") == 0) {
+                *toggles[i].flag = true;
+            } else if (strcmp(argv[2], "off") == 0 || strcmp(argv[2], "0") == 0) {
+                *toggles[i].flag = false;
+            } else {
+                printf("Expected on or off\n");
+                return 1;
+            }
+            printf("%s %s\n", toggles[i].name, *toggles[i].flag ? "on" : "off");
+            return 0;
+        }
+    }
+    printf("Unknown switch '%s'\n", argv[1]);
+    return 1;
+}
+
+// log <tag|*> <level>: change log verbosity at runtime
+static int cmd_log(int argc, char **argv)
+{
+    static const char *const levels[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    if (argc != 3) {
+        printf("Usage: log <tag|*> <none|error|warn|info|debug|verbose>\n");
+        return 1;
+    }
+    for (int i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (strcmp(argv[2], levels[i]) == 0) {
+            esp_log_level_set(argv[1], (esp_log_level_t)i);
+            return 0;
+        }
+    }
+    printf("Unknown level '%s'\n", argv[2]);
+    return 1;
+}
+
+#if TRACE_ENABLED
+static void write_stdout(const char *text, size_t len, void *ctx)
+{
+    fwrite(text, 1, len, stdout);
+}
+#endif
+
+// trace start|stop|dump: capture spans and print them as Chrome trace JSON
+static int cmd_trace(int argc, char **argv)
+{
+#if TRACE_ENABLED
+    if (argc > 1 && strcmp(argv[1], "start") == 0) {
+        trace_start();
+    } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        trace_stop();
+    } else if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        trace_stop();
+        // Markers let trace_capture.py cut the JSON out of the console output
+        printf("--- trace begin ---\n");
+        uint32_t count = trace_export_chrome(write_stdout, NULL);
+        printf("--- trace end ---\n%lu spans\n", (unsigned long)count);
+        return 0;
+    } else if (argc > 1) {
+        printf("Usage: trace [start|stop|dump]\n");
+        return 1;
+    }
+    
+    trace_stats_t stats;
+    trace_get_stats(&stats);
+    printf("%s: %lu spans in %lu ms, %lu dropped\n", stats.active ? "recording" : "stopped",
+           (unsigned long)stats.events, (unsigned long)(stats.duration_us / 1000), (unsigned long)stats.dropped);
+    return 0;
+#else
+    printf("Tracing is not built in (menuconfig: Component config > Trace)\n");
+    return 1;
+#endif
+}
+
+bool console_parse_int(const char *arg, long min, long max, long *value)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno == ERANGE || v < min || v > max) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+bool console_parse_float(const char *arg, float min, float max, float *value)
+{
+    char *end;
+    float v = strtof(arg, &end);
+    if (end == arg || *end != '\0' || !(v >= min && v <= max)) {     // NaN fails the range too
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+// calib [matrix a..i | wb r g b | pixel i r g b [w] | reset]: color calibration of the strip
+static int cmd_calib(int argc, char **argv)
+{
+    int16_t matrix[3][3];
+    calibration_get_matrix(matrix);
+    esp_err_t ret = ESP_OK;
+    if (argc == 11 && strcmp(argv[1], "matrix") == 0) {
+        for (int i = 0; i < 9; i++) {
+            float value;
+            if (!console_parse_float(argv[2 + i], -7.9f, 7.9f, &value)) {
+                printf("Coefficients must be numbers within -7.9 and 7.9\n");
+                return 1;
+            }
+            matrix[i / 3][i % 3] = (int16_t)lroundf(value * LED_STRIP_COLOR_ONE);
+        }
+        ret = calibration_set_matrix(matrix);
+    } else if (argc == 5 && strcmp(argv[1], "wb") == 0) {
+        // Scale whole rows, so crosstalk terms keep their proportion to the channel
+        for (int row = 0; row < 3; row++) {
+            long percent;
+            if (!console_parse_int(argv[2 + row], 0, 200, &percent)) {
+                printf("White balance is 0-200%%\n");
+                return 1;
+            }
+            for (int col = 0; col < 3; col++) {
+                int32_t value = matrix[row][col] * percent / 100;
+                matrix[row][col] = (int16_t)(value > INT16_MAX ? INT16_MAX : value < -INT16_MAX ? -INT16_MAX : value);
+            }
+        }
+        ret = calibration_set_matrix(matrix);
+    } else if ((argc == 6 || argc == 7) && strcmp(argv[1], "pixel") == 0) {
+        long index;
+        if (!console_parse_int(argv[2], 0, LED_COUNT - 1, &index)) {
+            printf("LED index is 0-%d\n", LED_COUNT - 1);
+            return 1;
+        }
+        uint8_t gains[4] = { 255, 255, 255, 255 };
+        for (int c = 0; c < argc - 3; c++) {
+            long gain;
+            if (!console_parse_int(argv[3 + c], 0, 255, &gain)) {
+                printf("Gains are 0-255 (255 = unity)\n");
+                return 1;
+            }
+            gains[c] = (uint8_t)gain;
+        }
+        ret = calibration_set_pixel_gain((uint32_t)index, gains);
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        ret = calibration_reset();
+    } else if (argc != 1) {
+        printf("Usage: calib [matrix a b c d e f g h i | wb r%% g%% b%% | pixel i r g b [w] | reset]\n");
+        return 1;
+    }
+    if (ret != ESP_OK) {
+        printf("Failed: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    
+    calibration_get_matrix(matrix);
+    for (int row = 0; row < 3; row++) {
+        printf("%s %6.3f %6.3f %6.3f\n", row == 0 ? "matrix" : "      ", matrix[row][0] / (float)LED_STRIP_COLOR_ONE,
+               matrix[row][1] / (float)LED_STRIP_COLOR_ONE, matrix[row][2] / (float)LED_STRIP_COLOR_ONE);
+    }
+    printf("%lu of %d LEDs with own gains\n", (unsigned long)calibration_adjusted_pixels(), LED_COUNT);
+    return 0;
+}
+
+// seq [play <n> [loop] | stop | record | save [name] | erase]: sequences in flash
+static int cmd_seq(int argc, char **argv)
+{
+    esp_err_t ret = ESP_OK;
+    if ((argc == 3 || (argc == 4 && strcmp(argv[3], "loop") == 0)) && strcmp(argv[1], "play") == 0) {
+        long index;
+        if (!console_parse_int(argv[2], 0, sequence_count() - 1, &index)) {
+            printf("No sequence %s (%d stored)\n", argv[2], sequence_count());
+            return 1;
+        }
+        const led_sequence_header_t *header = sequence_get(index);
+        ret = sequence_play(index, argc == 4 || (header->flags & LED_SEQUENCE_FLAG_LOOP));
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        sequence_stop();
+        return 0;
+    } else if (argc == 2 && strcmp(argv[1], "record") == 0) {
+        ret = sequence_record_start();
+    } else if (argc <= 3 && argc >= 2 && strcmp(argv[1], "save") == 0) {
+        char name[LED_SEQUENCE_NAME_LEN];
+        if (argc == 3) {
+            strlcpy(name, argv[2], sizeof(name));
+        } else {
+            snprintf(name, sizeof(name), "recording %d", sequence_count());
+        }
+        ret = sequence_record_save(name);
+    } else if (argc == 2 && strcmp(argv[1], "erase") == 0) {
+        ret = sequence_erase_all();
+    } else if (argc != 1) {
+        printf("Usage: seq [play <n> [loop] | stop | record | save [name] | erase]\n");
+        return 1;
+    }
+    if (ret != ESP_OK) {
+        printf("Failed: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    if (argc > 1) {
+        return 0;
+    }
+    
+    for (int i = 0; i < sequence_count(); i++) {
+        const led_sequence_header_t *h = sequence_get(i);
+        printf("%2d %-16s %5lu frames %4u px %6.1f s %3u Hz %6lu bytes%s\n", i, h->name,
+               (unsigned long)h->frame_count, h->pixel_count, h->duration_ms / 1000.0f, h->frame_rate_hz,
+               (unsigned long)h->data_size, h->flags & LED_SEQUENCE_FLAG_LOOP ? " loop" : "");
+    }
+    printf("%d sequence(s), %lu KB free%s\n", sequence_count(), (unsigned long)(sequence_free_space() / 1024),
+           sequence_is_playing() ? ", playing" : sequence_is_recording() ? ", recording" : "");
+    return 0;
+}
+
+void console_mark_heap_baseline(void)
+{
+    baseline_free = esp_get_free_heap_size();
+}
+
+esp_err_t console_start(void)
+{
+    const esp_console_cmd_t commands[] = {
+        { .command = "perf", .help = "Stage timing histograms and frame counters ('perf reset' clears)", .func = cmd_perf },
+        { .command = "heap", .help = "Free heap, its low-water mark and growth since startup", .func = cmd_heap },
+        { .command = "tasks", .help = "Task states, stack high-water marks and CPU load since the last call", .func = cmd_tasks },
+        { .command = "set", .help = "List runtime switches, or 'set <name> on|off'", .func = cmd_set },
+        { .command = "log", .help = "Set log level: 'log <tag|*> <level>'", .func = cmd_log },
+        { .command = "trace", .help = "Span capture for Perfetto: 'trace [start|stop|dump]'", .func = cmd_trace },
+        { .command = "calib", .help = "Strip color calibration: 'calib [matrix ... | wb r g b | pixel i r g b [w] | reset]'", .func = cmd_calib },
+        { .command = "seq", .help = "Sequences in flash: 'seq [play <n> [loop] | stop | record | save [name] | erase]'", .func = cmd_seq },
+    };
+    
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "picker>";
+    
+    esp_err_t ret;
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_uart(&hw_config, &repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_CDC
+    esp_console_dev_usb_cdc_config_t hw_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl);
+#else
+    ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Console REPL failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    esp_console_register_help_command();
+    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        ret = esp_console_cmd_register(&commands[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return esp_console_start_repl(repl);
+}
@@ -0,0 +1,24 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define CONSOLE_MAX_TOGGLES  8       // Runtime switches registered with console_register_toggle
+#define CONSOLE_MAX_TASKS    32      // Tasks tracked for CPU load
+
+// Register a runtime switch shown and changed by "set <name> on|off"
+esp_err_t console_register_toggle(const char *name, volatile bool *flag, const char *help);
+
+// Command arguments: the whole of arg must be a decimal number within
+// [min, max], or false is returned and value left alone
+bool console_parse_int(const char *arg, long min, long max, long *value);
+bool console_parse_float(const char *arg, float min, float max, float *value);
+
+// Record free heap at the end of startup; "heap" then reports what was taken since
+void console_mark_heap_baseline(void);
+
+// Register the built-in commands (perf, heap, tasks, set, log, trace, calib, seq) and start the REPL
+esp_err_t console_start(void);
+
+#endif // CONSOLE_H
@@ -0,0 +1,206 @@
+#include "display_governor.h"
+#include "main.h"
+#include "esp_timer.h"
+
+// Only the newest color is kept. Submitting never blocks: the governor task
+// draws right away when the frame interval has passed, and otherwise arms a
+// one-shot timer for the end of the interval (the trailing edge), so the
+// value a knob stops on is always the one left on screen.
+//
+// The interval follows the measured frame time, keeping display traffic to
+// DISPLAY_GOVERNOR_BUS_DUTY_PCT of the bus, and backs off while the CPU is
+// busy so the display never competes with the LEDs.
+
+static portMUX_TYPE governor_lock = portMUX_INITIALIZER_UNLOCKED;
+static color_rgb_t pending_color;
+static bool pending = false;
+static bool paused = false;
+static display_governor_stats_t stats;
+
+static display_render_t render_cb;
+static void *render_ctx;
+static TaskHandle_t governor_task_handle = NULL;
+static esp_timer_handle_t flush_timer = NULL;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// CPU load of this core since the last sample, from the idle task's run time
+static uint8_t sample_cpu_load(void)
+{
+    static configRUN_TIME_COUNTER_TYPE last_idle, last_total;
+    configRUN_TIME_COUNTER_TYPE idle = ulTaskGetIdleRunTimeCounter();
+    configRUN_TIME_COUNTER_TYPE total = portGET_RUN_TIME_COUNTER_VALUE();
+    configRUN_TIME_COUNTER_TYPE idle_delta = idle - last_idle;
+    configRUN_TIME_COUNTER_TYPE total_delta = total - last_total;
+    last_idle = idle;
+    last_total = total;
+    
+    if (total_delta == 0 || idle_delta >= total_delta) {
+        return 0;
+    }
+    return 100 - (uint8_t)((uint64_t)idle_delta * 100 / total_delta);
+}
+#else
+static uint8_t sample_cpu_load(void)
+{
+    return 0;
+}
+#endif
+
+// Fit the frame interval to the last frame time and the CPU load
+static void adapt_interval(uint32_t frame_us)
+{
+    uint32_t avg_us = stats.flush_avg_us ? (stats.flush_avg_us * 7 + frame_us) / 8 : frame_us;
+    uint8_t load = sample_cpu_load();
+    uint32_t interval_ms = stats.interval_ms;
+    
+    uint32_t target_ms = avg_us * 100 / DISPLAY_GOVERNOR_BUS_DUTY_PCT / 1000;
+    if (load > DISPLAY_GOVERNOR_BUSY_LOAD_PCT && target_ms < interval_ms * 2) {
+        target_ms = interval_ms * 2;
+    }
+    if (target_ms < DISPLAY_GOVERNOR_MIN_INTERVAL_MS) {
+        target_ms = DISPLAY_GOVERNOR_MIN_INTERVAL_MS;
+    } else if (target_ms > DISPLAY_GOVERNOR_MAX_INTERVAL_MS) {
+        target_ms = DISPLAY_GOVERNOR_MAX_INTERVAL_MS;
+    }
+    
+    // Back off at once, speed up gradually so one fast frame doesn't undo it
+    if (target_ms < interval_ms) {
+        target_ms = (interval_ms * 3 + target_ms) / 4;
+    }
+    
+    portENTER_CRITICAL(&governor_lock);
+    stats.flush_avg_us = avg_us;
+    stats.cpu_load_pct = load;
+    stats.interval_ms = target_ms;
+    portEXIT_CRITICAL(&governor_lock);
+}
+
+static void governor_task(void *pvParameter)
+{
+    int64_t last_frame_us = 0;
+    
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        // Inside the interval: the timer brings us back for the newest color
+        int64_t now = esp_timer_get_time();
+        int64_t wait_us = last_frame_us + stats.interval_ms * 1000LL - now;
+        if (last_frame_us != 0 && wait_us > 0) {
+            if (!esp_timer_is_active(flush_timer)) {
+                esp_timer_start_once(flush_timer, wait_us);
+            }
+            continue;
+        }
+        
+        color_rgb_t color;
+        portENTER_CRITICAL(&governor_lock);
+        bool have_frame = pending && !paused;
+        color = pending_color;
+        if (have_frame) {
+            pending = false;
+        }
+        portEXIT_CRITICAL(&governor_lock);
+        if (!have_frame) {
+            continue;
+        }
+        
+        bool shown = render_cb(&color, render_ctx);
+        int64_t end = esp_timer_get_time();
+        
+        if (shown) {
+            last_frame_us = now;
+            adapt_interval((uint32_t)(end - now));
+        }
+        portENTER_CRITICAL(&governor_lock);
+        if (shown) {
+            stats.rendered++;
+        } else {
+            stats.dropped++;
+        }
+        portEXIT_CRITICAL(&governor_lock);
+    }
+}
+
+static void flush_timer_cb(void *arg)
+{
+    xTaskNotifyGive(governor_task_handle);
+}
+
+esp_err_t display_governor_init(display_render_t render, void *ctx)
+{
+    if (!render) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    render_cb = render;
+    render_ctx = ctx;
+    stats.interval_ms = DISPLAY_GOVERNOR_MIN_INTERVAL_MS;
+    
+    const esp_timer_create_args_t timer_args = {
+        .callback = flush_timer_cb,
+        .name = "display_flush",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &flush_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Below the transition task: LED frames keep their pace during a flush
+    if (xTaskCreate(governor_task, "display", 4096, NULL, 4, &governor_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void display_governor_submit(const color_rgb_t *color)
+{
+    if (!governor_task_handle) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&governor_lock);
+    if (pending) {
+        stats.coalesced++;
+    }
+    pending_color = *color;
+    pending = true;
+    stats.submitted++;
+    portEXIT_CRITICAL(&governor_lock);
+    
+    xTaskNotifyGive(governor_task_handle);
+}
+
+void display_governor_redraw(void)
+{
+    if (!governor_task_handle) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&governor_lock);
+    pending = stats.submitted > 0;
+    portEXIT_CRITICAL(&governor_lock);
+    
+    xTaskNotifyGive(governor_task_handle);
+}
+
+void display_governor_set_paused(bool pause)
+{
+    if (!governor_task_handle) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&governor_lock);
+    paused = pause;
+    portEXIT_CRITICAL(&governor_lock);
+    
+    if (!pause) {
+        xTaskNotifyGive(governor_task_handle);
+    }
+}
+
+void display_governor_get_stats(display_governor_stats_t *out)
+{
+    portENTER_CRITICAL(&governor_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&governor_lock);
+}
@@ -0,0 +1,45 @@
+#ifndef DISPLAY_GOVERNOR_H
+#define DISPLAY_GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "color_source.h"
+
+// Display refresh governor configuration
+#define DISPLAY_GOVERNOR_MIN_INTERVAL_MS  20   // Fastest frame pace (50 fps)
+#define DISPLAY_GOVERNOR_MAX_INTERVAL_MS  250  // Slowest frame pace under load
+#define DISPLAY_GOVERNOR_BUS_DUTY_PCT     50   // Share of time display frames may keep the bus busy
+#define DISPLAY_GOVERNOR_BUSY_LOAD_PCT    80   // CPU load above which the frame pace backs off
+
+// Draw and flush one frame, returning once it is on the panel. Returns false
+// when the display is not available and the frame was not shown.
+typedef bool (*display_render_t)(const color_rgb_t *color, void *ctx);
+
+typedef struct {
+    uint32_t submitted;     // Colors handed to the governor
+    uint32_t rendered;      // Frames drawn and flushed
+    uint32_t dropped;       // Frames the display could not take (not ready or bus error)
+    uint32_t coalesced;     // Colors replaced by a newer one before they were drawn
+    uint32_t interval_ms;   // Current minimum time between frames
+    uint32_t flush_avg_us;  // Smoothed render and flush time
+    uint8_t cpu_load_pct;   // Last CPU load sample (0 without FreeRTOS run time stats)
+} display_governor_stats_t;
+
+// Start the governor task; render runs only on that task
+esp_err_t display_governor_init(display_render_t render, void *ctx);
+
+// Show color as soon as the frame pace allows. Updates inside the frame
+// interval are merged, and the newest one is always drawn when the
+// interval ends.
+void display_governor_submit(const color_rgb_t *color);
+
+// Draw the newest color again, for a panel that lost its picture
+void display_governor_redraw(void);
+
+// While paused nothing is sent; the newest color is kept and drawn on resume
+void display_governor_set_paused(bool paused);
+
+void display_governor_get_stats(display_governor_stats_t *stats);
+
+#endif // DISPLAY_GOVERNOR_H
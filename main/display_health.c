@@ -0,0 +1,108 @@
+#include "display_health.h"
+#include "main.h"
+#include "display_governor.h"
+#include "display_power.h"
+
+// A panel that stops answering (a glitch leaving SDA held low, a brown-out
+// resetting its controller) turns every transaction into a NACK or a 100 ms
+// timeout. After DISPLAY_HEALTH_FAIL_LIMIT failed frames or power commands
+// in a row the display goes offline: the governor drops frames at once and
+// display power sends no commands, so no task waits on the bus. A
+// low-priority task clears the bus and runs the init sequence again,
+// backing off up to DISPLAY_HEALTH_RETRY_MAX_MS, then puts back the power
+// state and the last color. The LEDs never touch the display bus, so they
+// are not affected.
+
+static portMUX_TYPE health_lock = portMUX_INITIALIZER_UNLOCKED;
+static display_health_stats_t stats = { .online = true, .last_error = ESP_OK };
+static ssd1306_handle_t display = NULL;
+static TaskHandle_t recovery_task_handle = NULL;
+
+static void recovery_task(void *pvParameter)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        uint32_t delay_ms = DISPLAY_HEALTH_RETRY_MIN_MS;
+        uint32_t attempts = 0;
+        esp_err_t ret;
+        do {
+            vTaskDelay(pdMS_TO_TICKS(delay_ms));
+            ret = ssd1306_recover(display);
+            attempts++;
+            
+            portENTER_CRITICAL(&health_lock);
+            stats.attempts++;
+            if (ret == ESP_OK) {
+                stats.online = true;
+                stats.fail_streak = 0;
+                stats.recoveries++;
+            } else {
+                stats.last_error = ret;
+            }
+            portEXIT_CRITICAL(&health_lock);
+            
+            if (ret != ESP_OK) {
+                ESP_LOGD(TAG, "Display recovery failed (%s), next try in %lu ms", esp_err_to_name(ret),
+                         (unsigned long)delay_ms * 2);
+                delay_ms = delay_ms * 2 < DISPLAY_HEALTH_RETRY_MAX_MS ? delay_ms * 2 : DISPLAY_HEALTH_RETRY_MAX_MS;
+            }
+        } while (ret != ESP_OK);
+        
+        // The init sequence left the panel on at full contrast
+        display_power_restore();
+        display_governor_redraw();
+        ESP_LOGI(TAG, "Display recovered after %lu attempt(s)", (unsigned long)attempts);
+    }
+}
+
+esp_err_t display_health_init(ssd1306_handle_t dev)
+{
+    if (!dev) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    display = dev;
+    
+    // Below the display governor: recovery only uses idle time
+    if (xTaskCreate(recovery_task, "display_fix", 3072, NULL, 2, &recovery_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool display_health_ok(void)
+{
+    return stats.online;
+}
+
+void display_health_report(esp_err_t result)
+{
+    bool fault = false;
+    
+    portENTER_CRITICAL(&health_lock);
+    if (result == ESP_OK) {
+        stats.fail_streak = 0;
+    } else {
+        stats.last_error = result;
+        stats.fail_streak++;
+        if (stats.online && stats.fail_streak >= DISPLAY_HEALTH_FAIL_LIMIT && recovery_task_handle) {
+            stats.online = false;
+            stats.faults++;
+            fault = true;
+        }
+    }
+    portEXIT_CRITICAL(&health_lock);
+    
+    if (fault) {
+        ESP_LOGW(TAG, "Display offline after %d failed transfers (%s), recovering in the background",
+                 DISPLAY_HEALTH_FAIL_LIMIT, esp_err_to_name(result));
+        xTaskNotifyGive(recovery_task_handle);
+    }
+}
+
+void display_health_get_stats(display_health_stats_t *out)
+{
+    portENTER_CRITICAL(&health_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&health_lock);
+}
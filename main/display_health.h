@@ -0,0 +1,38 @@
+#ifndef DISPLAY_HEALTH_H
+#define DISPLAY_HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "ssd1306.h"
+
+// Display health monitor configuration
+#define DISPLAY_HEALTH_FAIL_LIMIT      3        // Failed frames or commands in a row that take the display offline
+#define DISPLAY_HEALTH_RETRY_MIN_MS    200      // Wait before the first recovery attempt
+#define DISPLAY_HEALTH_RETRY_MAX_MS    10000    // Longest wait between recovery attempts
+#define DISPLAY_HEALTH_BOOT_ATTEMPTS   3        // Tries to bring the display up at boot
+
+typedef struct {
+    bool online;            // Frames and panel commands are being sent
+    uint32_t faults;        // Times the display went offline
+    uint32_t recoveries;    // Times it came back
+    uint32_t attempts;      // Recovery attempts, failed ones included
+    uint32_t fail_streak;   // Failed frames and commands in a row
+    esp_err_t last_error;   // Last failed frame, command or recovery attempt
+} display_health_stats_t;
+
+// Watch dev from now on and start the recovery task
+esp_err_t display_health_init(ssd1306_handle_t dev);
+
+// False while the display is offline: skip frames and panel commands, the
+// recovery task has the bus. True before init.
+bool display_health_ok(void);
+
+// Outcome of a frame or a panel command: ESP_OK or the bus error.
+// DISPLAY_HEALTH_FAIL_LIMIT failures in a row take the display offline and
+// start recovery.
+void display_health_report(esp_err_t result);
+
+void display_health_get_stats(display_health_stats_t *stats);
+
+#endif // DISPLAY_HEALTH_H
@@ -0,0 +1,227 @@
+#include "display_power.h"
+#include "main.h"
+#include "display_governor.h"
+#include "display_health.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+// Everything here is a single command transaction to the panel: contrast for
+// dimming, display off for sleep and the COM display offset for burn-in
+// shifting, so no frame is ever resent. While the panel is off the display
+// governor is paused, so an idle picker puts nothing on the I2C bus. While
+// the display is offline only the state changes; display_power_restore
+// sends it once the panel is back. Every command's outcome goes to display
+// health like a frame's, so a panel that wedges while it is off still goes
+// offline and gets recovered.
+//
+// The shift walks the picture down by up to two rows and back. Rows pushed
+// off the bottom wrap to the top, but the bottom two rows are the blue
+// field's descender space and stay blank. The SSD1306 has no column
+// offset, so there is no horizontal shift.
+//
+// The timers and user activity only set a bit for the power task: their
+// callbacks run in the esp_timer task and activity comes from the control
+// loop, and neither may wait for power_lock, the bus or the panel.
+
+static const uint8_t shift_offsets[] = { 0, SSD1306_HEIGHT - 1, SSD1306_HEIGHT - 2, SSD1306_HEIGHT - 1 };
+
+static ssd1306_handle_t display = NULL;
+static display_power_state_t state = DISPLAY_POWER_ACTIVE;
+static uint8_t shift_step = 0;
+static SemaphoreHandle_t power_lock = NULL;    // Orders state changes between callers and the power task
+static esp_timer_handle_t idle_timer = NULL;
+static esp_timer_handle_t shift_timer = NULL;
+static TaskHandle_t power_task_handle = NULL;
+static int64_t idle_deadline_us = 0;            // When the running inactivity timeout expires
+
+// Power task notification bits
+#define POWER_BIT_IDLE      (1 << 0)    // Inactivity timeout expired
+#define POWER_BIT_SHIFT     (1 << 1)    // Time for the next layout shift
+#define POWER_BIT_WAKE      (1 << 2)    // User activity
+
+static void idle_timer_cb(void *arg)
+{
+    xTaskNotify(power_task_handle, POWER_BIT_IDLE, eSetBits);
+}
+
+static void shift_timer_cb(void *arg)
+{
+    xTaskNotify(power_task_handle, POWER_BIT_SHIFT, eSetBits);
+}
+
+// Send one panel command from the power or recovery task and report how it
+// went. Queued commands report a NACK or timeout only in the error count.
+static void send_command(esp_err_t (*command)(ssd1306_handle_t, uint8_t), uint8_t arg)
+{
+    ssd1306_stats_t bus;
+    ssd1306_get_stats(display, &bus);
+    uint32_t errors = bus.errors;
+    esp_err_t ret = command(display, arg);
+    if (ret == ESP_OK) {
+        ret = ssd1306_wait_idle(display, DISPLAY_COMMAND_TIMEOUT_MS);
+    }
+    ssd1306_get_stats(display, &bus);
+    if (ret == ESP_OK && bus.errors != errors) {
+        ret = ESP_FAIL;
+    }
+    display_health_report(ret);
+}
+
+static esp_err_t set_display_on(ssd1306_handle_t dev, uint8_t on)
+{
+    return ssd1306_set_display_on(dev, on);
+}
+
+// Call with power_lock held, or before the timers run
+static void start_idle_timer(uint32_t timeout_ms)
+{
+    esp_timer_stop(idle_timer);
+    idle_deadline_us = esp_timer_get_time() + timeout_ms * 1000LL;
+    esp_timer_start_once(idle_timer, timeout_ms * 1000ULL);
+}
+
+// Inactivity timeout: dim first, then switch off
+static void idle_timeout(void)
+{
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    if (esp_timer_get_time() < idle_deadline_us) {
+        // Activity restarted the timeout after this expiry was posted
+        xSemaphoreGive(power_lock);
+        return;
+    }
+    if (state == DISPLAY_POWER_ACTIVE) {
+        if (display_health_ok()) {
+            send_command(ssd1306_set_contrast, DISPLAY_CONTRAST_DIM);
+        }
+        state = DISPLAY_POWER_DIMMED;
+        start_idle_timer(DISPLAY_OFF_TIMEOUT_MS - DISPLAY_DIM_TIMEOUT_MS);
+        ESP_LOGI(TAG, "Display dimmed");
+    } else if (state == DISPLAY_POWER_DIMMED) {
+        display_governor_set_paused(true);
+        esp_timer_stop(shift_timer);
+        if (display_health_ok()) {
+            send_command(set_display_on, false);
+        }
+        state = DISPLAY_POWER_OFF;
+        ESP_LOGI(TAG, "Display off");
+    }
+    xSemaphoreGive(power_lock);
+}
+
+// User activity: switch the panel back on at full contrast
+static void wake(void)
+{
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    if (state == DISPLAY_POWER_OFF) {
+        if (display_health_ok()) {
+            send_command(set_display_on, true);
+        }
+        display_governor_set_paused(false);
+        esp_timer_start_periodic(shift_timer, DISPLAY_PIXEL_SHIFT_MS * 1000ULL);
+    }
+    if (state != DISPLAY_POWER_ACTIVE) {
+        // Checked again: a failed display on may have taken it offline
+        if (display_health_ok()) {
+            send_command(ssd1306_set_contrast, SSD1306_DEFAULT_CONTRAST);
+        }
+        state = DISPLAY_POWER_ACTIVE;
+    }
+    start_idle_timer(DISPLAY_DIM_TIMEOUT_MS);
+    xSemaphoreGive(power_lock);
+}
+
+static void shift_layout(void)
+{
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    if (state != DISPLAY_POWER_OFF) {
+        shift_step = (shift_step + 1) % sizeof(shift_offsets);
+        if (display_health_ok()) {
+            send_command(ssd1306_set_display_offset, shift_offsets[shift_step]);
+        }
+    }
+    xSemaphoreGive(power_lock);
+}
+
+// Sends the commands the timers and user activity ask for. A wake goes
+// first: it restarts the timeout, so an expiry posted with it is dropped.
+static void power_task(void *pvParameter)
+{
+    for (;;) {
+        uint32_t bits;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        if (bits & POWER_BIT_WAKE) {
+            wake();
+        }
+        if (bits & POWER_BIT_IDLE) {
+            idle_timeout();
+        }
+        if (bits & POWER_BIT_SHIFT) {
+            shift_layout();
+        }
+    }
+}
+
+esp_err_t display_power_init(ssd1306_handle_t dev)
+{
+    power_lock = xSemaphoreCreateMutex();
+    if (!power_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Below the display governor so a command never delays a frame flush
+    if (xTaskCreate(power_task, "display_power", 3072, NULL, 3, &power_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    const esp_timer_create_args_t idle_args = {
+        .callback = idle_timer_cb,
+        .name = "display_idle",
+    };
+    esp_err_t ret = esp_timer_create(&idle_args, &idle_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    const esp_timer_create_args_t shift_args = {
+        .callback = shift_timer_cb,
+        .name = "display_shift",
+    };
+    ret = esp_timer_create(&shift_args, &shift_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    start_idle_timer(DISPLAY_DIM_TIMEOUT_MS);
+    esp_timer_start_periodic(shift_timer, DISPLAY_PIXEL_SHIFT_MS * 1000ULL);
+    display = dev;
+    return ESP_OK;
+}
+
+void display_power_activity(void)
+{
+    if (!display) {
+        return;
+    }
+    xTaskNotify(power_task_handle, POWER_BIT_WAKE, eSetBits);
+}
+
+void display_power_restore(void)
+{
+    if (!display) {
+        return;
+    }
+    
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    if (state == DISPLAY_POWER_OFF) {
+        send_command(set_display_on, false);
+    } else if (state == DISPLAY_POWER_DIMMED) {
+        send_command(ssd1306_set_contrast, DISPLAY_CONTRAST_DIM);
+    }
+    send_command(ssd1306_set_display_offset, shift_offsets[shift_step]);
+    xSemaphoreGive(power_lock);
+}
+
+display_power_state_t display_power_get_state(void)
+{
+    return state;
+}
@@ -0,0 +1,33 @@
+#ifndef DISPLAY_POWER_H
+#define DISPLAY_POWER_H
+
+#include "esp_err.h"
+#include "ssd1306.h"
+
+// Display power configuration
+#define DISPLAY_DIM_TIMEOUT_MS        30000     // Inactivity before the contrast drops
+#define DISPLAY_OFF_TIMEOUT_MS        300000    // Inactivity before the panel is switched off
+#define DISPLAY_CONTRAST_DIM          0x08      // Contrast while dimmed (full: SSD1306_DEFAULT_CONTRAST)
+#define DISPLAY_PIXEL_SHIFT_MS        60000     // Time between one-pixel layout shifts while on
+#define DISPLAY_COMMAND_TIMEOUT_MS    250       // Longest wait for a queued panel command
+
+typedef enum {
+    DISPLAY_POWER_ACTIVE,
+    DISPLAY_POWER_DIMMED,
+    DISPLAY_POWER_OFF,
+} display_power_state_t;
+
+// Start managing dev once it is initialized and showing the first frame
+esp_err_t display_power_init(ssd1306_handle_t dev);
+
+// User activity: wake the panel and restart the inactivity timeout. Only
+// posts to the power task, so it never waits for the bus and is cheap
+// enough to call on every input; does nothing before init.
+void display_power_activity(void);
+
+// Send the current power state to a panel that was re-initialized
+void display_power_restore(void);
+
+display_power_state_t display_power_get_state(void);
+
+#endif // DISPLAY_POWER_H
@@ -0,0 +1,276 @@
+#include "dmx_receiver.h"
+#include "main.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "dmx_net.h"
+#include "network.h"
+#include "strip_owner.h"
+
+#define DMX_CHANNELS    512
+
+static led_strip_t *dmx_strips[DMX_RECEIVER_MAX_STRIPS];
+static uint32_t dmx_pixels[DMX_RECEIVER_MAX_STRIPS];
+static int strip_count = 0;
+static dmx_net_t net;
+static uint16_t universes[DMX_NET_MAX_UNIVERSES];
+static int universe_count = 0;
+
+static volatile bool streaming = false;
+static int64_t last_frame_us = 0;
+static int64_t frame_begin_us = 0;
+static int64_t packet_time_us = 0;      // When the packet being parsed was received
+static uint32_t refresh_pending = 0;    // Bit per strip still sending the last frame
+
+static dmx_receiver_stats_t stats;
+static uint64_t latency_sum_us = 0;
+static uint64_t output_sum_us = 0;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void wait_refreshes(void)
+{
+    for (int i = 0; i < strip_count; i++) {
+        if (refresh_pending & (1u << i)) {
+            dmx_strips[i]->wait_refresh_done(dmx_strips[i], 10);
+        }
+    }
+    refresh_pending = 0;
+}
+
+// First data of a frame: the stream takes the strip with its first frame,
+// the previous one must be out of the buffers before it is overwritten, and
+// the strips told their pixels are about to change
+static void on_frame_begin(void *ctx)
+{
+    if (!streaming) {
+        strip_owner_take(STRIP_OWNER_DMX, portMAX_DELAY);
+        streaming = true;
+        ESP_LOGI(TAG, "DMX stream started");
+    }
+    wait_refreshes();
+    for (int i = 0; i < strip_count; i++) {
+        dmx_strips[i]->mark_dirty(dmx_strips[i], 0, dmx_pixels[i]);
+    }
+    frame_begin_us = packet_time_us;
+}
+
+static void on_frame_end(void *ctx, uint32_t strips, bool complete)
+{
+    // Start every strip back to back; they send in parallel on their own channels
+    for (int i = 0; i < strip_count; i++) {
+        dmx_strips[i]->commit(dmx_strips[i]);
+        if ((strips & (1u << i)) && dmx_strips[i]->refresh_async(dmx_strips[i]) == ESP_OK) {
+            refresh_pending |= 1u << i;
+        }
+    }
+    
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = (uint32_t)(now - frame_begin_us);
+    last_frame_us = now;
+    
+    portENTER_CRITICAL(&stats_lock);
+    stats.frames++;
+    stats.latency_last_us = latency;
+    if (latency > stats.latency_max_us) {
+        stats.latency_max_us = latency;
+    }
+    latency_sum_us += latency;
+    output_sum_us += (uint64_t)(now - packet_time_us);
+    stats.latency_avg_us = (uint32_t)(latency_sum_us / stats.frames);
+    stats.output_avg_us = (uint32_t)(output_sum_us / stats.frames);
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void log_stats(void)
+{
+    dmx_receiver_stats_t s;
+    dmx_receiver_get_stats(&s);
+    ESP_LOGI(TAG, "DMX: %lu frames, %lu partial, %lu out of sequence, latency %lu us (avg %lu, max %lu, output %lu)",
+             (unsigned long)s.frames, (unsigned long)s.partial_frames, (unsigned long)s.sequence_drops,
+             (unsigned long)s.latency_last_us, (unsigned long)s.latency_avg_us, (unsigned long)s.latency_max_us,
+             (unsigned long)s.output_avg_us);
+}
+
+static int open_socket(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// E1.31 sends each universe to its own group, 239.255.hi.lo
+static void join_groups(int sock)
+{
+    for (int i = 0; i < universe_count; i++) {
+        struct ip_mreq mreq = {
+            .imr_multiaddr.s_addr = htonl(0xEFFF0000 | universes[i]),
+            .imr_interface.s_addr = htonl(INADDR_ANY),
+        };
+        // Memberships may not survive the interface going down; start over
+        setsockopt(sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            ESP_LOGW(TAG, "Failed to join multicast group of universe %u", universes[i]);
+        }
+    }
+}
+
+// Everything waiting on the socket, straight into the strip buffers
+static void drain_socket(int sock)
+{
+    static uint8_t packet[DMX_NET_PACKET_MAX];
+    for (;;) {
+        int len = recv(sock, packet, sizeof(packet), MSG_DONTWAIT);
+        if (len <= 0) {
+            return;
+        }
+        packet_time_us = esp_timer_get_time();
+        dmx_net_feed(&net, packet, len, (uint32_t)(packet_time_us / 1000));
+    }
+}
+
+static void dmx_receiver_task(void *pvParameter)
+{
+    int e131_sock = open_socket(DMX_NET_E131_PORT);
+    int artnet_sock = open_socket(DMX_NET_ARTNET_PORT);
+    if (e131_sock < 0 || artnet_sock < 0) {
+        ESP_LOGE(TAG, "Failed to open DMX sockets");
+        vTaskDelete(NULL);
+        return;
+    }
+    uint32_t joined_connect = 0;
+    int64_t last_stats_us = 0;
+    
+    for (;;) {
+        uint32_t connect = network_get_connect_count();
+        if (connect != joined_connect && network_is_connected()) {
+            join_groups(e131_sock);
+            joined_connect = connect;
+        }
+        
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(e131_sock, &fds);
+        FD_SET(artnet_sock, &fds);
+        struct timeval timeout = { .tv_sec = 0, .tv_usec = DMX_RECEIVER_TICK_MS * 1000 };
+        int max_fd = e131_sock > artnet_sock ? e131_sock : artnet_sock;
+        if (select(max_fd + 1, &fds, NULL, NULL, &timeout) > 0) {
+            if (FD_ISSET(e131_sock, &fds)) {
+                drain_socket(e131_sock);
+            }
+            if (FD_ISSET(artnet_sock, &fds)) {
+                drain_socket(artnet_sock);
+            }
+        }
+        
+        int64_t now = esp_timer_get_time();
+        dmx_net_tick(&net, (uint32_t)(now / 1000));
+        if (streaming && now - last_frame_us > DMX_RECEIVER_TIMEOUT_MS * 1000LL) {
+            wait_refreshes();
+            streaming = false;
+            strip_owner_give(STRIP_OWNER_DMX);
+            ESP_LOGI(TAG, "DMX stream stopped");
+            log_stats();
+        } else if (streaming && now - last_stats_us > DMX_RECEIVER_STATS_MS * 1000LL) {
+            last_stats_us = now;
+            log_stats();
+        }
+    }
+}
+
+esp_err_t dmx_receiver_start(led_strip_t *const *strips, int count)
+{
+    if (count < 1 || count > DMX_RECEIVER_MAX_STRIPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Lay the strips out from the configured start address; a pixel never
+    // straddles two universes, so each universe carries at most 170
+    dmx_net_mapping_t mappings[DMX_NET_MAX_MAPPINGS];
+    int mapping_count = 0;
+    uint16_t universe = DMX_UNIVERSE;
+    uint16_t channel = DMX_START_CHANNEL;
+    for (int s = 0; s < count; s++) {
+        uint8_t *buffer;
+        led_strip_layout_t layout;
+        esp_err_t ret = strips[s]->get_buffer(strips[s], &buffer, &layout);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        dmx_strips[s] = strips[s];
+        dmx_pixels[s] = layout.pixel_count;
+        
+        uint32_t pixel = 0;
+        while (pixel < layout.pixel_count) {
+            uint32_t fit = (DMX_CHANNELS - channel + 1) / 3;
+            if (fit == 0) {
+                universe++;
+                channel = 1;
+                continue;
+            }
+            if (mapping_count == DMX_NET_MAX_MAPPINGS) {
+                ESP_LOGE(TAG, "DMX layout needs more than %d universe regions", DMX_NET_MAX_MAPPINGS);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            uint32_t n = layout.pixel_count - pixel < fit ? layout.pixel_count - pixel : fit;
+            mappings[mapping_count++] = (dmx_net_mapping_t){
+                .universe = universe,
+                .channel = channel,
+                .buffer = buffer + pixel * layout.bytes_per_pixel,
+                .pixel_count = n,
+                .bytes_per_pixel = layout.bytes_per_pixel,
+                .offset = { layout.red_offset, layout.green_offset, layout.blue_offset },
+                .strip = s,
+            };
+            if (universe_count == 0 || universes[universe_count - 1] != universe) {
+                universes[universe_count++] = universe;
+            }
+            pixel += n;
+            channel += 3 * n;
+        }
+    }
+    strip_count = count;
+    
+    const dmx_net_config_t config = DMX_NET_DEFAULT_CONFIG();
+    const dmx_net_callbacks_t callbacks = {
+        .frame_begin = on_frame_begin,
+        .frame_end = on_frame_end,
+    };
+    if (!dmx_net_init(&net, &config, mappings, mapping_count, &callbacks)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    // Above the transition engine so a frame is never held up by a fade
+    if (xTaskCreate(dmx_receiver_task, "dmx_receiver", 3072, NULL, 7, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "DMX receiver: %d strip(s) on universes %u-%u from channel %u", count, universes[0],
+             universes[universe_count - 1], DMX_START_CHANNEL);
+    return ESP_OK;
+}
+
+bool dmx_receiver_is_active(void)
+{
+    return streaming;
+}
+
+void dmx_receiver_get_stats(dmx_receiver_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    out->partial_frames = net.stats.partial_frames;
+    out->sync_packets = net.stats.sync_packets;
+    out->sequence_drops = net.stats.sequence_drops;
+    out->bad_packets = net.stats.bad_packets;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,38 @@
+#ifndef DMX_RECEIVER_H
+#define DMX_RECEIVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip.h"
+
+// DMX-over-IP receiver configuration
+#define DMX_RECEIVER_MAX_STRIPS   4       // Strips one receiver drives
+#define DMX_RECEIVER_TICK_MS      10      // Socket wait; frame and sync timeouts are checked this often
+#define DMX_RECEIVER_TIMEOUT_MS   2500    // Streaming ends after this long without a frame (E1.31 data loss timeout)
+#define DMX_RECEIVER_STATS_MS     5000    // Stats log interval while streaming
+
+typedef struct {
+    uint32_t frames;            // Frames shown
+    uint32_t partial_frames;    // Shown with universes missing
+    uint32_t sync_packets;
+    uint32_t sequence_drops;    // Late or duplicate packets discarded
+    uint32_t bad_packets;
+    uint32_t latency_last_us;   // First packet of the frame received to refresh started
+    uint32_t latency_max_us;
+    uint32_t latency_avg_us;
+    uint32_t output_avg_us;     // Last packet of the frame (or sync) received to refresh started
+} dmx_receiver_stats_t;
+
+// Receive E1.31 and Art-Net into the strips once the network is up. Strips
+// are laid out back to back from DMX_UNIVERSE, DMX_START_CHANNEL, three
+// channels per pixel, without splitting a pixel across universes; each
+// frame refreshes every strip it touched together.
+esp_err_t dmx_receiver_start(led_strip_t *const *strips, int count);
+
+// True while frames are arriving; the stream holds the strip (strip_owner.h)
+bool dmx_receiver_is_active(void);
+
+void dmx_receiver_get_stats(dmx_receiver_stats_t *stats);
+
+#endif // DMX_RECEIVER_H
@@ -0,0 +1,184 @@
+#include "encoder.h"
+#include "main.h"
+#include "driver/pulse_cnt.h"
+#include "esp_timer.h"
+
+typedef struct encoder_t {
+    pcnt_unit_handle_t unit;
+    pcnt_channel_handle_t chan_a;
+    pcnt_channel_handle_t chan_b;
+    encoder_config_t config;
+    int last_count;             // Hardware count at the last read
+    int remainder;              // Counts not yet making up a full detent
+    int64_t last_time_us;
+    int32_t value;
+} encoder_t;
+
+// Step multiplier for a rotation speed in detents per second
+static int32_t encoder_accel(const encoder_t *encoder, int32_t detents, int64_t elapsed_us)
+{
+    if (!encoder->config.accelerate || elapsed_us <= 0) {
+        return 1;
+    }
+    int64_t speed = (int64_t)abs(detents) * 1000000 / elapsed_us;
+    if (speed <= ENCODER_ACCEL_THRESHOLD) {
+        return 1;
+    }
+    int64_t mult = 1 + (speed - ENCODER_ACCEL_THRESHOLD) / ENCODER_ACCEL_STEP;
+    return mult > ENCODER_ACCEL_MAX ? ENCODER_ACCEL_MAX : (int32_t)mult;
+}
+
+static int32_t encoder_limit(const encoder_config_t *config, int32_t value)
+{
+    if (config->mode == ENCODER_MODE_WRAP) {
+        int32_t span = config->max - config->min + 1;
+        value = (value - config->min) % span;
+        if (value < 0) {
+            value += span;
+        }
+        return value + config->min;
+    }
+    if (value < config->min) {
+        return config->min;
+    }
+    if (value > config->max) {
+        return config->max;
+    }
+    return value;
+}
+
+esp_err_t encoder_create(const encoder_config_t *config, encoder_handle_t *ret_encoder)
+{
+    if (!config || !ret_encoder || config->min >= config->max || config->counts_per_detent == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    encoder_t *encoder = calloc(1, sizeof(encoder_t));
+    if (!encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    encoder->config = *config;
+    encoder->value = encoder_limit(config, config->initial);
+    
+    // Counting is done entirely by the PCNT unit. The only interrupt is at
+    // the watch points when the hardware count wraps into the accumulator.
+    pcnt_unit_config_t unit_config = {
+        .low_limit = -ENCODER_PCNT_LIMIT,
+        .high_limit = ENCODER_PCNT_LIMIT,
+        .flags.accum_count = true,
+    };
+    esp_err_t ret = pcnt_new_unit(&unit_config, &encoder->unit);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No free PCNT unit for encoder");
+        free(encoder);
+        return ret;
+    }
+    
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = ENCODER_GLITCH_NS,
+    };
+    ret = pcnt_unit_set_glitch_filter(encoder->unit, &filter_config);
+    
+    // Two channels, each counting edges of one input gated by the other: full x4 decoding
+    pcnt_chan_config_t chan_a_config = {
+        .edge_gpio_num = config->pin_a,
+        .level_gpio_num = config->pin_b,
+    };
+    pcnt_chan_config_t chan_b_config = {
+        .edge_gpio_num = config->pin_b,
+        .level_gpio_num = config->pin_a,
+    };
+    if (ret == ESP_OK) {
+        ret = pcnt_new_channel(encoder->unit, &chan_a_config, &encoder->chan_a);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_new_channel(encoder->unit, &chan_b_config, &encoder->chan_b);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_channel_set_edge_action(encoder->chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_channel_set_level_action(encoder->chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_channel_set_edge_action(encoder->chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_channel_set_level_action(encoder->chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_add_watch_point(encoder->unit, -ENCODER_PCNT_LIMIT);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_add_watch_point(encoder->unit, ENCODER_PCNT_LIMIT);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_enable(encoder->unit);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_clear_count(encoder->unit);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_start(encoder->unit);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Encoder setup failed: %s", esp_err_to_name(ret));
+        encoder_delete(encoder);
+        return ret;
+    }
+    
+    encoder->last_time_us = esp_timer_get_time();
+    *ret_encoder = encoder;
+    return ESP_OK;
+}
+
+esp_err_t encoder_delete(encoder_handle_t encoder)
+{
+    if (!encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (encoder->unit) {
+        pcnt_unit_stop(encoder->unit);
+        pcnt_unit_disable(encoder->unit);
+    }
+    if (encoder->chan_a) {
+        pcnt_del_channel(encoder->chan_a);
+    }
+    if (encoder->chan_b) {
+        pcnt_del_channel(encoder->chan_b);
+    }
+    if (encoder->unit) {
+        pcnt_del_unit(encoder->unit);
+    }
+    free(encoder);
+    return ESP_OK;
+}
+
+int32_t encoder_read(encoder_handle_t encoder)
+{
+    int count;
+    if (pcnt_unit_get_count(encoder->unit, &count) != ESP_OK) {
+        return encoder->value;
+    }
+    
+    int64_t now = esp_timer_get_time();
+    int delta = count - encoder->last_count + encoder->remainder;
+    encoder->last_count = count;
+    
+    int32_t detents = delta / encoder->config.counts_per_detent;
+    encoder->remainder = delta % encoder->config.counts_per_detent;
+    if (detents == 0) {
+        // Keep the speed window open until a detent completes
+        return encoder->value;
+    }
+    
+    int32_t mult = encoder_accel(encoder, detents, now - encoder->last_time_us);
+    encoder->last_time_us = now;
+    encoder->value = encoder_limit(&encoder->config, encoder->value + detents * mult);
+    return encoder->value;
+}
+
+void encoder_set_value(encoder_handle_t encoder, int32_t value)
+{
+    encoder->value = encoder_limit(&encoder->config, value);
+}
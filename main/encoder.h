@@ -0,0 +1,60 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// Encoder configuration
+#define ENCODER_PCNT_LIMIT        1000    // Hardware count range; accumulated in software beyond it
+#define ENCODER_GLITCH_NS         1000    // PCNT glitch filter on the A/B inputs
+#define ENCODER_ACCEL_THRESHOLD   8       // Detents per second before acceleration starts
+#define ENCODER_ACCEL_STEP        8       // Every this many detents/s above the threshold adds 1x
+#define ENCODER_ACCEL_MAX         8       // Maximum step multiplier
+
+// What happens at the ends of the range
+typedef enum {
+    ENCODER_MODE_CLAMP,         // Stop at min/max
+    ENCODER_MODE_WRAP,          // Continue from the other end
+} encoder_mode_t;
+
+typedef struct {
+    gpio_num_t pin_a;
+    gpio_num_t pin_b;
+    int32_t min;
+    int32_t max;
+    int32_t initial;
+    encoder_mode_t mode;
+    uint8_t counts_per_detent;  // Quadrature counts per click, usually 4
+    bool accelerate;            // Scale steps with rotation speed
+} encoder_config_t;
+
+typedef struct encoder_t *encoder_handle_t;
+
+// Default configuration for a 0-255 color channel
+#define ENCODER_DEFAULT_CONFIG(a, b) { \
+    .pin_a = (a),                      \
+    .pin_b = (b),                      \
+    .min = 0,                          \
+    .max = 255,                        \
+    .initial = 0,                      \
+    .mode = ENCODER_MODE_CLAMP,        \
+    .counts_per_detent = 4,            \
+    .accelerate = true,                \
+}
+
+// Create an encoder decoded in hardware by a PCNT unit (x4 quadrature)
+esp_err_t encoder_create(const encoder_config_t *config, encoder_handle_t *ret_encoder);
+
+// Delete an encoder and release its PCNT unit
+esp_err_t encoder_delete(encoder_handle_t encoder);
+
+// Apply the detents counted since the last call and return the value.
+// Costs one counter read; nothing runs per detent.
+int32_t encoder_read(encoder_handle_t encoder);
+
+// Set the value, e.g. when a preset is recalled
+void encoder_set_value(encoder_handle_t encoder, int32_t value);
+
+#endif // ENCODER_H
@@ -0,0 +1,304 @@
+#include "input.h"
+#include "main.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "trace.h"
+
+// Task notification bits: one per button for each kind of work
+#define INPUT_BIT_EDGE(id)      (1UL << (id))
+#define INPUT_BIT_SETTLED(id)   (1UL << (8 + (id)))
+#define INPUT_BIT_GESTURE(id)   (1UL << (16 + (id)))
+
+// Gesture state of a button
+typedef enum {
+    BUTTON_IDLE,
+    BUTTON_PRESSED,             // Down, waiting for release or long press
+    BUTTON_HELD,                // Long press sent, repeating
+    BUTTON_WAIT_SECOND,         // Released, waiting for a second press
+    BUTTON_SECOND_DOWN,         // Double press sent, waiting for release
+} button_phase_t;
+
+typedef struct {
+    input_button_config_t config;
+    uint8_t id;
+    volatile int64_t edge_time_us;  // Last edge seen by the ISR
+    bool pressed;                   // Debounced state
+    button_phase_t phase;
+    int32_t repeat_count;
+    esp_timer_handle_t debounce_timer;
+    esp_timer_handle_t gesture_timer;
+} input_button_t;
+
+typedef struct {
+    input_handler_t handler;
+    void *ctx;
+} input_handler_entry_t;
+
+static input_button_t buttons[INPUT_MAX_BUTTONS];
+static uint8_t button_count = 0;
+static input_handler_entry_t handlers[INPUT_MAX_HANDLERS];
+static uint8_t handler_count = 0;
+static TaskHandle_t input_task_handle = NULL;
+static QueueHandle_t event_queue = NULL;       // Input task to dispatcher
+static volatile uint32_t dropped_events = 0;
+
+// Both edges: remember when and wake the task. Notification bits coalesce,
+// so a bouncing contact can never overflow anything.
+static void IRAM_ATTR input_gpio_isr(void *arg)
+{
+    input_button_t *button = (input_button_t *)arg;
+    BaseType_t woken = pdFALSE;
+    
+    button->edge_time_us = esp_timer_get_time();
+    xTaskNotifyFromISR(input_task_handle, INPUT_BIT_EDGE(button->id), eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void debounce_timer_cb(void *arg)
+{
+    input_button_t *button = (input_button_t *)arg;
+    xTaskNotify(input_task_handle, INPUT_BIT_SETTLED(button->id), eSetBits);
+}
+
+static void gesture_timer_cb(void *arg)
+{
+    input_button_t *button = (input_button_t *)arg;
+    xTaskNotify(input_task_handle, INPUT_BIT_GESTURE(button->id), eSetBits);
+}
+
+// Hand an event to the dispatcher; never waits, so gesture timing does not
+// depend on what the handlers do
+static void queue_event(const input_event_t *event)
+{
+    if (xQueueSend(event_queue, event, 0) != pdTRUE) {
+        dropped_events++;
+    }
+}
+
+static void emit(input_button_t *button, input_event_type_t type, int32_t value, int64_t time_us)
+{
+    input_event_t event = {
+        .source = button->id,
+        .type = type,
+        .value = value,
+        .time_us = time_us,
+    };
+    queue_event(&event);
+}
+
+static void start_gesture_timer(input_button_t *button, uint32_t ms)
+{
+    esp_timer_stop(button->gesture_timer);
+    esp_timer_start_once(button->gesture_timer, ms * 1000ULL);
+}
+
+// Debounced press or release
+static void button_transition(input_button_t *button, bool pressed, int64_t time_us)
+{
+    if (pressed) {
+        switch (button->phase) {
+        case BUTTON_WAIT_SECOND:
+            esp_timer_stop(button->gesture_timer);
+            button->phase = BUTTON_SECOND_DOWN;
+            emit(button, INPUT_EVENT_DOUBLE_PRESS, 0, time_us);
+            break;
+        default:
+            button->phase = BUTTON_PRESSED;
+            button->repeat_count = 0;
+            start_gesture_timer(button, INPUT_LONG_PRESS_MS);
+            break;
+        }
+    } else {
+        switch (button->phase) {
+        case BUTTON_PRESSED:
+            if (button->config.double_press) {
+                button->phase = BUTTON_WAIT_SECOND;
+                start_gesture_timer(button, INPUT_DOUBLE_PRESS_MS);
+            } else {
+                esp_timer_stop(button->gesture_timer);
+                button->phase = BUTTON_IDLE;
+                emit(button, INPUT_EVENT_PRESS, 0, time_us);
+            }
+            break;
+        case BUTTON_HELD:
+            esp_timer_stop(button->gesture_timer);
+            button->phase = BUTTON_IDLE;
+            emit(button, INPUT_EVENT_RELEASE, button->repeat_count, time_us);
+            break;
+        default:
+            button->phase = BUTTON_IDLE;
+            break;
+        }
+    }
+}
+
+// Long press, hold repeat or double press window expired
+static void button_timeout(input_button_t *button)
+{
+    int64_t now = esp_timer_get_time();
+    
+    switch (button->phase) {
+    case BUTTON_PRESSED:
+        button->phase = BUTTON_HELD;
+        emit(button, INPUT_EVENT_LONG_PRESS, 0, now);
+        start_gesture_timer(button, INPUT_HOLD_REPEAT_MS);
+        break;
+    case BUTTON_HELD:
+        emit(button, INPUT_EVENT_HOLD_REPEAT, ++button->repeat_count, now);
+        start_gesture_timer(button, INPUT_HOLD_REPEAT_MS);
+        break;
+    case BUTTON_WAIT_SECOND:
+        button->phase = BUTTON_IDLE;
+        emit(button, INPUT_EVENT_PRESS, 0, now);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool button_read(const input_button_t *button)
+{
+    return gpio_get_level(button->config.gpio) == (button->config.active_low ? 0 : 1);
+}
+
+// Turns edges into gestures; the events go to the dispatcher
+static void input_task(void *pvParameter)
+{
+    uint32_t bits;
+    
+    for (;;) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        int64_t start = trace_begin();
+        
+        for (int i = 0; i < button_count; i++) {
+            input_button_t *button = &buttons[i];
+            
+            // Every edge pushes the settle point out; the level is only read once it is quiet
+            if (bits & INPUT_BIT_EDGE(i)) {
+                esp_timer_stop(button->debounce_timer);
+                esp_timer_start_once(button->debounce_timer, INPUT_DEBOUNCE_MS * 1000ULL);
+            }
+            
+            if (bits & INPUT_BIT_SETTLED(i)) {
+                bool pressed = button_read(button);
+                if (pressed != button->pressed) {
+                    button->pressed = pressed;
+                    button_transition(button, pressed, button->edge_time_us);
+                }
+            }
+            
+            if (bits & INPUT_BIT_GESTURE(i)) {
+                button_timeout(button);
+            }
+        }
+        trace_end("input", start);
+    }
+}
+
+// Runs the handlers, which may save presets or talk to the display
+static void dispatch_task(void *pvParameter)
+{
+    input_event_t event;
+    
+    for (;;) {
+        xQueueReceive(event_queue, &event, portMAX_DELAY);
+        for (int i = 0; i < handler_count; i++) {
+            handlers[i].handler(&event, handlers[i].ctx);
+        }
+    }
+}
+
+esp_err_t input_init(void)
+{
+    event_queue = xQueueCreate(INPUT_EVENT_QUEUE_DEPTH, sizeof(input_event_t));
+    if (!event_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Detection above the LED and display work so gestures are timed
+    // accurately; handlers below the LED writers so a flash write or a slow
+    // bus never holds up a frame
+    if (xTaskCreate(input_task, "input", 3072, NULL, 10, &input_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(dispatch_task, "input_dispatch", 3072, NULL, 3, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "Input engine started");
+    return ESP_OK;
+}
+
+esp_err_t input_add_button(const input_button_config_t *config, uint8_t *id)
+{
+    if (!config || !input_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (button_count >= INPUT_MAX_BUTTONS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    input_button_t *button = &buttons[button_count];
+    button->config = *config;
+    button->id = button_count;
+    button->phase = BUTTON_IDLE;
+    
+    const esp_timer_create_args_t debounce_args = {
+        .callback = debounce_timer_cb,
+        .arg = button,
+        .name = "btn_debounce",
+    };
+    const esp_timer_create_args_t gesture_args = {
+        .callback = gesture_timer_cb,
+        .arg = button,
+        .name = "btn_gesture",
+    };
+    esp_err_t ret = esp_timer_create(&debounce_args, &button->debounce_timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_create(&gesture_args, &button->gesture_timer);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << config->gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = config->active_low ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = config->active_low ? GPIO_PULLDOWN_DISABLE : GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    button->pressed = button_read(button);
+    
+    ret = gpio_isr_handler_add(config->gpio, input_gpio_isr, button);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    *id = button->id;
+    button_count++;
+    return ESP_OK;
+}
+
+esp_err_t input_register_handler(input_handler_t handler, void *ctx)
+{
+    if (!handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handler_count >= INPUT_MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    handlers[handler_count].handler = handler;
+    handlers[handler_count].ctx = ctx;
+    handler_count++;
+    return ESP_OK;
+}
+
+uint32_t input_get_dropped_events(void)
+{
+    return dropped_events;
+}
@@ -0,0 +1,57 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// Input engine configuration
+#define INPUT_MAX_BUTTONS          8       // One notification bit per button for edges, debounce and gestures
+#define INPUT_MAX_HANDLERS         4       // Registered event handlers
+#define INPUT_EVENT_QUEUE_DEPTH    32      // Events waiting for the dispatcher
+#define INPUT_DEBOUNCE_MS          20      // Level must be stable this long after the last edge
+#define INPUT_LONG_PRESS_MS        600     // Held this long = long press
+#define INPUT_HOLD_REPEAT_MS       150     // Repeat interval while held after a long press
+#define INPUT_DOUBLE_PRESS_MS      250     // Max gap between two presses of a double press
+
+// Input event types
+typedef enum {
+    INPUT_EVENT_PRESS,          // Short press (released before the long press time)
+    INPUT_EVENT_LONG_PRESS,     // Held for INPUT_LONG_PRESS_MS
+    INPUT_EVENT_HOLD_REPEAT,    // Every INPUT_HOLD_REPEAT_MS while still held after a long press
+    INPUT_EVENT_DOUBLE_PRESS,   // Second press within INPUT_DOUBLE_PRESS_MS
+    INPUT_EVENT_RELEASE,        // Button released after a long press
+} input_event_type_t;
+
+// An input event as delivered to handlers
+typedef struct {
+    uint8_t source;             // Button id
+    input_event_type_t type;
+    int32_t value;              // Event-specific (repeat count)
+    int64_t time_us;            // When the triggering edge happened
+} input_event_t;
+
+// Button configuration
+typedef struct {
+    gpio_num_t gpio;
+    bool active_low;            // Pressed reads 0 (button to ground with pull-up)
+    bool double_press;          // Detect double presses; costs INPUT_DOUBLE_PRESS_MS latency on short presses
+} input_button_config_t;
+
+typedef void (*input_handler_t)(const input_event_t *event, void *ctx);
+
+// Start the input and dispatcher tasks. The GPIO ISR service must be installed.
+esp_err_t input_init(void);
+
+// Add a button; its id is returned in *id and used as the event source
+esp_err_t input_add_button(const input_button_config_t *config, uint8_t *id);
+
+// Register a handler; handlers run in a low-priority dispatcher task, in
+// event order, and may block (they only delay later events)
+esp_err_t input_register_handler(input_handler_t handler, void *ctx);
+
+// Events dropped because the dispatcher queue was full
+uint32_t input_get_dropped_events(void);
+
+#endif // INPUT_H
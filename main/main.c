@@ -2,17 +2,73 @@
 #include "driver/rmt.h"
 #include "led_strip.h"
 #include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "numfmt.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "boot_profile.h"
+#include "presets.h"
+#include "calibration.h"
+#include "input.h"
+#include "encoder.h"
+#include "color_source.h"
+#include "transition.h"
+#include "serial_stream.h"
+#include "network.h"
+#include "dmx_receiver.h"
+#include "sequence.h"
+#include "strip_owner.h"
+#include "perf.h"
+#include "trace.h"
+#include "display_governor.h"
+#include "display_power.h"
+#include "display_health.h"
+#include "audio_input.h"
+#include "console.h"
+#include "esp_console.h"
 
 // For SSD1306 OLED display
 #include "ssd1306.h"
 
 static led_strip_t *strip;
 static led_strip_t *onboard_led;
-static ssd1306_handle_t ssd1306_dev = NULL;
+#if CONFIG_PICKER_STATIC_MEMORY
+// Driver state and pixel/frame buffers, sized from Kconfig
+static LED_STRIP_WS2812_STORAGE(strip_storage, LED_COUNT, LED_PIXEL_FORMAT);
+static LED_STRIP_WS2812_STORAGE(onboard_led_storage, 1, LED_PIXEL_FORMAT_GRB);
+static DMA_ATTR ssd1306_static_t display_storage;
+#endif
+static ssd1306_handle_t volatile ssd1306_dev = NULL; // Published once the display is fully initialized
+static i2c_master_bus_handle_t i2c_bus = NULL;
 
 // Button state variables
-static bool onboard_led_active = false;
-static QueueHandle_t gpio_evt_queue = NULL;
+static volatile bool onboard_led_active = false;
+static uint8_t boot_button_id;
+
+// Current state, persisted by the preset subsystem. The main loop owns it;
+// the input handler only flips onboard_led_active. Writes hold picker_lock and
+// other tasks read it through picker_state_snapshot. Recalls and effects
+// from other tasks go through the preset source to the main loop.
+static picker_state_t picker_state = { 0 };
+static portMUX_TYPE picker_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Rotary encoders used instead of the pots when COLOR_INPUT_ENCODERS is set
+static encoder_handle_t color_encoders[3] = { NULL };
+
+// Runtime switches, changed from the console with "set"
+static volatile bool display_partial_update = DISPLAY_PARTIAL_UPDATE_ENABLED;
+static volatile bool adc_debug_log = ADC_DEBUG_LOG_ENABLED;
+static volatile bool color_log = true;
+
+// Wire time of one strip refresh, from the waveform check at init
+static uint32_t strip_frame_time_us = 0;
+
+// Color sources polled by the main loop
+static color_source_t *manual_source = NULL;
+static color_source_t *preset_source = NULL;
+static color_source_t *serial_source = NULL;
+static color_source_t *effect_source = NULL;
 
 // Initialize GPIO pins
 void init_gpio(void)
@@ -20,60 +76,79 @@ void init_gpio(void)
     gpio_reset_pin(RGB_LED_DATA_PIN);
     gpio_set_direction(RGB_LED_DATA_PIN, GPIO_MODE_OUTPUT);
     
-    // Configure BOOT button as input with pull-up
-    gpio_reset_pin(BOOT_BUTTON_PIN);
-    gpio_set_direction(BOOT_BUTTON_PIN, GPIO_MODE_INPUT);
-    gpio_set_pull_mode(BOOT_BUTTON_PIN, GPIO_PULLUP_ONLY);
-    gpio_intr_enable(BOOT_BUTTON_PIN);
-    
-    // Configure GPIO interrupt for button
+    // Buttons are configured by the input engine
     gpio_install_isr_service(0);
-    gpio_set_intr_type(BOOT_BUTTON_PIN, GPIO_INTR_NEGEDGE);
-    
-    // Create a queue to handle GPIO event from ISR
-    gpio_evt_queue = xQueueCreate(10, sizeof(uint32_t));
     
     ESP_LOGI(TAG, "GPIO initialized");
 }
 
-// GPIO interrupt handler
-static void IRAM_ATTR gpio_isr_handler(void* arg)
+// Consistent copy of picker_state for tasks other than the main loop
+static picker_state_t picker_state_snapshot(void)
 {
-    uint32_t gpio_num = (uint32_t) arg;
-    xQueueSendFromISR(gpio_evt_queue, &gpio_num, NULL);
+    picker_state_t state;
+    portENTER_CRITICAL(&picker_lock);
+    state = picker_state;
+    portEXIT_CRITICAL(&picker_lock);
+    return state;
 }
 
-// Button task to handle button presses
-void button_task(void *pvParameter)
+// Load a preset; the main loop switches to the preset source on its next pass
+static esp_err_t recall_preset(const char *name)
 {
-    uint32_t gpio_num;
-    TickType_t last_press_time = 0;
+    picker_state_t recalled;
+    esp_err_t ret = presets_recall(name, &recalled);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No preset \"%s\" saved", name);
+        return ret;
+    }
     
-    for(;;) {
-        if(xQueueReceive(gpio_evt_queue, &gpio_num, portMAX_DELAY)) {
-            // Simple debounce
-            TickType_t current_time = xTaskGetTickCount();
-            if((current_time - last_press_time) < pdMS_TO_TICKS(DEBOUNCE_TIME_MS)) {
-                continue; // Skip this press (debounce)
-            }
-            last_press_time = current_time;
-            
-            // Toggle onboard LED state
-            if(gpio_num == BOOT_BUTTON_PIN) {
-                onboard_led_active = !onboard_led_active;
-                ESP_LOGI(TAG, "Boot button pressed, onboard LED %s", onboard_led_active ? "ON" : "OFF");
-                
-                if(onboard_led_active) {
-                    // Turn on with current RGB value
-                    ESP_ERROR_CHECK(onboard_led->set_pixel(onboard_led, 0, 255, 255, 255));
-                } else {
-                    // Turn off
-                    ESP_ERROR_CHECK(onboard_led->clear(onboard_led, 100));
-                }
-                ESP_ERROR_CHECK(onboard_led->refresh(onboard_led, 100));
-            }
+    color_rgb_t color = { recalled.red, recalled.green, recalled.blue };
+    color_source_preset_set(preset_source, &color, recalled.effect, recalled.effect_speed);
+    ESP_LOGI(TAG, "Recalled preset \"%s\"", name);
+    return ESP_OK;
+}
+
+// Button gestures: press toggles the onboard LED, long press stores the
+// color as the favorite preset, double press recalls it
+static void handle_input_event(const input_event_t *event, void *ctx)
+{
+    if (event->source != boot_button_id) {
+        return;
+    }
+    display_power_activity();
+    
+    picker_state_t state;
+    switch (event->type) {
+    case INPUT_EVENT_PRESS:
+        onboard_led_active = !onboard_led_active;
+        ESP_LOGI(TAG, "Boot button pressed, onboard LED %s", onboard_led_active ? "ON" : "OFF");
+        
+        portENTER_CRITICAL(&picker_lock);
+        picker_state.onboard_led_active = onboard_led_active;
+        state = picker_state;
+        portEXIT_CRITICAL(&picker_lock);
+        presets_update_state(&state);
+        
+        // The transition task owns the LED: it shows or clears it on the redraw
+        transition_redraw();
+        break;
+        
+    case INPUT_EVENT_LONG_PRESS:
+        state = picker_state_snapshot();
+        if (presets_save(FAVORITE_PRESET_NAME, &state) == ESP_OK) {
+            ESP_LOGI(TAG, "Saved preset \"%s\"", FAVORITE_PRESET_NAME);
+        } else {
+            ESP_LOGE(TAG, "Failed to save preset \"%s\"", FAVORITE_PRESET_NAME);
         }
-    } 
+        break;
+        
+    case INPUT_EVENT_DOUBLE_PRESS:
+        recall_preset(FAVORITE_PRESET_NAME);
+        break;
+    
+    default:
+        break;
+    }
 }
 
 // Initialize I2C
@@ -88,20 +163,36 @@ void init_i2c(void)
     gpio_set_pull_mode(OLED_SCL_PIN, GPIO_PULLUP_ENABLE);
     
     // Now configure I2C
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = I2C_MASTER_NUM,
         .sda_io_num = OLED_SDA_PIN,
         .scl_io_num = OLED_SCL_PIN,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = I2C_TRANS_QUEUE_DEPTH,
+        .flags.enable_internal_pullup = true,
     };
     
-    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_config, &i2c_bus));
     ESP_LOGI(TAG, "I2C initialized with SDA:%d, SCL:%d", OLED_SDA_PIN, OLED_SCL_PIN);
 }
 
+// Initialize the SPI bus for an SPI-wired OLED
+void init_spi(void)
+{
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = OLED_SPI_MOSI_PIN,
+        .miso_io_num = -1,
+        .sclk_io_num = OLED_SPI_SCLK_PIN,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = SSD1306_FRAME_BYTES,   // Whole frame in one DMA transaction
+    };
+    
+    ESP_ERROR_CHECK(spi_bus_initialize(OLED_SPI_HOST, &bus_config, SPI_DMA_CH_AUTO));
+    ESP_LOGI(TAG, "SPI initialized with SCLK:%d, MOSI:%d", OLED_SPI_SCLK_PIN, OLED_SPI_MOSI_PIN);
+}
+
 // Initialize ADC for potentiometers
 bool init_adc(adc_oneshot_unit_handle_t *adc1_handle)
 {
@@ -212,6 +303,8 @@ uint8_t find_blue_pot_channel(adc_oneshot_unit_handle_t adc1_handle)
 // Initialize RGB LEDs (using RMT peripheral and WS2812 driver)
 void init_rgb_leds(void)
 {
+    ESP_ERROR_CHECK(strip_owner_init());
+    
     // Main RGB LED strip
     rmt_config_t config = RMT_DEFAULT_CONFIG_TX(RGB_LED_DATA_PIN, 0);
     // Set suitable clock divider
@@ -222,16 +315,47 @@ void init_rgb_leds(void)
     
     // Install led strip driver for main LEDs
     led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(LED_COUNT, (led_strip_dev_t)config.channel);
+    strip_config.pixel_format = LED_PIXEL_FORMAT;
+    strip_config.timing = (led_strip_timing_t)LED_STRIP_TIMING;
+#if CONFIG_PICKER_STATIC_MEMORY
+    strip = led_strip_new_rmt_ws2812_static(&strip_config, strip_storage, sizeof(strip_storage));
+#else
     strip = led_strip_new_rmt_ws2812(&strip_config);
+#endif
     
     if (!strip) {
         ESP_LOGE(TAG, "Install main LED strip failed");
         return;
     }
     
+    // Scale frames that would draw more than the supply budget
+    led_strip_power_config_t power = {
+        .budget_ma = LED_POWER_BUDGET_MA,
+        .ma_per_channel = LED_MA_PER_CHANNEL,
+        .idle_ma_per_led = LED_IDLE_MA_PER_LED,
+        .max_brightness = LED_BRIGHTNESS,
+    };
+    ESP_ERROR_CHECK(led_strip_ws2812_set_power_limit(strip, &power));
+    
+    // White balance and per-LED gains saved with the "calib" command
+    if (calibration_init(strip) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to apply color calibration");
+    }
+    
     // Set all LEDs to initial value (off)
     ESP_ERROR_CHECK(strip->clear(strip, 100));
     
+    // Check the encoded waveform against the WS2812 timing tolerances. The
+    // strip is dark here; verify sends its own 0/1 bit pattern ahead of it
+    led_strip_ws2812_timing_report_t timing;
+    if (led_strip_ws2812_verify(strip, &timing) == ESP_OK) {
+        ESP_LOGI(TAG, "LED strip waveform OK: %lu us per frame, max %lu fps",
+                 (unsigned long)timing.frame_time_us, (unsigned long)timing.max_fps);
+        strip_frame_time_us = timing.frame_time_us;
+    } else {
+        ESP_LOGE(TAG, "LED strip waveform out of tolerance");
+    }
+    
     // Onboard RGB LED
     rmt_config_t onboard_config = RMT_DEFAULT_CONFIG_TX(ONBOARD_LED_PIN, 1);
     onboard_config.clk_div = 2;
@@ -241,7 +365,12 @@ void init_rgb_leds(void)
     
     // Install led strip driver for onboard LED
     led_strip_config_t onboard_strip_config = LED_STRIP_DEFAULT_CONFIG(1, (led_strip_dev_t)onboard_config.channel);
+#if CONFIG_PICKER_STATIC_MEMORY
+    onboard_led = led_strip_new_rmt_ws2812_static(&onboard_strip_config, onboard_led_storage,
+                                                  sizeof(onboard_led_storage));
+#else
     onboard_led = led_strip_new_rmt_ws2812(&onboard_strip_config);
+#endif
     
     if (!onboard_led) {
         ESP_LOGE(TAG, "Install onboard LED failed");
@@ -251,185 +380,309 @@ void init_rgb_leds(void)
     // Set onboard LED to initial value (off)
     ESP_ERROR_CHECK(onboard_led->clear(onboard_led, 100));
     
-    // Configure ISR for button
-    gpio_isr_handler_add(BOOT_BUTTON_PIN, gpio_isr_handler, (void*) BOOT_BUTTON_PIN);
-    
     ESP_LOGI(TAG, "RGB LEDs initialized");
 }
 
 // Update the RGB LEDs with new color values
 void update_rgb_leds(uint8_t red, uint8_t green, uint8_t blue)
 {
+    int64_t start = perf_begin();
     for (int i = 0; i < LED_COUNT; i++) {
         ESP_ERROR_CHECK(strip->set_pixel(strip, i, red, green, blue));
     }
+    int64_t refresh_start = trace_begin();
     ESP_ERROR_CHECK(strip->refresh(strip, 100));
+    trace_end("ws2812_refresh", refresh_start);
+    perf_end(PERF_STAGE_LED_REFRESH, start);
+    perf_count(PERF_COUNTER_LED_FRAMES);
 }
 
-// Update the onboard LED with new color values (if active)
+// Transition engine output: every interpolated frame goes to the LEDs
+static void show_color(const color_rgb_t *color, void *ctx)
+{
+    // A PC or console streaming pixel data owns the strip until it goes quiet,
+    // a sequence until it ends or is stopped; the frame is skipped meanwhile
+    if (strip_owner_take(STRIP_OWNER_PICKER, 0)) {
+        update_rgb_leds(color->r, color->g, color->b);
+        strip_owner_give(STRIP_OWNER_PICKER);
+        sequence_record_color(color);
+    }
+    update_onboard_led(color->r, color->g, color->b);
+}
+
+// Mirror the color on the onboard LED while it is active, and clear it once
+// when it is switched off. Only called from the transition task.
 void update_onboard_led(uint8_t red, uint8_t green, uint8_t blue)
 {
-    if (onboard_led_active) {
-        ESP_ERROR_CHECK(onboard_led->set_pixel(onboard_led, 0, red, green, blue));
-        ESP_ERROR_CHECK(onboard_led->refresh(onboard_led, 100));
+    static bool shown = false;
+    bool active = onboard_led_active;
+    if (!active && !shown) {
+        return;
+    }
+    onboard_led->set_pixel(onboard_led, 0, active ? red : 0, active ? green : 0, active ? blue : 0);
+    if (onboard_led->refresh(onboard_led, 100) != ESP_OK) {
+        ESP_LOGW(TAG, "Onboard LED refresh timed out");
     }
+    shown = active;
 }
 
-// Initialize OLED display
-void init_oled(void)
+// Load the display address found on a previous boot
+static bool load_oled_addr(uint8_t *addr)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    esp_err_t ret = nvs_get_u8(nvs, "oled_addr", addr);
+    nvs_close(nvs);
+    return ret == ESP_OK;
+}
+
+// Remember the display address for the next boot
+static void save_oled_addr(uint8_t addr)
 {
-    ESP_LOGI(TAG, "Initializing OLED display at address 0x%02X", OLED_ADDR);
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_u8(nvs, "oled_addr", addr) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+// Create the display at an address, returning NULL if it does not respond
+static ssd1306_handle_t create_oled(uint8_t addr, uint32_t power_on_delay_ms)
+{
+    ssd1306_config_t oled_config = SSD1306_DEFAULT_CONFIG(i2c_bus, addr);
+    oled_config.scl_speed_hz = I2C_FAST_MODE_PLUS ? SSD1306_I2C_SPEED_FAST_PLUS : I2C_MASTER_FREQ_HZ;
+    oled_config.async = true;
+    oled_config.power_on_delay_ms = power_on_delay_ms;
+#if CONFIG_PICKER_STATIC_MEMORY
+    return ssd1306_create_static(&oled_config, &display_storage);
+#else
+    return ssd1306_create(&oled_config);
+#endif
+}
+
+// Find the panel on I2C: the saved address first, then a bus scan
+static ssd1306_handle_t find_oled_i2c(void)
+{
+    ssd1306_handle_t dev = NULL;
+    uint8_t addr = OLED_ADDR;
+    uint8_t saved_addr;
+    bool have_saved_addr = load_oled_addr(&saved_addr);
     
-    // First, try to verify the I2C device is present with a direct scan
-    uint8_t device_count = 0;
-    for (uint8_t i = 1; i < 128; i++) {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (i << 1) | I2C_MASTER_WRITE, true);
-        i2c_master_stop(cmd);
-        
-        esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 10 / portTICK_PERIOD_MS);
-        i2c_cmd_link_delete(cmd);
+    // Fast path: the address from the last boot answers a single probe, so
+    // skip the bus scan and the settle delays (the panel has been powered
+    // since reset)
+    if (FAST_BOOT_ENABLED && have_saved_addr && i2c_master_probe(i2c_bus, saved_addr, 10) == ESP_OK) {
+        addr = saved_addr;
+        ESP_LOGI(TAG, "Initializing OLED display at saved address 0x%02X", addr);
+        dev = create_oled(addr, 0);
+    }
+    
+    if (dev == NULL) {
+        ESP_LOGI(TAG, "Looking for the OLED display at address 0x%02X", OLED_ADDR);
         
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "Found I2C device at address 0x%02X", i);
-            device_count++;
+        // Scan the bus for the display: the configured address if it
+        // answers, else either SSD1306 address (0x3C, or 0x3D with the
+        // address jumper moved)
+        uint8_t device_count = 0;
+        uint8_t found = 0;
+        for (uint8_t i = 1; i < 128; i++) {
+            esp_err_t ret = i2c_master_probe(i2c_bus, i, 10);
             
-            if (i == (OLED_ADDR >> 1)) {  // Convert 8-bit to 7-bit address if needed
-                ESP_LOGI(TAG, "Found OLED display at address 0x%02X", i);
+            if (ret == ESP_OK) {
+                ESP_LOGI(TAG, "Found I2C device at address 0x%02X", i);
+                device_count++;
+                
+                if (i == OLED_ADDR || (found != OLED_ADDR && (i == 0x3C || i == 0x3D))) {
+                    found = i;
+                }
             }
         }
+        
+        if (device_count == 0) {
+            ESP_LOGE(TAG, "No I2C devices found! Check connections");
+            return NULL;
+        }
+        if (found == 0) {
+            ESP_LOGE(TAG, "No OLED display at 0x%02X, 0x3C or 0x3D", OLED_ADDR);
+            return NULL;
+        }
+        if (found != OLED_ADDR) {
+            ESP_LOGW(TAG, "Nothing at the configured address 0x%02X, using the display found at 0x%02X",
+                     OLED_ADDR, found);
+        }
+        
+        // Give some time for the display to initialize its internal circuits
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+        
+        addr = found;
+        dev = create_oled(addr, 100);
+        if (dev == NULL) {
+            ESP_LOGE(TAG, "OLED display initialization failed at address 0x%02X", addr);
+            return NULL;
+        }
     }
     
-    if (device_count == 0) {
-        ESP_LOGE(TAG, "No I2C devices found! Check connections");
-        return;
+    if (!have_saved_addr || saved_addr != addr) {
+        save_oled_addr(addr);
     }
     
-    // Give some time for the display to initialize its internal circuits
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-    
-    // Try to initialize the display with the configured address
-    ssd1306_dev = ssd1306_create(I2C_MASTER_NUM, OLED_ADDR);
-    if (ssd1306_dev == NULL) {
-        ESP_LOGE(TAG, "OLED display initialization failed at address 0x%02X", OLED_ADDR);
-        
-        // Try alternate address format (convert between 7-bit and 8-bit)
-        uint8_t alt_addr = ((OLED_ADDR & 0x80) == 0) ? OLED_ADDR >> 1 : OLED_ADDR;
-        ESP_LOGI(TAG, "Trying alternate address format: 0x%02X", alt_addr);
-        
-        ssd1306_dev = ssd1306_create(I2C_MASTER_NUM, alt_addr);
-        if (ssd1306_dev == NULL) {
-            ESP_LOGE(TAG, "OLED display initialization failed with alternate address");
-            return;
-        }
+    return dev;
+}
+
+// Create the display on SPI; there is nothing to probe on a write-only bus
+static ssd1306_handle_t create_oled_spi(void)
+{
+    ssd1306_spi_config_t oled_config = SSD1306_DEFAULT_SPI_CONFIG(OLED_SPI_HOST, OLED_SPI_CS_PIN, OLED_SPI_DC_PIN);
+    oled_config.rst_gpio = OLED_SPI_RST_PIN;
+    oled_config.async = true;
+    oled_config.power_on_delay_ms = FAST_BOOT_ENABLED ? 0 : 100;
+#if CONFIG_PICKER_STATIC_MEMORY
+    return ssd1306_create_spi_static(&oled_config, &display_storage);
+#else
+    return ssd1306_create_spi(&oled_config);
+#endif
+}
+
+// Initialize OLED display
+void init_oled(void)
+{
+    ssd1306_handle_t dev = OLED_TRANSPORT_SPI ? create_oled_spi() : find_oled_i2c();
+    if (dev == NULL) {
+        ESP_LOGE(TAG, "OLED display not available");
+        return;
     }
     
     // Fix the display orientation by setting it to 180 degrees
-    if (ssd1306_set_orientation(ssd1306_dev, SSD1306_ORIENTATION_180_DEGREES) != ESP_OK) {
+    if (ssd1306_set_orientation(dev, SSD1306_ORIENTATION_180_DEGREES) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set OLED display orientation");
     } else {
         ESP_LOGI(TAG, "OLED display orientation set to 180 degrees");
     }
     
     // If we got here, the display was initialized successfully
-    ssd1306_clear_screen(ssd1306_dev, 0x00);
+    ssd1306_clear_screen(dev, 0x00);
     
-    // Draw initialization screen
-    ssd1306_display_string(ssd1306_dev, 0, 0, (uint8_t *)"LED Color Picker", 16, 0);
-    ssd1306_display_string(ssd1306_dev, 0, 20, (uint8_t *)"Initialized!", 16, 0);
-    ssd1306_refresh_gram(ssd1306_dev);
+    if (!FAST_BOOT_ENABLED) {
+        // Draw initialization screen
+        ssd1306_display_string(dev, 0, 0, (uint8_t *)"LED Color Picker", 16, 0);
+        ssd1306_display_string(dev, 0, 20, (uint8_t *)"Initialized!", 16, 0);
+        ssd1306_refresh_gram(dev);
+        
+        // Short delay to show init screen
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    }
     
-    // Short delay to show init screen
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    if (display_power_init(dev) != ESP_OK) {
+        ESP_LOGW(TAG, "Display power management unavailable");
+    }
+    if (display_health_init(dev) != ESP_OK) {
+        ESP_LOGW(TAG, "Display fault recovery unavailable");
+    }
     
+    // Hand the display over to the main loop
+    ssd1306_dev = dev;
     ESP_LOGI(TAG, "OLED initialized successfully");
 }
 
-// Update OLED display with new color values
-void update_oled_display(uint8_t red, uint8_t green, uint8_t blue)
+// Bring up the display bus and the display without holding up the LEDs
+void display_init_task(void *pvParameter)
 {
-    // Skip updating if the display was not initialized properly
-    if (ssd1306_dev == NULL) {
-        return;
+    if (OLED_TRANSPORT_SPI) {
+        init_spi();
+    } else {
+        init_i2c();
     }
+    boot_profile_mark("bus ready");
     
-    // Rate limiting to prevent excessive display updates
-    static uint32_t last_update_time = 0;
-    uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    if ((current_time - last_update_time) < DISPLAY_UPDATE_MIN_INTERVAL_MS) {
-        return; // Skip this update if it's too soon after the last one
+    // A panel still holding the bus from before the reset fails the first
+    // try; clear the bus and try again with the health monitor's backoff
+    uint32_t delay_ms = DISPLAY_HEALTH_RETRY_MIN_MS;
+    for (int attempt = 1; ; attempt++) {
+        init_oled();
+        if (ssd1306_dev != NULL || OLED_TRANSPORT_SPI || attempt == DISPLAY_HEALTH_BOOT_ATTEMPTS) {
+            break;
+        }
+        i2c_master_bus_reset(i2c_bus);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        delay_ms *= 2;
     }
-    last_update_time = current_time;
+    boot_profile_mark(ssd1306_dev ? "display ready" : "display failed");
+    
+    boot_profile_report();
+    vTaskDelete(NULL);
+}
+
+// Draw one display frame (display governor task)
+static bool render_oled_display(const color_rgb_t *color, void *ctx)
+{
+    // Skip updating if the display was not initialized properly or is being recovered
+    if (ssd1306_dev == NULL || !display_health_ok()) {
+        return false;
+    }
+    
+    uint8_t red = color->r, green = color->g, blue = color->b;
+    int64_t start = perf_begin();
     
     // Store previous values to detect changes
     static uint8_t prev_red = 0xFF, prev_green = 0xFF, prev_blue = 0xFF;
     static bool first_update = true;
     
-    char red_hex[5], green_hex[5], blue_hex[5];
-    char red_val[5], green_val[5], blue_val[5];
+    char red_hex[NUMFMT_HEX_U8_LEN], green_hex[NUMFMT_HEX_U8_LEN], blue_hex[NUMFMT_HEX_U8_LEN];
+    char red_val[NUMFMT_DEC_U8_LEN], green_val[NUMFMT_DEC_U8_LEN], blue_val[NUMFMT_DEC_U8_LEN];
     
-    // Format strings for display
-    snprintf(red_hex, sizeof(red_hex), "%02X", red);       // Just the hex value without '#'
-    snprintf(green_hex, sizeof(green_hex), "%02X", green); // Just the hex value without '#'
-    snprintf(blue_hex, sizeof(blue_hex), "%02X", blue);    // Just the hex value without '#'
+    // Format strings for display (table lookups, no snprintf)
+    numfmt_hex_u8(red_hex, red);       // Just the hex value without '#'
+    numfmt_hex_u8(green_hex, green);   // Just the hex value without '#'
+    numfmt_hex_u8(blue_hex, blue);     // Just the hex value without '#'
     
-    snprintf(red_val, sizeof(red_val), "%3d", red);
-    snprintf(green_val, sizeof(green_val), "%3d", green);
-    snprintf(blue_val, sizeof(blue_val), "%3d", blue);
+    numfmt_dec_u8(red_val, red);
+    numfmt_dec_u8(green_val, green);
+    numfmt_dec_u8(blue_val, blue);
     
     // For first update, do a full refresh
-    if (first_update || !DISPLAY_PARTIAL_UPDATE_ENABLED) {
+    if (first_update || !display_partial_update) {
         // Clear and redraw everything
         ssd1306_clear_screen(ssd1306_dev, 0x00);
         
         // Row 1: Red
-        ssd1306_display_string(ssd1306_dev, 0, 5, (uint8_t *)"R:", 16, 0);
-        ssd1306_display_string(ssd1306_dev, 20, 5, (uint8_t *)red_hex, 16, 0);
-        ssd1306_display_string(ssd1306_dev, 80, 5, (uint8_t *)red_val, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 0, DISPLAY_ROW_RED_Y, (uint8_t *)"R:", 16, 0);
+        ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_RED_Y, (uint8_t *)red_hex, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_RED_Y, (uint8_t *)red_val, 16, 0);
         
         // Row 2: Green
-        ssd1306_display_string(ssd1306_dev, 0, 25, (uint8_t *)"G:", 16, 0);
-        ssd1306_display_string(ssd1306_dev, 20, 25, (uint8_t *)green_hex, 16, 0);
-        ssd1306_display_string(ssd1306_dev, 80, 25, (uint8_t *)green_val, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 0, DISPLAY_ROW_GREEN_Y, (uint8_t *)"G:", 16, 0);
+        ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_GREEN_Y, (uint8_t *)green_hex, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_GREEN_Y, (uint8_t *)green_val, 16, 0);
         
         // Row 3: Blue
-        ssd1306_display_string(ssd1306_dev, 0, 45, (uint8_t *)"B:", 16, 0);
-        ssd1306_display_string(ssd1306_dev, 20, 45, (uint8_t *)blue_hex, 16, 0);
-        ssd1306_display_string(ssd1306_dev, 80, 45, (uint8_t *)blue_val, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 0, DISPLAY_ROW_BLUE_Y, (uint8_t *)"B:", 16, 0);
+        ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_BLUE_Y, (uint8_t *)blue_hex, 16, 0);
+        ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_BLUE_Y, (uint8_t *)blue_val, 16, 0);
         
         first_update = false;
     } else {
-        // Partial update - only update changed values
+        // Partial update - only update changed values. Glyphs are drawn
+        // opaque and the fields are fixed width, so the new text fully
+        // covers the old one without clearing first.
         
         if (red != prev_red) {
-            // Update hex value
-            ssd1306_fill_rectangle(ssd1306_dev, 20, 5, 60, 20, 0);
-            ssd1306_display_string(ssd1306_dev, 20, 5, (uint8_t *)red_hex, 16, 0);
-            
-            // Update numeric value
-            ssd1306_fill_rectangle(ssd1306_dev, 80, 5, 120, 20, 0);
-            ssd1306_display_string(ssd1306_dev, 80, 5, (uint8_t *)red_val, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_RED_Y, (uint8_t *)red_hex, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_RED_Y, (uint8_t *)red_val, 16, 0);
         }
         
         if (green != prev_green) {
-            // Update hex value
-            ssd1306_fill_rectangle(ssd1306_dev, 20, 25, 60, 40, 0);
-            ssd1306_display_string(ssd1306_dev, 20, 25, (uint8_t *)green_hex, 16, 0);
-            
-            // Update numeric value
-            ssd1306_fill_rectangle(ssd1306_dev, 80, 25, 120, 40, 0);
-            ssd1306_display_string(ssd1306_dev, 80, 25, (uint8_t *)green_val, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_GREEN_Y, (uint8_t *)green_hex, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_GREEN_Y, (uint8_t *)green_val, 16, 0);
         }
         
         if (blue != prev_blue) {
-            // Update hex value
-            ssd1306_fill_rectangle(ssd1306_dev, 20, 45, 60, 60, 0);
-            ssd1306_display_string(ssd1306_dev, 20, 45, (uint8_t *)blue_hex, 16, 0);
-            
-            // Update numeric value
-            ssd1306_fill_rectangle(ssd1306_dev, 80, 45, 120, 60, 0);
-            ssd1306_display_string(ssd1306_dev, 80, 45, (uint8_t *)blue_val, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 20, DISPLAY_ROW_BLUE_Y, (uint8_t *)blue_hex, 16, 0);
+            ssd1306_display_string(ssd1306_dev, 80, DISPLAY_ROW_BLUE_Y, (uint8_t *)blue_val, 16, 0);
         }
     }
     
@@ -438,21 +691,74 @@ void update_oled_display(uint8_t red, uint8_t green, uint8_t blue)
     prev_green = green;
     prev_blue = blue;
     
-    // Refresh the display
-    ssd1306_refresh_gram(ssd1306_dev);
+    perf_end(PERF_STAGE_DISPLAY_RENDER, start);
+    
+    // Refresh the display; waiting for the bus gives the governor the real frame time
+    start = perf_begin();
+    ssd1306_stats_t bus;
+    ssd1306_get_stats(ssd1306_dev, &bus);
+    uint32_t errors = bus.errors;
+    int64_t refresh_start = trace_begin();
+    esp_err_t ret = ssd1306_refresh_gram(ssd1306_dev);
+    trace_end("ssd1306_refresh_gram", refresh_start);
+    if (ret == ESP_OK) {
+        ret = ssd1306_wait_idle(ssd1306_dev, DISPLAY_GOVERNOR_MAX_INTERVAL_MS);
+    }
+    
+    // Queued transfers report a NACK or timeout only in the error count
+    ssd1306_get_stats(ssd1306_dev, &bus);
+    if (ret == ESP_OK && bus.errors != errors) {
+        ret = ESP_FAIL;
+    }
+    display_health_report(ret);
+    perf_end(PERF_STAGE_DISPLAY_FLUSH, start);
+    return ret == ESP_OK;
+}
+
+// Update OLED display with new color values
+void update_oled_display(uint8_t red, uint8_t green, uint8_t blue)
+{
+    int64_t start = trace_begin();
+    display_governor_submit(&(color_rgb_t){ red, green, blue });
+    trace_end("update_oled_display", start);
 }
 
 // Read ADC value from potentiometer and convert to 0-255 range
 uint8_t read_potentiometer(adc_oneshot_unit_handle_t adc1_handle, adc_channel_t channel)
 {
     int adc_raw;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, channel, &adc_raw));
+    // While audio capture owns ADC1 the pots are sampled along with the microphone
+    if (audio_input_read_aux(channel, &adc_raw) != ESP_OK) {
+        ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, channel, &adc_raw));
+    }
     
     // Convert directly from ADC range (0-4095) to 0-255 without reversing
     // This makes clockwise rotation increase values
     return (uint8_t)((adc_raw * 255) / 4095);
 }
 
+// Create the red, green and blue encoders
+bool init_color_encoders(void)
+{
+    const gpio_num_t pins[3][2] = {
+        { RED_ENCODER_PIN_A, RED_ENCODER_PIN_B },
+        { GREEN_ENCODER_PIN_A, GREEN_ENCODER_PIN_B },
+        { BLUE_ENCODER_PIN_A, BLUE_ENCODER_PIN_B },
+    };
+    
+    for (int i = 0; i < 3; i++) {
+        encoder_config_t config = ENCODER_DEFAULT_CONFIG(pins[i][0], pins[i][1]);
+        config.mode = ENCODER_WRAP_ENABLED ? ENCODER_MODE_WRAP : ENCODER_MODE_CLAMP;
+        if (encoder_create(&config, &color_encoders[i]) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create encoder %d", i);
+            return false;
+        }
+    }
+    
+    ESP_LOGI(TAG, "Color encoders initialized");
+    return true;
+}
+
 // Debug function to print raw ADC values with more detail
 void debug_adc_values(adc_oneshot_unit_handle_t adc1_handle)
 {
@@ -480,22 +786,378 @@ void debug_adc_values(adc_oneshot_unit_handle_t adc1_handle)
              BLUE_POT_ADC_CHANNEL, adc_raw[BLUE_POT_ADC_CHANNEL]);
 }
 
+// Compare the table-driven formatters against snprintf for the display fields
+void benchmark_number_formatting(void)
+{
+    const int iterations = 10000;
+    char hex[NUMFMT_HEX_U8_LEN];
+    char val[NUMFMT_DEC_U8_LEN];
+    volatile char sink = 0; // Keep the compiler from dropping the loops
+    
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        uint8_t v = (uint8_t)i;
+        snprintf(hex, sizeof(hex), "%02X", v);
+        snprintf(val, sizeof(val), "%3d", v);
+        sink ^= hex[1] ^ val[2];
+    }
+    int64_t snprintf_us = esp_timer_get_time() - start;
+    
+    start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        uint8_t v = (uint8_t)i;
+        numfmt_hex_u8(hex, v);
+        numfmt_dec_u8(val, v);
+        sink ^= hex[1] ^ val[2];
+    }
+    int64_t numfmt_us = esp_timer_get_time() - start;
+    (void)sink;
+    
+    ESP_LOGI(TAG, "Formatting %d hex+dec pairs: snprintf %lld us, numfmt %lld us",
+             iterations, snprintf_us, numfmt_us);
+}
+
+// bus: I2C, RMT, serial and DMX streams and input traffic
+static int cmd_bus(int argc, char **argv)
+{
+    const char *oled_bus = OLED_TRANSPORT_SPI ? "spi" : "i2c";
+    if (ssd1306_dev) {
+        ssd1306_stats_t bus;
+        ssd1306_get_stats(ssd1306_dev, &bus);
+        printf("%s:    %lu frames, %lu transactions, %lu bytes, %lu errors\n", oled_bus, (unsigned long)bus.frames,
+               (unsigned long)bus.transactions, (unsigned long)bus.bytes, (unsigned long)bus.errors);
+        display_health_stats_t health;
+        display_health_get_stats(&health);
+        printf("        %s, %lu faults, %lu recovered in %lu attempts, last error %s\n",
+               health.online ? "online" : "offline", (unsigned long)health.faults, (unsigned long)health.recoveries,
+               (unsigned long)health.attempts, esp_err_to_name(health.last_error));
+    } else {
+        printf("%s:    display not ready\n", oled_bus);
+    }
+    printf("rmt:    %lu strip frames, %lu us wire time each\n",
+           (unsigned long)perf_get_counter(PERF_COUNTER_LED_FRAMES), (unsigned long)strip_frame_time_us);
+    if (strip) {
+        led_strip_power_stats_t power;
+        led_strip_ws2812_get_power_stats(strip, &power);
+        printf("power:  %lu mA demand, %lu mA out (budget %u mA), scale %u/256, %lu frames limited\n",
+               (unsigned long)power.demand_ma, (unsigned long)power.output_ma, (unsigned)LED_POWER_BUDGET_MA,
+               power.scale, (unsigned long)power.limited_frames);
+    }
+    printf("fade:   %lu frames\n", (unsigned long)transition_get_frame_count());
+    
+    display_governor_stats_t oled;
+    display_governor_get_stats(&oled);
+    printf("oled:   %lu rendered, %lu dropped, %lu coalesced, every %lu ms, frame %lu us, cpu %u%%\n",
+           (unsigned long)oled.rendered, (unsigned long)oled.dropped, (unsigned long)oled.coalesced,
+           (unsigned long)oled.interval_ms, (unsigned long)oled.flush_avg_us, oled.cpu_load_pct);
+    
+    serial_stream_stats_t stream;
+    serial_stream_get_stats(&stream);
+    printf("serial: %lu frames, %lu dropped, %lu overflows, latency avg %lu max %lu us\n",
+           (unsigned long)stream.frames, (unsigned long)stream.dropped_frames, (unsigned long)stream.overflows,
+           (unsigned long)stream.latency_avg_us, (unsigned long)stream.latency_max_us);
+    
+    dmx_receiver_stats_t dmx;
+    dmx_receiver_get_stats(&dmx);
+    printf("dmx:    %lu frames, %lu partial, %lu sync, %lu out of sequence, %lu bad, latency avg %lu max %lu us"
+           " (output %lu us)%s\n",
+           (unsigned long)dmx.frames, (unsigned long)dmx.partial_frames, (unsigned long)dmx.sync_packets,
+           (unsigned long)dmx.sequence_drops, (unsigned long)dmx.bad_packets, (unsigned long)dmx.latency_avg_us,
+           (unsigned long)dmx.latency_max_us, (unsigned long)dmx.output_avg_us,
+           DMX_NET_ENABLED && !network_is_connected() ? ", no network" : "");
+    printf("input:  %lu dropped events\n", (unsigned long)input_get_dropped_events());
+    return 0;
+}
+
+// Decimal 0-255 with nothing after it
+static bool parse_byte(const char *arg, uint8_t *value)
+{
+    long v;
+    if (!console_parse_int(arg, 0, 255, &v)) {
+        return false;
+    }
+    *value = (uint8_t)v;
+    return true;
+}
+
+// color <#RRGGBB | r g b>: set the color through the serial command source
+static int cmd_color(int argc, char **argv)
+{
+    color_rgb_t color;
+    if (argc == 2) {
+        const char *hex = argv[1][0] == '#' ? argv[1] + 1 : argv[1];
+        char *end;
+        unsigned long value = strtoul(hex, &end, 16);
+        if (strlen(hex) != 6 || *end != '\0') {
+            printf("Usage: color <#RRGGBB | r g b>\n");
+            return 1;
+        }
+        color = (color_rgb_t){ value >> 16, (value >> 8) & 0xFF, value & 0xFF };
+    } else if (argc == 4) {
+        if (!parse_byte(argv[1], &color.r) || !parse_byte(argv[2], &color.g) || !parse_byte(argv[3], &color.b)) {
+            printf("Channels are 0-255\n");
+            return 1;
+        }
+    } else {
+        printf("Usage: color <#RRGGBB | r g b>\n");
+        return 1;
+    }
+    color_source_serial_push(serial_source, &color);
+    return 0;
+}
+
+// effect <none|hue|breathe|audio> [speed]: run an effect on the current color
+static int cmd_effect(int argc, char **argv)
+{
+    static const char *const names[EFFECT_COUNT] = {
+        [EFFECT_NONE] = "none",
+        [EFFECT_HUE_CYCLE] = "hue",
+        [EFFECT_BREATHE] = "breathe",
+        [EFFECT_AUDIO] = "audio",
+    };
+    if (argc < 2 || argc > 3) {
+        printf("Usage: effect <none|hue|breathe|audio> [speed 0-255]\n");
+        return 1;
+    }
+    for (int i = 0; i < EFFECT_COUNT; i++) {
+        if (strcmp(argv[1], names[i]) == 0) {
+            // Goes through the preset source so the main loop starts the effect
+            picker_state_t state = picker_state_snapshot();
+            color_rgb_t color = { state.red, state.green, state.blue };
+            uint8_t speed = state.effect_speed;
+            if (argc == 3 && !parse_byte(argv[2], &speed)) {
+                printf("Speed is 0-255\n");
+                return 1;
+            }
+            color_source_preset_set(preset_source, &color, i, speed);
+            return 0;
+        }
+    }
+    printf("Unknown effect '%s'\n", argv[1]);
+    return 1;
+}
+
+// audio [bench [frames]]: capture stats and band levels, or time the FFT
+static int cmd_audio(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        long frames = 1000;
+        if (argc == 3 && !console_parse_int(argv[2], 1, 1000000, &frames)) {
+            printf("Frames are 1-1000000\n");
+            return 1;
+        }
+        uint32_t fft_ns, analysis_ns;
+        if (audio_input_benchmark((uint32_t)frames, &fft_ns, &analysis_ns) != ESP_OK) {
+            printf("Benchmark failed\n");
+            return 1;
+        }
+        printf("%d-point FFT: %lu ns, %lu frames/s\n", AUDIO_FFT_SIZE,
+               (unsigned long)fft_ns, (unsigned long)(1000000000ULL / (fft_ns ? fft_ns : 1)));
+        printf("Analysis:     %lu ns, %lu frames/s (input needs %d)\n", (unsigned long)analysis_ns,
+               (unsigned long)(1000000000ULL / (analysis_ns ? analysis_ns : 1)), AUDIO_SAMPLE_RATE_HZ / AUDIO_FFT_SIZE);
+        return 0;
+    }
+    if (argc != 1) {
+        printf("Usage: audio [bench [frames]]\n");
+        return 1;
+    }
+    
+    audio_input_stats_t stats;
+    audio_input_get_stats(&stats);
+    printf("capture %s: %lu frames, %lu overruns, analysis avg %lu max %lu us\n",
+           audio_input_is_running() ? "running" : "stopped", (unsigned long)stats.frames,
+           (unsigned long)stats.overruns, (unsigned long)stats.analysis_avg_us, (unsigned long)stats.analysis_max_us);
+    uint8_t levels[AUDIO_BAND_COUNT];
+    if (audio_input_get_levels(levels)) {
+        printf("bands:");
+        for (int i = 0; i < AUDIO_BAND_COUNT; i++) {
+            printf(" %3u", levels[i]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+// preset <list | save name | recall name | delete name>
+static int cmd_preset(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "list") == 0) {
+        for (int i = 0; i < PRESET_MAX_COUNT; i++) {
+            char name[PRESET_NAME_LEN];
+            if (presets_get_name(i, name, sizeof(name))) {
+                printf("%d: %s\n", i, name);
+            }
+        }
+        return 0;
+    }
+    if (argc != 3) {
+        printf("Usage: preset <list | save name | recall name | delete name>\n");
+        return 1;
+    }
+    
+    esp_err_t ret;
+    if (strcmp(argv[1], "save") == 0) {
+        // The main loop may be writing the color as the console saves it
+        picker_state_t state = picker_state_snapshot();
+        ret = presets_save(argv[2], &state);
+    } else if (strcmp(argv[1], "recall") == 0) {
+        ret = recall_preset(argv[2]);
+    } else if (strcmp(argv[1], "delete") == 0) {
+        ret = presets_delete(argv[2]);
+    } else {
+        printf("Unknown action '%s'\n", argv[1]);
+        return 1;
+    }
+    if (ret != ESP_OK) {
+        printf("Failed: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+// Runtime console with the application's switches and commands
+static void start_console(void)
+{
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    if (SERIAL_STREAM_ENABLED && CONFIG_ESP_CONSOLE_UART_NUM == SERIAL_STREAM_UART_NUM) {
+        ESP_LOGW(TAG, "Console disabled: UART%d carries the serial pixel stream", SERIAL_STREAM_UART_NUM);
+        return;
+    }
+#endif
+    
+    console_register_toggle("partial_update", &display_partial_update, "Redraw only changed display fields");
+    console_register_toggle("adc_debug", &adc_debug_log, "Log raw ADC readings every 20 loops");
+    console_register_toggle("color_log", &color_log, "Log color changes");
+    if (console_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start console");
+        return;
+    }
+    
+    const esp_console_cmd_t commands[] = {
+        { .command = "bus", .help = "I2C, RMT, serial and DMX stream and input counters", .func = cmd_bus },
+        { .command = "color", .help = "Set the color: 'color #RRGGBB' or 'color r g b'", .func = cmd_color },
+        { .command = "effect", .help = "Run an effect: 'effect <none|hue|breathe|audio> [speed]'", .func = cmd_effect },
+        { .command = "audio", .help = "Audio capture stats, or time the FFT: 'audio [bench [frames]]'", .func = cmd_audio },
+        { .command = "preset", .help = "Presets: 'preset list|save|recall|delete [name]'", .func = cmd_preset },
+    };
+    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        ESP_ERROR_CHECK(esp_console_cmd_register(&commands[i]));
+    }
+}
+
 void app_main(void)
 {
     // Initialize components
+    boot_profile_mark("app_main");
     ESP_LOGI(TAG, "Starting LED Color Picker");
     
+    // NVS holds settings such as the display address
+    esp_err_t nvs_ret = nvs_flash_init();
+    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        nvs_ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(nvs_ret);
+    boot_profile_mark("nvs ready");
+    
+    // Restore the state from the last session
+    bool state_restored = false;
+    if (presets_init(&picker_state, &state_restored) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize presets");
+    }
+    if (state_restored) {
+        onboard_led_active = picker_state.onboard_led_active;
+        ESP_LOGI(TAG, "Restored state: R=%d G=%d B=%d, onboard LED %s",
+                 picker_state.red, picker_state.green, picker_state.blue,
+                 onboard_led_active ? "ON" : "OFF");
+    }
+    
     init_gpio();
-    init_i2c();
+    
+    // The display comes up in parallel, so a missing or stuck panel never
+    // holds up the LEDs; frames are dropped until it is ready
+    xTaskCreate(display_init_task, "display_init", 4096, NULL, 5, NULL);
     
     adc_oneshot_unit_handle_t adc1_handle;
     if (!init_adc(&adc1_handle)) {
         ESP_LOGE(TAG, "Failed to initialize ADC");
         return;
     }
+    boot_profile_mark("adc ready");
+    
+    if (AUDIO_INPUT_ENABLED) {
+        // The pots share ADC1 with the microphone; capture samples them too
+        const adc_channel_t pots[] = { RED_POT_ADC_CHANNEL, GREEN_POT_ADC_CHANNEL, BLUE_POT_ADC_CHANNEL };
+        if (audio_input_init(AUDIO_ADC_CHANNEL, pots, COLOR_INPUT_ENCODERS ? 0 : 3) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize audio input");
+        }
+    }
     
     init_rgb_leds();
-    init_oled();
+    boot_profile_mark("leds ready");
+    
+    if (SERIAL_STREAM_ENABLED && serial_stream_start(strip) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start serial pixel stream");
+    }
+    
+    if (SEQUENCE_ENABLED && strip && sequence_init(strip) != ESP_OK) {
+        ESP_LOGW(TAG, "Sequence playback unavailable");
+    }
+    
+    if (COLOR_INPUT_ENCODERS && !init_color_encoders()) {
+        return;
+    }
+    
+    // Color sources: the manual one (pots or encoders) is always polled and
+    // takes over when touched; presets and serial commands take over when they
+    // deliver a color; an effect runs while it is the active source
+    manual_source = COLOR_INPUT_ENCODERS
+                    ? color_source_new_encoders(color_encoders[0], color_encoders[1], color_encoders[2])
+                    : color_source_new_pots(adc1_handle);
+    preset_source = color_source_new_preset();
+    serial_source = color_source_new_serial();
+    effect_source = color_source_new_effect();
+    if (!manual_source || !preset_source || !serial_source || !effect_source) {
+        ESP_LOGE(TAG, "Failed to create color sources");
+        return;
+    }
+    
+    color_source_t *active_source = manual_source;
+    color_rgb_t color;
+    if (state_restored) {
+        color = (color_rgb_t){ picker_state.red, picker_state.green, picker_state.blue };
+        if (picker_state.effect != EFFECT_NONE) {
+            color_source_effect_set(effect_source, picker_state.effect, picker_state.effect_speed, &color);
+            active_source = effect_source;
+        }
+        manual_source->sync(manual_source, &color);
+    } else {
+        manual_source->read(manual_source, &color);
+        picker_state.red = color.r;
+        picker_state.green = color.g;
+        picker_state.blue = color.b;
+    }
+    
+    if (display_governor_init(render_oled_display, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start display governor");
+    }
+    
+    // Show the color right away instead of after the display is up
+    show_color(&color, NULL);
+    if (transition_init(&color, show_color, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start transition engine");
+        return;
+    }
+    boot_profile_mark("first color");
+    
+    // WiFi bring-up takes a while; start the network and the DMX receiver
+    // once the first color is out and the transition engine is running
+    if (DMX_NET_ENABLED && strip) {
+        led_strip_t *const dmx_strips[] = { strip };
+        if (network_start() != ESP_OK || dmx_receiver_start(dmx_strips, 1) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start DMX receiver");
+        }
+    }
     
     // Run the blue pot detection routine
     ESP_LOGI(TAG, "Starting automatic detection of blue potentiometer channel...");
@@ -503,13 +1165,30 @@ void app_main(void)
     // uint8_t detected_blue_channel = find_blue_pot_channel(adc1_handle);
     // ESP_LOGI(TAG, "Detection suggests blue potentiometer might be on channel: %d", detected_blue_channel);
     
-    // Create a task to handle button presses
-    xTaskCreate(button_task, "button_task", 2048, NULL, 10, NULL);
+    // Uncomment to compare display field formatting against snprintf:
+    // benchmark_number_formatting();
+    
+    // Start the input engine for button gestures
+    const input_button_config_t boot_button = {
+        .gpio = BOOT_BUTTON_PIN,
+        .active_low = true,
+        .double_press = true,
+    };
+    if (input_init() != ESP_OK ||
+        input_add_button(&boot_button, &boot_button_id) != ESP_OK ||
+        input_register_handler(handle_input_event, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize button input");
+    }
+    
+    if (CONSOLE_ENABLED) {
+        start_console();
+    }
+    console_mark_heap_baseline();
     
     // Main loop
-    uint8_t red = 0, green = 0, blue = 0;
-    uint8_t prev_red = 0, prev_green = 0, prev_blue = 0;
     uint32_t debug_counter = 0;
+    bool display_shown = false;
+    bool was_streaming = false;
     
     // Try different channels for blue pot
     adc_channel_t blue_channel_options[] = {
@@ -529,8 +1208,10 @@ void app_main(void)
     
     ESP_LOGI(TAG, "Entering main loop - using channel %d for blue pot", BLUE_POT_ADC_CHANNEL);
     while (1) {
+        int64_t loop_start = trace_begin();
+        
         // Print debug ADC values every 20 iterations
-        if (debug_counter % 20 == 0) {
+        if (adc_debug_log && debug_counter % 20 == 0) {
             debug_adc_values(adc1_handle);
             
             // Rotate through channels automatically every ~5 seconds (if enabled)
@@ -543,30 +1224,95 @@ void app_main(void)
         }
         debug_counter++;
         
-        // Read potentiometer values
-        red = read_potentiometer(adc1_handle, RED_POT_ADC_CHANNEL);
-        green = read_potentiometer(adc1_handle, GREEN_POT_ADC_CHANNEL);
-        blue = read_potentiometer(adc1_handle, BLUE_POT_ADC_CHANNEL);  // Use the fixed channel from main.h, not the current_blue_channel variable
+        // Poll the sources; the first with something new becomes active
+        int64_t inputs_start = perf_begin();
+        bool changed = false;
+        if (manual_source->read(manual_source, &color)) {
+            active_source = manual_source;
+            changed = true;
+        } else if (preset_source->read(preset_source, &color)) {
+            color_effect_t effect;
+            uint8_t speed;
+            color_source_preset_get_effect(preset_source, &effect, &speed);
+            active_source = preset_source;
+            if (effect != EFFECT_NONE) {
+                // The recalled preset carries an effect based on its color
+                portENTER_CRITICAL(&picker_lock);
+                picker_state.red = color.r;
+                picker_state.green = color.g;
+                picker_state.blue = color.b;
+                picker_state.effect = effect;
+                picker_state.effect_speed = speed;
+                portEXIT_CRITICAL(&picker_lock);
+                color_source_effect_set(effect_source, effect, speed, &color);
+                active_source = effect_source;
+                effect_source->read(effect_source, &color);
+            }
+            changed = true;
+        } else if (serial_source->read(serial_source, &color)) {
+            active_source = serial_source;
+            changed = true;
+        } else if (active_source == effect_source) {
+            changed = effect_source->read(effect_source, &color);
+        }
+        
+        perf_end(PERF_STAGE_INPUTS, inputs_start);
         
-        // Update only if the color has changed
-        if (red != prev_red || green != prev_green || blue != prev_blue) {
-            update_rgb_leds(red, green, blue);
-            update_oled_display(red, green, blue);
-            update_onboard_led(red, green, blue);
+        if (changed) {
+            if (active_source != manual_source) {
+                manual_source->sync(manual_source, &color);
+            }
             
-            if (debug_counter % 10 == 0) {
-                ESP_LOGI(TAG, "Color updated: R=%d (CH%d), G=%d (CH%d), B=%d (CH%d)", 
-                       red, RED_POT_ADC_CHANNEL,
-                       green, GREEN_POT_ADC_CHANNEL,
-                       blue, BLUE_POT_ADC_CHANNEL);
+            // Effects step once per loop; fading over exactly one loop period
+            // joins the steps into smooth motion at the transition frame rate.
+            // The LEDs go first so the display never delays them.
+            transition_set_target(&color, active_source == effect_source ? MAIN_LOOP_INTERVAL_MS : TRANSITION_DURATION_MS);
+            
+            // Effect steps are not user activity and let the display sleep
+            if (active_source != effect_source) {
+                display_power_activity();
             }
+            update_oled_display(color.r, color.g, color.b);
             
-            prev_red = red;
-            prev_green = green;
-            prev_blue = blue;
+            if (color_log && debug_counter % 10 == 0) {
+                char color_hex[1 + 3 * (NUMFMT_HEX_U8_LEN - 1) + 1] = "#";
+                numfmt_hex_u8(numfmt_hex_u8(numfmt_hex_u8(color_hex + 1, color.r), color.g), color.b);
+                ESP_LOGI(TAG, "Color updated %s from %s: R=%d, G=%d, B=%d", color_hex,
+                         active_source->name, color.r, color.g, color.b);
+            }
+            
+            // Written to NVS only once the color has settled. An effect
+            // keeps its base color; anything else replaces the effect.
+            if (active_source != effect_source) {
+                // Stops the effect too, so it releases what it runs on (audio capture)
+                color_source_effect_set(effect_source, EFFECT_NONE, 0, &color);
+                portENTER_CRITICAL(&picker_lock);
+                picker_state.red = color.r;
+                picker_state.green = color.g;
+                picker_state.blue = color.b;
+                picker_state.effect = EFFECT_NONE;
+                portEXIT_CRITICAL(&picker_lock);
+            }
+            picker_state_t state = picker_state_snapshot();
+            presets_update_state(&state);
+        }
+        
+        // Put the picked color back when a serial or DMX stream or a sequence ends
+        bool streaming = serial_stream_is_active() || dmx_receiver_is_active() || sequence_is_playing();
+        if (was_streaming && !streaming) {
+            transition_redraw();
         }
+        was_streaming = streaming;
+        
+        // The display may come up after the color has settled; draw it once when it does
+        if (!display_shown && ssd1306_dev != NULL) {
+            update_oled_display(color.r, color.g, color.b);
+            display_shown = true;
+        }
+        
+        trace_end("main_loop", loop_start);
         
         // Small delay to avoid excessive updates
-        vTaskDelay(pdMS_TO_TICKS(50));
+        vTaskDelay(pdMS_TO_TICKS(MAIN_LOOP_INTERVAL_MS));
     }
 }
\ No newline at end of file
@@ -7,7 +7,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
+#include "driver/spi_master.h"
+#include "driver/uart.h"
 #include "esp_log.h"
 #include "driver/adc.h"
 #include "esp_adc/adc_oneshot.h"
@@ -17,45 +19,192 @@
 // Debug tag for logging
 #define TAG "LED_COLOR_PICKER"
 
+// Build configuration comes from Kconfig (idf.py menuconfig, "LED Color
+// Picker"); the names below are what the code uses. Kconfig leaves disabled
+// bool options undefined, hence the #ifdef blocks.
+
 // GPIO pin definitions
-#define RGB_LED_DATA_PIN     1   // GPIO1 for RGB LED data
-#define ONBOARD_LED_PIN      21  // GPIO21 for onboard RGB LED
-#define BOOT_BUTTON_PIN      0   // GPIO0 for boot button
+#define RGB_LED_DATA_PIN     CONFIG_PICKER_LED_DATA_PIN
+#define ONBOARD_LED_PIN      CONFIG_PICKER_ONBOARD_LED_PIN
+#define BOOT_BUTTON_PIN      CONFIG_PICKER_BOOT_BUTTON_PIN
+
+#define RED_POT_ADC_CHANNEL   ((adc_channel_t)CONFIG_PICKER_RED_POT_ADC_CHANNEL)
+#define GREEN_POT_ADC_CHANNEL ((adc_channel_t)CONFIG_PICKER_GREEN_POT_ADC_CHANNEL)
+#define BLUE_POT_ADC_CHANNEL  ((adc_channel_t)CONFIG_PICKER_BLUE_POT_ADC_CHANNEL)
+
+// Audio-reactive effect: microphone or line input, sampled together with the pots
+#ifdef CONFIG_PICKER_AUDIO_INPUT
+#define AUDIO_INPUT_ENABLED   true
+#else
+#define AUDIO_INPUT_ENABLED   false
+#endif
+#define AUDIO_ADC_CHANNEL     ((adc_channel_t)CONFIG_PICKER_AUDIO_ADC_CHANNEL)
 
-#define RED_POT_ADC_CHANNEL   ADC_CHANNEL_1
-#define GREEN_POT_ADC_CHANNEL ADC_CHANNEL_2
-#define BLUE_POT_ADC_CHANNEL  ADC_CHANNEL_3
+// Rotary encoders (PCNT), used instead of the pots when enabled
+#ifdef CONFIG_PICKER_COLOR_INPUT_ENCODERS
+#define COLOR_INPUT_ENCODERS  true
+#else
+#define COLOR_INPUT_ENCODERS  false
+#endif
+#ifdef CONFIG_PICKER_ENCODER_WRAP
+#define ENCODER_WRAP_ENABLED  true
+#else
+#define ENCODER_WRAP_ENABLED  false
+#endif
+#define RED_ENCODER_PIN_A     CONFIG_PICKER_RED_ENCODER_PIN_A
+#define RED_ENCODER_PIN_B     CONFIG_PICKER_RED_ENCODER_PIN_B
+#define GREEN_ENCODER_PIN_A   CONFIG_PICKER_GREEN_ENCODER_PIN_A
+#define GREEN_ENCODER_PIN_B   CONFIG_PICKER_GREEN_ENCODER_PIN_B
+#define BLUE_ENCODER_PIN_A    CONFIG_PICKER_BLUE_ENCODER_PIN_A
+#define BLUE_ENCODER_PIN_B    CONFIG_PICKER_BLUE_ENCODER_PIN_B
+
+// ADC1 channel n is GPIO n + 1 on the ESP32-S3
+#if defined(CONFIG_PICKER_AUDIO_INPUT) && defined(CONFIG_PICKER_COLOR_INPUT_ENCODERS)
+#if CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_RED_ENCODER_PIN_A || \
+    CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_RED_ENCODER_PIN_B || \
+    CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_GREEN_ENCODER_PIN_A || \
+    CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_GREEN_ENCODER_PIN_B || \
+    CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_BLUE_ENCODER_PIN_A || \
+    CONFIG_PICKER_AUDIO_ADC_CHANNEL + 1 == CONFIG_PICKER_BLUE_ENCODER_PIN_B
+#error "The microphone ADC channel (PICKER_AUDIO_ADC_CHANNEL) is on an encoder pin"
+#endif
+#endif
 
 // I2C pins for OLED display
-#define OLED_SDA_PIN         5
-#define OLED_SCL_PIN         6
-#define I2C_MASTER_FREQ_HZ   400000  // I2C clock frequency
-#define OLED_ADDR            0x78    // Updated address for SSD1306 (was 0x3C)
+#define OLED_SDA_PIN         CONFIG_PICKER_OLED_SDA_PIN
+#define OLED_SCL_PIN         CONFIG_PICKER_OLED_SCL_PIN
+#define I2C_MASTER_FREQ_HZ   CONFIG_PICKER_I2C_MASTER_FREQ_HZ
+#ifdef CONFIG_PICKER_I2C_FAST_MODE_PLUS
+#define I2C_FAST_MODE_PLUS   true    // Falls back to I2C_MASTER_FREQ_HZ if the panel fails
+#else
+#define I2C_FAST_MODE_PLUS   false
+#endif
+#define I2C_TRANS_QUEUE_DEPTH CONFIG_PICKER_I2C_TRANS_QUEUE_DEPTH // Queued I2C transactions, enables async display writes
+#define OLED_ADDR            CONFIG_PICKER_OLED_ADDR // 7-bit I2C address
 
 // I2C master number
 #define I2C_MASTER_NUM       I2C_NUM_0
 
+// SPI-wired OLED modules
+#ifdef CONFIG_PICKER_OLED_TRANSPORT_SPI
+#define OLED_TRANSPORT_SPI   true
+#else
+#define OLED_TRANSPORT_SPI   false
+#endif
+#define OLED_SPI_HOST        SPI2_HOST
+#define OLED_SPI_SCLK_PIN    CONFIG_PICKER_OLED_SPI_SCLK_PIN
+#define OLED_SPI_MOSI_PIN    CONFIG_PICKER_OLED_SPI_MOSI_PIN
+#define OLED_SPI_CS_PIN      CONFIG_PICKER_OLED_SPI_CS_PIN
+#define OLED_SPI_DC_PIN      CONFIG_PICKER_OLED_SPI_DC_PIN
+#define OLED_SPI_RST_PIN     CONFIG_PICKER_OLED_SPI_RST_PIN
+
 // RGB LED parameters
-#define LED_COUNT            4      // 4 RGB LEDs 
-#define LED_BRIGHTNESS       64     // 0-255 (lower is brighter for WS2812)
-#define DEBOUNCE_TIME_MS     200    // Debounce time for button in milliseconds
+#define LED_COUNT            CONFIG_PICKER_LED_COUNT
+#if CONFIG_PICKER_LED_FORMAT_RGB
+#define LED_PIXEL_FORMAT     LED_PIXEL_FORMAT_RGB
+#elif CONFIG_PICKER_LED_FORMAT_BRG
+#define LED_PIXEL_FORMAT     LED_PIXEL_FORMAT_BRG
+#elif CONFIG_PICKER_LED_FORMAT_GRBW
+#define LED_PIXEL_FORMAT     LED_PIXEL_FORMAT_GRBW
+#elif CONFIG_PICKER_LED_FORMAT_RGBW
+#define LED_PIXEL_FORMAT     LED_PIXEL_FORMAT_RGBW
+#else
+#define LED_PIXEL_FORMAT     LED_PIXEL_FORMAT_GRB
+#endif
+#if CONFIG_PICKER_LED_TIMING_SK6812
+#define LED_STRIP_TIMING     LED_STRIP_TIMING_SK6812
+#elif CONFIG_PICKER_LED_TIMING_WS2811
+#define LED_STRIP_TIMING     LED_STRIP_TIMING_WS2811
+#else
+#define LED_STRIP_TIMING     LED_STRIP_TIMING_WS2812
+#endif
+#define LED_BRIGHTNESS       CONFIG_PICKER_LED_BRIGHTNESS
+#define LED_POWER_BUDGET_MA  CONFIG_PICKER_LED_POWER_BUDGET_MA
+#define LED_MA_PER_CHANNEL   CONFIG_PICKER_LED_MA_PER_CHANNEL
+#define LED_IDLE_MA_PER_LED  CONFIG_PICKER_LED_IDLE_MA_PER_LED
+#define FAVORITE_PRESET_NAME "favorite" // Preset stored by a long press, recalled by a double press
+#define POT_TAKEOVER_THRESHOLD 8    // Pot movement (0-255 scale) that overrides a restored color
+
+// Serial pixel streaming (Adalight/TPM2 from a PC)
+#ifdef CONFIG_PICKER_SERIAL_STREAM
+#define SERIAL_STREAM_ENABLED true
+#else
+#define SERIAL_STREAM_ENABLED false
+#endif
+#define SERIAL_STREAM_UART_NUM CONFIG_PICKER_SERIAL_STREAM_UART_NUM
+#define SERIAL_STREAM_BAUD     CONFIG_PICKER_SERIAL_STREAM_BAUD
+#define SERIAL_STREAM_TX_PIN   UART_PIN_NO_CHANGE
+#define SERIAL_STREAM_RX_PIN   UART_PIN_NO_CHANGE
+
+// DMX over WiFi (E1.31/sACN and Art-Net from a lighting console)
+#ifdef CONFIG_PICKER_DMX_NET
+#define DMX_NET_ENABLED      true
+#else
+#define DMX_NET_ENABLED      false
+#endif
+#define WIFI_SSID            CONFIG_PICKER_WIFI_SSID
+#define WIFI_PASSWORD        CONFIG_PICKER_WIFI_PASSWORD
+#define DMX_UNIVERSE         CONFIG_PICKER_DMX_UNIVERSE      // Art-Net port-address is one less
+#define DMX_START_CHANNEL    CONFIG_PICKER_DMX_START_CHANNEL
+
+// Sequences recorded on the device or encoded on a host, played from flash
+#ifdef CONFIG_PICKER_SEQUENCE
+#define SEQUENCE_ENABLED     true
+#else
+#define SEQUENCE_ENABLED     false
+#endif
+#define SEQUENCE_RECORD_KB   CONFIG_PICKER_SEQUENCE_RECORD_KB // RAM for a recording: .bss, or heap until it is saved
+
+// Boot configuration
+#ifdef CONFIG_PICKER_FAST_BOOT
+#define FAST_BOOT_ENABLED    true   // Skip the bus scan, splash screen and settle delays of display bring-up
+#else
+#define FAST_BOOT_ENABLED    false
+#endif
+#define NVS_NAMESPACE        "picker" // NVS namespace for persisted settings
+
+// Console and diagnostics
+#ifdef CONFIG_PICKER_CONSOLE
+#define CONSOLE_ENABLED       true
+#else
+#define CONSOLE_ENABLED       false
+#endif
+#ifdef CONFIG_PICKER_ADC_DEBUG_LOG
+#define ADC_DEBUG_LOG_ENABLED true  // Default for raw ADC logging (console: set adc_debug)
+#else
+#define ADC_DEBUG_LOG_ENABLED false
+#endif
+
+// Main loop configuration
+#define MAIN_LOOP_INTERVAL_MS CONFIG_PICKER_MAIN_LOOP_INTERVAL_MS // Outputs are smoothed by the transition engine
+
+// Display update configuration (frame pacing: display_governor.h)
+#ifdef CONFIG_PICKER_DISPLAY_PARTIAL_UPDATE
+#define DISPLAY_PARTIAL_UPDATE_ENABLED true // Default for partial screen updates (console: set partial_update)
+#else
+#define DISPLAY_PARTIAL_UPDATE_ENABLED false
+#endif
 
-// Display update configuration
-#define DISPLAY_UPDATE_MIN_INTERVAL_MS 50  // Minimum time between display updates (ms)
-#define DISPLAY_PARTIAL_UPDATE_ENABLED true // Enable partial screen updates to reduce flashing
+// Display layout: rows start on 8-pixel page boundaries so glyphs are plain page copies
+#define DISPLAY_ROW_RED_Y    0
+#define DISPLAY_ROW_GREEN_Y  24
+#define DISPLAY_ROW_BLUE_Y   48
 
 // Function prototypes
 void app_main(void);
 void init_gpio(void);
 void init_i2c(void);
+void init_spi(void);
 bool init_adc(adc_oneshot_unit_handle_t *adc1_handle);
 void init_rgb_leds(void);
 void update_rgb_leds(uint8_t red, uint8_t green, uint8_t blue);
 void update_onboard_led(uint8_t red, uint8_t green, uint8_t blue);
 void init_oled(void);
+void display_init_task(void *pvParameter);
 void update_oled_display(uint8_t red, uint8_t green, uint8_t blue);
 uint8_t read_potentiometer(adc_oneshot_unit_handle_t adc1_handle, adc_channel_t channel);
-void button_task(void *pvParameter);
+bool init_color_encoders(void);
 void debug_adc_values(adc_oneshot_unit_handle_t adc1_handle);
+void benchmark_number_formatting(void);
 
 #endif // MAIN_H
\ No newline at end of file
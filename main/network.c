@@ -0,0 +1,113 @@
+#include "network.h"
+#include "main.h"
+#include "freertos/event_groups.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+
+#define NETWORK_CONNECTED_BIT   BIT0
+
+static EventGroupHandle_t network_events = NULL;
+static volatile uint32_t connect_count = 0;
+static esp_timer_handle_t retry_timer = NULL;
+
+static void retry_connect(void *arg)
+{
+    esp_wifi_connect();
+}
+
+static void on_wifi_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *event = data;
+        if (xEventGroupGetBits(network_events) & NETWORK_CONNECTED_BIT) {
+            ESP_LOGW(TAG, "WiFi disconnected (reason %d), reconnecting", event->reason);
+        }
+        xEventGroupClearBits(network_events, NETWORK_CONNECTED_BIT);
+        // Not from the event handler: a missing access point would be retried back to back
+        esp_timer_start_once(retry_timer, NETWORK_RETRY_DELAY_MS * 1000ULL);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *event = data;
+        ESP_LOGI(TAG, "WiFi connected, IP " IPSTR, IP2STR(&event->ip_info.ip));
+        connect_count++;
+        xEventGroupSetBits(network_events, NETWORK_CONNECTED_BIT);
+    }
+}
+
+esp_err_t network_start(void)
+{
+    network_events = xEventGroupCreate();
+    if (!network_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t retry_args = {
+        .callback = retry_connect,
+        .name = "wifi_retry",
+    };
+    esp_err_t ret = esp_timer_create(&retry_args, &retry_timer);
+    if (ret == ESP_OK) {
+        ret = esp_netif_init();
+    }
+    if (ret == ESP_OK) {
+        ret = esp_event_loop_create_default();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Network stack setup failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    esp_netif_create_default_wifi_sta();
+    
+    wifi_init_config_t init_config = WIFI_INIT_CONFIG_DEFAULT();
+    ret = esp_wifi_init(&init_config);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, on_wifi_event, NULL);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_wifi_event, NULL);
+    }
+    
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASSWORD,
+        },
+    };
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_start();
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_ps(WIFI_PS_NONE);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi setup failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "Connecting to WiFi network \"%s\"", WIFI_SSID);
+    return ESP_OK;
+}
+
+bool network_wait_connected(TickType_t timeout)
+{
+    EventBits_t bits = xEventGroupWaitBits(network_events, NETWORK_CONNECTED_BIT, pdFALSE, pdTRUE, timeout);
+    return bits & NETWORK_CONNECTED_BIT;
+}
+
+bool network_is_connected(void)
+{
+    return network_events && (xEventGroupGetBits(network_events) & NETWORK_CONNECTED_BIT);
+}
+
+uint32_t network_get_connect_count(void)
+{
+    return connect_count;
+}
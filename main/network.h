@@ -0,0 +1,26 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// WiFi station configuration (credentials: WIFI_SSID and WIFI_PASSWORD in main.h)
+#define NETWORK_RETRY_DELAY_MS  2000    // Pause between reconnect attempts after a disconnect
+
+// Join WIFI_SSID as a station and stay connected; needs NVS to be initialized.
+// Power saving is off: modem sleep holds received packets until the next
+// beacon, adding up to a beacon interval (~100 ms) to stream latency.
+esp_err_t network_start(void);
+
+// Block until an IP address is assigned; false on timeout
+bool network_wait_connected(TickType_t timeout);
+
+bool network_is_connected(void);
+
+// Incremented on every new IP address, so users can redo per-connection
+// setup such as multicast group membership after a reconnect
+uint32_t network_get_connect_count(void);
+
+#endif // NETWORK_H
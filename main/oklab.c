@@ -0,0 +1,107 @@
+#include "oklab.h"
+#include <math.h>
+
+// Everything per conversion is fixed point: Q16 for linear light and Lab,
+// Q14 for the matrices, and two tables for the sRGB transfer curve.
+
+#define Q14(x) ((int32_t)((x) * 16384.0 + ((x) < 0 ? -0.5 : 0.5)))
+static uint16_t srgb_to_linear[256];                    // Q16, saturating at 65535
+static uint16_t srgb_threshold[256];                    // Q16 linear level where code i starts
+
+static float srgb_decode(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+void oklab_init(void)
+{
+    for (int i = 0; i < 256; i++) {
+        uint32_t v = (uint32_t)(srgb_decode(i / 255.0f) * 65535.0f + 0.5f);
+        srgb_to_linear[i] = v > 65535 ? 65535 : v;
+        // Halfway between two codes in sRGB, so encoding rounds like the
+        // float curve instead of truncating to a table cell
+        srgb_threshold[i] = i == 0 ? 0 : (uint16_t)(srgb_decode((i - 0.5f) / 255.0f) * 65535.0f + 0.5f);
+    }
+}
+
+// Integer cube root of a 64-bit value
+static uint32_t icbrt64(uint64_t x)
+{
+    uint64_t y = 0;
+    for (int s = 63; s >= 0; s -= 3) {
+        y <<= 1;
+        uint64_t b = 3 * y * (y + 1) + 1;
+        if ((x >> s) >= b) {
+            x -= b << s;
+            y++;
+        }
+    }
+    return (uint32_t)y;
+}
+
+// Cube root of a Q16 value, in Q16
+static int32_t cbrt_q16(int32_t x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    return (int32_t)icbrt64((uint64_t)x << 32);
+}
+
+static int32_t mat3_row(int32_t c0, int32_t c1, int32_t c2, int32_t x, int32_t y, int32_t z)
+{
+    return (int32_t)(((int64_t)c0 * x + (int64_t)c1 * y + (int64_t)c2 * z + (1 << 13)) >> 14);
+}
+
+oklab_t oklab_from_srgb(uint8_t r8, uint8_t g8, uint8_t b8)
+{
+    int32_t r = srgb_to_linear[r8];
+    int32_t g = srgb_to_linear[g8];
+    int32_t b = srgb_to_linear[b8];
+    
+    int32_t l = cbrt_q16(mat3_row(Q14(0.4122214708), Q14(0.5363325363), Q14(0.0514459929), r, g, b));
+    int32_t m = cbrt_q16(mat3_row(Q14(0.2119034982), Q14(0.6806995451), Q14(0.1073969566), r, g, b));
+    int32_t s = cbrt_q16(mat3_row(Q14(0.0883024619), Q14(0.2817188376), Q14(0.6299787005), r, g, b));
+    
+    oklab_t lab = {
+        .L = mat3_row(Q14(0.2104542553), Q14(0.7936177850), Q14(-0.0040720468), l, m, s),
+        .a = mat3_row(Q14(1.9779984951), Q14(-2.4285922050), Q14(0.4505937099), l, m, s),
+        .b = mat3_row(Q14(0.0259040371), Q14(0.7827717662), Q14(-0.8086757660), l, m, s),
+    };
+    return lab;
+}
+
+static int32_t cube_q16(int32_t x)
+{
+    int64_t x2 = ((int64_t)x * x) >> 16;
+    return (int32_t)((x2 * x) >> 16);
+}
+
+// Highest code whose threshold v reaches: eight steps of a binary search
+static uint8_t linear_q16_to_srgb(int32_t v)
+{
+    if (v <= 0) {
+        return 0;
+    }
+    if (v >= 65535) {
+        return 255;
+    }
+    uint32_t code = 0;
+    for (uint32_t step = 128; step > 0; step >>= 1) {
+        if (v >= srgb_threshold[code + step]) {
+            code += step;
+        }
+    }
+    return (uint8_t)code;
+}
+
+void oklab_to_srgb(const oklab_t *lab, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    int32_t l = cube_q16(mat3_row(Q14(1.0), Q14(0.3963377774), Q14(0.2158037573), lab->L, lab->a, lab->b));
+    int32_t m = cube_q16(mat3_row(Q14(1.0), Q14(-0.1055613458), Q14(-0.0638541728), lab->L, lab->a, lab->b));
+    int32_t s = cube_q16(mat3_row(Q14(1.0), Q14(-0.0894841775), Q14(-1.2914855480), lab->L, lab->a, lab->b));
+    
+    *r = linear_q16_to_srgb(mat3_row(Q14(4.0767416621), Q14(-3.3077115913), Q14(0.2309699292), l, m, s));
+    *g = linear_q16_to_srgb(mat3_row(Q14(-1.2684380046), Q14(2.6097574011), Q14(-0.3413193965), l, m, s));
+    *b = linear_q16_to_srgb(mat3_row(Q14(-0.0041960863), Q14(-0.7034186147), Q14(1.7076147010), l, m, s));
+}
@@ -0,0 +1,22 @@
+#ifndef OKLAB_H
+#define OKLAB_H
+
+#include <stdint.h>
+
+// Fixed-point OKLab conversion for the transition engine. Plain C with no
+// ESP-IDF dependencies so tools/oklab_check.c can run it on the host.
+
+typedef struct {
+    int32_t L, a, b;        // Q16
+} oklab_t;
+
+// Build the sRGB transfer tables; call once before converting
+void oklab_init(void);
+
+// 8-bit sRGB to OKLab
+oklab_t oklab_from_srgb(uint8_t r, uint8_t g, uint8_t b);
+
+// OKLab to 8-bit sRGB, clipping out-of-gamut colors per channel
+void oklab_to_srgb(const oklab_t *lab, uint8_t *r, uint8_t *g, uint8_t *b);
+
+#endif // OKLAB_H
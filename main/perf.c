@@ -0,0 +1,80 @@
+#include "perf.h"
+#include "main.h"
+#include "trace.h"
+
+static perf_stage_stats_t stages[PERF_STAGE_COUNT];
+static uint32_t counters[PERF_COUNTER_COUNT];  // Atomic increments, outside perf_lock
+static portMUX_TYPE perf_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const stage_names[PERF_STAGE_COUNT] = {
+    [PERF_STAGE_INPUTS] = "inputs",
+    [PERF_STAGE_TRANSITION] = "transition",
+    [PERF_STAGE_LED_REFRESH] = "led_refresh",
+    [PERF_STAGE_DISPLAY_RENDER] = "display_render",
+    [PERF_STAGE_DISPLAY_FLUSH] = "display_flush",
+    [PERF_STAGE_AUDIO_ANALYSIS] = "audio_analysis",
+};
+
+static const char *const counter_names[PERF_COUNTER_COUNT] = {
+    [PERF_COUNTER_LED_FRAMES] = "led_frames",
+};
+
+void perf_end(perf_stage_t stage, int64_t start_us)
+{
+    int64_t end_us = esp_timer_get_time();
+    uint32_t us = (uint32_t)(end_us - start_us);
+    trace_span(stage_names[stage], start_us, end_us);
+    
+    // Bucket n holds durations below 2^(n+1) us
+    int bucket = us ? 31 - __builtin_clz(us) : 0;
+    if (bucket >= PERF_HIST_BUCKETS) {
+        bucket = PERF_HIST_BUCKETS - 1;
+    }
+    
+    portENTER_CRITICAL(&perf_lock);
+    perf_stage_stats_t *s = &stages[stage];
+    s->count++;
+    s->total_us += us;
+    if (us > s->max_us) {
+        s->max_us = us;
+    }
+    s->buckets[bucket]++;
+    portEXIT_CRITICAL(&perf_lock);
+}
+
+void perf_count(perf_counter_t counter)
+{
+    __atomic_fetch_add(&counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+void perf_get_stage(perf_stage_t stage, perf_stage_stats_t *stats)
+{
+    portENTER_CRITICAL(&perf_lock);
+    *stats = stages[stage];
+    portEXIT_CRITICAL(&perf_lock);
+}
+
+uint32_t perf_get_counter(perf_counter_t counter)
+{
+    return __atomic_load_n(&counters[counter], __ATOMIC_RELAXED);
+}
+
+const char *perf_stage_name(perf_stage_t stage)
+{
+    return stage_names[stage];
+}
+
+const char *perf_counter_name(perf_counter_t counter)
+{
+    return counter_names[counter];
+}
+
+void perf_reset(void)
+{
+    portENTER_CRITICAL(&perf_lock);
+    memset(stages, 0, sizeof(stages));
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+    portEXIT_CRITICAL(&perf_lock);
+}
@@ -0,0 +1,52 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+// Pipeline stages with timing histograms
+typedef enum {
+    PERF_STAGE_INPUTS,          // Polling the color sources
+    PERF_STAGE_TRANSITION,      // Interpolating one output frame
+    PERF_STAGE_LED_REFRESH,     // Writing the strip and onboard LED
+    PERF_STAGE_DISPLAY_RENDER,  // Drawing the display fields into GRAM
+    PERF_STAGE_DISPLAY_FLUSH,   // Sending the frame over I2C
+    PERF_STAGE_AUDIO_ANALYSIS,  // FFT and band levels of one audio frame
+    PERF_STAGE_COUNT,
+} perf_stage_t;
+
+// Frame counters (display frames: display_governor_get_stats)
+typedef enum {
+    PERF_COUNTER_LED_FRAMES,        // Strip refreshes sent
+    PERF_COUNTER_COUNT,
+} perf_counter_t;
+
+#define PERF_HIST_BUCKETS 16    // Power-of-two microsecond buckets: <2, <4, ... , >=32768
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[PERF_HIST_BUCKETS];
+} perf_stage_stats_t;
+
+// Start timing a stage
+static inline int64_t perf_begin(void)
+{
+    return esp_timer_get_time();
+}
+
+// Record the time since perf_begin
+void perf_end(perf_stage_t stage, int64_t start_us);
+
+void perf_count(perf_counter_t counter);
+
+void perf_get_stage(perf_stage_t stage, perf_stage_stats_t *stats);
+uint32_t perf_get_counter(perf_counter_t counter);
+const char *perf_stage_name(perf_stage_t stage);
+const char *perf_counter_name(perf_counter_t counter);
+
+// Clear all histograms and counters
+void perf_reset(void);
+
+#endif // PERF_H
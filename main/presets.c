@@ -0,0 +1,290 @@
+#include "presets.h"
+#include "main.h"
+#include "nvs.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+// NVS keys
+#define PRESET_KEY_STATE "state"
+#define PRESET_KEY_SLOT  "preset%d"
+
+// What a named preset slot holds
+typedef struct {
+    char name[PRESET_NAME_LEN];
+    picker_state_t state;
+} preset_entry_t;
+
+static picker_state_t pending_state;    // Latest reported state
+static picker_state_t stored_state;     // What NVS holds
+static bool stored_valid = false;
+static bool pending_dirty = false;
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t flush_timer = NULL;
+static TaskHandle_t writer_task = NULL;
+static SemaphoreHandle_t nvs_lock = NULL;  // Serializes NVS access between the writer and callers
+
+// The pending state up to (and including) state is in NVS. A report that
+// came in while it was written keeps the state dirty.
+static void mark_written(const picker_state_t *state)
+{
+    portENTER_CRITICAL(&state_lock);
+    if (memcmp(state, &pending_state, sizeof(*state)) == 0) {
+        pending_dirty = false;
+    }
+    portEXIT_CRITICAL(&state_lock);
+}
+
+// Write the pending state if it differs from the stored one. It stays dirty
+// until the commit succeeds, so a failed write is tried again.
+static esp_err_t write_pending_state(void)
+{
+    picker_state_t state;
+    bool dirty;
+    
+    portENTER_CRITICAL(&state_lock);
+    state = pending_state;
+    dirty = pending_dirty;
+    portEXIT_CRITICAL(&state_lock);
+    
+    if (!dirty) {
+        return ESP_OK;
+    }
+    if (stored_valid && memcmp(&state, &stored_state, sizeof(state)) == 0) {
+        mark_written(&state); // Nothing new; don't spend a flash write
+        return ESP_OK;
+    }
+    
+    xSemaphoreTake(nvs_lock, portMAX_DELAY);
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, PRESET_KEY_STATE, &state, sizeof(state));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (ret == ESP_OK) {
+        stored_state = state;
+        stored_valid = true;
+        mark_written(&state);
+        ESP_LOGI(TAG, "State saved");
+    } else {
+        // Still dirty: try again after another flush delay
+        ESP_LOGE(TAG, "Failed to save state: %s", esp_err_to_name(ret));
+        if (flush_timer) {
+            esp_timer_stop(flush_timer);
+            esp_timer_start_once(flush_timer, PRESET_STATE_FLUSH_DELAY_MS * 1000ULL);
+        }
+    }
+    xSemaphoreGive(nvs_lock);
+    return ret;
+}
+
+// Low-priority writer so flash erase/write never runs in the control loop
+static void preset_writer_task(void *pvParameter)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        write_pending_state();
+    }
+}
+
+// State has been stable for the flush delay
+static void flush_timer_cb(void *arg)
+{
+    xTaskNotifyGive(writer_task);
+}
+
+esp_err_t presets_init(picker_state_t *state, bool *restored)
+{
+    *restored = false;
+    
+    nvs_lock = xSemaphoreCreateMutex();
+    if (!nvs_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        size_t len = sizeof(stored_state);
+        if (nvs_get_blob(nvs, PRESET_KEY_STATE, &stored_state, &len) == ESP_OK && len == sizeof(stored_state)) {
+            stored_valid = true;
+            *state = stored_state;
+            *restored = true;
+        }
+        nvs_close(nvs);
+    }
+    pending_state = *state;
+    
+    if (xTaskCreate(preset_writer_task, "preset_writer", 3072, NULL, 1, &writer_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    const esp_timer_create_args_t timer_args = {
+        .callback = flush_timer_cb,
+        .name = "preset_flush",
+    };
+    return esp_timer_create(&timer_args, &flush_timer);
+}
+
+void presets_update_state(const picker_state_t *state)
+{
+    bool changed;
+    
+    portENTER_CRITICAL(&state_lock);
+    changed = memcmp(state, &pending_state, sizeof(*state)) != 0;
+    if (changed) {
+        pending_state = *state;
+        pending_dirty = true;
+    }
+    portEXIT_CRITICAL(&state_lock);
+    
+    // Every change pushes the write out again, so a moving knob never writes
+    if (changed && flush_timer) {
+        esp_timer_stop(flush_timer);
+        esp_timer_start_once(flush_timer, PRESET_STATE_FLUSH_DELAY_MS * 1000ULL);
+    }
+}
+
+esp_err_t presets_flush(void)
+{
+    if (flush_timer) {
+        esp_timer_stop(flush_timer);
+    }
+    return write_pending_state();
+}
+
+// Find the slot holding name, or the first free slot if free_slot is not NULL
+static int find_slot(nvs_handle_t nvs, const char *name, int *free_slot)
+{
+    if (free_slot) {
+        *free_slot = -1;
+    }
+    for (int i = 0; i < PRESET_MAX_COUNT; i++) {
+        char key[16];
+        preset_entry_t entry;
+        size_t len = sizeof(entry);
+        snprintf(key, sizeof(key), PRESET_KEY_SLOT, i);
+        if (nvs_get_blob(nvs, key, &entry, &len) != ESP_OK || len != sizeof(entry)) {
+            if (free_slot && *free_slot < 0) {
+                *free_slot = i;
+            }
+            continue;
+        }
+        if (strncmp(entry.name, name, PRESET_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t presets_save(const char *name, const picker_state_t *state)
+{
+    if (!name || !state || name[0] == '\0' || strlen(name) >= PRESET_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    xSemaphoreTake(nvs_lock, portMAX_DELAY);
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        int free_slot;
+        int slot = find_slot(nvs, name, &free_slot);
+        if (slot < 0) {
+            slot = free_slot;
+        }
+        if (slot < 0) {
+            ret = ESP_ERR_NO_MEM; // All slots used
+        } else {
+            preset_entry_t entry = { .state = *state };
+            char key[16];
+            strlcpy(entry.name, name, sizeof(entry.name));
+            snprintf(key, sizeof(key), PRESET_KEY_SLOT, slot);
+            ret = nvs_set_blob(nvs, key, &entry, sizeof(entry));
+            if (ret == ESP_OK) {
+                ret = nvs_commit(nvs);
+            }
+        }
+        nvs_close(nvs);
+    }
+    xSemaphoreGive(nvs_lock);
+    return ret;
+}
+
+esp_err_t presets_recall(const char *name, picker_state_t *state)
+{
+    if (!name || !state) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    xSemaphoreTake(nvs_lock, portMAX_DELAY);
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret == ESP_OK) {
+        int slot = find_slot(nvs, name, NULL);
+        if (slot < 0) {
+            ret = ESP_ERR_NOT_FOUND;
+        } else {
+            preset_entry_t entry;
+            size_t len = sizeof(entry);
+            char key[16];
+            snprintf(key, sizeof(key), PRESET_KEY_SLOT, slot);
+            ret = nvs_get_blob(nvs, key, &entry, &len);
+            if (ret == ESP_OK) {
+                *state = entry.state;
+            }
+        }
+        nvs_close(nvs);
+    }
+    xSemaphoreGive(nvs_lock);
+    return ret;
+}
+
+esp_err_t presets_delete(const char *name)
+{
+    xSemaphoreTake(nvs_lock, portMAX_DELAY);
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        int slot = find_slot(nvs, name, NULL);
+        if (slot < 0) {
+            ret = ESP_ERR_NOT_FOUND;
+        } else {
+            char key[16];
+            snprintf(key, sizeof(key), PRESET_KEY_SLOT, slot);
+            ret = nvs_erase_key(nvs, key);
+            if (ret == ESP_OK) {
+                ret = nvs_commit(nvs);
+            }
+        }
+        nvs_close(nvs);
+    }
+    xSemaphoreGive(nvs_lock);
+    return ret;
+}
+
+bool presets_get_name(int slot, char *name, size_t len)
+{
+    if (slot < 0 || slot >= PRESET_MAX_COUNT || !name || len == 0) {
+        return false;
+    }
+    
+    bool found = false;
+    xSemaphoreTake(nvs_lock, portMAX_DELAY);
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        preset_entry_t entry;
+        size_t entry_len = sizeof(entry);
+        char key[16];
+        snprintf(key, sizeof(key), PRESET_KEY_SLOT, slot);
+        if (nvs_get_blob(nvs, key, &entry, &entry_len) == ESP_OK && entry_len == sizeof(entry)) {
+            entry.name[PRESET_NAME_LEN - 1] = '\0';
+            strlcpy(name, entry.name, len);
+            found = true;
+        }
+        nvs_close(nvs);
+    }
+    xSemaphoreGive(nvs_lock);
+    return found;
+}
@@ -0,0 +1,43 @@
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Preset storage configuration
+#define PRESET_MAX_COUNT            8       // Named preset slots in NVS
+#define PRESET_NAME_LEN             16      // Including the terminating NUL
+#define PRESET_STATE_FLUSH_DELAY_MS 5000    // State must be stable this long before it is written
+
+// Everything that is restored at boot or recalled from a preset
+typedef struct {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t effect;             // Effect id, 0 = static color
+    uint8_t effect_speed;       // Effect-specific speed/parameter
+    bool onboard_led_active;    // Onboard LED mirrors the color
+} picker_state_t;
+
+// Load the last saved state and start the background writer.
+// Returns true in *restored if a saved state was found and copied to *state.
+esp_err_t presets_init(picker_state_t *state, bool *restored);
+
+// Report the current state. Cheap and flash-free: the state is written by a
+// background task once it has not changed for PRESET_STATE_FLUSH_DELAY_MS,
+// and only if it differs from what is already stored. Safe from any task.
+void presets_update_state(const picker_state_t *state);
+
+// Write any pending state immediately (e.g. before a restart)
+esp_err_t presets_flush(void);
+
+// Named presets
+esp_err_t presets_save(const char *name, const picker_state_t *state);
+esp_err_t presets_recall(const char *name, picker_state_t *state);
+esp_err_t presets_delete(const char *name);
+
+// Name of the preset in a slot; returns false for an empty slot
+bool presets_get_name(int slot, char *name, size_t len);
+
+#endif // PRESETS_H
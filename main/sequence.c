@@ -0,0 +1,366 @@
+#include "sequence.h"
+#include "main.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "transition.h"
+#include "strip_owner.h"
+#include "trace.h"
+
+#define RECORD_BYTES (SEQUENCE_RECORD_KB * 1024)
+
+static const esp_partition_t *partition = NULL;
+static const uint8_t *image = NULL;             // The partition, memory-mapped
+static esp_partition_mmap_handle_t image_handle;
+static const led_sequence_header_t *sequences[SEQUENCE_MAX_COUNT];
+static int count = 0;
+static size_t used = 0;                         // Bytes taken by the listed sequences
+
+// Player, under player_lock: the console starts and stops it, the task ticks it
+static SemaphoreHandle_t player_lock = NULL;
+static led_strip_t *player_strip = NULL;
+static led_sequence_target_t target;
+static led_sequence_t current;
+static volatile bool playing = false;
+static bool looping = false;
+static int64_t start_us = 0;                    // Time of the current pass's first frame
+static TaskHandle_t player_task_handle = NULL;
+static esp_timer_handle_t frame_timer = NULL;
+
+// Recorder, under record_lock: the transition task feeds it, the console saves it
+static SemaphoreHandle_t record_lock = NULL;
+#if CONFIG_PICKER_STATIC_MEMORY
+static uint8_t record_storage[RECORD_BYTES];
+#endif
+static uint8_t *record_buffer = NULL;          // From record to save: record_storage, or RECORD_BYTES from the heap
+static uint8_t record_frame[LED_COUNT * 3];
+static uint8_t record_previous[LED_COUNT * 3];
+static led_sequence_encoder_t encoder;
+static volatile bool recording = false;
+static int64_t record_last_us = 0;              // Time of the last recorded frame
+
+static void list_sequences(void)
+{
+    count = led_sequence_list(image, partition->size, sequences, SEQUENCE_MAX_COUNT);
+    used = 0;
+    for (int i = 0; i < count; i++) {
+        used += led_sequence_image_size(sequences[i]);
+    }
+}
+
+static void stop_locked(void)
+{
+    if (playing) {
+        esp_timer_stop(frame_timer);
+        player_strip->wait_refresh_done(player_strip, 10);
+        playing = false;
+        strip_owner_give(STRIP_OWNER_SEQUENCE);
+        ESP_LOGI(TAG, "Sequence %s stopped", current.header->name);
+    }
+}
+
+// Decode every frame that is due, then send the last one. Frames due
+// together (recordings are faster than the tick at times) are decoded in
+// order but only the result goes out.
+static void player_tick(void)
+{
+    const led_sequence_header_t *header = current.header;
+    uint32_t pixels = header->pixel_count < target.pixel_count ? header->pixel_count : target.pixel_count;
+    uint32_t duration_ms = header->duration_ms ? header->duration_ms : 1;
+    uint32_t now_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    bool changed = false;
+    bool ended = false;
+    int64_t start = trace_begin();
+    
+    for (;;) {
+        if (led_sequence_next_time(&current) <= now_ms) {
+            if (!changed) {
+                player_strip->wait_refresh_done(player_strip, 10);
+                player_strip->mark_dirty(player_strip, 0, pixels);
+                changed = true;
+            }
+            if (led_sequence_decode(&current, &target) == LED_SEQUENCE_CORRUPT) {
+                ESP_LOGE(TAG, "Sequence %s is corrupt at frame %lu", header->name, (unsigned long)current.frame);
+                ended = true;
+                break;
+            }
+        } else if (led_sequence_next_time(&current) == UINT32_MAX && now_ms >= duration_ms) {
+            if (!looping) {
+                ended = true;
+                break;
+            }
+            led_sequence_rewind(&current);
+            start_us += duration_ms * 1000LL;
+            now_ms -= duration_ms;
+        } else {
+            break;
+        }
+    }
+    
+    if (changed) {
+        player_strip->commit(player_strip);
+        player_strip->refresh_async(player_strip);
+        trace_end("sequence_frame", start);
+    }
+    if (ended) {
+        stop_locked();
+    }
+}
+
+static void player_task(void *pvParameter)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(player_lock, portMAX_DELAY);
+        if (playing) {
+            player_tick();
+        }
+        xSemaphoreGive(player_lock);
+    }
+}
+
+static void frame_timer_cb(void *arg)
+{
+    xTaskNotifyGive(player_task_handle);
+}
+
+esp_err_t sequence_init(led_strip_t *strip)
+{
+    if (!strip) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SEQUENCE_PARTITION);
+    if (!partition) {
+        ESP_LOGW(TAG, "No \"%s\" partition; sequence playback is off", SEQUENCE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // Mapped once: frames are read through the flash cache as they are played
+    const void *mapped;
+    esp_err_t ret = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &mapped, &image_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    image = mapped;
+    list_sequences();
+    
+    uint8_t *buffer;
+    led_strip_layout_t layout;
+    ret = strip->get_buffer(strip, &buffer, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    player_strip = strip;
+    target = (led_sequence_target_t){
+        .buffer = buffer,
+        .pixel_count = layout.pixel_count,
+        .bytes_per_pixel = layout.bytes_per_pixel,
+        .offset = { layout.red_offset, layout.green_offset, layout.blue_offset },
+    };
+    
+    player_lock = xSemaphoreCreateMutex();
+    record_lock = xSemaphoreCreateMutex();
+    if (!player_lock || !record_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Above the transition engine, like the other strip writers
+    if (xTaskCreate(player_task, "sequence", 3072, NULL, 7, &player_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = frame_timer_cb,
+        .name = "sequence",
+    };
+    ret = esp_timer_create(&timer_args, &frame_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "%d sequence(s) in flash, %lu KB free", count, (unsigned long)(sequence_free_space() / 1024));
+    return ESP_OK;
+}
+
+int sequence_count(void)
+{
+    return count;
+}
+
+const led_sequence_header_t *sequence_get(int index)
+{
+    return index >= 0 && index < count ? sequences[index] : NULL;
+}
+
+size_t sequence_free_space(void)
+{
+    return partition ? partition->size - used : 0;
+}
+
+esp_err_t sequence_play(int index, bool loop)
+{
+    if (!player_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (index < 0 || index >= count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    xSemaphoreTake(player_lock, portMAX_DELAY);
+    stop_locked();
+    
+    // A stream has the strip until it goes quiet
+    if (!strip_owner_take(STRIP_OWNER_SEQUENCE, pdMS_TO_TICKS(SEQUENCE_STRIP_WAIT_MS))) {
+        xSemaphoreGive(player_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    led_sequence_open(&current, sequences[index], partition->size - ((const uint8_t *)sequences[index] - image));
+    
+    // Pixels the sequence does not cover stay off
+    player_strip->wait_refresh_done(player_strip, 10);
+    player_strip->mark_dirty(player_strip, 0, target.pixel_count);
+    memset(target.buffer, 0, target.pixel_count * target.bytes_per_pixel);
+    player_strip->commit(player_strip);
+    looping = loop;
+    start_us = esp_timer_get_time();
+    playing = true;
+    esp_err_t ret = esp_timer_start_periodic(frame_timer, 1000000 / current.header->frame_rate_hz);
+    xSemaphoreGive(player_lock);
+    
+    // First frame now rather than a tick later
+    xTaskNotifyGive(player_task_handle);
+    ESP_LOGI(TAG, "Playing sequence %s (%lu frames, %lu ms%s)", current.header->name,
+             (unsigned long)current.header->frame_count, (unsigned long)current.header->duration_ms,
+             loop ? ", looping" : "");
+    return ret;
+}
+
+void sequence_stop(void)
+{
+    if (!player_lock) {
+        return;
+    }
+    xSemaphoreTake(player_lock, portMAX_DELAY);
+    stop_locked();
+    xSemaphoreGive(player_lock);
+}
+
+bool sequence_is_playing(void)
+{
+    return playing;
+}
+
+esp_err_t sequence_record_start(void)
+{
+    if (!record_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sequence_stop();
+    
+    xSemaphoreTake(record_lock, portMAX_DELAY);
+    if (!record_buffer) {
+#if CONFIG_PICKER_STATIC_MEMORY
+        record_buffer = record_storage;
+#else
+        record_buffer = malloc(RECORD_BYTES);
+#endif
+        if (!record_buffer) {
+            xSemaphoreGive(record_lock);
+            ESP_LOGE(TAG, "No memory for a %d KB recording buffer", SEQUENCE_RECORD_KB);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    led_sequence_encoder_init(&encoder, LED_COUNT, record_previous, record_buffer, RECORD_BYTES);
+    recording = true;
+    xSemaphoreGive(record_lock);
+    
+    // The color already shown is the first frame
+    transition_redraw();
+    ESP_LOGI(TAG, "Recording sequence (%d KB buffer)", SEQUENCE_RECORD_KB);
+    return ESP_OK;
+}
+
+void sequence_record_color(const color_rgb_t *color)
+{
+    if (!recording) {
+        return;
+    }
+    xSemaphoreTake(record_lock, portMAX_DELAY);
+    if (recording) {
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < LED_COUNT; i++) {
+            record_frame[i * 3] = color->r;
+            record_frame[i * 3 + 1] = color->g;
+            record_frame[i * 3 + 2] = color->b;
+        }
+        if (led_sequence_encode_frame(&encoder, record_frame, (uint32_t)((now - record_last_us) / 1000))) {
+            record_last_us = now;
+        } else {
+            // Keep what fits; it can still be saved
+            recording = false;
+            ESP_LOGW(TAG, "Recording buffer full after %lu frames", (unsigned long)encoder.frame_count);
+        }
+    }
+    xSemaphoreGive(record_lock);
+}
+
+bool sequence_is_recording(void)
+{
+    return recording;
+}
+
+esp_err_t sequence_record_save(const char *name)
+{
+    if (!record_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(record_lock, portMAX_DELAY);
+    recording = false;
+    if (!record_buffer || encoder.frame_count == 0) {
+        xSemaphoreGive(record_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // The last color is held until the recording was stopped
+    uint32_t hold_ms = (uint32_t)((esp_timer_get_time() - record_last_us) / 1000);
+    size_t size = led_sequence_encoder_finish(&encoder, name, SEQUENCE_RECORD_RATE_HZ, hold_ms, LED_SEQUENCE_FLAG_LOOP);
+    size_t sectors = (size + LED_SEQUENCE_ALIGN - 1) / LED_SEQUENCE_ALIGN * LED_SEQUENCE_ALIGN;
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (used + sectors <= partition->size) {
+        ret = esp_partition_erase_range(partition, used, sectors);
+        if (ret == ESP_OK) {
+            ret = esp_partition_write(partition, used, record_buffer, size);
+        }
+    }
+    
+    // The name as stored, which may be truncated; a heap buffer goes back
+    char saved_name[LED_SEQUENCE_NAME_LEN];
+    memcpy(saved_name, ((const led_sequence_header_t *)record_buffer)->name, sizeof(saved_name));
+    encoder.frame_count = 0;
+#if !CONFIG_PICKER_STATIC_MEMORY
+    free(record_buffer);
+#endif
+    record_buffer = NULL;
+    xSemaphoreGive(record_lock);
+    
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save sequence %s: %s", saved_name, esp_err_to_name(ret));
+        return ret;
+    }
+    list_sequences();
+    ESP_LOGI(TAG, "Saved sequence %s: %lu bytes", saved_name, (unsigned long)size);
+    return ESP_OK;
+}
+
+esp_err_t sequence_erase_all(void)
+{
+    if (!partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sequence_stop();
+    if (used == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = esp_partition_erase_range(partition, 0, used);
+    list_sequences();
+    return ret;
+}
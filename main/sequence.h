@@ -0,0 +1,51 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip.h"
+#include "led_sequence.h"
+#include "color_source.h"
+
+// Sequence playback configuration
+#define SEQUENCE_PARTITION       "sequences"    // Data partition label (partitions.csv)
+#define SEQUENCE_MAX_COUNT       32             // Sequences listed from the partition
+#define SEQUENCE_RECORD_RATE_HZ  100            // Playback tick of recordings, the transition frame rate
+#define SEQUENCE_STRIP_WAIT_MS   200            // Wait for the strip at play: a picker frame, not a stream
+
+// Map the sequences partition and start the player task. Sequences are
+// read in place from flash; only the strip buffer holds a frame.
+esp_err_t sequence_init(led_strip_t *strip);
+
+// Sequences in the partition, in the order they were added
+int sequence_count(void);
+const led_sequence_header_t *sequence_get(int index);
+
+// Bytes left in the partition for new sequences
+size_t sequence_free_space(void);
+
+// Play a sequence at its frame rate, from its first frame. Safe from any task.
+// ESP_ERR_INVALID_STATE while a serial or DMX stream has the strip.
+esp_err_t sequence_play(int index, bool loop);
+void sequence_stop(void);
+
+// True while a sequence plays; the player holds the strip (strip_owner.h)
+bool sequence_is_playing(void);
+
+// Record the colors shown on the strip into RAM, with their timing
+esp_err_t sequence_record_start(void);
+
+// Color being shown on the strip; cheap when not recording
+void sequence_record_color(const color_rgb_t *color);
+
+// Stop recording and add the recording to the partition
+esp_err_t sequence_record_save(const char *name);
+
+bool sequence_is_recording(void);
+
+// Erase every sequence in the partition
+esp_err_t sequence_erase_all(void);
+
+#endif // SEQUENCE_H
@@ -0,0 +1,202 @@
+#include "serial_stream.h"
+#include "main.h"
+#include "driver/uart.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "pixel_stream.h"
+#include "strip_owner.h"
+
+static led_strip_t *stream_strip = NULL;
+static uint32_t stream_pixels = 0;
+static pixel_stream_t stream;
+static QueueHandle_t uart_queue = NULL;
+
+static volatile bool streaming = false;
+static int64_t last_frame_us = 0;
+static int64_t frame_begin_us = 0;
+static int64_t read_time_us = 0;        // When the chunk being parsed was read
+static bool refresh_pending = false;
+
+static serial_stream_stats_t stats;
+static uint64_t latency_sum_us = 0;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Header accepted: the stream takes the strip with its first frame, the
+// previous frame must be out of the buffer before the payload overwrites
+// it, and the strip told which pixels it is about to get
+static void on_frame_begin(void *ctx)
+{
+    if (!streaming) {
+        strip_owner_take(STRIP_OWNER_SERIAL, portMAX_DELAY);
+        streaming = true;
+        ESP_LOGI(TAG, "Serial pixel stream started");
+    }
+    if (refresh_pending) {
+        stream_strip->wait_refresh_done(stream_strip, 10);
+        refresh_pending = false;
+    }
+    stream_strip->mark_dirty(stream_strip, 0, stream_pixels);
+    frame_begin_us = read_time_us;
+}
+
+static void on_frame_end(void *ctx, bool valid, pixel_stream_protocol_t protocol)
+{
+    stream_strip->commit(stream_strip);
+    if (!valid) {
+        return; // Counted by the parser; the buffer is not shown
+    }
+    
+    // Start sending and return to parsing; the wait happens at the next header
+    if (stream_strip->refresh_async(stream_strip) == ESP_OK) {
+        refresh_pending = true;
+    }
+    
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = (uint32_t)(now - frame_begin_us);
+    last_frame_us = now;
+    
+    portENTER_CRITICAL(&stats_lock);
+    stats.frames++;
+    stats.latency_last_us = latency;
+    if (latency > stats.latency_max_us) {
+        stats.latency_max_us = latency;
+    }
+    latency_sum_us += latency;
+    stats.latency_avg_us = (uint32_t)(latency_sum_us / stats.frames);
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void log_stats(void)
+{
+    serial_stream_stats_t s;
+    serial_stream_get_stats(&s);
+    ESP_LOGI(TAG, "Stream: %lu frames, %lu dropped, %lu overflows, latency %lu us (avg %lu, max %lu)",
+             (unsigned long)s.frames, (unsigned long)s.dropped_frames, (unsigned long)s.overflows,
+             (unsigned long)s.latency_last_us, (unsigned long)s.latency_avg_us, (unsigned long)s.latency_max_us);
+}
+
+static void serial_stream_task(void *pvParameter)
+{
+    static uint8_t chunk[SERIAL_STREAM_CHUNK];
+    int64_t last_stats_us = 0;
+    
+    // Adalight hosts wait for this greeting before sending
+    uart_write_bytes(SERIAL_STREAM_UART_NUM, "Ada\n", 4);
+    
+    for (;;) {
+        uart_event_t event;
+        if (xQueueReceive(uart_queue, &event, pdMS_TO_TICKS(100)) == pdTRUE) {
+            switch (event.type) {
+            case UART_DATA: {
+                size_t available = event.size;
+                while (available > 0) {
+                    int n = uart_read_bytes(SERIAL_STREAM_UART_NUM, chunk,
+                                            available < sizeof(chunk) ? available : sizeof(chunk), 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    read_time_us = esp_timer_get_time();
+                    pixel_stream_feed(&stream, chunk, n);
+                    available -= n;
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // Bytes are gone; drop the frame in progress and resynchronize
+                uart_flush_input(SERIAL_STREAM_UART_NUM);
+                xQueueReset(uart_queue);
+                pixel_stream_reset(&stream);
+                portENTER_CRITICAL(&stats_lock);
+                stats.overflows++;
+                portEXIT_CRITICAL(&stats_lock);
+                break;
+            default:
+                break;
+            }
+        }
+        
+        int64_t now = esp_timer_get_time();
+        if (streaming && now - last_frame_us > SERIAL_STREAM_TIMEOUT_MS * 1000LL) {
+            if (refresh_pending) {
+                stream_strip->wait_refresh_done(stream_strip, 10);
+                refresh_pending = false;
+            }
+            streaming = false;
+            strip_owner_give(STRIP_OWNER_SERIAL);
+            ESP_LOGI(TAG, "Serial pixel stream stopped");
+            log_stats();
+        } else if (streaming && now - last_stats_us > SERIAL_STREAM_STATS_MS * 1000LL) {
+            last_stats_us = now;
+            log_stats();
+        }
+    }
+}
+
+esp_err_t serial_stream_start(led_strip_t *strip)
+{
+    uint8_t *buffer;
+    led_strip_layout_t layout;
+    esp_err_t ret = strip->get_buffer(strip, &buffer, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    stream_strip = strip;
+    stream_pixels = layout.pixel_count;
+    
+    // Payload goes straight into the strip buffer in wire order
+    const pixel_stream_target_t target = {
+        .buffer = buffer,
+        .pixel_count = layout.pixel_count,
+        .bytes_per_pixel = layout.bytes_per_pixel,
+        .offset = { layout.red_offset, layout.green_offset, layout.blue_offset },
+    };
+    const pixel_stream_callbacks_t callbacks = {
+        .frame_begin = on_frame_begin,
+        .frame_end = on_frame_end,
+    };
+    pixel_stream_init(&stream, &target, &callbacks);
+    
+    const uart_config_t uart_config = {
+        .baud_rate = SERIAL_STREAM_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    ret = uart_driver_install(SERIAL_STREAM_UART_NUM, SERIAL_STREAM_RX_BUFFER, 0, 16, &uart_queue, 0);
+    if (ret == ESP_OK) {
+        ret = uart_param_config(SERIAL_STREAM_UART_NUM, &uart_config);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(SERIAL_STREAM_UART_NUM, SERIAL_STREAM_TX_PIN, SERIAL_STREAM_RX_PIN,
+                           UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Serial stream UART setup failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Above the transition engine so a frame is never held up by a fade
+    if (xTaskCreate(serial_stream_task, "serial_stream", 3072, NULL, 7, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "Serial pixel stream listening on UART%d at %d baud", SERIAL_STREAM_UART_NUM, SERIAL_STREAM_BAUD);
+    return ESP_OK;
+}
+
+bool serial_stream_is_active(void)
+{
+    return streaming;
+}
+
+void serial_stream_get_stats(serial_stream_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    out->dropped_frames = stream.stats.bad_frames;
+    out->skipped_bytes = stream.stats.skipped_bytes;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,33 @@
+#ifndef SERIAL_STREAM_H
+#define SERIAL_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip.h"
+
+// Serial streaming configuration
+#define SERIAL_STREAM_RX_BUFFER    4096    // UART driver ring buffer
+#define SERIAL_STREAM_CHUNK        256     // Bytes handed to the parser per read
+#define SERIAL_STREAM_TIMEOUT_MS   2000    // Streaming ends after this long without a valid frame
+#define SERIAL_STREAM_STATS_MS     5000    // Stats log interval while streaming
+
+typedef struct {
+    uint32_t frames;            // Frames shown
+    uint32_t dropped_frames;    // Bad checksum/end byte, or lost to an RX overflow
+    uint32_t overflows;         // UART FIFO or ring buffer overflows
+    uint32_t skipped_bytes;     // Bytes discarded while resynchronizing
+    uint32_t latency_last_us;   // Header received to refresh started
+    uint32_t latency_max_us;
+    uint32_t latency_avg_us;
+} serial_stream_stats_t;
+
+// Start receiving Adalight/TPM2 frames on SERIAL_STREAM_UART_NUM into the strip
+esp_err_t serial_stream_start(led_strip_t *strip);
+
+// True while frames are arriving; the stream holds the strip (strip_owner.h)
+bool serial_stream_is_active(void);
+
+void serial_stream_get_stats(serial_stream_stats_t *stats);
+
+#endif // SERIAL_STREAM_H
@@ -0,0 +1,44 @@
+#include "strip_owner.h"
+#include "main.h"
+#include "freertos/semphr.h"
+
+// A binary semaphore rather than a mutex: a sequence is started from the
+// console and ends in the player task, so the strip is not always given
+// back by the task that took it.
+
+static SemaphoreHandle_t owner_sem = NULL;
+static volatile strip_owner_t owner = STRIP_OWNER_NONE;
+
+esp_err_t strip_owner_init(void)
+{
+    owner_sem = xSemaphoreCreateBinary();
+    if (!owner_sem) {
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(owner_sem);
+    return ESP_OK;
+}
+
+bool strip_owner_take(strip_owner_t who, TickType_t ticks)
+{
+    if (!owner_sem || xSemaphoreTake(owner_sem, ticks) != pdTRUE) {
+        return false;
+    }
+    owner = who;
+    return true;
+}
+
+void strip_owner_give(strip_owner_t who)
+{
+    if (owner != who) {
+        ESP_LOGE(TAG, "Strip given back by %d while owned by %d", who, owner);
+        return;
+    }
+    owner = STRIP_OWNER_NONE;
+    xSemaphoreGive(owner_sem);
+}
+
+strip_owner_t strip_owner_get(void)
+{
+    return owner;
+}
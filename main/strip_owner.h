@@ -0,0 +1,32 @@
+#ifndef STRIP_OWNER_H
+#define STRIP_OWNER_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// One writer at a time on the main strip. The picker holds the strip for
+// one frame (write and refresh); a serial or DMX stream from its first
+// frame until it goes quiet, a sequence from play until it ends or is
+// stopped. Whoever holds it may fill the buffer and refresh; everyone else
+// keeps their hands off, so a frame is never mixed from two writers and
+// the driver's running channel sums match the buffer.
+
+typedef enum {
+    STRIP_OWNER_NONE,
+    STRIP_OWNER_PICKER,         // Transition engine frames
+    STRIP_OWNER_SERIAL,         // Serial pixel stream
+    STRIP_OWNER_DMX,            // E1.31 / Art-Net receiver
+    STRIP_OWNER_SEQUENCE,       // Sequence player
+} strip_owner_t;
+
+esp_err_t strip_owner_init(void);
+
+// Take the strip for owner, waiting up to ticks for the current owner to
+// give it back. Any task may give it back, not only the one that took it.
+bool strip_owner_take(strip_owner_t owner, TickType_t ticks);
+void strip_owner_give(strip_owner_t owner);
+
+strip_owner_t strip_owner_get(void);
+
+#endif // STRIP_OWNER_H
@@ -0,0 +1,172 @@
+// Check the transition engine's fixed-point OKLab conversion on the host.
+//
+// Converts every 24-bit sRGB color to OKLab and back with the code the
+// transition task runs (oklab.c) and reports the largest per-channel
+// error and how many colors miss by each amount. Black, white and the
+// primaries must come back exactly, and grays must have a and b near zero.
+// Also times both directions per color.
+//
+//     cc -O2 -I.. -o oklab_check oklab_check.c ../oklab.c -lm
+//     ./oklab_check              every 24-bit color
+//     ./oklab_check --step 5     every 5th level per channel (quick)
+//     ./oklab_check -v           print each color that misses the bound
+//
+// Exits 1 if any channel comes back more than 1 step off, or if an exact
+// color does not round-trip exactly.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "oklab.h"
+
+#define MAX_ERROR       1       // Steps a round trip may be off per channel
+#define GRAY_CHROMA     (1 << 6) // |a| and |b| bound for grays, Q16 (0.001)
+
+static int failures;
+static bool verbose;
+
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("  FAIL: " __VA_ARGS__);     \
+            printf("\n");                       \
+            failures++;                         \
+        }                                       \
+    } while (0)
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int round_trip_error(int r, int g, int b)
+{
+    uint8_t out[3];
+    oklab_t lab = oklab_from_srgb(r, g, b);
+    oklab_to_srgb(&lab, &out[0], &out[1], &out[2]);
+    int err = abs(out[0] - r);
+    if (abs(out[1] - g) > err) {
+        err = abs(out[1] - g);
+    }
+    if (abs(out[2] - b) > err) {
+        err = abs(out[2] - b);
+    }
+    return err;
+}
+
+static void check_cube(int step)
+{
+    static const int levels[] = {0, 255};
+    long histogram[MAX_ERROR + 2] = {0};
+    long colors = 0;
+    int worst = 0;
+    
+    for (int r = 0; r < 256; r += step) {
+        for (int g = 0; g < 256; g += step) {
+            for (int b = 0; b < 256; b += step) {
+                int err = round_trip_error(r, g, b);
+                histogram[err > MAX_ERROR ? MAX_ERROR + 1 : err]++;
+                colors++;
+                if (err > worst) {
+                    worst = err;
+                }
+                if (err > MAX_ERROR && verbose) {
+                    printf("  %02X%02X%02X off by %d\n", r, g, b, err);
+                }
+            }
+        }
+    }
+    printf("round trip: %ld colors, max error %d step(s)\n", colors, worst);
+    for (int i = 0; i <= MAX_ERROR + 1; i++) {
+        printf("  %s%d: %ld\n", i > MAX_ERROR ? ">" : "", i > MAX_ERROR ? MAX_ERROR : i, histogram[i]);
+    }
+    CHECK(worst <= MAX_ERROR, "round trip off by %d steps, bound %d", worst, MAX_ERROR);
+    
+    // Corners of the cube are where fades start and end most often
+    for (int i = 0; i < 8; i++) {
+        int r = levels[i & 1], g = levels[(i >> 1) & 1], b = levels[(i >> 2) & 1];
+        CHECK(round_trip_error(r, g, b) == 0, "corner %02X%02X%02X does not round-trip exactly", r, g, b);
+    }
+}
+
+static void check_grays(void)
+{
+    int32_t worst = 0;
+    int32_t last_L = -1;
+    bool monotonic = true;
+    
+    for (int v = 0; v < 256; v++) {
+        oklab_t lab = oklab_from_srgb(v, v, v);
+        int32_t chroma = abs(lab.a) > abs(lab.b) ? abs(lab.a) : abs(lab.b);
+        if (chroma > worst) {
+            worst = chroma;
+        }
+        monotonic &= lab.L > last_L;
+        last_L = lab.L;
+    }
+    printf("grays: max |a|,|b| %.5f, L %s\n", worst / 65536.0, monotonic ? "rising" : "NOT rising");
+    CHECK(worst <= GRAY_CHROMA, "gray chroma %.5f above %.5f", worst / 65536.0, GRAY_CHROMA / 65536.0);
+    CHECK(monotonic, "L does not rise with gray level");
+}
+
+static void time_conversions(void)
+{
+    enum { RUNS = 1 << 20 };
+    volatile uint32_t sink = 0;
+    uint32_t x = 1;
+    
+    double t0 = now_s();
+    for (int i = 0; i < RUNS; i++) {
+        x = x * 1664525u + 1013904223u;
+        oklab_t lab = oklab_from_srgb(x >> 24, x >> 16, x >> 8);
+        sink += lab.L;
+    }
+    double t1 = now_s();
+    for (int i = 0; i < RUNS; i++) {
+        x = x * 1664525u + 1013904223u;
+        oklab_t lab = { .L = (x >> 16) & 0xFFFF, .a = (int16_t)x >> 2, .b = (int16_t)(x >> 8) >> 2 };
+        uint8_t r, g, b;
+        oklab_to_srgb(&lab, &r, &g, &b);
+        sink += r + g + b;
+    }
+    double t2 = now_s();
+    (void)sink;
+    printf("time: to OKLab %.1f ns, to sRGB %.1f ns per color\n",
+           (t1 - t0) * 1e9 / RUNS, (t2 - t1) * 1e9 / RUNS);
+}
+
+int main(int argc, char **argv)
+{
+    int step = 1;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            step = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [--step N] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (step < 1 || step > 255) {
+        fprintf(stderr, "step must be 1-255\n");
+        return 2;
+    }
+    
+    oklab_init();
+    check_cube(step);
+    check_grays();
+    time_conversions();
+    
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "transition.h"
+#include "main.h"
+#include "esp_timer.h"
+#include "oklab.h"
+#include "perf.h"
+
+// Colors are interpolated in OKLab so fades keep an even brightness and hue
+// instead of dipping through muddy midpoints as RGB lerps do. The conversion
+// is fixed point (oklab.c).
+
+static portMUX_TYPE transition_lock = portMUX_INITIALIZER_UNLOCKED;
+static oklab_t from_lab, to_lab, current_lab;
+static color_rgb_t target_rgb;
+static int64_t start_us;
+static uint32_t duration_us;
+static bool active = false;
+
+static transition_output_t output_cb;
+static void *output_ctx;
+static TaskHandle_t transition_task_handle = NULL;
+static esp_timer_handle_t frame_timer = NULL;
+static volatile uint32_t frame_count = 0;
+static volatile bool redraw = false;
+
+static oklab_t rgb_to_oklab(const color_rgb_t *rgb)
+{
+    return oklab_from_srgb(rgb->r, rgb->g, rgb->b);
+}
+
+static color_rgb_t oklab_to_rgb(const oklab_t *lab)
+{
+    color_rgb_t rgb;
+    oklab_to_srgb(lab, &rgb.r, &rgb.g, &rgb.b);
+    return rgb;
+}
+
+static int32_t lerp_q16(int32_t a, int32_t b, int32_t t)
+{
+    return a + (int32_t)(((int64_t)(b - a) * t) >> 16);
+}
+
+static void frame_timer_cb(void *arg)
+{
+    xTaskNotifyGive(transition_task_handle);
+}
+
+// Renders one frame per timer tick while a transition is running
+static void transition_task(void *pvParameter)
+{
+    color_rgb_t last_output = target_rgb;
+    
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        color_rgb_t rgb;
+        bool done;
+        
+        portENTER_CRITICAL(&transition_lock);
+        int64_t elapsed = esp_timer_get_time() - start_us;
+        done = !active || elapsed >= duration_us;
+        if (done) {
+            current_lab = to_lab;
+            rgb = target_rgb; // Land exactly on the target, no rounding residue
+            active = false;
+        } else {
+            int32_t t = (int32_t)((elapsed << 16) / duration_us);
+            current_lab.L = lerp_q16(from_lab.L, to_lab.L, t);
+            current_lab.a = lerp_q16(from_lab.a, to_lab.a, t);
+            current_lab.b = lerp_q16(from_lab.b, to_lab.b, t);
+        }
+        oklab_t lab = current_lab;
+        portEXIT_CRITICAL(&transition_lock);
+        
+        if (!done) {
+            int64_t start = perf_begin();
+            rgb = oklab_to_rgb(&lab);
+            perf_end(PERF_STAGE_TRANSITION, start);
+        } else {
+            esp_timer_stop(frame_timer);
+            
+            // A target set while stopping saw the timer still running and relies on it
+            portENTER_CRITICAL(&transition_lock);
+            bool retargeted = active;
+            portEXIT_CRITICAL(&transition_lock);
+            if (retargeted) {
+                esp_timer_start_periodic(frame_timer, 1000000 / TRANSITION_FRAME_RATE_HZ);
+            }
+        }
+        
+        if (redraw || rgb.r != last_output.r || rgb.g != last_output.g || rgb.b != last_output.b) {
+            redraw = false;
+            output_cb(&rgb, output_ctx);
+            last_output = rgb;
+            frame_count++;
+        }
+    }
+}
+
+esp_err_t transition_init(const color_rgb_t *initial, transition_output_t output, void *ctx)
+{
+    if (!initial || !output) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    oklab_init();
+    output_cb = output;
+    output_ctx = ctx;
+    target_rgb = *initial;
+    current_lab = rgb_to_oklab(initial);
+    to_lab = current_lab;
+    
+    // Above the main loop so frames keep their pace while inputs are sampled
+    if (xTaskCreate(transition_task, "transition", 3072, NULL, 6, &transition_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    const esp_timer_create_args_t timer_args = {
+        .callback = frame_timer_cb,
+        .name = "transition",
+    };
+    return esp_timer_create(&timer_args, &frame_timer);
+}
+
+void transition_set_target(const color_rgb_t *target, uint32_t duration_ms)
+{
+    oklab_t lab = rgb_to_oklab(target);
+    
+    portENTER_CRITICAL(&transition_lock);
+    from_lab = current_lab;
+    to_lab = lab;
+    target_rgb = *target;
+    start_us = esp_timer_get_time();
+    duration_us = duration_ms * 1000;
+    active = true;
+    portEXIT_CRITICAL(&transition_lock);
+    
+    if (duration_ms == 0 || !esp_timer_is_active(frame_timer)) {
+        // Render the first frame now rather than a frame period later
+        xTaskNotifyGive(transition_task_handle);
+    }
+    if (duration_ms > 0 && !esp_timer_is_active(frame_timer)) {
+        esp_timer_start_periodic(frame_timer, 1000000 / TRANSITION_FRAME_RATE_HZ);
+    }
+}
+
+void transition_redraw(void)
+{
+    redraw = true;
+    xTaskNotifyGive(transition_task_handle);
+}
+
+uint32_t transition_get_frame_count(void)
+{
+    return frame_count;
+}
@@ -0,0 +1,29 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "color_source.h"
+
+// Transition engine configuration
+#define TRANSITION_FRAME_RATE_HZ   100     // Output frames per second while a transition runs
+#define TRANSITION_DURATION_MS     150     // Default fade time for manual color changes
+
+// Called from the transition task with each new output color
+typedef void (*transition_output_t)(const color_rgb_t *color, void *ctx);
+
+// Start the transition task; output is called only when the color changes
+esp_err_t transition_init(const color_rgb_t *initial, transition_output_t output, void *ctx);
+
+// Fade from the color currently shown to target. Safe from any task;
+// a new target mid-fade continues from wherever the fade has got to.
+void transition_set_target(const color_rgb_t *target, uint32_t duration_ms);
+
+// Output the current color again even if unchanged, e.g. after another
+// writer has used the strip
+void transition_redraw(void);
+
+// Frames rendered since start
+uint32_t transition_get_frame_count(void);
+
+#endif // TRANSITION_H
@@ -0,0 +1,6 @@
+// Placement attributes mean nothing on the host
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define DMA_ATTR
@@ -0,0 +1,9 @@
+// Capability-based allocation for host builds: plain calloc
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_8BIT     (1 << 2)
+
+#define heap_caps_calloc(n, size, caps) calloc(n, size)
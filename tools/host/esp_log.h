@@ -0,0 +1,18 @@
+// ESP-IDF logging for host builds: errors and warnings go to stderr when
+// host_log_verbose is set, the rest is dropped
+#pragma once
+
+#include <stdio.h>
+
+typedef enum { ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE } esp_log_level_t;
+
+extern int host_log_verbose;
+
+#define HOST_LOG(letter, tag, fmt, ...) \
+    do { if (host_log_verbose) fprintf(stderr, letter " (%s) " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { } while (0)
+#define ESP_LOG_BUFFER_HEX_LEVEL(tag, buf, len, level) do { } while (0)
@@ -0,0 +1,44 @@
+// FreeRTOS for host builds of the components: one task and a virtual clock.
+// Nothing can give a semaphore while the only task waits for it, except
+// simulated bus hardware finishing queued transactions in host_idle_hook
+// (NULL when there is none). A take that still fails advances host_now_ms
+// by its timeout, as a real wait would, and a take that would block
+// forever aborts. A tool that uses semaphores or delays defines
+// host_now_ms and host_idle_hook.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       ((TickType_t)UINT32_MAX)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))      // 1 kHz tick
+
+extern uint32_t host_now_ms;
+extern void (*host_idle_hook)(void);
+
+typedef struct {
+    UBaseType_t count;
+    UBaseType_t max;
+} StaticSemaphore_t;
+
+// Single task: the spinlock only has to exist, at the target's size
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZE(mux)     ((mux)->owner = 0)
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+
+// Nothing else runs on the host, so a yield requested by an ISR is counted
+extern uint32_t host_isr_yields;
+#define portYIELD_FROM_ISR()    (host_isr_yields++)
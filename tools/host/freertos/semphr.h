@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t host_semaphore(StaticSemaphore_t *buf, UBaseType_t max, UBaseType_t count)
+{
+    buf->max = max;
+    buf->count = count;
+    return buf;
+}
+
+#define xSemaphoreCreateMutexStatic(buf)                    host_semaphore(buf, 1, 1)
+#define xSemaphoreCreateBinaryStatic(buf)                   host_semaphore(buf, 1, 0)
+#define xSemaphoreCreateCountingStatic(max, count, buf)     host_semaphore(buf, max, count)
+#define vSemaphoreDelete(sem)                               ((void)(sem))
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if (sem->count == 0 && host_idle_hook) {
+        host_idle_hook();
+    }
+    if (sem->count > 0) {
+        sem->count--;
+        return pdTRUE;
+    }
+    if (ticks == portMAX_DELAY) {
+        fprintf(stderr, "semaphore taken forever with nothing left to give it\n");
+        abort();
+    }
+    host_now_ms += ticks;
+    return pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (sem->count >= sem->max) {
+        return pdFALSE;
+    }
+    sem->count++;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
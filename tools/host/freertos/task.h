@@ -0,0 +1,8 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    host_now_ms += ticks;
+}
@@ -0,0 +1,9 @@
+// The C library's sys/cdefs.h plus the container macro ESP-IDF adds to it
+#pragma once
+
+#include_next <sys/cdefs.h>
+#include <stddef.h>
+
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif